@@ -0,0 +1,61 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Number of heap allocations made so far, counted by the operator new override in BenchMain.cpp.
+uint64_t allocationCount();
+
+//Collects the results of one benchmark function.
+class Bench {
+    public:
+        typedef void (*Function)(Bench& bench);
+
+        struct Result {
+            std::string metric;
+            double value;
+            std::string unit;
+        };
+
+        struct Entry {
+            const char* name;
+            Function function;
+        };
+
+        static std::vector<Entry>& registry();
+        static int direction(const std::string& unit);
+
+        std::vector<Result> results;
+
+        void report(const std::string& metric, double value, const std::string& unit) {
+            results.push_back({ metric, value, unit });
+        }
+
+        static double now() {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+};
+
+//Adds a benchmark function to the registry before main runs.
+struct BenchRegistrar {
+    BenchRegistrar(const char* name, Bench::Function function) {
+        Bench::registry().push_back({ name, function });
+    }
+};
+
+#define BENCHMARK(name) \
+    static void name(Bench& bench); \
+    static BenchRegistrar name##_registrar(#name, name); \
+    static void name(Bench& bench)
+
+extern volatile size_t benchSink;
+
+//Stops the optimiser discarding a value that is only computed for timing.
+inline void keep(size_t value) {
+    benchSink = value;
+}
+
+#endif
@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+
+#include "Bench.h"
+
+static std::atomic<uint64_t> allocations(0);
+volatile size_t benchSink = 0;
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+std::vector<Bench::Entry>& Bench::registry() {
+    static std::vector<Entry> entries;
+    return entries;
+}
+
+/**
+ * Which way a metric should move, judged by its unit.
+ * @return 1 if higher is better (rates, delivery percentages), -1 if lower is better (times, sizes, allocations, draw
+ *         calls), 0 for counts that only describe the run and are not compared.
+ */
+int Bench::direction(const std::string& unit) {
+    if (unit == "particles" || unit == "%" || (unit.size() > 2 && unit.compare(unit.size() - 2, 2, "/s") == 0)) {
+        return 1;
+    }
+    static const char* lowerIsBetter[] = { "ns", "us", "ms", "ns/snapshot", "allocs", "allocs/frame", "calls/frame", "B" };
+    for (const char* lower : lowerIsBetter) {
+        if (unit == lower) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+//One result, named benchmark.metric as printed and written to JSON.
+struct Measurement {
+    std::string name;
+    double value;
+    std::string unit;
+};
+
+/**
+ * Keeps the best of repeated runs of a metric, or the latest if it has no direction. Results stay
+ * in the order the benchmark reported them.
+ */
+static void keepBest(std::vector<Measurement>& results, const std::string& name, const Bench::Result& r) {
+    int direction = Bench::direction(r.unit);
+    for (Measurement& kept : results) {
+        if (kept.name == name) {
+            if (direction == 0 || (direction > 0 && r.value > kept.value) || (direction < 0 && r.value < kept.value)) {
+                kept.value = r.value;
+            }
+            return;
+        }
+    }
+    results.push_back(Measurement{ name, r.value, r.unit });
+}
+
+static std::string escapeJson(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+/**
+ * Writes results as JSON, one result object per line so readJson() and diffs stay simple.
+ * @return false if the file could not be written.
+ */
+static bool writeJson(const std::string& path, const std::vector<Measurement>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "Could not write " << path << std::endl;
+        return false;
+    }
+    out << "{\n  \"results\": [\n";
+    size_t i = 0;
+    for (const Measurement& result : results) {
+        char value[64];
+        snprintf(value, sizeof(value), "%.17g", result.value);
+        out << "    { \"name\": \"" << escapeJson(result.name) << "\", \"value\": " << value
+            << ", \"unit\": \"" << escapeJson(result.unit) << "\" }" << (++i < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+/**
+ * Extracts a string field from one line written by writeJson().
+ */
+static bool jsonString(const std::string& line, const char* field, std::string& value) {
+    std::string key = std::string("\"") + field + "\": \"";
+    size_t start = line.find(key);
+    if (start == std::string::npos) {
+        return false;
+    }
+    value.clear();
+    for (size_t i = start + key.size(); i < line.size(); i++) {
+        if (line[i] == '\\' && i + 1 < line.size()) {
+            value += line[++i];
+        }
+        else if (line[i] == '"') {
+            return true;
+        }
+        else {
+            value += line[i];
+        }
+    }
+    return false;
+}
+
+/**
+ * Reads results written by writeJson(), e.g. from a run before a change.
+ * @return false if the file could not be read or held no results.
+ */
+static bool readJson(const std::string& path, std::map<std::string, Measurement>& results) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "Could not read " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string name, unit;
+        size_t valueAt = line.find("\"value\": ");
+        if (!jsonString(line, "name", name) || !jsonString(line, "unit", unit) || valueAt == std::string::npos) {
+            continue;
+        }
+        results[name] = Measurement{ name, std::strtod(line.c_str() + valueAt + 9, nullptr), unit };
+    }
+    if (results.empty()) {
+        std::cout << path << " holds no benchmark results" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Prints how each metric moved against the baseline and flags those that got worse by more than
+ * the threshold. Metrics missing from either run are listed but never count as regressions; with a
+ * filter, only the baseline's metrics matching it are expected.
+ * @return number of regressions.
+ */
+static int compare(const std::map<std::string, Measurement>& baseline, const std::vector<Measurement>& current, const char* filter, double thresholdPct) {
+    int regressions = 0;
+    printf("\nAgainst baseline, threshold %.1f%%:\n", thresholdPct);
+    for (const Measurement& result : current) {
+        auto base = baseline.find(result.name);
+        int direction = Bench::direction(result.unit);
+        if (base == baseline.end()) {
+            printf("  new        %s: %g %s\n", result.name.c_str(), result.value, result.unit.c_str());
+            continue;
+        }
+        if (direction == 0) {
+            continue;
+        }
+        double was = base->second.value;
+        double now = result.value;
+        double changePct = was != 0 ? (now - was) / was * 100 : (now != 0 ? 100.0 : 0.0);
+        double worsePct = -direction * changePct; //positive when the metric moved the wrong way
+        const char* verdict = "ok        ";
+        if (worsePct > thresholdPct) {
+            verdict = "REGRESSED ";
+            regressions++;
+        }
+        else if (-worsePct > thresholdPct) {
+            verdict = "improved  ";
+        }
+        printf("  %s %s: %g -> %g %s (%+.1f%%)\n", verdict, result.name.c_str(), was, now, result.unit.c_str(), changePct);
+    }
+    for (const auto& base : baseline) {
+        bool found = std::any_of(current.begin(), current.end(), [&](const Measurement& m) { return m.name == base.first; });
+        if (!found && (filter == nullptr || base.first.find(filter) != std::string::npos)) {
+            printf("  missing    %s\n", base.first.c_str());
+        }
+    }
+    printf("%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+    return regressions;
+}
+
+/**
+ * Runs every registered benchmark, or only those whose name contains FILTER.
+ * pong_bench [FILTER] [--repeat N] [--json FILE] [--compare BASELINE] [--threshold PCT]
+ * --repeat N runs each benchmark N times and keeps the best value of each metric, to steady
+ *   the numbers before comparing.
+ * --json FILE writes the results as JSON.
+ * --compare BASELINE reads results written by --json from an earlier run and reports every
+ *   time, rate, size, allocation or draw call metric that got worse by more than --threshold
+ *   percent, 10 by default. The exit code is 1 if any did, so it can gate a build.
+ * --list prints the benchmark names.
+ */
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    std::string jsonPath, baselinePath;
+    double thresholdPct = 10;
+    int repeat = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        }
+        else if (arg == "--compare" && hasValue) {
+            baselinePath = argv[++i];
+        }
+        else if (arg == "--threshold" && hasValue) {
+            thresholdPct = std::atof(argv[++i]);
+        }
+        else if (arg == "--repeat" && hasValue) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--list") {
+            for (const Bench::Entry& entry : Bench::registry()) {
+                std::cout << entry.name << std::endl;
+            }
+            return 0;
+        }
+        else if (arg.compare(0, 2, "--") != 0 && filter == nullptr) {
+            filter = argv[i];
+        }
+        else {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    std::map<std::string, Measurement> baseline;
+    if (!baselinePath.empty() && !readJson(baselinePath, baseline)) {
+        return 2;
+    }
+
+    std::vector<Measurement> results;
+    for (const Bench::Entry& entry : Bench::registry()) {
+        if (filter != nullptr && std::strstr(entry.name, filter) == nullptr) {
+            continue;
+        }
+        std::vector<Measurement> best;
+        for (int run = 0; run < repeat; run++) {
+            Bench bench;
+            entry.function(bench);
+            for (const Bench::Result& r : bench.results) {
+                keepBest(best, std::string(entry.name) + "." + r.metric, r);
+            }
+        }
+        for (const Measurement& result : best) {
+            std::cout << result.name << ": " << result.value << " " << result.unit << std::endl;
+        }
+        results.insert(results.end(), best.begin(), best.end());
+    }
+
+    if (!jsonPath.empty() && !writeJson(jsonPath, results)) {
+        return 2;
+    }
+    if (!baselinePath.empty() && compare(baseline, results, filter, thresholdPct) > 0) {
+        return 1;
+    }
+    return 0;
+}
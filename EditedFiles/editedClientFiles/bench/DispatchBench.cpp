@@ -0,0 +1,178 @@
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Bench.h"
+#include "CommandTable.h"
+#include "Message.h"
+
+//Server traffic as on_receive sees it, already split by parseMessage. GAME_DATA dominates.
+static const char* sampleMessages[] = {
+    "GAME_DATA,270,270,395,295,0WIN,0,0",
+    "GAME_DATA,262,270,401,301,0WIN,-1,0",
+    "GAME_DATA,255,278,407,307,0WIN,-1,1",
+    "BALL_HIT_BAT1",
+    "GAME_DATA,247,286,413,313,0WIN,0,1",
+    "HIT_WALL_UP",
+    "GAME_DATA,240,294,419,319,0WIN,0,0",
+    "HIT_WALL_LEFT,3,4",
+    "COUNT,2",
+    "CONN_CHECK",
+};
+static const size_t sampleCount = sizeof(sampleMessages) / sizeof(sampleMessages[0]);
+static const size_t messagesPerRun = 2000000;
+
+//Stands in for MyGame: the handlers only fold their decoded arguments into a checksum.
+struct DispatchTarget {
+    size_t checksum = 0;
+
+    void onGameData(const MessageArgs& args) {
+        int p1y, p2y, bx, by;
+        std::string_view win;
+        if (decodeArgs(args, p1y, p2y, bx, by, win)) {
+            checksum += p1y + p2y + bx + by + win.size();
+        }
+    }
+    void onEvent(const MessageArgs&) {
+        checksum++;
+    }
+    void onScore(const MessageArgs& args) {
+        int one, two;
+        if (decodeArgs(args, one, two)) {
+            checksum += one + two;
+        }
+    }
+    void onCount(const MessageArgs& args) {
+        int count;
+        if (decodeArgs(args, count)) {
+            checksum += count;
+        }
+    }
+};
+
+typedef void (DispatchTarget::*TargetHandler)(const MessageArgs& args);
+
+static constexpr CommandEntry<TargetHandler> TARGET_HANDLERS[] = {
+    { "GAME_DATA", 5, 7, false, &DispatchTarget::onGameData },
+    { "BALL_HIT_BAT1", 0, 0, true, &DispatchTarget::onEvent },
+    { "BALL_HIT_BAT2", 0, 0, true, &DispatchTarget::onEvent },
+    { "HIT_WALL_UP", 0, 0, true, &DispatchTarget::onEvent },
+    { "HIT_WALL_DOWN", 0, 0, true, &DispatchTarget::onEvent },
+    { "HIT_WALL_LEFT", 2, 2, true, &DispatchTarget::onScore },
+    { "HIT_WALL_RIGHT", 2, 2, true, &DispatchTarget::onScore },
+    { "ROLE", 1, 1, true, &DispatchTarget::onCount },
+    { "COUNT", 1, 1, true, &DispatchTarget::onCount },
+    { "CONN_CHECK", 0, 0, true, &DispatchTarget::onEvent },
+    { "WIRE", 1, 1, true, &DispatchTarget::onEvent },
+};
+static constexpr CommandTable targetHandlers(TARGET_HANDLERS);
+static_assert(targetHandlers.isPerfect(), "no collision-free seed for TARGET_HANDLERS");
+
+/**
+ * Splits every sample once up front so the timed loops measure dispatch and decoding only.
+ */
+static void parseSamples(std::vector<std::string_view>& cmds, std::vector<MessageArgs>& args) {
+    cmds.resize(sampleCount);
+    args.resize(sampleCount);
+    for (size_t i = 0; i < sampleCount; i++) {
+        parseMessage(sampleMessages[i], cmds[i], args[i]);
+    }
+}
+
+/**
+ * The previous on_receive: a cmd.find scan for each command in turn and stoi on owned copies.
+ */
+BENCHMARK(dispatch_find_chain_legacy) {
+    std::vector<std::string_view> cmds;
+    std::vector<MessageArgs> args;
+    parseSamples(cmds, args);
+    size_t checksum = 0;
+
+    double start = Bench::now();
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        std::string_view cmd = cmds[i % sampleCount];
+        const MessageArgs& a = args[i % sampleCount];
+        if (cmd.find("GAME_DATA") != std::string_view::npos && a.size() >= 5) {
+            checksum += std::stoi(std::string(a[0])) + std::stoi(std::string(a[1]))
+                + std::stoi(std::string(a[2])) + std::stoi(std::string(a[3])) + a[4].size();
+        }
+        if (cmd.find("BALL_HIT_BAT") != std::string_view::npos) {
+            checksum++;
+        }
+        if (cmd.find("HIT_WALL") != std::string_view::npos) {
+            checksum++;
+            if (a.size() == 2) {
+                checksum += std::stoi(std::string(a[0])) + std::stoi(std::string(a[1]));
+            }
+        }
+        if (cmd.find("ROLE") != std::string_view::npos && !a.empty()) {
+            checksum += std::stoi(std::string(a[0]));
+        }
+        if (cmd.find("COUNT") != std::string_view::npos && !a.empty()) {
+            checksum += std::stoi(std::string(a[0]));
+        }
+        if (cmd.find("CONN_CHECK") != std::string_view::npos) {
+            checksum++;
+        }
+    }
+    double elapsed = Bench::now() - start;
+    keep(checksum);
+
+    bench.report("ns_per_message", elapsed * 1e9 / messagesPerRun, "ns");
+}
+
+/**
+ * The table path on_receive uses now: one perfect-hash lookup, the argument count check, then
+ * the handler decodes with from_chars.
+ */
+BENCHMARK(dispatch_command_table) {
+    std::vector<std::string_view> cmds;
+    std::vector<MessageArgs> args;
+    parseSamples(cmds, args);
+    DispatchTarget target;
+    size_t rejected = 0;
+
+    uint64_t allocsBefore = allocationCount();
+    double start = Bench::now();
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        const MessageArgs& a = args[i % sampleCount];
+        const CommandEntry<TargetHandler>* entry = targetHandlers.find(cmds[i % sampleCount]);
+        if (entry == nullptr || a.size() < entry->minArgs || a.size() > entry->maxArgs) {
+            rejected++;
+            continue;
+        }
+        (target.*entry->handler)(a);
+    }
+    double elapsed = Bench::now() - start;
+    uint64_t allocs = allocationCount() - allocsBefore;
+    keep(target.checksum + rejected);
+
+    bench.report("ns_per_message", elapsed * 1e9 / messagesPerRun, "ns");
+    bench.report("allocs_per_message", (double)allocs / messagesPerRun, "allocs");
+    bench.report("messages_rejected", (double)rejected, "msg");
+}
+
+/**
+ * The lookup alone, including names that must miss: near misses of real commands and
+ * commands the old substring scan would have matched.
+ */
+BENCHMARK(dispatch_lookup_only) {
+    static const std::string_view names[] = {
+        "GAME_DATA", "HIT_WALL_LEFT", "COUNT", "ROLE", "CONN_CHECK",
+        "GAME_DAT", "ROLES", "HIT_WALL", "PONG", "XCOUNT",
+    };
+    const size_t nameCount = sizeof(names) / sizeof(names[0]);
+    size_t hits = 0;
+
+    double start = Bench::now();
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        if (targetHandlers.find(names[i % nameCount]) != nullptr) {
+            hits++;
+        }
+    }
+    double elapsed = Bench::now() - start;
+    keep(hits);
+
+    bench.report("ns_per_lookup", elapsed * 1e9 / messagesPerRun, "ns");
+    bench.report("hits", (double)hits, "lookups");
+}
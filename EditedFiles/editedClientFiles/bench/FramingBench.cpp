@@ -0,0 +1,113 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "Framing.h"
+#include "Message.h"
+
+//A representative mix of server traffic, dominated by per-tick GAME_DATA.
+static const char* sampleMessages[] = {
+    "GAME_DATA,270,270,395,295,0WIN,",
+    "GAME_DATA,262,270,401,301,0WIN,",
+    "GAME_DATA,255,278,407,307,0WIN,",
+    "GAME_DATA,247,286,413,313,0WIN,",
+    "HIT_WALL_UP",
+    "GAME_DATA,240,294,419,319,0WIN,",
+    "HIT_WALL_LEFT,3,4",
+    "COUNT,2",
+};
+static const size_t sampleCount = sizeof(sampleMessages) / sizeof(sampleMessages[0]);
+static const size_t messagesPerRun = 200000;
+
+/**
+ * The original on_receive parse: one read is assumed to be one message, split with strtok into
+ * a vector of owned strings.
+ */
+BENCHMARK(framing_strtok_legacy) {
+    char message[1024];
+    size_t checksum = 0;
+
+    uint64_t allocsBefore = allocationCount();
+    double start = Bench::now();
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        std::strcpy(message, sampleMessages[i % sampleCount]);
+
+        char* pch = std::strtok(message, ",");
+        std::string cmd(pch);
+        std::vector<std::string> args;
+        while (pch != NULL) {
+            pch = std::strtok(NULL, ",");
+            if (pch != NULL) {
+                args.push_back(std::string(pch));
+            }
+        }
+        checksum += cmd.size() + args.size();
+    }
+    double elapsed = Bench::now() - start;
+    uint64_t allocs = allocationCount() - allocsBefore;
+    keep(checksum);
+
+    bench.report("messages_per_sec", messagesPerRun / elapsed, "msg/s");
+    bench.report("allocs_per_message", (double)allocs / messagesPerRun, "allocs");
+}
+
+/**
+ * The framed path: the same messages sent back to back as one stream and delivered in reads of
+ * varying size, so frames are both merged and split across reads.
+ */
+BENCHMARK(framing_ring_views) {
+    std::vector<char> stream;
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        const char* m = sampleMessages[i % sampleCount];
+        char frame[FRAME_HEADER_SIZE + 64];
+        size_t length = encodeFrame(frame, sizeof(frame), m);
+        stream.insert(stream.end(), frame, frame + length);
+    }
+
+    FrameReader reader;
+    std::string_view payload;
+    std::string_view cmd;
+    MessageArgs args;
+    size_t checksum = 0;
+    size_t received = 0;
+    size_t offset = 0;
+    unsigned int seed = 12345;
+
+    //warm the ring up so growth is not counted against steady state
+    size_t warm;
+    reader.prepareWrite(4096, warm);
+
+    uint64_t allocsBefore = allocationCount();
+    double start = Bench::now();
+    while (offset < stream.size()) {
+        seed = seed * 1103515245 + 12345;
+        size_t chunk = 1 + (seed >> 16) % 1460; //anything up to one ethernet segment
+
+        size_t writable;
+        char* buffer = reader.prepareWrite(1024, writable);
+        if (chunk > writable) {
+            chunk = writable;
+        }
+        if (chunk > stream.size() - offset) {
+            chunk = stream.size() - offset;
+        }
+        std::memcpy(buffer, stream.data() + offset, chunk);
+        reader.commitWrite(chunk);
+        offset += chunk;
+
+        while (reader.next(payload)) {
+            if (parseMessage(payload, cmd, args)) {
+                checksum += cmd.size() + args.size();
+                received++;
+            }
+        }
+    }
+    double elapsed = Bench::now() - start;
+    uint64_t allocs = allocationCount() - allocsBefore;
+    keep(checksum);
+
+    bench.report("messages_per_sec", received / elapsed, "msg/s");
+    bench.report("allocs_per_message", (double)allocs / received, "allocs");
+    bench.report("messages_lost", (double)(messagesPerRun - received), "msg");
+}
@@ -0,0 +1,323 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_ttf.h"
+#include "SDL_mixer.h"
+#include "SDL_image.h"
+
+#include "Bench.h"
+#include "MatchWall.h"
+#include "MyGame.h"
+#include "SpriteBatch.h"
+#include "TextCache.h"
+
+static const float frameTime = 1.0f / 60;
+static const char* fontPath = "../res/font/pong.ttf"; //the client's asset root, run from the build directory
+
+//Server traffic as on_receive sees it. GAME_DATA dominates.
+static const char* sampleMessages[] = {
+    "GAME_DATA,270,270,395,295,0WIN,0,0",
+    "GAME_DATA,262,270,401,301,0WIN,-1,0",
+    "GAME_DATA,255,278,407,307,0WIN,-1,1",
+    "BALL_HIT_BAT1",
+    "GAME_DATA,247,286,413,313,0WIN,0,1",
+    "HIT_WALL_UP",
+    "GAME_DATA,240,294,419,319,0WIN,0,0",
+    "HIT_WALL_LEFT,3,4",
+    "COUNT,2",
+    "CONN_CHECK",
+};
+static const size_t sampleCount = sizeof(sampleMessages) / sizeof(sampleMessages[0]);
+
+/**
+ * A software renderer drawing into an 800x600 surface, the client's window size, with SDL_ttf,
+ * SDL_image and a dummy audio device initialised, so whole frames can be drawn with no window.
+ */
+class OffscreenScreen {
+    private:
+        SDL_Surface* target = nullptr;
+        SDL_Renderer* renderer = nullptr;
+
+    public:
+        OffscreenScreen() {
+            SDL_setenv("SDL_AUDIODRIVER", "dummy", 1);
+            if (SDL_Init(SDL_INIT_AUDIO) == 0) {
+                Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048);
+            }
+            TTF_Init();
+            IMG_Init(IMG_INIT_PNG);
+            target = SDL_CreateRGBSurfaceWithFormat(0, 800, 600, 32, SDL_PIXELFORMAT_RGBA32);
+            if (target != nullptr) {
+                renderer = SDL_CreateSoftwareRenderer(target);
+            }
+            if (renderer != nullptr) {
+                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+            }
+        }
+        ~OffscreenScreen() {
+            if (renderer != nullptr) {
+                SDL_DestroyRenderer(renderer);
+            }
+            if (target != nullptr) {
+                SDL_FreeSurface(target);
+            }
+            Mix_CloseAudio();
+            IMG_Quit();
+            TTF_Quit();
+            SDL_Quit();
+        }
+
+        SDL_Renderer* getRenderer() const {
+            return renderer;
+        }
+};
+
+/**
+ * The real MyGame::on_receive, headless, so handlers do everything but play sounds. Replies to
+ * CONN_CHECK are drained as the send thread would.
+ */
+BENCHMARK(game_on_receive) {
+    const size_t messagesPerRun = 2000000;
+    MyGame game(true);
+    game.setLogging(false);
+    game.setup(nullptr);
+
+    std::vector<std::string_view> cmds(sampleCount);
+    std::vector<MessageArgs> args(sampleCount);
+    for (size_t i = 0; i < sampleCount; i++) {
+        parseMessage(sampleMessages[i], cmds[i], args[i]);
+    }
+
+    ClientCommand reply;
+    uint64_t allocsBefore = allocationCount();
+    double start = Bench::now();
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        size_t sample = i % sampleCount;
+        game.on_receive(cmds[sample], args[sample]);
+        while (game.nextOutbound(reply)) {
+        }
+    }
+    double seconds = Bench::now() - start;
+    uint64_t allocs = allocationCount() - allocsBefore;
+
+    bench.report("per_message", seconds / messagesPerRun * 1e9, "ns");
+    bench.report("messages_per_second", messagesPerRun / seconds, "msg/s");
+    bench.report("allocs_per_message", (double)allocs / messagesPerRun, "allocs");
+    bench.report("messages_rejected", (double)game.getRejectedMessages(), "msg");
+}
+
+/**
+ * Draws of a string through TextCache on a software renderer: a cached string, a changing
+ * counter from the glyph atlas, the same through a SpriteBatch, and rasterizing every draw as
+ * drawText did before caching.
+ */
+BENCHMARK(text_draw) {
+    OffscreenScreen screen;
+    SDL_Renderer* renderer = screen.getRenderer();
+    TTF_Font* font = renderer != nullptr ? TTF_OpenFont(fontPath, 18) : nullptr;
+    if (font == nullptr) {
+        bench.report("skipped_no_renderer_or_font", 1, "");
+        return;
+    }
+    const SDL_Color white{ 255, 255, 255, 255 };
+    const int drawsPerRun = 20000;
+    char counter[64];
+
+    auto run = [&](const char* name, int draws, auto draw) {
+        double start = Bench::now();
+        for (int i = 0; i < draws; i++) {
+            draw(i);
+        }
+        double seconds = Bench::now() - start;
+        bench.report(std::string(name) + "_draws_per_second", draws / seconds, "draws/s");
+    };
+
+    TextCache cache;
+    run("cached", drawsPerRun, [&](int i) {
+        cache.draw(renderer, font, 400, 300, "Connect to localhost? ENTER to confirm.", white);
+    });
+    run("glyphs", drawsPerRun, [&](int i) {
+        snprintf(counter, sizeof(counter), "render %.2fms  frame %d", i * 0.01, i);
+        cache.drawGlyphs(renderer, font, 400, 300, counter, white);
+    });
+
+    SpriteBatch batch;
+    cache.setBatch(&batch, 0);
+    run("glyphs_batched", drawsPerRun, [&](int i) {
+        snprintf(counter, sizeof(counter), "render %.2fms  frame %d", i * 0.01, i);
+        cache.drawGlyphs(renderer, font, 400, 300, counter, white);
+        if (i % 8 == 7) { //about as many strings as the F3 overlay draws per frame
+            batch.flush(renderer);
+            cache.endFrame();
+        }
+    });
+    batch.flush(renderer);
+    cache.setBatch(nullptr, 0);
+    cache.endFrame();
+
+    cache.setEnabled(false);
+    run("uncached", drawsPerRun / 10, [&](int i) {
+        snprintf(counter, sizeof(counter), "frame %d", i);
+        cache.draw(renderer, font, 400, 300, counter, white);
+    });
+    cache.clear();
+    TTF_CloseFont(font);
+}
+
+/**
+ * Draws frames of one screen and reports the mean time of update() plus render().
+ * @param feed called before each frame with its number, to deliver messages.
+ */
+template <typename Feed>
+static void timeScreen(Bench& bench, const char* name, MyGame& game, SDL_Renderer* renderer, Feed feed) {
+    const int frames = 300;
+    for (int f = 0; f < 30; f++) { //warm the text cache and glyph atlases
+        feed(f);
+        game.update(frameTime);
+        game.render(renderer, 0.5f);
+    }
+    double start = Bench::now();
+    for (int f = 0; f < frames; f++) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        feed(f);
+        game.update(frameTime);
+        game.render(renderer, 0.5f);
+        SDL_RenderPresent(renderer);
+    }
+    double seconds = Bench::now() - start;
+    bench.report(std::string(name) + "_frame", seconds / frames * 1e6, "us");
+}
+
+/**
+ * Passes one ASCII message to MyGame as the receive thread does.
+ */
+static void deliver(MyGame& game, const std::string& message) {
+    std::string_view cmd;
+    MessageArgs args;
+    if (parseMessage(message, cmd, args)) {
+        game.on_receive(cmd, args);
+    }
+}
+
+/**
+ * Whole frames of every screen MyGame draws, with its real assets, on a software renderer:
+ * menu, error, the match with and without the F3 to F5 overlays, and game over, also copied
+ * from the screen cache.
+ */
+BENCHMARK(render_screens) {
+    OffscreenScreen screen;
+    SDL_Renderer* renderer = screen.getRenderer();
+    FILE* font = fopen(fontPath, "rb");
+    if (renderer == nullptr || font == nullptr) {
+        bench.report("skipped_no_renderer_or_assets", 1, "");
+        return;
+    }
+    fclose(font);
+
+    MyGame game;
+    game.setLogging(false);
+    game.setSyncAssets(true);
+    game.setup(renderer);
+    auto nothing = [](int f) {};
+
+    timeScreen(bench, "menu", game, renderer, nothing);
+
+    game.setMenu();
+    game.setErrorScreen();
+    game.setErrorMessage("Could not connect to localhost:55555");
+    timeScreen(bench, "error", game, renderer, nothing);
+    game.setErrorScreen();
+
+    deliver(game, "ROLE,1");
+    deliver(game, "COUNT,0");
+    auto match = [&game](int f) {
+        int ball = f % 500;
+        deliver(game, "GAME_DATA,270," + std::to_string(200 + f % 100) + "," + std::to_string(150 + ball) + ","
+            + std::to_string(100 + ball / 2) + ",0WIN,0,0");
+        if (f % 30 == 0) {
+            deliver(game, "BALL_HIT_BAT1");
+        }
+        if (f % 45 == 0) {
+            deliver(game, "HIT_WALL_UP");
+        }
+    };
+    timeScreen(bench, "in_game", game, renderer, match);
+
+    SDL_Event key{};
+    key.type = SDL_KEYDOWN;
+    for (SDL_Keycode overlay : { SDLK_F3, SDLK_F4, SDLK_F5 }) {
+        key.key.keysym.sym = overlay;
+        game.input(key);
+    }
+    timeScreen(bench, "in_game_overlays", game, renderer, match);
+
+    deliver(game, "GAME_DATA,270,270,400,300,1WIN,0,0");
+    timeScreen(bench, "game_over", game, renderer, nothing);
+
+    game.setScreenCache(true); //as --lazy draws a text screen, when it draws one at all
+    timeScreen(bench, "game_over_cached", game, renderer, nothing);
+}
+
+/**
+ * Frames of 16 and 64 matches tiled on one renderer as MatchWall draws them, sharing one game's
+ * assets, each fed a snapshot per frame.
+ */
+BENCHMARK(match_wall) {
+    OffscreenScreen screen;
+    SDL_Renderer* renderer = screen.getRenderer();
+    FILE* font = fopen(fontPath, "rb");
+    if (renderer == nullptr || font == nullptr) {
+        bench.report("skipped_no_renderer_or_assets", 1, "");
+        return;
+    }
+    fclose(font);
+
+    for (size_t count : { 16, 64 }) {
+        std::vector<std::unique_ptr<MyGame>> games;
+        for (size_t i = 0; i < count; i++) {
+            games.push_back(std::make_unique<MyGame>());
+            MyGame& game = *games.back();
+            game.setLogging(false);
+            game.setAudio(false);
+            game.setSyncAssets(true);
+            if (i > 0) {
+                game.shareAssets(*games[0]);
+            }
+            game.setup(renderer);
+            game.setMenu();
+            deliver(game, "ROLE,3");
+            deliver(game, "COUNT,0");
+        }
+
+        const int frames = 60;
+        double start = 0;
+        for (int f = -10; f < frames; f++) { //the first ten warm the text caches
+            if (f == 0) {
+                start = Bench::now();
+            }
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+            SDL_RenderClear(renderer);
+            for (size_t i = 0; i < count; i++) {
+                int ball = (f + (int)i * 37) % 500 + 10;
+                deliver(*games[i], "GAME_DATA,270," + std::to_string(200 + ball % 100) + "," + std::to_string(150 + ball) + ","
+                    + std::to_string(100 + ball / 2) + ",0WIN,0,0");
+                games[i]->update(frameTime);
+                MatchWall::beginTile(renderer, MatchWall::tile(i, count, 800, 600));
+                games[i]->render(renderer, 0.5f);
+                MatchWall::endTile(renderer);
+            }
+            SDL_RenderPresent(renderer);
+        }
+        double seconds = Bench::now() - start;
+        std::string name = "tiles_" + std::to_string(count);
+        bench.report(name + "_frame", seconds / frames * 1e6, "us");
+        while (!games.empty()) { //the first game owns the shared assets
+            games.pop_back();
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <string>
+
+#include "Bench.h"
+#include "GameState.h"
+
+/**
+ * A frame's worth of match state handling at 60 ticks per second with a goal every few seconds:
+ * the string fields MyGame kept before, building the winner line and copying the scores every
+ * frame, against GameStateStore with text formatted only when the version changes and a rewind
+ * lookup as an effect would make.
+ */
+BENCHMARK(game_state) {
+    const int frames = 1000000;
+    int16_t positions[SNAPSHOT_POSITIONS] = { 270, 270, 400, 300 };
+
+    std::string score[2] = { "0", "0" };
+    std::string countdown = "0";
+    std::string playerWin = "0";
+    uint64_t allocsBefore = allocationCount();
+    double start = Bench::now();
+    for (int f = 0; f < frames; f++) {
+        if (f % 300 == 0) {
+            score[f / 300 % 2] = std::to_string(f / 600);
+        }
+        std::string shown[2] = { score[0], score[1] };
+        std::string winnerText = "Player ";
+        winnerText.append(playerWin);
+        winnerText.append(" was the winner!");
+        keep(shown[0].size() + shown[1].size() + winnerText.size() + (countdown != "0"));
+    }
+    double seconds = Bench::now() - start;
+    bench.report("strings_per_frame", seconds / frames * 1e9, "ns");
+    bench.report("strings_allocs_per_frame", (double)(allocationCount() - allocsBefore) / frames, "allocs/frame");
+
+    GameStateStore* store = new GameStateStore();
+    char scoreText[2][8];
+    char winnerText[32];
+    uint32_t textVersion = ~0u;
+    GameState past;
+    allocsBefore = allocationCount();
+    start = Bench::now();
+    for (int f = 0; f < frames; f++) {
+        positions[SNAP_BALL_X] = (int16_t)(f % 500);
+        store->setPositions(positions);
+        if (f % 300 == 0) {
+            store->setScore((uint16_t)(f / 600), (uint16_t)(f / 600));
+        }
+        uint32_t version = store->getVersion();
+        GameState match = store->get();
+        if (version != textVersion) {
+            textVersion = version;
+            snprintf(scoreText[0], sizeof(scoreText[0]), "%u", (unsigned)match.score[0]);
+            snprintf(scoreText[1], sizeof(scoreText[1]), "%u", (unsigned)match.score[1]);
+            snprintf(winnerText, sizeof(winnerText), "Player %d was the winner!", (int)match.winner);
+        }
+        store->rewind(6, past);
+        keep(scoreText[0][0] + scoreText[1][0] + winnerText[0] + (size_t)past.positions[SNAP_BALL_X]);
+    }
+    seconds = Bench::now() - start;
+    bench.report("store_per_frame", seconds / frames * 1e9, "ns");
+    bench.report("store_allocs_per_frame", (double)(allocationCount() - allocsBefore) / frames, "allocs/frame");
+    delete store;
+}
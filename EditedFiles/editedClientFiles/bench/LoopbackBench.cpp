@@ -0,0 +1,249 @@
+#include <string>
+
+#include "SDL.h"
+#include "SDL_net.h"
+
+#include "Backoff.h"
+#include "Bench.h"
+#include "LoadGenerator.h"
+#include "NetReactor.h"
+#include "StandInServer.h"
+
+static const Uint16 loopbackPort = 55655; //away from the default, so a local server can keep running
+
+static int runStandIn(void* server) {
+    ((StandInServer*)server)->run();
+    return 0;
+}
+
+/**
+ * One run of a few clients against an in-process stand-in server on loopback, through the
+ * client's framing, parsing and snapshot decoding.
+ * @param name prefix of the metrics reported.
+ * @param binary ask for binary snapshots rather than ASCII GAME_DATA.
+ */
+static void runLoopback(Bench& bench, const std::string& name, bool binary) {
+    LoadConfig config;
+    config.host = "127.0.0.1";
+    config.port = loopbackPort;
+    config.clients = 4;
+    config.duration = 3;
+    config.binaryWire = binary;
+    config.pingInterval = 0.25f;
+
+    StandInConfig standInConfig;
+    standInConfig.port = config.port;
+    standInConfig.tickRate = config.tickRate;
+    standInConfig.maxClients = config.clients;
+    standInConfig.autoplay = true;
+
+    StandInServer server;
+    if (!server.start(standInConfig)) {
+        bench.report(name + "_skipped_no_socket", 1, "");
+        return;
+    }
+    SDL_Thread* serverThread = SDL_CreateThread(runStandIn, "StandIn", &server);
+    LoadGenerator generator;
+    LoadReport report = generator.run(config);
+    server.stop();
+    SDL_WaitThread(serverThread, nullptr);
+
+    bench.report(name + "_connected", report.connected, "clients");
+    bench.report(name + "_delivered", report.deliveryRatio(config.tickRate) * 100, "%");
+    if (report.interArrival.count() > 0) {
+        bench.report(name + "_snapshot_interval_p99", report.interArrival.percentileMs(0.99), "ms");
+    }
+    if (report.pingRtt.count() > 0) {
+        bench.report(name + "_ping_rtt_p50", report.pingRtt.percentileMs(0.5), "ms");
+        bench.report(name + "_ping_rtt_p99", report.pingRtt.percentileMs(0.99), "ms");
+    }
+    if (report.roleTime.count() > 0) {
+        bench.report(name + "_connect_to_role_p50", report.roleTime.percentileMs(0.5), "ms");
+    }
+    if (report.snapshots > 0) {
+        bench.report(name + "_bytes_per_snapshot", (double)report.bytesReceived / report.snapshots, "B");
+    }
+}
+
+/**
+ * End to end on loopback: connect, ROLE, a stream of snapshots and PING round trips, with ASCII
+ * and binary snapshots. Takes a few seconds, as the stand-in ticks in real time.
+ */
+BENCHMARK(loopback_standin) {
+    if (SDL_Init(0) == -1 || SDLNet_Init() == -1) {
+        bench.report("skipped_no_sdl_net", 1, "");
+        return;
+    }
+    runLoopback(bench, "ascii", false);
+    runLoopback(bench, "binary", true);
+    SDLNet_Quit();
+    SDL_Quit();
+}
+
+/**
+ * Many connections served by one NetReactor against the stand-in, drained once a frame as the
+ * client's main thread does: how much reaches the main thread, and what draining costs a frame.
+ */
+BENCHMARK(loopback_reactor) {
+    const int connections = 64;
+    const double duration = 3;
+
+    if (SDL_Init(0) == -1 || SDLNet_Init() == -1) {
+        bench.report("skipped_no_sdl_net", 1, "");
+        return;
+    }
+    StandInConfig standInConfig;
+    standInConfig.port = loopbackPort;
+    standInConfig.maxClients = connections;
+    standInConfig.autoplay = true;
+    StandInServer server;
+    if (!server.start(standInConfig)) {
+        bench.report("skipped_no_socket", 1, "");
+        SDLNet_Quit();
+        SDL_Quit();
+        return;
+    }
+    SDL_Thread* serverThread = SDL_CreateThread(runStandIn, "StandIn", &server);
+
+    NetReactor* reactor = new NetReactor();
+    reactor->start();
+    for (int i = 0; i < connections; i++) {
+        reactor->open("127.0.0.1", loopbackPort, nullptr, nullptr);
+    }
+    NetEvent event;
+    uint64_t opened = 0;
+    uint64_t messages = 0;
+    uint64_t frames = 0;
+    double drainSeconds = 0;
+    double start = Bench::now();
+    while (Bench::now() - start < duration) {
+        double drainStart = Bench::now();
+        while (reactor->next(event)) {
+            opened += event.type == NetEventType::OPENED;
+            messages += event.type == NetEventType::MESSAGE;
+        }
+        drainSeconds += Bench::now() - drainStart;
+        frames++;
+        SDL_Delay(16);
+    }
+    reactor->stop();
+    NetReactorStats stats = reactor->getStats();
+    delete reactor;
+    server.stop();
+    SDL_WaitThread(serverThread, nullptr);
+
+    bench.report("connected", (double)opened, "connections");
+    bench.report("messages_per_second", messages / duration, "msg/s");
+    bench.report("drain_per_frame", frames > 0 ? drainSeconds / frames * 1e6 : 0, "us");
+    bench.report("stalls", (double)stats.stalls, "");
+    bench.report("send_stalls", (double)stats.sendStalls, "");
+    SDLNet_Quit();
+    SDL_Quit();
+}
+
+/**
+ * A stand-in that goes away for a second mid-match and comes back: how long the client's
+ * backoff takes to find it again, and how many attempts that costs.
+ */
+BENCHMARK(loopback_reconnect) {
+    const double outage = 1; //seconds the server is down
+    int rounds = 3;
+
+    if (SDL_Init(0) == -1 || SDLNet_Init() == -1) {
+        bench.report("skipped_no_sdl_net", 1, "");
+        return;
+    }
+    StandInConfig standInConfig;
+    standInConfig.port = loopbackPort;
+    standInConfig.autoplay = true;
+    StandInServer* server = nullptr;
+    SDL_Thread* serverThread = nullptr;
+    auto startServer = [&]() {
+        server = new StandInServer();
+        if (server->start(standInConfig)) {
+            serverThread = SDL_CreateThread(runStandIn, "StandIn", server);
+        }
+    };
+    auto stopServer = [&]() {
+        server->stop();
+        if (serverThread != nullptr) {
+            SDL_WaitThread(serverThread, nullptr);
+        }
+        delete server;
+        server = nullptr;
+        serverThread = nullptr;
+    };
+
+    NetReactor* reactor = new NetReactor();
+    reactor->start();
+    Backoff backoff;
+    NetEvent event;
+    startServer();
+    uint32_t connection = reactor->open("127.0.0.1", loopbackPort, nullptr, nullptr);
+    bool open = false;
+    double start = Bench::now();
+    while (!open && connection != 0 && Bench::now() - start < 5) {
+        while (reactor->next(event)) {
+            open = open || event.type == NetEventType::OPENED;
+            connection = event.type == NetEventType::CLOSED ? 0 : connection;
+        }
+        SDL_Delay(1);
+    }
+    if (!open) {
+        bench.report("skipped_no_socket", 1, "");
+        rounds = 0;
+    }
+
+    double totalMs = 0, maxMs = 0;
+    int attempts = 0, reconnected = 0;
+    for (int round = 0; round < rounds; round++) {
+        SDL_Delay(200); //a little of the match
+        stopServer();
+        while (connection != 0) { //the drop, as the client sees it
+            while (reactor->next(event)) {
+                connection = event.type == NetEventType::CLOSED ? 0 : connection;
+            }
+            SDL_Delay(1);
+        }
+        double lostAt = Bench::now();
+        double retryAt = lostAt + backoff.next() / 1000.0;
+        open = false;
+        while (!open && Bench::now() - lostAt < 30) {
+            double now = Bench::now();
+            if (server == nullptr && now - lostAt >= outage) {
+                startServer();
+            }
+            if (connection == 0 && now >= retryAt) {
+                connection = reactor->open("127.0.0.1", loopbackPort, nullptr, nullptr);
+                attempts++;
+            }
+            while (reactor->next(event)) {
+                open = open || event.type == NetEventType::OPENED;
+                if (event.type == NetEventType::CLOSED) {
+                    connection = 0;
+                    retryAt = Bench::now() + backoff.next() / 1000.0;
+                }
+            }
+            SDL_Delay(1);
+        }
+        if (open) {
+            double tookMs = (Bench::now() - lostAt) * 1000;
+            totalMs += tookMs;
+            maxMs = tookMs > maxMs ? tookMs : maxMs;
+            reconnected++;
+        }
+        backoff.reset();
+    }
+    reactor->stop();
+    delete reactor;
+    if (server != nullptr) {
+        stopServer();
+    }
+
+    bench.report("reconnected", reconnected, "rounds");
+    bench.report("time_to_reconnect_mean", reconnected > 0 ? totalMs / reconnected : 0, "ms");
+    bench.report("time_to_reconnect_max", maxMs, "ms");
+    bench.report("attempts_per_reconnect", reconnected > 0 ? (double)attempts / reconnected : 0, "attempts");
+    SDLNet_Quit();
+    SDL_Quit();
+}
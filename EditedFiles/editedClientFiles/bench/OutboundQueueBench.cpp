@@ -0,0 +1,94 @@
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "Bench.h"
+#include "ClientCommand.h"
+#include "SpscQueue.h"
+#include "WakeSignal.h"
+
+static const uint32_t commandsPerRun = 200000;
+static const int histogramBuckets = 24; //bucket b holds latencies below 2^b microseconds
+
+/**
+ * Two-thread stress of the outbound path: an input thread queues key commands in bursts, the
+ * send thread sleeps on the wake signal and drains them. Reports the latency from queueing to
+ * the point the command would be written to the socket, and checks nothing is lost or reordered.
+ */
+BENCHMARK(outbound_spsc_stress) {
+    SpscQueue<ClientCommand, 64> queue;
+    WakeSignal signal;
+    std::atomic<bool> producing(true);
+    uint64_t histogram[histogramBuckets] = {};
+    uint32_t received = 0;
+    uint32_t outOfOrder = 0;
+    uint32_t queueFull = 0;
+    uint64_t maxLatency = 0;
+
+    std::thread consumer([&] {
+        uint32_t expected = 0;
+        ClientCommand command;
+        while (producing.load() || queue.size() > 0) {
+            signal.wait(10);
+            while (queue.pop(command)) {
+                uint64_t latency = (commandClock() - command.created) / 1000;
+                int bucket = 0;
+                while (bucket < histogramBuckets - 1 && latency >= (1ull << bucket)) {
+                    bucket++;
+                }
+                histogram[bucket]++;
+                if (latency > maxLatency) {
+                    maxLatency = latency;
+                }
+                if (command.arg != expected) {
+                    outOfOrder++;
+                }
+                expected = command.arg + 1;
+                received++;
+            }
+        }
+    });
+
+    unsigned int seed = 42;
+    double start = Bench::now();
+    for (uint32_t i = 0; i < commandsPerRun; i++) {
+        ClientCommand command{ (i & 1) ? CommandId::W_UP : CommandId::W_DOWN, i, commandClock() };
+        while (!queue.push(command)) { //a full queue is counted, then retried so the order check still holds
+            queueFull++;
+            std::this_thread::yield();
+        }
+        signal.notify();
+
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 64 == 0) { //pause between bursts, like a player between key presses
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    }
+    producing = false;
+    signal.notify();
+    consumer.join();
+    double elapsed = Bench::now() - start;
+
+    bench.report("commands_per_sec", received / elapsed, "cmd/s");
+    bench.report("commands_lost", (double)(commandsPerRun - received), "cmd");
+    bench.report("commands_out_of_order", outOfOrder, "cmd");
+    bench.report("queue_full_retries", queueFull, "push");
+
+    uint64_t total = 0;
+    double p50 = -1, p99 = -1;
+    for (int b = 0; b < histogramBuckets; b++) {
+        total += histogram[b];
+        if (p50 < 0 && total * 2 >= received) {
+            p50 = (double)(1ull << b);
+        }
+        if (p99 < 0 && total * 100 >= (uint64_t)received * 99) {
+            p99 = (double)(1ull << b);
+        }
+        if (histogram[b] > 0) {
+            bench.report("latency_under_" + std::to_string(1ull << b) + "us", (double)histogram[b], "cmd");
+        }
+    }
+    bench.report("latency_p50_under", p50, "us");
+    bench.report("latency_p99_under", p99, "us");
+    bench.report("latency_max", (double)maxLatency, "us");
+}
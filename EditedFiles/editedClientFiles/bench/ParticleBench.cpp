@@ -0,0 +1,123 @@
+#include <cstdlib>
+#include <vector>
+
+#include "Bench.h"
+#include "ParticleSystem.h"
+
+static const int frames = 3000;
+static const float frameTime = 1.0f / 60;
+
+//The rect MyGame::ballParticle used to allocate per frame, without needing SDL_Rect's layout.
+struct LegacyRect {
+    int x, y, w, h;
+};
+
+/**
+ * The original trail: a new rect pushed to the front of a vector each frame, the last one dropped
+ * without being freed, and rand() twice per particle. Drawing was one fill call per particle.
+ * @param live particles kept in the trail.
+ * @param seconds set to the time taken.
+ * @return bytes leaked.
+ */
+static size_t runLegacy(size_t live, double& seconds) {
+    std::vector<LegacyRect*> trail;
+    std::vector<LegacyRect*> leaked; //kept only so the benchmark can free them afterwards
+    size_t checksum = 0;
+    srand(1);
+    for (size_t i = 0; i < live; i++) { //start with a full trail, as it is after the first second of play
+        trail.push_back(new LegacyRect{ 0, 0, 10, 10 });
+    }
+    double start = Bench::now();
+    for (int f = 0; f < frames; f++) {
+        trail.insert(trail.begin(), new LegacyRect{ f % 800, f % 600, 10, 10 });
+        if (trail.size() > live) {
+            leaked.push_back(trail.back());
+            trail.erase(trail.end() - 1);
+        }
+        for (LegacyRect* r : trail) {
+            r->x += (rand() % 2) == 1 ? 2 : -2;
+            if ((rand() % 2) == 1) {
+                r->y -= 2;
+            }
+            checksum += r->x;
+        }
+    }
+    seconds = Bench::now() - start;
+    keep(checksum);
+
+    size_t leakedBytes = leaked.size() * sizeof(LegacyRect);
+    for (LegacyRect* r : leaked) {
+        delete r;
+    }
+    for (LegacyRect* r : trail) {
+        delete r;
+    }
+    return leakedBytes;
+}
+
+/**
+ * Update and vertex building for the pooled system with the given number of live particles.
+ * @param seconds set to the time taken.
+ * @param allocations set to heap allocations made after construction.
+ */
+static void runPool(size_t live, double& seconds, uint64_t& allocations) {
+    EmitterConfig config;
+    config.life = 1.0f;
+    config.rate = live / config.life;
+    config.size = 10;
+    config.speed = 120;
+    config.gravity = -75;
+    ParticleSystem particles(live + live / 8, config);
+
+    for (int f = 0; f < 60; f++) { //a full second, so the pool is at its steady state
+        particles.emitOver(0, 0, frameTime);
+        particles.update(frameTime);
+    }
+
+    size_t checksum = 0;
+    uint64_t allocationsBefore = allocationCount();
+    double start = Bench::now();
+    for (int f = 0; f < frames; f++) {
+        particles.emitOver((float)(f % 800), (float)(f % 600), frameTime);
+        particles.update(frameTime);
+        checksum += particles.buildVertices();
+    }
+    seconds = Bench::now() - start;
+    allocations = allocationCount() - allocationsBefore;
+    keep(checksum);
+}
+
+/**
+ * Per-frame CPU cost of the original ball trail versus the pooled particle system, at the original
+ * trail length and at the thousands of particles the hit bursts can produce.
+ */
+BENCHMARK(particles_legacy_vs_pool) {
+    const size_t sizes[] = { 50, 5000 };
+    for (size_t live : sizes) {
+        std::string suffix = "_" + std::to_string(live);
+        double legacySeconds, poolSeconds;
+        uint64_t poolAllocations;
+        size_t leakedBytes = runLegacy(live, legacySeconds);
+        runPool(live, poolSeconds, poolAllocations);
+
+        bench.report("legacy_frame" + suffix, legacySeconds / frames * 1e6, "us");
+        bench.report("legacy_leaked_per_minute" + suffix, (double)leakedBytes / frames * 3600, "B");
+        bench.report("legacy_draw_calls" + suffix, (double)live, "calls/frame");
+        bench.report("pool_frame" + suffix, poolSeconds / frames * 1e6, "us");
+        bench.report("pool_allocations" + suffix, (double)poolAllocations / frames, "allocs/frame");
+        bench.report("pool_draw_calls" + suffix, 1, "calls/frame");
+    }
+
+    //how many particles fit in a quarter of a 60 FPS frame
+    size_t fits = 0;
+    for (size_t live = 1000; live <= 1024000; live *= 2) {
+        double seconds;
+        uint64_t allocations;
+        runPool(live, seconds, allocations);
+        if (seconds / frames > frameTime / 4) {
+            break;
+        }
+        fits = live;
+    }
+    bench.report("pool_particles_in_quarter_frame", (double)fits, "particles");
+}
@@ -0,0 +1,152 @@
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "Bench.h"
+#include "ClientCommand.h"
+#include "Framing.h"
+#include "SpscQueue.h"
+#include "WakeSignal.h"
+
+static const size_t messagesPerRun = 500000;
+static const int framesPerRun = 2000;
+static const int frameMicros = 2000; //frames are shortened from 16.7ms so a run stays short
+
+//What one flush usually carries: a key change with its sequence number and an ACK.
+static const ClientCommand sampleCommands[] = {
+    { CommandId::W_DOWN, 1041, 0 },
+    { CommandId::ACK, 88213, 0 },
+    { CommandId::S_UP, 1042, 0 },
+};
+static const size_t sampleCount = sizeof(sampleCommands) / sizeof(sampleCommands[0]);
+
+/**
+ * The previous flush: a std::string built with appendCommand, then copied into a frame.
+ */
+BENCHMARK(send_encode_string_legacy) {
+    char frame[FRAME_HEADER_SIZE + 1024];
+    size_t checksum = 0;
+
+    uint64_t allocsBefore = allocationCount();
+    double start = Bench::now();
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        std::string message = "CLIENT_DATA";
+        for (size_t c = 0; c < sampleCount; c++) {
+            appendCommand(message, sampleCommands[c]);
+        }
+        checksum += encodeFrame(frame, sizeof(frame), message);
+    }
+    double elapsed = Bench::now() - start;
+    uint64_t allocs = allocationCount() - allocsBefore;
+    keep(checksum);
+
+    bench.report("messages_per_sec", messagesPerRun / elapsed, "msg/s");
+    bench.report("allocs_per_message", (double)allocs / messagesPerRun, "allocs");
+}
+
+/**
+ * The current flush: commands written straight into a reused ClientDataFrame.
+ */
+BENCHMARK(send_encode_frame) {
+    ClientDataFrame frame;
+    size_t checksum = 0;
+
+    uint64_t allocsBefore = allocationCount();
+    double start = Bench::now();
+    for (size_t i = 0; i < messagesPerRun; i++) {
+        frame.clear();
+        for (size_t c = 0; c < sampleCount; c++) {
+            frame.append(sampleCommands[c]);
+        }
+        checksum += frame.size();
+    }
+    double elapsed = Bench::now() - start;
+    uint64_t allocs = allocationCount() - allocsBefore;
+    keep(checksum);
+
+    bench.report("messages_per_sec", messagesPerRun / elapsed, "msg/s");
+    bench.report("allocs_per_message", (double)allocs / messagesPerRun, "allocs");
+}
+
+/**
+ * The send thread's loop from Main.cpp against an input thread that queues two or three
+ * commands a few hundred microseconds apart each frame, as key events polled in one frame are.
+ * Each flush stands for one send call, so sends per frame is the syscall cost and the wait is
+ * key-to-wire latency.
+ * @param batchUs the --send-batch window.
+ */
+static void runBatchWindow(Bench& bench, int batchUs) {
+    SpscQueue<ClientCommand, 64> queue;
+    WakeSignal signal;
+    std::atomic<bool> producing(true);
+    uint64_t sends = 0;
+    uint64_t commands = 0;
+    uint64_t waitTotalUs = 0;
+    uint64_t waitMaxUs = 0;
+
+    std::thread sender([&] {
+        ClientDataFrame frame;
+        ClientCommand command;
+        while (producing.load() || queue.size() > 0) {
+            bool woken = signal.wait(10);
+            if (woken && batchUs > 0 && queue.size() > 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(batchUs));
+            }
+            frame.clear();
+            bool any = false;
+            while (queue.pop(command)) {
+                uint64_t wait = (commandClock() - command.created) / 1000;
+                waitTotalUs += wait;
+                waitMaxUs = wait > waitMaxUs ? wait : waitMaxUs;
+                frame.append(command);
+                commands++;
+                any = true;
+            }
+            if (any) {
+                keep(frame.size());
+                sends++;
+            }
+        }
+    });
+
+    unsigned int seed = 7;
+    for (int f = 0; f < framesPerRun; f++) {
+        double frameStart = Bench::now();
+        seed = seed * 1103515245 + 12345;
+        int burst = 2 + (seed >> 16) % 2;
+        for (int c = 0; c < burst; c++) {
+            ClientCommand command = sampleCommands[c % sampleCount];
+            command.created = commandClock();
+            while (!queue.push(command)) {
+                std::this_thread::yield();
+            }
+            signal.notify();
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        double remaining = frameMicros - (Bench::now() - frameStart) * 1e6;
+        if (remaining > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds((int)remaining));
+        }
+    }
+    producing = false;
+    signal.notify();
+    sender.join();
+
+    bench.report("sends_per_frame", (double)sends / framesPerRun, "sends");
+    bench.report("sends_per_sec_at_60hz", (double)sends / framesPerRun * 60, "sends/s");
+    bench.report("commands_per_send", sends > 0 ? (double)commands / sends : 0.0, "cmd");
+    bench.report("key_to_wire_mean", commands > 0 ? (double)waitTotalUs / commands : 0.0, "us");
+    bench.report("key_to_wire_max", (double)waitMaxUs, "us");
+}
+
+BENCHMARK(send_batch_window_0us) {
+    runBatchWindow(bench, 0);
+}
+
+BENCHMARK(send_batch_window_250us) {
+    runBatchWindow(bench, 250);
+}
+
+BENCHMARK(send_batch_window_1000us) {
+    runBatchWindow(bench, 1000);
+}
@@ -0,0 +1,143 @@
+#include <charconv>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "Framing.h"
+#include "Message.h"
+#include "Snapshot.h"
+
+static const int ticks = 6000;
+static const int tickRate = 60;
+static const int ackDelayTicks = 3; //ticks before an ACK reaches the server, ~50ms round trip
+
+/**
+ * Positions over a rally: the ball bounces around at physics-engine velocities and both bats track it.
+ */
+static std::vector<double> simulateRally() {
+    std::vector<double> positions;
+    double bat1 = 270, bat2 = 270, bx = 395, by = 295;
+    double vx = 318.75 / tickRate, vy = 290.125 / tickRate;
+    for (int t = 0; t < ticks; t++) {
+        bx += vx;
+        by += vy;
+        if (bx < 0 || bx > 785) {
+            vx = -vx;
+        }
+        if (by < 0 || by > 585) {
+            vy = -vy;
+        }
+        bat1 += (by - 22 > bat1) ? 7 : -7;
+        bat2 += (by - 22 > bat2) ? 7 : -7;
+        positions.insert(positions.end(), { bat1, bat2, bx, by });
+    }
+    return positions;
+}
+
+static void appendDouble(std::string& out, double value) {
+    char text[32];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, result.ptr - text);
+    if (std::string_view(text, result.ptr - text).find('.') == std::string_view::npos) {
+        out.append(".0");
+    }
+}
+
+/**
+ * Bytes on the wire and client decode cost per tick for ASCII GAME_DATA versus binary snapshots.
+ */
+BENCHMARK(snapshot_ascii_vs_binary) {
+    std::vector<double> positions = simulateRally();
+
+    std::vector<std::string> asciiFrames;
+    size_t asciiBytes = 0;
+    for (int t = 0; t < ticks; t++) {
+        std::string m = "GAME_DATA";
+        for (int f = 0; f < 4; f++) {
+            m += ",";
+            appendDouble(m, positions[t * 4 + f]);
+        }
+        m += ",0WIN,";
+        asciiBytes += FRAME_HEADER_SIZE + m.size();
+        asciiFrames.push_back(m);
+    }
+
+    //server side encoding against the client's acknowledgements, which arrive a few ticks late
+    std::vector<std::string> binaryFrames;
+    std::deque<std::pair<int, uint16_t>> acksInFlight;
+    Snapshot history[SNAPSHOT_HISTORY];
+    SnapshotDecoder client;
+    bool acked = false;
+    uint16_t ackSeq = 0;
+    size_t binaryBytes = 0;
+    for (int t = 0; t < ticks; t++) {
+        while (!acksInFlight.empty() && acksInFlight.front().first <= t) {
+            ackSeq = acksInFlight.front().second;
+            acked = true;
+            acksInFlight.pop_front();
+        }
+        Snapshot snap;
+        snap.seq = (uint16_t)t;
+        for (int f = 0; f < SNAPSHOT_POSITIONS; f++) {
+            snap.fields[f] = (int16_t)positions[t * 4 + f];
+        }
+        history[snap.seq % SNAPSHOT_HISTORY] = snap;
+
+        char out[MAX_SNAPSHOT_SIZE];
+        size_t length = 0;
+        if (acked && (uint16_t)(snap.seq - ackSeq) < SNAPSHOT_HISTORY) {
+            length = encodeDeltaSnapshot(snap, history[ackSeq % SNAPSHOT_HISTORY], out, sizeof(out));
+        }
+        if (length == 0) {
+            length = encodeKeySnapshot(snap, out, sizeof(out));
+        }
+        binaryBytes += FRAME_HEADER_SIZE + length;
+        binaryFrames.push_back(std::string(out, length));
+
+        Snapshot decoded;
+        if (client.decode(binaryFrames.back(), decoded) && client.shouldAck(decoded.seq)) {
+            acksInFlight.push_back({ t + ackDelayTicks, decoded.seq });
+        }
+    }
+
+    //decode cost, repeated so the timer resolution doesn't matter
+    const int repeats = 50;
+    std::string_view cmd;
+    MessageArgs args;
+    size_t checksum = 0;
+    double start = Bench::now();
+    for (int r = 0; r < repeats; r++) {
+        for (const std::string& m : asciiFrames) {
+            int values[4];
+            if (parseMessage(m, cmd, args) && args.size() == 5) {
+                for (int f = 0; f < 4; f++) {
+                    toInt(args[f], values[f]);
+                }
+                checksum += values[2];
+            }
+        }
+    }
+    double asciiTime = Bench::now() - start;
+
+    start = Bench::now();
+    for (int r = 0; r < repeats; r++) {
+        SnapshotDecoder decoder;
+        Snapshot snap;
+        for (const std::string& m : binaryFrames) {
+            if (decoder.decode(m, snap)) {
+                checksum += snap.fields[SNAP_BALL_X];
+            }
+        }
+    }
+    double binaryTime = Bench::now() - start;
+    keep(checksum);
+
+    double decoded = (double)ticks * repeats;
+    bench.report("ascii_bytes_per_tick", (double)asciiBytes / ticks, "B");
+    bench.report("binary_bytes_per_tick", (double)binaryBytes / ticks, "B");
+    bench.report("ascii_bytes_per_spectator", (double)asciiBytes / ticks * tickRate, "B/s");
+    bench.report("binary_bytes_per_spectator", (double)binaryBytes / ticks * tickRate, "B/s");
+    bench.report("ascii_decode", asciiTime / decoded * 1e9, "ns/snapshot");
+    bench.report("binary_decode", binaryTime / decoded * 1e9, "ns/snapshot");
+}
@@ -0,0 +1,164 @@
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+
+#include "Bench.h"
+#include "ParticleSystem.h"
+#include "SpriteBatch.h"
+
+static const int frames = 120;
+static const float frameTime = 1.0f / 60;
+static const int viewWidth = 200; //each match view is a quarter-scale game screen
+static const int viewHeight = 150;
+
+//Where the stand-in sprites are in the bench's atlas, laid out like AssetManager's.
+static const SDL_Rect batClip{ 0, 0, 20, 60 };
+static const SDL_Rect ballClip{ 21, 0, 50, 50 };
+static const SDL_Rect glyphClip{ 72, 0, 16, 24 };
+static const SDL_Rect whiteClip{ 89, 0, 4, 4 };
+
+//One match view of the stress scene: what MyGame::render draws in game, scaled down.
+struct MatchView {
+    int x, y;
+    ParticleSystem trail;
+
+    MatchView(int x, int y, uint32_t seed) : x(x), y(y), trail(64, trailConfig(), seed) {
+    }
+
+    static EmitterConfig trailConfig() {
+        EmitterConfig config;
+        config.rate = 60;
+        config.life = 0.8f;
+        config.size = 3;
+        config.speed = 30;
+        config.gravity = -20;
+        config.colour = SDL_Color{ 175, 175, 175, 250 };
+        return config;
+    }
+
+    SDL_Rect bat(int side, int f) const {
+        return SDL_Rect{ x + (side == 0 ? 50 : 145), y + (f * (side + 1)) % (viewHeight - 15), 5, 15 };
+    }
+    SDL_Rect ball(int f) const {
+        return SDL_Rect{ x + 10 + (f * 3) % (viewWidth - 20), y + 10 + (f * 2) % (viewHeight - 20), 4, 4 };
+    }
+};
+
+/**
+ * Draws the scene the way render() did: a copy per bat, ball and glyph, and a colour change and
+ * fill per particle.
+ * @return draw calls issued.
+ */
+static uint64_t drawUnbatched(SDL_Renderer* renderer, SDL_Texture* atlas, std::vector<MatchView>& views, int f) {
+    uint64_t calls = 0;
+    for (MatchView& view : views) {
+        for (int side = 0; side < 2; side++) {
+            SDL_Rect bat = view.bat(side, f);
+            SDL_RenderCopy(renderer, atlas, &batClip, &bat);
+            calls++;
+        }
+        size_t vertexCount = view.trail.buildVertices();
+        const SDL_Vertex* vertices = view.trail.getVertices();
+        for (size_t i = 0; i < vertexCount; i += 4) {
+            const SDL_Vertex& corner = vertices[i];
+            SDL_Rect fill{ (int)corner.position.x, (int)corner.position.y,
+                (int)(vertices[i + 3].position.x - corner.position.x), (int)(vertices[i + 3].position.y - corner.position.y) };
+            SDL_SetRenderDrawColor(renderer, corner.color.r, corner.color.g, corner.color.b, corner.color.a);
+            SDL_RenderFillRect(renderer, &fill);
+            calls++;
+        }
+        SDL_Rect ball = view.ball(f);
+        SDL_RenderCopyEx(renderer, atlas, &ballClip, &ball, f * 5.0, nullptr, SDL_FLIP_NONE);
+        calls++;
+        for (int digit = 0; digit < 2; digit++) {
+            SDL_Rect glyph{ view.x + 40 + digit * 120, view.y + 10, 8, 12 };
+            SDL_RenderCopy(renderer, atlas, &glyphClip, &glyph);
+            calls++;
+        }
+    }
+    return calls;
+}
+
+/**
+ * Draws the same scene through a SpriteBatch, as render() now does.
+ */
+static void drawBatched(SDL_Renderer* renderer, SDL_Texture* atlas, SpriteBatch& batch, std::vector<MatchView>& views, int f) {
+    for (MatchView& view : views) {
+        for (int side = 0; side < 2; side++) {
+            SDL_Rect bat = view.bat(side, f);
+            batch.add(0, atlas, &batClip, SDL_FRect{ (float)bat.x, (float)bat.y, (float)bat.w, (float)bat.h });
+        }
+        view.trail.draw(batch, 0);
+        SDL_Rect ball = view.ball(f);
+        batch.addRotated(0, atlas, &ballClip, SDL_FRect{ (float)ball.x, (float)ball.y, (float)ball.w, (float)ball.h }, f * 5.0);
+        for (int digit = 0; digit < 2; digit++) {
+            batch.add(1, atlas, &glyphClip, SDL_FRect{ (float)(view.x + 40 + digit * 120), (float)(view.y + 10), 8, 12 });
+        }
+    }
+    batch.flush(renderer);
+}
+
+/**
+ * Stress scene of many concurrent match views, each with two bats, a spinning ball, a particle
+ * trail and a score, drawn to a software renderer. Compares draw calls and frame time of
+ * drawing each quad on its own against one SpriteBatch flush.
+ */
+BENCHMARK(sprite_batch_stress) {
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, 1600, 1200, 32, SDL_PIXELFORMAT_RGBA32);
+    SDL_Renderer* renderer = target != nullptr ? SDL_CreateSoftwareRenderer(target) : nullptr;
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, 96, 64, 32, SDL_PIXELFORMAT_RGBA32);
+    if (renderer == nullptr || sheet == nullptr) {
+        bench.report("skipped_no_renderer", 1, "");
+        return;
+    }
+    SDL_FillRect(sheet, nullptr, 0xFFFFFFFFu);
+    SDL_Texture* atlas = SDL_CreateTextureFromSurface(renderer, sheet);
+    SDL_FreeSurface(sheet);
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    const int viewCounts[] = { 4, 64 };
+    for (int viewCount : viewCounts) {
+        std::vector<MatchView> views;
+        for (int i = 0; i < viewCount; i++) {
+            views.emplace_back((i % 8) * viewWidth, (i / 8) * viewHeight, 0x1234567u + i);
+        }
+        for (int f = 0; f < 60; f++) { //a full second, so every trail is at its steady state
+            for (MatchView& view : views) {
+                SDL_Rect ball = view.ball(f);
+                view.trail.emitOver((float)ball.x, (float)ball.y, frameTime);
+                view.trail.update(frameTime);
+            }
+        }
+
+        uint64_t unbatchedCalls = 0;
+        double start = Bench::now();
+        for (int f = 0; f < frames; f++) {
+            SDL_RenderClear(renderer);
+            unbatchedCalls += drawUnbatched(renderer, atlas, views, f);
+        }
+        double unbatchedSeconds = Bench::now() - start;
+
+        SpriteBatch batch;
+        batch.setWhite(atlas, whiteClip);
+        start = Bench::now();
+        for (int f = 0; f < frames; f++) {
+            SDL_RenderClear(renderer);
+            drawBatched(renderer, atlas, batch, views, f);
+        }
+        double batchedSeconds = Bench::now() - start;
+        SpriteBatchStats stats = batch.takeStats();
+
+        std::string suffix = "_" + std::to_string(viewCount) + "_views";
+        bench.report("unbatched_draw_calls" + suffix, (double)unbatchedCalls / frames, "calls/frame");
+        bench.report("unbatched_frame" + suffix, unbatchedSeconds / frames * 1e6, "us");
+        bench.report("batched_draw_calls" + suffix, (double)stats.drawCalls / stats.flushes, "calls/frame");
+        bench.report("batched_quads" + suffix, (double)stats.quads / stats.flushes, "quads/frame");
+        bench.report("batched_frame" + suffix, batchedSeconds / frames * 1e6, "us");
+    }
+
+    SDL_DestroyTexture(atlas);
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+}
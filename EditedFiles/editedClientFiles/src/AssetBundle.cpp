@@ -0,0 +1,153 @@
+#include "AssetBundle.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char BUNDLE_MAGIC[] = "PONGPACK";
+
+static void putU16(char* out, uint16_t value) {
+    out[0] = (char)(value >> 8);
+    out[1] = (char)(value & 0xFF);
+}
+
+static void putU32(char* out, uint32_t value) {
+    putU16(out, (uint16_t)(value >> 16));
+    putU16(out + 2, (uint16_t)value);
+}
+
+static uint16_t getU16(const char* in) {
+    return (uint16_t)(((uint8_t)in[0] << 8) | (uint8_t)in[1]);
+}
+
+static uint32_t getU32(const char* in) {
+    return ((uint32_t)getU16(in) << 16) | getU16(in + 2);
+}
+
+/**
+ * Maps a bundle and reads its table.
+ * @param path the bundle file.
+ * @return false if it could not be mapped or is not a bundle this version can read.
+ */
+bool AssetBundle::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+    const char* data = file.getData();
+    size_t size = file.size();
+    if (size < BUNDLE_HEADER_SIZE || memcmp(data, BUNDLE_MAGIC, 8) != 0 || getU16(data + 8) != BUNDLE_VERSION) {
+        std::cout << path << " is not an asset bundle" << std::endl;
+        close();
+        return false;
+    }
+
+    uint16_t count = getU16(data + 10);
+    size_t at = BUNDLE_HEADER_SIZE;
+    for (uint16_t i = 0; i < count; i++) {
+        if (at + 1 > size || at + 1 + (uint8_t)data[at] + 8 > size) {
+            break;
+        }
+        size_t nameLength = (uint8_t)data[at];
+        std::string_view name(data + at + 1, nameLength);
+        at += 1 + nameLength;
+        uint32_t offset = getU32(data + at);
+        uint32_t length = getU32(data + at + 4);
+        at += 8;
+        if ((size_t)offset + length > size) {
+            break;
+        }
+        entries.push_back({ name, std::string_view(data + offset, length) });
+    }
+    if (entries.size() != count) {
+        std::cout << path << " is truncated" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void AssetBundle::close() {
+    entries.clear();
+    file.close();
+}
+
+/**
+ * Looks up a file in the bundle.
+ * @param name path relative to the res directory.
+ * @param data set to the file's bytes, in place in the mapping.
+ * @return false if the bundle does not hold it.
+ */
+bool AssetBundle::find(std::string_view name, std::string_view& data) const {
+    for (const Entry& entry : entries) {
+        if (entry.name == name) {
+            data = entry.data;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Packs files into a bundle, replacing any file at path.
+ * @param path the bundle to write.
+ * @param root directory the names are relative to, ending in a separator.
+ * @param names the files to pack, stored under these names.
+ * @return false if a file could not be read or the bundle written.
+ */
+bool writeAssetBundle(const std::string& path, const std::string& root, const std::vector<std::string>& names) {
+    std::vector<std::vector<char>> contents;
+    size_t tableSize = 0;
+    for (const std::string& name : names) {
+        if (name.size() > 255) {
+            std::cout << "Name too long for a bundle: " << name << std::endl;
+            return false;
+        }
+        FILE* in = fopen((root + name).c_str(), "rb");
+        if (in == nullptr) {
+            std::cout << "Could not read " << root << name << std::endl;
+            return false;
+        }
+        std::vector<char> bytes;
+        char chunk[1 << 16];
+        size_t read;
+        while ((read = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+            bytes.insert(bytes.end(), chunk, chunk + read);
+        }
+        fclose(in);
+        contents.push_back(std::move(bytes));
+        tableSize += 1 + name.size() + 8;
+    }
+    if (names.size() > 0xFFFF) {
+        return false;
+    }
+
+    FILE* out = fopen(path.c_str(), "wb");
+    if (out == nullptr) {
+        std::cout << "Could not create bundle " << path << std::endl;
+        return false;
+    }
+    char header[BUNDLE_HEADER_SIZE] = {};
+    memcpy(header, BUNDLE_MAGIC, 8);
+    putU16(header + 8, BUNDLE_VERSION);
+    putU16(header + 10, (uint16_t)names.size());
+    fwrite(header, 1, sizeof(header), out);
+
+    size_t offset = BUNDLE_HEADER_SIZE + tableSize;
+    for (size_t i = 0; i < names.size(); i++) {
+        char entry[8];
+        uint8_t nameLength = (uint8_t)names[i].size();
+        fwrite(&nameLength, 1, 1, out);
+        fwrite(names[i].data(), 1, nameLength, out);
+        putU32(entry, (uint32_t)offset);
+        putU32(entry + 4, (uint32_t)contents[i].size());
+        fwrite(entry, 1, sizeof(entry), out);
+        offset += contents[i].size();
+    }
+    for (const std::vector<char>& bytes : contents) {
+        fwrite(bytes.data(), 1, bytes.size(), out);
+    }
+    bool written = ferror(out) == 0;
+    fclose(out);
+    return written;
+}
@@ -0,0 +1,48 @@
+#ifndef __ASSET_BUNDLE_H__
+#define __ASSET_BUNDLE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+
+//A bundle is the asset files the client loads, packed into one file so startup is a single
+//mapping instead of an open and read per asset. Files are stored as they are on disk (PNG, WAV,
+//TTF) and decoded from memory. Integers are big-endian like the wire.
+//  header:  "PONGPACK" [version u16][entries u16][reserved u32]
+//  table:   [name length u8][name][offset u32][size u32] per entry, offsets from the file start
+//  data:    the files, each starting at its offset
+//Names are paths relative to the res directory, e.g. "img/pBat.png".
+const size_t BUNDLE_HEADER_SIZE = 16;
+const uint16_t BUNDLE_VERSION = 1;
+
+//A bundle mapped for reading. Views returned by find stay valid until it is closed.
+class AssetBundle {
+    private:
+        struct Entry {
+            std::string_view name;
+            std::string_view data;
+        };
+
+        MappedFile file;
+        std::vector<Entry> entries;
+
+    public:
+        bool open(const std::string& path);
+        void close();
+        bool find(std::string_view name, std::string_view& data) const;
+
+        bool isOpen() const {
+            return !entries.empty();
+        }
+        size_t size() const {
+            return file.size();
+        }
+};
+
+bool writeAssetBundle(const std::string& path, const std::string& root, const std::vector<std::string>& names);
+
+#endif
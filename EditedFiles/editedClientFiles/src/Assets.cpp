@@ -0,0 +1,340 @@
+#include "Assets.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include "Profiler.h"
+
+static uint64_t assetClock() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+AssetManager::~AssetManager() {
+    clear();
+}
+
+/**
+ * Requests an image, to be packed into the sprite atlas.
+ * @param name path relative to the res directory.
+ */
+AssetManager::Handle AssetManager::image(const std::string& name) {
+    return request(Kind::IMAGE, name, 0, MIX_MAX_VOLUME);
+}
+
+/**
+ * Requests a sound.
+ * @param name path relative to the res directory.
+ * @param volume from 0 to MIX_MAX_VOLUME.
+ */
+AssetManager::Handle AssetManager::sound(const std::string& name, int volume) {
+    return request(Kind::SOUND, name, 0, volume);
+}
+
+/**
+ * Requests a font at one point size.
+ * @param name path relative to the res directory.
+ * @param size point size.
+ */
+AssetManager::Handle AssetManager::font(const std::string& name, int size) {
+    return request(Kind::FONT, name, size, MIX_MAX_VOLUME);
+}
+
+AssetManager::Handle AssetManager::request(Kind kind, const std::string& name, int size, int volume) {
+    if (started) {
+        std::cout << "Asset requested after loading started: " << name << std::endl;
+        return -1;
+    }
+    for (size_t i = 0; i < assets.size(); i++) {
+        if (assets[i].kind == kind && assets[i].name == name && assets[i].size == size) {
+            assets[i].requests++;
+            return (Handle)i;
+        }
+    }
+    Asset asset;
+    asset.kind = kind;
+    asset.name = name;
+    asset.size = size;
+    asset.volume = volume;
+    asset.requests = 1;
+    asset.file = fileFor(name);
+    assets.push_back(asset);
+    return (Handle)(assets.size() - 1);
+}
+
+size_t AssetManager::fileFor(const std::string& name) {
+    for (size_t i = 0; i < files.size(); i++) {
+        if (files[i].name == name) {
+            return i;
+        }
+    }
+    files.push_back(File{ name, {}, {} });
+    return files.size() - 1;
+}
+
+/**
+ * Reads files from this bundle, where it holds them, instead of the res directory.
+ * @param path the bundle, made with pong_pack.
+ */
+void AssetManager::setBundle(const std::string& path) {
+    bundlePath = path;
+}
+
+/**
+ * Starts decoding every requested asset on the worker thread. Returns at once.
+ */
+void AssetManager::start() {
+    if (started) {
+        return;
+    }
+    started = true;
+    startUs = assetClock();
+    worker = std::thread([this] { load(); });
+}
+
+/**
+ * Worker thread: reads each file once and decodes each asset from memory.
+ */
+void AssetManager::load() {
+    PROFILE_THREAD("assets");
+    if (!bundlePath.empty() && bundle.open(bundlePath)) {
+        stats.fromBundle = true;
+        stats.bytesRead += bundle.size();
+    }
+    for (File& file : files) {
+        if (read(file)) {
+            stats.files++;
+        }
+    }
+
+    for (Asset& asset : assets) {
+        const File& file = files[asset.file];
+        if (file.data.empty()) {
+            decoded++;
+            continue;
+        }
+        SDL_RWops* rw = SDL_RWFromConstMem(file.data.data(), (int)file.data.size());
+        switch (asset.kind) {
+        case Kind::IMAGE: {
+            SDL_Surface* loaded = IMG_Load_RW(rw, 1);
+            if (loaded == nullptr) {
+                std::cout << "Error loading image " << asset.name << ": " << IMG_GetError() << std::endl;
+                break;
+            }
+            asset.surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+            SDL_FreeSurface(loaded);
+            break;
+        }
+        case Kind::SOUND:
+            asset.chunk = Mix_LoadWAV_RW(rw, 1);
+            if (asset.chunk == nullptr) {
+                std::cout << "Error loading sound " << asset.name << ": " << Mix_GetError() << std::endl;
+                break;
+            }
+            asset.chunk->volume = (Uint8)asset.volume;
+            break;
+        case Kind::FONT:
+            asset.font = TTF_OpenFontRW(rw, 1, asset.size);
+            if (asset.font == nullptr) {
+                std::cout << "Error loading font " << asset.name << ": " << TTF_GetError() << std::endl;
+            }
+            break;
+        }
+        decoded++;
+    }
+    stats.decodeMs = (assetClock() - startUs) / 1000.0;
+    workerDone = true;
+}
+
+/**
+ * Finds a file's bytes, in place in the bundle if it holds it, otherwise read from disk.
+ * @return false if neither has it.
+ */
+bool AssetManager::read(File& file) {
+    if (bundle.isOpen() && bundle.find(file.name, file.data)) {
+        return true;
+    }
+    FILE* in = fopen((root + file.name).c_str(), "rb");
+    if (in == nullptr) {
+        std::cout << "Could not open asset " << root << file.name << std::endl;
+        return false;
+    }
+    fseek(in, 0, SEEK_END);
+    long length = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if (length > 0) {
+        file.bytes.resize((size_t)length);
+        file.bytes.resize(fread(file.bytes.data(), 1, file.bytes.size(), in));
+    }
+    fclose(in);
+    file.data = std::string_view(file.bytes.data(), file.bytes.size());
+    stats.bytesRead += file.bytes.size();
+    return !file.data.empty();
+}
+
+/**
+ * Called every frame from the render thread until it returns true. Once the worker has decoded
+ * everything, packs the images into the atlas and uploads it.
+ * @return true when every asset is usable.
+ */
+bool AssetManager::poll(SDL_Renderer* renderer) {
+    if (ready) {
+        return true;
+    }
+    if (!started || !workerDone.load()) {
+        return false;
+    }
+    worker.join();
+    buildAtlas(renderer);
+    ready = true;
+    stats.readyMs = (assetClock() - startUs) / 1000.0;
+
+    printf("Assets ready in %.1fms (decoded in %.1fms) from %s: %zu files, %zu KB read\n",
+        stats.readyMs, stats.decodeMs, stats.fromBundle ? bundlePath.c_str() : root.c_str(),
+        stats.files, stats.bytesRead / 1024);
+    printf("Sprite atlas %dx%d, %zu KB of texture memory, was %zu KB as separate textures\n",
+        stats.atlasW, stats.atlasH, stats.atlasBytes / 1024, stats.separateBytes / 1024);
+    return true;
+}
+
+/**
+ * Blocks until poll() would return true, for callers that cannot show anything without assets.
+ */
+void AssetManager::wait(SDL_Renderer* renderer) {
+    start();
+    while (!poll(renderer)) {
+        SDL_Delay(1);
+    }
+}
+
+/**
+ * Shelf-packs the decoded images, tallest first, with a white block for coloured quads, then
+ * uploads the sheet as one texture.
+ */
+void AssetManager::buildAtlas(SDL_Renderer* renderer) {
+    std::vector<Asset*> images;
+    for (Asset& asset : assets) {
+        if (asset.kind == Kind::IMAGE && asset.surface != nullptr) {
+            images.push_back(&asset);
+            stats.separateBytes += (size_t)asset.surface->w * asset.surface->h * 4 * asset.requests;
+        }
+    }
+    std::stable_sort(images.begin(), images.end(), [](const Asset* a, const Asset* b) {
+        return a->surface->h > b->surface->h;
+    });
+
+    //one row if everything fits in ATLAS_WIDTH, so a few small sprites don't pay for a wide sheet
+    int rowWidth = WHITE_SIZE, widest = WHITE_SIZE;
+    for (Asset* asset : images) {
+        rowWidth += asset->surface->w + ATLAS_PADDING;
+        widest = std::max(widest, asset->surface->w);
+    }
+    int penX = 0, penY = 0, rowHeight = 0;
+    int width = std::max(widest, std::min(rowWidth, (int)ATLAS_WIDTH));
+    auto place = [&](int w, int h) {
+        if (penX + w > width) {
+            penX = 0;
+            penY += rowHeight + ATLAS_PADDING;
+            rowHeight = 0;
+        }
+        SDL_Rect rect{ penX, penY, w, h };
+        penX += w + ATLAS_PADDING;
+        rowHeight = std::max(rowHeight, h);
+        return rect;
+    };
+    for (Asset* asset : images) {
+        asset->sprite.rect = place(asset->surface->w, asset->surface->h);
+    }
+    white.rect = place(WHITE_SIZE, WHITE_SIZE);
+    int height = penY + rowHeight;
+
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (sheet != nullptr) {
+        for (Asset* asset : images) {
+            SDL_SetSurfaceBlendMode(asset->surface, SDL_BLENDMODE_NONE); //copy alpha rather than blend onto the empty sheet
+            SDL_BlitSurface(asset->surface, nullptr, sheet, &asset->sprite.rect);
+        }
+        SDL_FillRect(sheet, &white.rect, 0xFFFFFFFFu);
+        atlas = SDL_CreateTextureFromSurface(renderer, sheet);
+        SDL_FreeSurface(sheet);
+    }
+    for (Asset* asset : images) {
+        SDL_FreeSurface(asset->surface);
+        asset->surface = nullptr;
+    }
+    if (atlas == nullptr) {
+        std::cout << "Failed to build sprite atlas: " << SDL_GetError() << std::endl;
+        return;
+    }
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+    for (Asset* asset : images) {
+        asset->sprite.texture = atlas;
+    }
+    white.texture = atlas;
+    stats.atlasW = width;
+    stats.atlasH = height;
+    stats.atlasBytes = (size_t)width * height * 4;
+}
+
+/**
+ * Fraction of assets decoded so far, for the loading bar.
+ */
+float AssetManager::progress() const {
+    return assets.empty() ? 1.0f : (float)decoded.load() / assets.size();
+}
+
+Sprite AssetManager::sprite(Handle handle) const {
+    if (!ready || handle < 0 || (size_t)handle >= assets.size()) {
+        return Sprite();
+    }
+    return assets[handle].sprite;
+}
+
+Mix_Chunk* AssetManager::chunk(Handle handle) const {
+    if (!ready || handle < 0 || (size_t)handle >= assets.size()) {
+        return nullptr;
+    }
+    return assets[handle].chunk;
+}
+
+TTF_Font* AssetManager::ttf(Handle handle) const {
+    if (!ready || handle < 0 || (size_t)handle >= assets.size()) {
+        return nullptr;
+    }
+    return assets[handle].font;
+}
+
+/**
+ * Frees every asset and the atlas, waiting for the worker if it is still loading. Must be
+ * called before the renderer is destroyed.
+ */
+void AssetManager::clear() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+    for (Asset& asset : assets) {
+        if (asset.surface != nullptr) {
+            SDL_FreeSurface(asset.surface);
+        }
+        if (asset.chunk != nullptr) {
+            Mix_FreeChunk(asset.chunk);
+        }
+        if (asset.font != nullptr) {
+            TTF_CloseFont(asset.font);
+        }
+    }
+    assets.clear();
+    files.clear();
+    bundle.close();
+    if (atlas != nullptr) {
+        SDL_DestroyTexture(atlas);
+        atlas = nullptr;
+    }
+    white = Sprite();
+    started = false;
+    ready = false;
+    workerDone = false;
+    decoded = 0;
+}
@@ -0,0 +1,123 @@
+#ifndef __ASSETS_H__
+#define __ASSETS_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_ttf.h"
+#include "SDL_mixer.h"
+#include "SDL_image.h"
+
+#include "AssetBundle.h"
+
+//Where one image ended up in the sprite atlas.
+struct Sprite {
+    SDL_Texture* texture = nullptr; //the atlas, shared by every sprite
+    SDL_Rect rect = { 0, 0, 0, 0 };
+};
+
+//Cold start and memory figures, printed once loading finishes.
+struct AssetStats {
+    bool fromBundle = false;
+    size_t files = 0; //distinct files read, each once however often it was requested
+    size_t bytesRead = 0;
+    double decodeMs = 0; //worker start until every file was decoded
+    double readyMs = 0; //worker start until the atlas was uploaded
+    int atlasW = 0;
+    int atlasH = 0;
+    size_t atlasBytes = 0; //texture memory of the atlas
+    size_t separateBytes = 0; //what one texture per image request, as before, would have taken
+};
+
+//Loads the client's images, sounds and fonts on a worker thread while the menu renders. Assets are
+//requested before start() and identified by the handle returned; asking for the same file again,
+//or the same font at the same size, returns the same handle, and fonts at different sizes share
+//one copy of the file. Images are packed into one atlas texture, which has to be created on the
+//render thread, so poll() finishes the job there once the worker is done. Files come from an
+//AssetBundle when one is given and holds them, otherwise from the res directory.
+class AssetManager {
+    public:
+        typedef int Handle; //-1 for an asset that failed to load
+
+    private:
+        static const int ATLAS_WIDTH = 256;
+        static const int ATLAS_PADDING = 1; //between sprites, so filtering never samples a neighbour
+        static const int WHITE_SIZE = 4; //solid block for drawing coloured quads from the atlas
+
+        enum class Kind { IMAGE, SOUND, FONT };
+
+        struct Asset {
+            Kind kind;
+            std::string name; //relative to the res directory
+            int size = 0; //point size for fonts
+            int volume = MIX_MAX_VOLUME; //for sounds
+            int requests = 0;
+            size_t file = 0; //index into files
+            SDL_Surface* surface = nullptr; //decoded image, freed once in the atlas
+            Mix_Chunk* chunk = nullptr;
+            TTF_Font* font = nullptr;
+            Sprite sprite;
+        };
+
+        struct File {
+            std::string name;
+            std::vector<char> bytes; //empty when read in place from the bundle
+            std::string_view data;
+        };
+
+        std::string root = "../res/";
+        std::string bundlePath;
+        AssetBundle bundle;
+        std::vector<Asset> assets;
+        std::vector<File> files; //kept while fonts are open, SDL_ttf reads from them
+        SDL_Texture* atlas = nullptr;
+        Sprite white;
+        std::thread worker;
+        std::atomic<size_t> decoded{ 0 };
+        std::atomic<bool> workerDone{ false };
+        bool started = false;
+        bool ready = false;
+        uint64_t startUs = 0;
+        AssetStats stats;
+
+        Handle request(Kind kind, const std::string& name, int size, int volume);
+        size_t fileFor(const std::string& name);
+        void load();
+        bool read(File& file);
+        void buildAtlas(SDL_Renderer* renderer);
+
+    public:
+        ~AssetManager();
+
+        Handle image(const std::string& name);
+        Handle sound(const std::string& name, int volume);
+        Handle font(const std::string& name, int size);
+
+        void setBundle(const std::string& path);
+        void start();
+        bool poll(SDL_Renderer* renderer);
+        void wait(SDL_Renderer* renderer);
+        void clear();
+
+        bool isReady() const {
+            return ready;
+        }
+        float progress() const;
+        Sprite sprite(Handle handle) const;
+        Sprite whiteSprite() const {
+            return white;
+        }
+        Mix_Chunk* chunk(Handle handle) const;
+        TTF_Font* ttf(Handle handle) const;
+        AssetStats getStats() const {
+            return stats;
+        }
+};
+
+#endif
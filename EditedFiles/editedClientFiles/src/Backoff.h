@@ -0,0 +1,62 @@
+#ifndef __BACKOFF_H__
+#define __BACKOFF_H__
+
+#include <cstdint>
+
+#include "FastRandom.h"
+
+//How long to wait between reconnect attempts.
+struct BackoffConfig {
+    uint32_t baseMs = 250; //the first wait, doubled each attempt
+    uint32_t maxMs = 8000; //no wait is longer than this
+    int attempts = 8; //attempts before giving up, 0 to never reconnect
+};
+
+//Waits between attempts to reconnect: doubling from the base up to the cap, each drawn at random
+//from the upper half of its range, so clients dropped together by a server restart don't all
+//come back in the same instant.
+class Backoff {
+    private:
+        BackoffConfig config;
+        FastRandom random;
+        int attempt = 0; //attempts since the last reset()
+
+    public:
+        explicit Backoff(uint32_t seed = 0x9E3779B9u) : random(seed) {}
+
+        void configure(const BackoffConfig& settings) {
+            config = settings;
+        }
+
+        //Starts counting again, after a successful connect.
+        void reset() {
+            attempt = 0;
+        }
+
+        /**
+         * Counts an attempt and gets how long to wait before making it.
+         * @return milliseconds to wait.
+         */
+        uint32_t next() {
+            int doublings = attempt < 16 ? attempt : 16;
+            uint64_t wait = (uint64_t)config.baseMs << doublings;
+            uint32_t capped = wait < config.maxMs ? (uint32_t)wait : config.maxMs;
+            attempt++;
+            return capped - (uint32_t)(random.unit() * (capped / 2));
+        }
+
+        //True once every attempt allowed has been made.
+        bool exhausted() const {
+            return attempt >= config.attempts;
+        }
+
+        int getAttempt() const {
+            return attempt;
+        }
+
+        int getAttempts() const {
+            return config.attempts;
+        }
+};
+
+#endif
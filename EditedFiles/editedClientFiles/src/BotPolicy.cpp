@@ -0,0 +1,79 @@
+#include "BotPolicy.h"
+
+#include <cstring>
+
+#include "PongRules.h"
+
+/**
+ * @param config how the bot plays.
+ * @param seed starting state of this bot's random numbers, so a crowd of bots don't act in step.
+ */
+BotPolicy::BotPolicy(const BotConfig& config, uint32_t seed) : config(config), random(seed) {
+    untilTakeOver = config.takeOverInterval * random.unit(); //spread the first attempts out
+}
+
+/**
+ * Decides the keys to hold for this step.
+ * @param view the match as this session sees it.
+ * @param dt seconds since the last call.
+ */
+BotAction BotPolicy::act(const GameView& view, float dt) {
+    BotAction action;
+
+    if (view.role == 3 && config.takeOverInterval > 0) {
+        untilTakeOver -= dt;
+        if (untilTakeOver <= 0) {
+            untilTakeOver = config.takeOverInterval * (0.5f + random.unit());
+            action.takeOver = true;
+        }
+    }
+    if ((view.role != 1 && view.role != 2) || !view.valid || view.gameOver) {
+        direction = 0;
+        return action;
+    }
+
+    untilDecision -= dt;
+    if (untilDecision <= 0) {
+        switch (config.kind) {
+            case BotKind::TRACK: {
+                untilDecision = config.reaction;
+                float batCentre = view.ownY + BAT_HEIGHT / 2;
+                float ballCentre = view.ballY + BALL_SIZE / 2;
+                if (ballCentre < batCentre - config.deadZone) {
+                    direction = -1;
+                }
+                else if (ballCentre > batCentre + config.deadZone) {
+                    direction = 1;
+                }
+                else {
+                    direction = 0;
+                }
+                break;
+            }
+            case BotKind::RANDOM:
+                untilDecision = config.reaction * (1 + 4 * random.unit());
+                direction = (int)(random.next() % 3) - 1;
+                break;
+            default:
+                direction = 0;
+                break;
+        }
+    }
+    action.direction = direction;
+    return action;
+}
+
+/**
+ * Reads a bot kind from the command line.
+ * @param name "idle", "track" or "random".
+ * @return TRACK for anything unrecognised.
+ */
+BotKind parseBotKind(const char* name) {
+    if (std::strcmp(name, "idle") == 0) {
+        return BotKind::IDLE;
+    }
+    if (std::strcmp(name, "random") == 0) {
+        return BotKind::RANDOM;
+    }
+    return BotKind::TRACK;
+}
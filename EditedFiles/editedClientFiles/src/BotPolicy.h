@@ -0,0 +1,46 @@
+#ifndef __BOT_POLICY_H__
+#define __BOT_POLICY_H__
+
+#include <cstdint>
+
+#include "FastRandom.h"
+#include "MyGame.h"
+
+//How a headless bot plays.
+enum class BotKind {
+    IDLE, //never moves, only answers the server
+    TRACK, //follows the ball with a reaction delay, like a reasonable player
+    RANDOM //holds random directions for random lengths of time, for noisy input load
+};
+
+struct BotConfig {
+    BotKind kind = BotKind::TRACK;
+    float reaction = 0.1f; //seconds between decisions
+    float deadZone = 8; //pixels either side of the bat's centre the tracker tolerates before moving
+    float takeOverInterval = 5; //seconds between TAKE_OVER attempts while spectating, 0 never
+};
+
+//Keys a bot wants held this step.
+struct BotAction {
+    int direction = 0; //-1 up (W), 1 down (S), 0 neither
+    bool takeOver = false; //press ENTER, which asks to take over a free player slot
+};
+
+//Chooses inputs for one headless session from what it can see of the match.
+class BotPolicy {
+    private:
+        BotConfig config;
+        FastRandom random;
+        float untilDecision = 0;
+        float untilTakeOver;
+        int direction = 0;
+
+    public:
+        BotPolicy(const BotConfig& config, uint32_t seed);
+
+        BotAction act(const GameView& view, float dt);
+};
+
+BotKind parseBotKind(const char* name);
+
+#endif
@@ -0,0 +1,118 @@
+#include "ClientCommand.h"
+
+#include <charconv>
+#include <cstring>
+
+#include "Snapshot.h"
+
+/**
+ * Gets the text the server expects for a command.
+ * @param id the command.
+ */
+const char* commandName(CommandId id) {
+    switch (id) {
+    case CommandId::W_DOWN:
+        return "W_DOWN";
+    case CommandId::W_UP:
+        return "W_UP";
+    case CommandId::S_DOWN:
+        return "S_DOWN";
+    case CommandId::S_UP:
+        return "S_UP";
+    case CommandId::TAKE_OVER:
+        return "TAKE_OVER";
+    case CommandId::CONFIRM:
+        return "CONFIRM";
+    case CommandId::CON_CLOSE:
+        return "CON_CLOSE";
+    case CommandId::WIRE_BIN:
+        return WIRE_REQUEST;
+    case CommandId::ACK:
+        return "ACK";
+    case CommandId::PING:
+        return "PING";
+    }
+    return "";
+}
+
+/**
+ * Whether the command's arg is sent after its name. Key commands carry their input sequence number,
+ * PING an id the server echoes in PONG.
+ * @param id the command.
+ */
+bool commandHasArg(CommandId id) {
+    switch (id) {
+    case CommandId::W_DOWN:
+    case CommandId::W_UP:
+    case CommandId::S_DOWN:
+    case CommandId::S_UP:
+    case CommandId::ACK:
+    case CommandId::PING:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * Appends ",NAME" and, for commands that take one, ",arg" to a CLIENT_DATA message.
+ * @param message the message being built.
+ * @param command the command to add.
+ */
+void appendCommand(std::string& message, const ClientCommand& command) {
+    message += ",";
+    message += commandName(command.id);
+    if (commandHasArg(command.id)) {
+        message += ",";
+        message += std::to_string(command.arg);
+    }
+}
+
+//Sets the big-endian length header at the start of a frame, as encodeFrame does.
+static void writeHeader(char* frame, size_t payloadSize) {
+    frame[0] = (char)((payloadSize >> 8) & 0xFF);
+    frame[1] = (char)(payloadSize & 0xFF);
+}
+
+/**
+ * Empties the frame back to a bare "CLIENT_DATA".
+ */
+void ClientDataFrame::clear() {
+    static const char prefix[] = "CLIENT_DATA";
+    std::memcpy(bytes + FRAME_HEADER_SIZE, prefix, sizeof(prefix) - 1);
+    length = FRAME_HEADER_SIZE + sizeof(prefix) - 1;
+    writeHeader(bytes, length - FRAME_HEADER_SIZE);
+}
+
+/**
+ * Appends ",NAME" and, for commands that take one, ",arg", as appendCommand does.
+ * @param command the command to add.
+ * @return false, leaving the frame unchanged, if it does not fit.
+ */
+bool ClientDataFrame::append(const ClientCommand& command) {
+    char* end = bytes + sizeof(bytes);
+    char* out = bytes + length;
+    const char* name = commandName(command.id);
+    size_t nameLength = std::strlen(name);
+
+    if ((size_t)(end - out) < nameLength + 1) {
+        return false;
+    }
+    *out++ = ',';
+    std::memcpy(out, name, nameLength);
+    out += nameLength;
+    if (commandHasArg(command.id)) {
+        if (out == end) {
+            return false;
+        }
+        *out++ = ',';
+        std::to_chars_result result = std::to_chars(out, end, command.arg);
+        if (result.ec != std::errc()) {
+            return false;
+        }
+        out = result.ptr;
+    }
+    length = out - bytes;
+    writeHeader(bytes, length - FRAME_HEADER_SIZE);
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef __CLIENT_COMMAND_H__
+#define __CLIENT_COMMAND_H__
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "Framing.h"
+
+//Everything the client sends to the server, sent on the wire by name inside CLIENT_DATA.
+enum class CommandId : uint8_t {
+    W_DOWN, W_UP, S_DOWN, S_UP, TAKE_OVER, CONFIRM, CON_CLOSE, WIRE_BIN, ACK, PING
+};
+
+//Fixed-size outbound command, queued between the thread that creates it and the thread that sends
+//it: the reactor's for TCP, or the UDP send thread.
+struct ClientCommand {
+    CommandId id = CommandId::CONFIRM;
+    uint32_t arg = 0; //only sent for commands that take one: input sequence numbers, ACK and PING
+    uint64_t created = 0; //commandClock() when queued, for measuring key-to-wire latency
+};
+
+const char* commandName(CommandId id);
+bool commandHasArg(CommandId id);
+void appendCommand(std::string& message, const ClientCommand& command);
+
+//One framed CLIENT_DATA message built in place, so sending commands allocates nothing. The header
+//is kept up to date on every append, so data() is always a complete frame.
+class ClientDataFrame {
+    public:
+        static const size_t MAX_PAYLOAD = 1024;
+
+    private:
+        char bytes[FRAME_HEADER_SIZE + MAX_PAYLOAD];
+        size_t length = 0; //header included
+
+    public:
+        ClientDataFrame() {
+            clear();
+        }
+
+        void clear();
+        bool append(const ClientCommand& command);
+
+        const char* data() const {
+            return bytes;
+        }
+        size_t size() const {
+            return length;
+        }
+        std::string_view payload() const {
+            return std::string_view(bytes + FRAME_HEADER_SIZE, length - FRAME_HEADER_SIZE);
+        }
+};
+
+//Monotonic nanoseconds, used to stamp commands.
+inline uint64_t commandClock() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif
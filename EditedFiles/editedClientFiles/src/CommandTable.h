@@ -0,0 +1,114 @@
+#ifndef __COMMAND_TABLE_H__
+#define __COMMAND_TABLE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "Message.h"
+
+//One command: its exact name, how many arguments it accepts and what handles it.
+template <typename Handler>
+struct CommandEntry {
+    std::string_view name;
+    uint8_t minArgs = 0;
+    uint8_t maxArgs = 0;
+    bool logged = false; //printed when message logging is on, off for per-tick commands
+    Handler handler = nullptr;
+};
+
+/**
+ * FNV-1a of a command name, perturbed by a seed so a table can search for one without collisions.
+ * The low bits of FNV only depend on the low bits of its input, so the result is mixed down
+ * before a table masks it.
+ */
+constexpr uint32_t commandHash(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 16777619u);
+    for (char c : name) {
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    return hash ^ (hash >> 15);
+}
+
+//Maps command names to their entries with a perfect hash built at compile time: the constructor
+//tries seeds until every name lands in its own slot, so a lookup is one hash, one slot read and
+//one comparison that rejects anything but the exact name. Declare tables constexpr and
+//static_assert isPerfect(), so a duplicate name or an unlucky set fails the build.
+template <typename Handler, size_t N, size_t Slots = 32>
+class CommandTable {
+    static_assert((Slots & (Slots - 1)) == 0 && Slots >= N && N < 255, "Slots must be a power of two holding every entry");
+
+    private:
+        static const uint32_t MAX_SEEDS = 4096;
+
+        CommandEntry<Handler> entries[N];
+        uint8_t slots[Slots] = {}; //entry index + 1, 0 when empty
+        uint32_t seed = 0;
+        bool perfect = false;
+
+        constexpr bool place(uint32_t trySeed) {
+            for (size_t i = 0; i < Slots; i++) {
+                slots[i] = 0;
+            }
+            for (size_t i = 0; i < N; i++) {
+                uint8_t& slot = slots[commandHash(entries[i].name, trySeed) & (Slots - 1)];
+                if (slot != 0) {
+                    return false;
+                }
+                slot = (uint8_t)(i + 1);
+            }
+            return true;
+        }
+
+    public:
+        constexpr CommandTable(const CommandEntry<Handler> (&table)[N]) : entries{} {
+            for (size_t i = 0; i < N; i++) {
+                entries[i] = table[i];
+            }
+            for (uint32_t trySeed = 0; trySeed < MAX_SEEDS && !perfect; trySeed++) {
+                perfect = place(trySeed);
+                seed = trySeed;
+            }
+        }
+
+        /**
+         * Finds the entry for a command.
+         * @param cmd the first token of a message.
+         * @return nullptr unless cmd is exactly one of the table's names.
+         */
+        constexpr const CommandEntry<Handler>* find(std::string_view cmd) const {
+            uint8_t slot = slots[commandHash(cmd, seed) & (Slots - 1)];
+            if (slot == 0 || entries[slot - 1].name != cmd) {
+                return nullptr;
+            }
+            return &entries[slot - 1];
+        }
+
+        constexpr bool isPerfect() const {
+            return perfect;
+        }
+};
+
+inline bool decodeArg(std::string_view token, int& value) {
+    return toInt(token, value);
+}
+
+inline bool decodeArg(std::string_view token, std::string_view& value) {
+    value = token;
+    return true;
+}
+
+/**
+ * Converts the leading arguments of a message to the types of the values given, e.g.
+ * decodeArgs(args, x, y, label) for two ints and a string. Ints are parsed with from_chars.
+ * @return false if there are too few arguments or one does not convert.
+ */
+template <typename... Values>
+bool decodeArgs(const MessageArgs& args, Values&... values) {
+    size_t i = 0;
+    return args.size() >= sizeof...(Values) && (decodeArg(args[i++], values) && ...);
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef __FAST_RANDOM_H__
+#define __FAST_RANDOM_H__
+
+#include <cstdint>
+
+//xorshift32, much cheaper than rand() and private to each owner so users don't share state.
+class FastRandom {
+    private:
+        uint32_t state;
+
+    public:
+        explicit FastRandom(uint32_t seed = 0x9E3779B9u) : state(seed != 0 ? seed : 1) {}
+
+        uint32_t next() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+        //Uniform in [-1, 1).
+        float signedUnit() {
+            return (float)(next() >> 8) * (2.0f / 16777216.0f) - 1.0f;
+        }
+        //Uniform in [0, 1).
+        float unit() {
+            return (float)(next() >> 8) * (1.0f / 16777216.0f);
+        }
+};
+
+#endif
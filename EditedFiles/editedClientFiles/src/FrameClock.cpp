@@ -0,0 +1,113 @@
+#include "FrameClock.h"
+
+#include <cmath>
+
+static const double SPIN_MS = 2.0; //final part of a timer wait spent spinning rather than sleeping
+
+FrameClock::FrameClock() {
+    frequency = 1;
+    step = 1.0 / config.simRate;
+}
+
+/**
+ * Sets the simulation rate and pacing mode. Must be called after SDL_Init and before the first frame.
+ * @param settings the pacing to use.
+ */
+void FrameClock::configure(const PacingConfig& settings) {
+    frequency = (double)SDL_GetPerformanceFrequency();
+    config = settings;
+    if (config.simRate <= 0) {
+        config.simRate = 60;
+    }
+    if (config.maxSteps < 1) {
+        config.maxSteps = 1;
+    }
+    step = 1.0 / config.simRate;
+    reset();
+}
+
+/**
+ * Forgets the previous frame, so time spent outside the loop (e.g. connecting) is not simulated.
+ */
+void FrameClock::reset() {
+    lastFrame = 0;
+    deadline = 0;
+    accumulator = 0;
+}
+
+/**
+ * Called at the start of each frame, before input is read. Adds the real time since the previous
+ * frame to the accumulator.
+ * @return number of fixed simulation steps to run this frame.
+ */
+int FrameClock::beginFrame() {
+    frameStart = SDL_GetPerformanceCounter();
+    if (lastFrame == 0) {
+        lastFrame = frameStart;
+        return 0;
+    }
+    double elapsed = (frameStart - lastFrame) / frequency;
+    lastFrame = frameStart;
+    accumulator += elapsed;
+
+    int steps = (int)(accumulator / step);
+    if (steps > config.maxSteps) {
+        stats.droppedSteps += steps - config.maxSteps;
+        steps = config.maxSteps;
+        accumulator = step * steps; //spend the allowed steps and drop the rest
+    }
+    accumulator -= step * steps;
+    if (accumulator < 0) {
+        accumulator = 0;
+    }
+
+    record(elapsed * 1000.0);
+    return steps;
+}
+
+/**
+ * Called after the frame is presented. Records the frame's work time against the budget and, in
+ * timer mode, waits until the next frame is due.
+ */
+void FrameClock::endFrame() {
+    uint64_t now = SDL_GetPerformanceCounter();
+    double workMs = (now - frameStart) * 1000.0 / frequency;
+    double periodMs = config.targetFps > 0 ? 1000.0 / config.targetFps : 1000.0 / config.simRate;
+    double budget = config.budgetMs > 0 ? config.budgetMs : periodMs;
+    if (workMs > budget) {
+        stats.overruns++;
+    }
+    if (stats.frames > 0) {
+        stats.workMean += (workMs - stats.workMean) / stats.frames;
+    }
+
+    if (config.vsync || config.targetFps <= 0) {
+        return;
+    }
+    uint64_t period = (uint64_t)(frequency / config.targetFps);
+    if (deadline == 0 || now > deadline + period) { //first frame, or too far behind to catch up
+        deadline = now;
+    }
+    deadline += period;
+
+    double remainingMs = (double)(int64_t)(deadline - now) * 1000.0 / frequency;
+    if (remainingMs > SPIN_MS) {
+        SDL_Delay((Uint32)(remainingMs - SPIN_MS));
+    }
+    while (SDL_GetPerformanceCounter() < deadline) {
+    }
+}
+
+/**
+ * Adds one presented frame interval to the running mean and variance (Welford's method).
+ */
+void FrameClock::record(double intervalMs) {
+    stats.frames++;
+    double delta = intervalMs - stats.mean;
+    stats.mean += delta / stats.frames;
+    m2 += delta * (intervalMs - stats.mean);
+    stats.stdDev = stats.frames > 1 ? std::sqrt(m2 / (stats.frames - 1)) : 0.0;
+    if (intervalMs > stats.max) {
+        stats.max = intervalMs;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef __FRAME_CLOCK_H__
+#define __FRAME_CLOCK_H__
+
+#include <cstdint>
+
+#include "SDL.h"
+
+//How the main loop steps the simulation and paces frames.
+struct PacingConfig {
+    int simRate = 60; //fixed simulation updates per second
+    int targetFps = 60; //frames per second when pacing with the timer, 0 for unpaced
+    bool vsync = false; //let SDL_RenderPresent wait for the display instead of the timer
+    float budgetMs = 0; //frames whose work takes longer than this are overruns, 0 for one frame period
+    int maxSteps = 5; //most updates run in one frame, time beyond that is dropped rather than caught up
+};
+
+//Frame timing counters. Times are in milliseconds.
+struct FrameStats {
+    uint64_t frames = 0;
+    uint64_t overruns = 0; //frames whose work exceeded the budget
+    uint64_t droppedSteps = 0; //updates skipped after a stall, see PacingConfig::maxSteps
+    double mean = 0; //presented frame interval
+    double stdDev = 0;
+    double max = 0;
+    double workMean = 0; //input, update and render, excluding the pacing wait
+};
+
+//Fixed-timestep accumulator and frame pacer for the main loop. Real time is accumulated each
+//frame and spent in whole simulation steps; the remainder becomes the render interpolation alpha.
+//In timer mode frames are paced to absolute deadlines with SDL_Delay for the bulk of the wait
+//and a short spin on the high-resolution counter for the rest, so timer granularity and
+//render cost don't make the frame rate drift.
+class FrameClock {
+    private:
+        PacingConfig config;
+        double frequency; //performance counter ticks per second
+        uint64_t lastFrame = 0; //counter at the start of the previous frame, 0 before the first
+        uint64_t frameStart = 0;
+        uint64_t deadline = 0; //counter value the next frame should start at, in timer mode
+        double accumulator = 0; //seconds of real time not yet simulated
+        double step;
+        FrameStats stats;
+        double m2 = 0; //running sum of squared differences from the mean, for the variance
+
+        void record(double intervalMs);
+
+    public:
+        FrameClock();
+
+        void configure(const PacingConfig& settings);
+        void reset();
+        int beginFrame();
+        void endFrame();
+
+        float stepSeconds() const {
+            return (float)step;
+        }
+        float alpha() const {
+            return (float)(accumulator / step);
+        }
+        FrameStats getStats() const {
+            return stats;
+        }
+};
+
+#endif
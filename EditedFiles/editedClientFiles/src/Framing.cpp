@@ -0,0 +1,166 @@
+#include "Framing.h"
+
+#include <cstring>
+
+/**
+ * Rounds a capacity up to the next power of two so positions can be wrapped with a mask.
+ * @param value minimum capacity required.
+ */
+static size_t roundUpPow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+ByteRing::ByteRing(size_t initialCapacity) : data(roundUpPow2(initialCapacity < 16 ? 16 : initialCapacity)) {
+}
+
+/**
+ * Reallocates the ring so at least minFree bytes can be written, unwrapping the contents to the start.
+ * @param minFree the number of free bytes required after growing.
+ */
+void ByteRing::grow(size_t minFree) {
+    std::vector<char> larger(roundUpPow2(size() + minFree));
+    size_t count = size();
+    peek(0, larger.data(), count);
+    data.swap(larger);
+    head = 0;
+    tail = count;
+}
+
+/**
+ * Returns the largest contiguous free region at the write position, growing the ring if needed.
+ * @param minFree the ring grows until at least this many bytes are free.
+ * @param writable set to the number of bytes that can be written to the returned pointer.
+ */
+char* ByteRing::prepareWrite(size_t minFree, size_t& writable) {
+    if (head == tail) { //empty, so restart at the front to keep the free region contiguous
+        head = 0;
+        tail = 0;
+    }
+    if (capacity() - size() < minFree) {
+        grow(minFree);
+    }
+    size_t mask = capacity() - 1;
+    size_t tailIdx = tail & mask;
+    size_t untilEnd = capacity() - tailIdx;
+    size_t freeBytes = capacity() - size();
+    writable = untilEnd < freeBytes ? untilEnd : freeBytes;
+    return data.data() + tailIdx;
+}
+
+/**
+ * Marks bytes written to the region returned by prepareWrite() as readable.
+ * @param count number of bytes written.
+ */
+void ByteRing::commitWrite(size_t count) {
+    tail += count;
+}
+
+/**
+ * Copies bytes out of the ring without consuming them, handling the wrap at the end of storage.
+ * @param offset position relative to the read position.
+ * @param out destination for the copied bytes.
+ * @param count number of bytes to copy.
+ */
+void ByteRing::peek(size_t offset, char* out, size_t count) const {
+    size_t mask = capacity() - 1;
+    size_t start = (head + offset) & mask;
+    size_t first = capacity() - start;
+    if (first > count) {
+        first = count;
+    }
+    std::memcpy(out, data.data() + start, first);
+    std::memcpy(out + first, data.data(), count - first);
+}
+
+/**
+ * Gets a pointer to a run of bytes if it does not wrap around the end of storage.
+ * @param offset position relative to the read position.
+ * @param count length of the run.
+ * @return pointer into the ring, or nullptr if the run wraps.
+ */
+const char* ByteRing::contiguous(size_t offset, size_t count) const {
+    size_t start = (head + offset) & (capacity() - 1);
+    if (start + count > capacity()) {
+        return nullptr;
+    }
+    return data.data() + start;
+}
+
+/**
+ * Releases bytes at the read position.
+ * @param count number of bytes to release.
+ */
+void ByteRing::consume(size_t count) {
+    head += count;
+}
+
+FrameReader::FrameReader(size_t initialCapacity) : ring(initialCapacity) {
+}
+
+/**
+ * Gets space to receive into. Any views returned by next() are invalidated.
+ * @param minFree minimum number of free bytes to guarantee.
+ * @param writable set to the number of bytes that can be written to the returned pointer.
+ */
+char* FrameReader::prepareWrite(size_t minFree, size_t& writable) {
+    return ring.prepareWrite(minFree, writable);
+}
+
+/**
+ * Marks received bytes as part of the stream.
+ * @param count number of bytes received.
+ */
+void FrameReader::commitWrite(size_t count) {
+    ring.commitWrite(count);
+}
+
+/**
+ * Extracts the next complete frame. Partial frames stay buffered until the rest arrives.
+ * The view points into the reader and is valid until the next call to prepareWrite().
+ * @param payload set to the payload of the frame, excluding the length header.
+ * @return true if a complete frame was available.
+ */
+bool FrameReader::next(std::string_view& payload) {
+    if (ring.size() < FRAME_HEADER_SIZE) {
+        return false;
+    }
+    unsigned char header[FRAME_HEADER_SIZE];
+    ring.peek(0, (char*)header, FRAME_HEADER_SIZE);
+    size_t length = ((size_t)header[0] << 8) | header[1];
+    if (ring.size() < FRAME_HEADER_SIZE + length) {
+        return false;
+    }
+
+    const char* start = ring.contiguous(FRAME_HEADER_SIZE, length);
+    if (start == nullptr) { //frame wraps the end of the ring, copy it out once
+        if (scratch.size() < length) {
+            scratch.resize(length);
+        }
+        ring.peek(FRAME_HEADER_SIZE, scratch.data(), length);
+        start = scratch.data();
+    }
+    payload = std::string_view(start, length);
+    ring.consume(FRAME_HEADER_SIZE + length);
+    return true;
+}
+
+/**
+ * Writes a payload with its length header.
+ * @param out destination buffer.
+ * @param outSize size of the destination buffer.
+ * @param payload message to frame.
+ * @return number of bytes written, or 0 if the frame did not fit.
+ */
+size_t encodeFrame(char* out, size_t outSize, std::string_view payload) {
+    if (payload.size() > MAX_FRAME_PAYLOAD || FRAME_HEADER_SIZE + payload.size() > outSize) {
+        return 0;
+    }
+    out[0] = (char)((payload.size() >> 8) & 0xFF);
+    out[1] = (char)(payload.size() & 0xFF);
+    std::memcpy(out + FRAME_HEADER_SIZE, payload.data(), payload.size());
+    return FRAME_HEADER_SIZE + payload.size();
+}
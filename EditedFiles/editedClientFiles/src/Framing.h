@@ -0,0 +1,59 @@
+#ifndef __FRAMING_H__
+#define __FRAMING_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+//Every message on the wire is sent as [uint16 big-endian payload length][payload bytes].
+const size_t FRAME_HEADER_SIZE = 2;
+const size_t MAX_FRAME_PAYLOAD = 0xFFFF;
+
+//Growable ring buffer holding bytes received from a stream socket.
+class ByteRing {
+    private:
+        std::vector<char> data; //storage, size is always a power of two
+        size_t head = 0; //read position, only ever increases
+        size_t tail = 0; //write position, only ever increases
+
+        void grow(size_t minFree);
+
+    public:
+        explicit ByteRing(size_t initialCapacity = 4096);
+
+        size_t size() const {
+            return tail - head;
+        }
+        size_t capacity() const {
+            return data.size();
+        }
+
+        char* prepareWrite(size_t minFree, size_t& writable);
+        void commitWrite(size_t count);
+        void peek(size_t offset, char* out, size_t count) const;
+        const char* contiguous(size_t offset, size_t count) const;
+        void consume(size_t count);
+};
+
+//Splits a received byte stream into complete frames, regardless of how TCP segmented it.
+class FrameReader {
+    private:
+        ByteRing ring; //bytes received but not yet consumed as frames
+        std::vector<char> scratch; //used only for frames that wrap around the end of the ring
+
+    public:
+        explicit FrameReader(size_t initialCapacity = 4096);
+
+        char* prepareWrite(size_t minFree, size_t& writable);
+        void commitWrite(size_t count);
+        bool next(std::string_view& payload);
+
+        size_t buffered() const {
+            return ring.size();
+        }
+};
+
+size_t encodeFrame(char* out, size_t outSize, std::string_view payload);
+
+#endif
@@ -0,0 +1,85 @@
+#include "GameState.h"
+
+#include <algorithm>
+
+/**
+ * Records the positions of a new server tick, advancing the tick and keeping the state it ends
+ * in for rewind().
+ * @param positions bats and ball, indexed by SnapshotField.
+ */
+void GameStateStore::setPositions(const int16_t positions[SNAPSHOT_POSITIONS]) {
+    std::lock_guard<std::mutex> lock(mutex);
+    current.tick++;
+    std::copy_n(positions, SNAPSHOT_POSITIONS, current.positions);
+    history[current.tick % HISTORY] = current;
+}
+
+void GameStateStore::setScore(uint16_t one, uint16_t two) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current.score[0] != one || current.score[1] != two) {
+        current.score[0] = one;
+        current.score[1] = two;
+        version++;
+    }
+}
+
+void GameStateStore::setCountdown(int8_t countdown) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current.countdown != countdown) {
+        current.countdown = countdown;
+        version++;
+    }
+}
+
+void GameStateStore::setWinner(Winner winner) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (current.winner != winner) {
+        current.winner = winner;
+        version++;
+    }
+}
+
+/**
+ * Back to the state before a match: no score, countdown at 3, no winner, no history.
+ */
+void GameStateStore::reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = GameState();
+    version++;
+}
+
+/**
+ * Copies the current state.
+ */
+GameState GameStateStore::get() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+/**
+ * Changes whenever the score, countdown or winner does.
+ */
+uint32_t GameStateStore::getVersion() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return version;
+}
+
+Winner GameStateStore::getWinner() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current.winner;
+}
+
+/**
+ * Gets the state as it was a number of ticks before the newest, e.g. where the ball was.
+ * @param ticksAgo 0 for the newest tick.
+ * @param state set to the state at that tick.
+ * @return false if that tick is older than the history holds, or before the match was reset.
+ */
+bool GameStateStore::rewind(uint32_t ticksAgo, GameState& state) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (ticksAgo >= HISTORY || ticksAgo >= current.tick) {
+        return false;
+    }
+    state = history[(current.tick - ticksAgo) % HISTORY];
+    return true;
+}
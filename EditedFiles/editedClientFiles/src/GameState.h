@@ -0,0 +1,52 @@
+#ifndef __GAME_STATE_H__
+#define __GAME_STATE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "Snapshot.h"
+
+//Who has won the match, if anyone.
+enum class Winner : uint8_t {
+    NONE = 0, ONE = 1, TWO = 2
+};
+
+//The match as the server last described it, all integers so a copy is one small block.
+struct GameState {
+    uint32_t tick = 0; //position updates received since the match was reset, one per server tick
+    int16_t positions[SNAPSHOT_POSITIONS] = {}; //indexed by SnapshotField
+    uint16_t score[2] = { 0, 0 };
+    int8_t countdown = 3; //last COUNT, 0 once the ball is served
+    Winner winner = Winner::NONE;
+};
+
+//Holds the current GameState, written as server messages are handled and read by the renderer,
+//and a ring of the states at each of the last HISTORY ticks so effects can ask where things were
+//a few ticks ago. Nothing is allocated after construction. The version changes whenever the
+//score, countdown or winner does, so text showing them is only formatted again when it would
+//read differently.
+class GameStateStore {
+    public:
+        static const uint32_t HISTORY = 128; //ticks kept, about two seconds at 60 ticks per second
+
+    private:
+        mutable std::mutex mutex;
+        GameState current;
+        GameState history[HISTORY]; //indexed by tick % HISTORY
+        uint32_t version = 0;
+
+    public:
+        void setPositions(const int16_t positions[SNAPSHOT_POSITIONS]);
+        void setScore(uint16_t one, uint16_t two);
+        void setCountdown(int8_t countdown);
+        void setWinner(Winner winner);
+        void reset();
+
+        GameState get() const;
+        uint32_t getVersion() const;
+        Winner getWinner() const;
+        bool rewind(uint32_t ticksAgo, GameState& state) const;
+};
+
+#endif
@@ -0,0 +1,319 @@
+#include "HeadlessClient.h"
+
+#include <cstdio>
+
+#include "JitterBuffer.h"
+#include "Message.h"
+#include "Snapshot.h"
+
+static const Uint32 RECONNECT_DELAY = 1000; //ms before a closed session connects again, plus up to as much again at random
+
+HeadlessClient::HeadlessClient() : address{ 0, 0 } {
+}
+
+HeadlessClient::~HeadlessClient() {
+    for (std::unique_ptr<Session>& session : sessions) {
+        if (session->socket != nullptr) {
+            SDLNet_TCP_Close(session->socket);
+        }
+    }
+    for (SDLNet_SocketSet group : groups) {
+        SDLNet_FreeSocketSet(group);
+    }
+}
+
+/**
+ * Connects every session and runs the bots until the duration passes. SDL_net must be initialised;
+ * no other SDL subsystem is needed.
+ * @param settings the sessions to host and how their bots play.
+ * @return false if the server's address could not be resolved.
+ */
+bool HeadlessClient::run(const HeadlessConfig& settings) {
+    config = settings;
+    if (SDLNet_ResolveHost(&address, config.host.c_str(), config.port) == -1) {
+        printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+        return false;
+    }
+    if (config.tickRate <= 0) {
+        config.tickRate = 60;
+    }
+    int connectRate = config.connectRate > 0 ? config.connectRate : 1;
+
+    Uint32 start = SDL_GetTicks();
+    for (int i = 0; i < config.sessions; i++) {
+        sessions.push_back(std::make_unique<Session>(config.bot, 0x9E3779B9u * (uint32_t)(i + 1)));
+        sessions.back()->connectAt = start + (Uint32)((uint64_t)i * 1000 / connectRate);
+        if (i % GROUP_SIZE == 0) {
+            groups.push_back(SDLNet_AllocSocketSet(GROUP_SIZE));
+        }
+    }
+    printf("Headless: %d sessions against %s:%u\n", config.sessions, config.host.c_str(), (unsigned)config.port);
+    if (!config.recordPath.empty()) {
+        recorder.open(config.recordPath);
+    }
+
+    Uint32 tickMs = 1000 / config.tickRate;
+    float dt = tickMs / 1000.0f;
+    Uint32 nextTick = start;
+    Uint32 nextReport = start + (Uint32)(config.reportInterval * 1000);
+    Uint32 end = start + (Uint32)(config.duration * 1000);
+
+    while (config.duration <= 0 || (Sint32)(SDL_GetTicks() - end) < 0) {
+        Uint32 now = SDL_GetTicks();
+        for (size_t i = 0; i < sessions.size(); i++) {
+            if (sessions[i]->socket == nullptr && (Sint32)(now - sessions[i]->connectAt) >= 0) {
+                connect(i, now);
+            }
+        }
+
+        bool received = false;
+        for (size_t g = 0; g < groups.size(); g++) {
+            if (SDLNet_CheckSockets(groups[g], 0) <= 0) {
+                continue;
+            }
+            size_t last = (g + 1) * GROUP_SIZE < sessions.size() ? (g + 1) * GROUP_SIZE : sessions.size();
+            for (size_t i = g * GROUP_SIZE; i < last; i++) {
+                Session& session = *sessions[i];
+                if (session.socket != nullptr && SDLNet_SocketReady(session.socket)) {
+                    received = true;
+                    if (!receive(session)) {
+                        disconnect(i, false, now);
+                    }
+                }
+            }
+        }
+
+        now = SDL_GetTicks();
+        if ((Sint32)(now - nextTick) >= 0) {
+            for (size_t i = 0; i < sessions.size(); i++) {
+                if (sessions[i]->socket != nullptr) {
+                    step(i, dt, now);
+                }
+            }
+            nextTick += tickMs;
+            if ((Sint32)(now - nextTick) > 1000) { //too far behind to catch up, e.g. after a stall
+                nextTick = now;
+            }
+        }
+        if (config.reportInterval > 0 && (Sint32)(now - nextReport) >= 0) {
+            report(now - start);
+            nextReport += (Uint32)(config.reportInterval * 1000);
+        }
+        if (!received) {
+            SDL_Delay(1);
+        }
+    }
+
+    for (size_t i = 0; i < sessions.size(); i++) {
+        if (sessions[i]->socket != nullptr) {
+            disconnect(i, true, SDL_GetTicks());
+        }
+    }
+    report(SDL_GetTicks() - start);
+    if (recorder.isOpen()) {
+        printf("Recorded %u ticks to %s\n", recorder.getTicks(), config.recordPath.c_str());
+        recorder.close();
+    }
+    return true;
+}
+
+/**
+ * Opens a session's connection and gives it a fresh headless MyGame.
+ * @param index the session.
+ * @param now SDL_GetTicks().
+ * @return false if the server refused or did not answer; another attempt is scheduled.
+ */
+bool HeadlessClient::connect(size_t index, Uint32 now) {
+    Session& session = *sessions[index];
+    session.socket = SDLNet_TCP_Open(&address);
+    if (session.socket == nullptr) {
+        stats.connectFailures++;
+        session.connectAt = now + RECONNECT_DELAY + random.next() % RECONNECT_DELAY;
+        return false;
+    }
+    SDLNet_TCP_AddSocket(groups[index / GROUP_SIZE], session.socket);
+    stats.connects++;
+
+    session.game = std::make_unique<MyGame>(true);
+    session.game->setup(nullptr);
+    session.game->setLogging(false);
+    session.reader = FrameReader();
+    session.held = 0;
+    session.role = 0;
+    if (config.binaryWire) {
+        session.game->send(CommandId::WIRE_BIN);
+    }
+    if (index == 0) {
+        recorder.markSession();
+    }
+    return true;
+}
+
+/**
+ * Closes a session's connection and schedules a reconnect.
+ * @param index the session.
+ * @param byBot true to tell the server with CON_CLOSE first, as a player leaving would.
+ * @param now SDL_GetTicks().
+ */
+void HeadlessClient::disconnect(size_t index, bool byBot, Uint32 now) {
+    Session& session = *sessions[index];
+    if (byBot) {
+        session.game->send(CommandId::CON_CLOSE);
+        flush(session);
+        stats.botDisconnects++;
+    }
+    else {
+        stats.serverDisconnects++;
+    }
+    SDLNet_TCP_DelSocket(groups[index / GROUP_SIZE], session.socket);
+    SDLNet_TCP_Close(session.socket);
+    session.socket = nullptr;
+    session.connectAt = now + RECONNECT_DELAY + random.next() % RECONNECT_DELAY;
+}
+
+/**
+ * Reads what is waiting on a session's socket and dispatches complete frames to its MyGame.
+ * @return false if the connection was closed.
+ */
+bool HeadlessClient::receive(Session& session) {
+    size_t writable;
+    char* buffer = session.reader.prepareWrite(1024, writable);
+    int received = SDLNet_TCP_Recv(session.socket, buffer, (int)writable);
+    if (received <= 0) {
+        return false;
+    }
+    session.reader.commitWrite(received);
+    stats.bytesReceived += received;
+
+    std::string_view payload;
+    std::string_view cmd;
+    MessageArgs args;
+    bool recording = recorder.isOpen() && &session == sessions[0].get();
+    while (session.reader.next(payload)) {
+        stats.framesReceived++;
+        if (recording) {
+            recorder.record(payload);
+        }
+        if (isBinarySnapshot(payload)) {
+            session.game->on_snapshot(payload);
+        }
+        else if (parseMessage(payload, cmd, args)) {
+            session.game->on_receive(cmd, args);
+        }
+    }
+    return true;
+}
+
+/**
+ * Runs one tick of a session: updates its MyGame, lets the bot choose keys, feeds them through
+ * MyGame::input as key events and sends whatever was queued.
+ * @param index the session.
+ * @param dt seconds per tick.
+ * @param now SDL_GetTicks().
+ */
+void HeadlessClient::step(size_t index, float dt, Uint32 now) {
+    Session& session = *sessions[index];
+    session.game->update(dt);
+    GameView view = session.game->getView(JitterBuffer::nowMicros());
+
+    if (view.role != session.role) {
+        stats.roles[view.role]++;
+        if (session.role == 3 && (view.role == 1 || view.role == 2)) {
+            stats.takeOvers++;
+        }
+        session.role = view.role;
+    }
+    if (view.gameOver && config.reconnectOnGameOver) {
+        disconnect(index, true, now);
+        return;
+    }
+    if (config.churn > 0 && random.unit() < config.churn / 60.0f / config.tickRate) {
+        disconnect(index, true, now);
+        return;
+    }
+
+    BotAction action = session.bot.act(view, dt);
+    if (action.direction != session.held) {
+        if (session.held != 0) {
+            press(session, session.held < 0 ? SDLK_w : SDLK_s, false);
+        }
+        if (action.direction != 0) {
+            press(session, action.direction < 0 ? SDLK_w : SDLK_s, true);
+        }
+        session.held = action.direction;
+    }
+    if (action.takeOver) {
+        press(session, SDLK_RETURN, true);
+        stats.takeOverRequests++;
+    }
+
+    if (!flush(session)) {
+        disconnect(index, false, now);
+    }
+}
+
+/**
+ * Sends everything a session has queued as one CLIENT_DATA message.
+ * @return false if the send failed.
+ */
+bool HeadlessClient::flush(Session& session) {
+    ClientCommand command;
+    if (!session.game->nextOutbound(command)) {
+        return true;
+    }
+    frame.clear();
+    do {
+        if (!frame.append(command)) {
+            if (!sendFrame(session)) {
+                return false;
+            }
+            frame.clear();
+            frame.append(command);
+        }
+    } while (session.game->nextOutbound(command));
+    return sendFrame(session);
+}
+
+/**
+ * Writes the frame built by flush() to a session's socket.
+ * @return false if the send failed.
+ */
+bool HeadlessClient::sendFrame(Session& session) {
+    stats.bytesSent += frame.size();
+    return SDLNet_TCP_Send(session.socket, frame.data(), (int)frame.size()) == (int)frame.size();
+}
+
+/**
+ * Feeds a synthetic key event to a session's MyGame, as the keyboard would in the windowed client.
+ */
+void HeadlessClient::press(Session& session, SDL_Keycode key, bool down) {
+    SDL_Event event;
+    SDL_memset(&event, 0, sizeof(event));
+    event.type = down ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.state = down ? SDL_PRESSED : SDL_RELEASED;
+    event.key.keysym.sym = key;
+    session.game->input(event);
+}
+
+/**
+ * Prints one progress line.
+ * @param elapsed ms since the run started.
+ */
+void HeadlessClient::report(Uint32 elapsed) {
+    size_t connected = 0;
+    for (const std::unique_ptr<Session>& session : sessions) {
+        if (session->socket != nullptr) {
+            connected++;
+        }
+    }
+    double seconds = elapsed / 1000.0;
+    printf("[%7.1fs] connected %zu/%zu  connects %llu failed %llu  closed by server %llu by bots %llu  "
+        "roles p1 %llu p2 %llu spec %llu  take-over %llu/%llu  rx %.1f KB/s %.0f frames/s\n",
+        seconds, connected, sessions.size(),
+        (unsigned long long)stats.connects, (unsigned long long)stats.connectFailures,
+        (unsigned long long)stats.serverDisconnects, (unsigned long long)stats.botDisconnects,
+        (unsigned long long)stats.roles[1], (unsigned long long)stats.roles[2], (unsigned long long)stats.roles[3],
+        (unsigned long long)stats.takeOvers, (unsigned long long)stats.takeOverRequests,
+        seconds > 0 ? stats.bytesReceived / 1024.0 / seconds : 0.0,
+        seconds > 0 ? stats.framesReceived / seconds : 0.0);
+}
@@ -0,0 +1,94 @@
+#ifndef __HEADLESS_CLIENT_H__
+#define __HEADLESS_CLIENT_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SDL_net.h"
+
+#include "BotPolicy.h"
+#include "Framing.h"
+#include "MyGame.h"
+#include "Replay.h"
+
+//Settings for a headless run.
+struct HeadlessConfig {
+    std::string host = "localhost";
+    Uint16 port = 55555;
+    int sessions = 100; //client connections hosted by this process
+    int connectRate = 50; //most new connections opened per second, so the server's accept loop isn't flooded
+    float duration = 0; //seconds to run for, 0 until killed
+    int tickRate = 60; //bot decisions and MyGame updates per second
+    bool binaryWire = false; //ask for binary snapshots
+    float churn = 0; //chance per session per minute of disconnecting and reconnecting
+    bool reconnectOnGameOver = true; //leave and rejoin when a match ends, as a player returning to the menu would
+    float reportInterval = 5; //seconds between progress lines
+    std::string recordPath; //record what the first session receives, empty for no recording
+    BotConfig bot;
+};
+
+//Counters for a headless run, summed over all sessions.
+struct HeadlessStats {
+    uint64_t connects = 0;
+    uint64_t connectFailures = 0;
+    uint64_t serverDisconnects = 0; //connections closed by the server or the network
+    uint64_t botDisconnects = 0; //connections the bots closed with CON_CLOSE
+    uint64_t roles[4] = {}; //ROLE messages received, indexed by role
+    uint64_t takeOverRequests = 0;
+    uint64_t takeOvers = 0; //spectators that became players
+    uint64_t framesReceived = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t bytesSent = 0;
+};
+
+//Runs many bot-driven client sessions in one thread, with no window, renderer or audio. Each
+//session has its own socket and its own headless MyGame, so the receive, snapshot, prediction
+//and outbound code paths are the same as the windowed client's. Sockets are polled in groups
+//small enough for select() on every platform.
+class HeadlessClient {
+    private:
+        static const int GROUP_SIZE = 64; //sockets per SDLNet_SocketSet, FD_SETSIZE on Windows
+
+        struct Session {
+            std::unique_ptr<MyGame> game;
+            TCPsocket socket = nullptr;
+            FrameReader reader;
+            BotPolicy bot;
+            int held = 0; //direction key currently held, see BotAction
+            int role = 0;
+            Uint32 connectAt = 0; //SDL_GetTicks() when the next connect attempt is due
+
+            Session(const BotConfig& config, uint32_t seed) : bot(config, seed) {}
+        };
+
+        HeadlessConfig config;
+        IPaddress address;
+        std::vector<std::unique_ptr<Session>> sessions;
+        std::vector<SDLNet_SocketSet> groups; //session i is in groups[i / GROUP_SIZE]
+        FastRandom random;
+        HeadlessStats stats;
+        ReplayWriter recorder; //the first session's messages, when recordPath is set
+        ClientDataFrame frame; //reused by every session's flush, sessions run on one thread
+
+        bool connect(size_t index, Uint32 now);
+        void disconnect(size_t index, bool byBot, Uint32 now);
+        bool receive(Session& session);
+        void step(size_t index, float dt, Uint32 now);
+        bool flush(Session& session);
+        bool sendFrame(Session& session);
+        void press(Session& session, SDL_Keycode key, bool down);
+        void report(Uint32 elapsed);
+
+    public:
+        HeadlessClient();
+        ~HeadlessClient();
+
+        bool run(const HeadlessConfig& settings);
+
+        HeadlessStats getStats() const {
+            return stats;
+        }
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "JitterBuffer.h"
+
+#include <cmath>
+
+JitterBuffer::JitterBuffer() {
+    stats.delay = config.delay;
+}
+
+/**
+ * Applies new tuning. The current delay restarts from the configured value.
+ * @param settings the tuning to use.
+ */
+void JitterBuffer::configure(const JitterConfig& settings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = settings;
+    stats.delay = config.delay;
+}
+
+const JitterBuffer::Entry& JitterBuffer::at(size_t age) const {
+    return ring[(newest + CAPACITY - age) % CAPACITY];
+}
+
+/**
+ * Adds a snapshot as it arrives and updates the jitter estimate (RFC 3550 style smoothing).
+ * @param fields positions indexed by SnapshotField.
+ * @param nowUs arrival time in microseconds.
+ */
+void JitterBuffer::push(const int16_t fields[SNAPSHOT_POSITIONS], uint64_t nowUs) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint64_t time = nowUs;
+    if (count > 0) {
+        float gap = nowUs > lastArrival ? (nowUs - lastArrival) / 1000.0f : 0.0f;
+        if (stats.interval == 0) {
+            stats.interval = gap;
+        }
+        stats.jitter += (std::fabs(gap - stats.interval) - stats.jitter) / 16;
+        stats.interval += (gap - stats.interval) / 16;
+
+        if (starved) {
+            stats.latePackets++;
+            starved = false;
+        }
+
+        //snapshots delivered in a burst after a stall are spread out rather than stacked on one instant
+        uint64_t minSpacing = (uint64_t)(stats.interval * 500);
+        if (time < at(0).time + minSpacing) {
+            time = at(0).time + minSpacing;
+        }
+
+        if (config.adaptive) {
+            float target = stats.interval + config.jitterMultiplier * stats.jitter;
+            target = target < config.minDelay ? config.minDelay : (target > config.maxDelay ? config.maxDelay : target);
+            stats.delay += (target - stats.delay) / 32; //ease towards the target so the render clock doesn't jump
+        }
+    }
+    lastArrival = nowUs;
+
+    newest = (newest + 1) % CAPACITY;
+    Entry& e = ring[newest];
+    e.time = time;
+    for (int i = 0; i < SNAPSHOT_POSITIONS; i++) {
+        e.fields[i] = fields[i];
+    }
+    if (count < CAPACITY) {
+        count++;
+    }
+}
+
+/**
+ * Gets positions for the current frame: interpolated between the snapshots either side of
+ * (now - delay), or extrapolated for a bounded time past the newest one.
+ * @param nowUs current time in microseconds.
+ * @param out set to positions indexed by SnapshotField.
+ * @return false if nothing has been received yet.
+ */
+bool JitterBuffer::sample(uint64_t nowUs, float out[SNAPSHOT_POSITIONS]) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (count == 0) {
+        return false;
+    }
+    uint64_t sinceLast = lastSample == 0 ? 0 : nowUs - lastSample;
+    lastSample = nowUs;
+
+    const Entry& latest = at(0);
+    if (!config.enabled || count == 1) {
+        for (int i = 0; i < SNAPSHOT_POSITIONS; i++) {
+            out[i] = latest.fields[i];
+        }
+        stats.depth = 0;
+        return true;
+    }
+
+    uint64_t delayUs = (uint64_t)(stats.delay * 1000);
+    uint64_t renderTime = nowUs > delayUs ? nowUs - delayUs : 0;
+
+    if (renderTime >= latest.time) { //buffer ran dry, carry on from the last two snapshots
+        const Entry& previous = at(1);
+        float span = (float)(latest.time - previous.time);
+        float ahead = (float)(renderTime - latest.time);
+        float limit = config.maxExtrapolation * 1000;
+        if (ahead > limit) {
+            ahead = limit;
+        }
+        else {
+            stats.extrapolatedUs += sinceLast;
+        }
+        float t = span > 0 ? ahead / span : 0;
+        for (int i = 0; i < SNAPSHOT_POSITIONS; i++) {
+            out[i] = latest.fields[i] + (latest.fields[i] - previous.fields[i]) * t;
+        }
+        starved = true;
+        stats.depth = 0;
+        return true;
+    }
+
+    //walk back from the newest to the pair that brackets the render time
+    size_t age = 1;
+    while (age < count && at(age).time > renderTime) {
+        age++;
+    }
+    stats.depth = age;
+    if (age == count) { //render time is older than anything kept
+        const Entry& oldest = at(count - 1);
+        for (int i = 0; i < SNAPSHOT_POSITIONS; i++) {
+            out[i] = oldest.fields[i];
+        }
+        return true;
+    }
+    const Entry& before = at(age);
+    const Entry& after = at(age - 1);
+    float t = (float)(renderTime - before.time) / (float)(after.time - before.time);
+    for (int i = 0; i < SNAPSHOT_POSITIONS; i++) {
+        out[i] = before.fields[i] + (after.fields[i] - before.fields[i]) * t;
+    }
+    return true;
+}
+
+/**
+ * Forgets all snapshots, used when a new connection is made.
+ */
+void JitterBuffer::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    count = 0;
+    lastSample = 0;
+    starved = false;
+    JitterStats reset;
+    reset.delay = config.delay;
+    stats = reset;
+}
+
+JitterStats JitterBuffer::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,71 @@
+#ifndef __JITTER_BUFFER_H__
+#define __JITTER_BUFFER_H__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "Snapshot.h"
+
+//Tuning for the snapshot jitter buffer. Times are in milliseconds.
+struct JitterConfig {
+    bool enabled = true; //false renders the newest snapshot as soon as it arrives
+    bool adaptive = true; //move the delay towards what measured jitter needs
+    float delay = 50; //starting render delay behind real time
+    float minDelay = 20;
+    float maxDelay = 250;
+    float maxExtrapolation = 100; //longest time to extrapolate when snapshots stop arriving
+    float jitterMultiplier = 3; //adaptive delay is one snapshot interval plus this many times the jitter
+};
+
+//Counters exposed for tuning on lossy links.
+struct JitterStats {
+    size_t depth = 0; //snapshots buffered ahead of the render time
+    uint64_t latePackets = 0; //snapshots that arrived after the render time had run past the newest one
+    uint64_t extrapolatedUs = 0; //total time spent extrapolating
+    float delay = 0; //current render delay, ms
+    float jitter = 0; //smoothed inter-arrival jitter, ms
+    float interval = 0; //smoothed inter-arrival time, ms
+};
+
+//Timestamped ring of snapshots. The renderer samples it a fixed delay behind real time and
+//interpolates between the two snapshots either side of that moment.
+//push() and sample() may be called from different threads.
+class JitterBuffer {
+    private:
+        static const size_t CAPACITY = 32;
+
+        struct Entry {
+            uint64_t time; //microseconds, arrival time spread out if snapshots arrived in a burst
+            float fields[SNAPSHOT_POSITIONS];
+        };
+
+        std::mutex mutex;
+        JitterConfig config;
+        Entry ring[CAPACITY];
+        size_t count = 0;
+        size_t newest = 0; //index of the most recent entry
+        uint64_t lastArrival = 0;
+        uint64_t lastSample = 0; //time of the previous sample(), for counting extrapolated time
+        bool starved = false; //the render time has passed the newest snapshot
+        JitterStats stats;
+
+        const Entry& at(size_t age) const; //0 is the newest
+
+    public:
+        JitterBuffer();
+
+        void configure(const JitterConfig& settings);
+        void push(const int16_t fields[SNAPSHOT_POSITIONS], uint64_t nowUs);
+        bool sample(uint64_t nowUs, float out[SNAPSHOT_POSITIONS]);
+        void clear();
+        JitterStats getStats();
+
+        static uint64_t nowMicros() {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+};
+
+#endif
@@ -1,194 +1,915 @@
+#include <atomic>
+#include <cstring>
+
 #include "SDL_net.h"
 
 #include "MyGame.h"
+#include "Backoff.h"
+#include "NetTelemetry.h"
+#include "FrameClock.h"
+#include "Framing.h"
+#include "HeadlessClient.h"
+#include "MatchWall.h"
+#include "Message.h"
+#include "NetReactor.h"
+#include "Profiler.h"
+#include "Replay.h"
+#include "Snapshot.h"
+#include "UdpLink.h"
 
 using namespace std;
 
-const char* IP_NAME = "localhost";
-const Uint16 PORT = 55555;
+//settings chosen on the command line.
+struct Options {
+    string host = "localhost"; //the server to connect to
+    Uint16 port = 55555;
+    BackoffConfig reconnect; //rejoining the server after the connection drops
+    bool binaryWire = false; //ask the server for binary snapshots
+    bool udp = false; //connect over the UDP transport instead of TCP
+    JitterConfig interpolation; //how received positions are buffered before rendering
+    bool prediction = true; //simulate our own bat ahead of the server
+    bool textCache = true; //keep rendered text between frames
+    PacingConfig pacing; //simulation rate and frame pacing
+    bool headless = false; //run bot sessions instead of the window
+    HeadlessConfig bots; //the bot sessions to run when headless
+    string recordPath; //record every received message to this file
+    string replayPath; //play this recording instead of connecting
+    float replaySpeed = 1; //playback rate, 0 for one tick per frame as fast as possible
+    uint32_t replayFrom = 0; //tick to start playback at
+    string telemetryPath; //export network telemetry to this file, CSV or .json lines
+    float telemetryInterval = 1; //seconds per telemetry sample
+    string profileTracePath; //write profiled scopes to this file as Chrome trace events
+    int sendBatchUs = 0; //how long the first queued command is held for others to join its send
+    string assetBundle; //read assets from this pong_pack bundle instead of the res directory
+    bool syncAssets = false; //load assets before the first frame instead of on a worker
+    bool lazyRender = false; //only draw frames that show something new, sleeping in between
+    WallConfig wall; //matches to show tiled in one window, none for the single match client
+} options;
 
 enum class screenProg { 
-    MENU, GAME, CONN_ERROR, GAME_OVER, EXIT
+    MENU, CONNECTING, GAME, RECONNECTING, CONN_ERROR, GAME_OVER, EXIT
 };
 screenProg currentScreen = screenProg::MENU; //what screen should be being displayed
 
 MyGame* game = new MyGame();
+NetReactor reactor; //the network thread serving every TCP connection
+uint32_t connection = 0; //the reactor's id for the match's connection, 0 if none
+std::atomic<bool> udpLost{ false }; //the UDP receive thread saw the connection end
+std::atomic<bool> udpHeard{ false }; //the UDP receive thread got the server's first datagram
+bool udpReady = false; //resolved, run_game() starts a UDP session
+bool udpSession = false; //a UDP session is running, see run_udp_session()
+bool leaveLoop = false; //return from loop() without a screen change, to start or end a UDP session
+IPaddress udpServer{}; //the server, once the reactor has resolved it for --udp
+SpscQueue<NetEvent, 1024> udpEvents; //messages from the UDP receive thread, handled by drainNetwork()
+std::atomic<uint64_t> udpOversized{ 0 }; //UDP messages too long for a NetEvent, dropped
+Backoff backoff((uint32_t)commandClock()); //waits between attempts to reconnect after a drop
+uint64_t connectStartedAt = 0; //microseconds, when connecting or reconnecting began
+uint64_t retryAt = 0; //microseconds, when the next reconnect attempt is due
+string connectError; //why the last attempt failed, shown while reconnecting
+
+//Reconnects after a drop over the whole run.
+struct ReconnectStats {
+    uint64_t drops = 0;
+    uint64_t reconnects = 0;
+    uint64_t gaveUp = 0;
+    uint64_t attempts = 0;
+    uint64_t totalUs = 0; //time to reconnect: the drop noticed until connected again
+    uint64_t maxUs = 0;
+} reconnectStats;
+FrameClock frameClock; //fixed simulation steps and frame pacing for loop()
+Uint32 networkEvent = 0; //SDL event type that wakes a lazy loop() when messages arrive, 0 if not lazy
+const Uint32 LAZY_IDLE_WAIT = 250; //ms a lazy loop() sleeps at most between checks with nothing to draw
+
+//Time loop() spent asleep in lazy mode over the whole run.
+struct LazyStats {
+    uint64_t idleWaits = 0;
+    uint64_t idleUs = 0;
+} lazyStats;
+ReplayWriter recorder; //open when --record is given
+NetTelemetry telemetry; //measurements of the current connection, see F4
+TelemetryExporter telemetryExport; //open when --telemetry is given
+uint64_t nextTelemetrySample = 0; //microseconds
+uint64_t startedAt = 0; //run_game() started, microseconds, for reporting cold start
+uint64_t firstFrameAt = 0; //the first frame was presented
+
+//Totals for the TCP send path over the whole run, only touched by whichever thread is sending.
+struct SendStats {
+    uint64_t sendCalls = 0; //SDLNet_TCP_Send calls, one per frame
+    uint64_t commands = 0;
+    uint64_t waitTotalUs = 0; //key-to-wire: queued by MyGame until handed to the socket
+    uint64_t waitMaxUs = 0;
+    uint64_t firstSendUs = 0;
+    uint64_t lastSendUs = 0;
+} sendStats;
 
 /**
- * When received message from server.
- * @param socket_ptr pointer to socket.
+ * Passes one message from the server to MyGame, recording it first if --record was given, and
+ * times it for telemetry. PONG answers our own PING, so it stops here.
+ * @param payload the message, binary snapshot or ASCII.
+ * @param wireBytes its size on the wire, including framing.
+ * @param arrivalUs JitterBuffer::nowMicros() when it was read from the socket, 0 for now.
  */
-static int on_receive(void* socket_ptr) {
-    TCPsocket socket = (TCPsocket)socket_ptr;
+static void dispatch(string_view payload, size_t wireBytes, uint64_t arrivalUs = 0) {
+    PROFILE_SCOPE("dispatch");
+    string_view cmd;
+    MessageArgs args;
 
-    const int message_length = 1024;
+    if (recorder.isOpen()) {
+        recorder.record(payload);
+    }
+    uint64_t start = commandClock();
+    uint64_t arrived = arrivalUs != 0 ? arrivalUs : start / 1000;
+    TelemetryKind kind = telemetryKind(payload);
+    bool binary = isBinarySnapshot(payload); //decoded inside on_snapshot, so counted as handling
+    bool parsed = binary || parseMessage(payload, cmd, args);
+    uint64_t parsedAt = commandClock();
 
-    char message[message_length];
-    int received;
+    game->setArrival(arrivalUs);
+    if (binary) {
+        game->on_snapshot(payload);
+    }
+    else if (parsed && kind == KIND_PONG) {
+        if (!args.empty()) {
+            telemetry.onPong(args[0], arrived);
+        }
+    }
+    else if (parsed) {
+        game->on_receive(cmd, args);
+    }
+    game->setArrival(0);
+    uint64_t handledAt = commandClock();
+    telemetry.onReceived(kind, wireBytes, parsedAt - start, handledAt - parsedAt, arrived);
+}
 
-    do {
-        received = SDLNet_TCP_Recv(socket, message, message_length);
+/**
+ * Ends a telemetry period if one is due: updates the F4 overlay and appends to the export file.
+ */
+static void sampleTelemetry() {
+    uint64_t now = commandClock() / 1000;
+    if (now < nextTelemetrySample) {
+        return;
+    }
+    float interval = options.telemetryInterval > 0 ? options.telemetryInterval : 1;
+    nextTelemetrySample = now + (uint64_t)(interval * 1e6);
+    NetSample sample = telemetry.sample(now);
+    game->setNetSample(sample);
+    telemetryExport.write(sample);
+}
 
-        if (received != -1) {
-            message[received] = '\0';
-        }
-        else if (received >= message_length) {
-            currentScreen = screenProg::EXIT;
-            std::cout << "An unknown error occurred. 'Received' was out of array range" << std::endl;
-        }
-        else {
-            if (currentScreen != screenProg::EXIT) {
-                currentScreen = screenProg::CONN_ERROR;
-                game->setErrorMessage("Connection was terminated.");
-            }
-        }
-        
-        char* pch = strtok(message, ",");
+/**
+ * Starts telemetry for a new connection.
+ */
+static void resetTelemetry() {
+    uint64_t now = commandClock() / 1000;
+    telemetry.reset(now);
+    float interval = options.telemetryInterval > 0 ? options.telemetryInterval : 1;
+    nextTelemetrySample = now + (uint64_t)(interval * 1e6);
+}
 
-        // get the command, which is the first string in the message
-        if (pch == NULL) {
-            pch = strtok("CLOSING", ",");
-            currentScreen = screenProg::EXIT;
-        }
-        string cmd(pch);
+/**
+ * Takes every queued command for sending, adding a PING if one is due.
+ * @param commands filled with the commands, in order.
+ * @return false if there is nothing to send.
+ */
+static bool takeOutbound(vector<ClientCommand>& commands) {
+    size_t depth = game->getOutboundDepth();
+    ClientCommand command;
+    uint64_t totalWait = 0;
+    uint64_t maxWait = 0;
 
-        // then get the arguments to the command
-        vector<string> args;
+    commands.clear();
+    while (game->nextOutbound(command)) {
+        uint64_t now = commandClock();
+        uint64_t wait = now > command.created ? (now - command.created) / 1000 : 0;
+        totalWait += wait;
+        maxWait = wait > maxWait ? wait : maxWait;
+        commands.push_back(command);
+    }
+    size_t queued = commands.size();
+    uint32_t pingId;
+    uint64_t now = commandClock();
+    if (telemetry.pingDue(now / 1000, pingId)) {
+        commands.push_back(ClientCommand{ CommandId::PING, pingId, now });
+    }
+    if (commands.empty()) {
+        return false;
+    }
+    telemetry.onQueued(queued, depth, totalWait, maxWait);
+    sendStats.commands += queued;
+    sendStats.waitTotalUs += totalWait;
+    sendStats.waitMaxUs = maxWait > sendStats.waitMaxUs ? maxWait : sendStats.waitMaxUs;
+    return true;
+}
 
-        while (pch != NULL) {
-            pch = strtok(NULL, ",");
+/**
+ * Wakes a lazy loop() that may be asleep, when the UDP receive thread has queued something.
+ */
+static void wakeForUdp() {
+    if (networkEvent != 0) {
+        SDL_Event wake;
+        SDL_zero(wake);
+        wake.type = networkEvent;
+        SDL_PushEvent(&wake);
+    }
+}
 
-            if (pch != NULL) {
-                args.push_back(string(pch));
-            }
-        }
+/**
+ * When received datagrams from server over UDP. The link's session has already dropped stale
+ * snapshots and put reliable messages in order, so each message is queued for the main thread as
+ * it comes, as the reactor does for TCP. Runs until the link is stopped.
+ * @param link_ptr pointer to the UdpLink.
+ */
+static int on_receive_udp(void* link_ptr) {
+    UdpLink* link = (UdpLink*)link_ptr;
+    PROFILE_THREAD("receive");
 
-        game->on_receive(cmd, args);
+    const Uint32 silence_limit = 15000; //three CONN_CHECK intervals without a datagram
+    const Uint32 reply_limit = 3000; //the greeting is acknowledged at once by a live server
 
-    } while (received > 0 && currentScreen == screenProg::GAME);
+    vector<string> delivered;
+    NetEvent event;
+    bool heard = false;
+
+    while (link->isRunning()) {
+        delivered.clear();
+        int read = link->receive(10, delivered);
+        if (read < 0 || link->isSilent(heard ? silence_limit : reply_limit)) {
+            udpLost = true; //the main thread changes the screen, see drainNetwork()
+            wakeForUdp();
+            break;
+        }
+        if (read > 0 && !heard) {
+            heard = true;
+            udpHeard = true; //connected from here, see udpAnswered()
+            wakeForUdp();
+        }
+        uint64_t now = JitterBuffer::nowMicros();
+        for (const string& message : delivered) {
+            if (message.size() > NET_EVENT_PAYLOAD) {
+                udpOversized++;
+                continue;
+            }
+            event.size = (uint16_t)message.size();
+            event.wireBytes = (uint32_t)(UDP_HEADER_SIZE + message.size());
+            event.receivedUs = now;
+            memcpy(event.payload, message.data(), message.size());
+            while (!udpEvents.push(event) && link->isRunning()) {
+                SDL_Delay(1); //the main thread is behind, hold the rest until it catches up
+            }
+        }
+        if (!delivered.empty()) {
+            wakeForUdp();
+        }
+    }
 
     return 0;
 }
 
 /**
- * When sending to server.
- * @param socket_ptr pointer to socket.
+ * Writes a framed CLIENT_DATA message to the socket with one send call.
+ * @param socket the socket to write to.
+ * @param frame the message.
+ * @return false if the send failed.
  */
-static int on_send(void* socket_ptr) {
-    TCPsocket socket = (TCPsocket)socket_ptr;
+static bool sendFrame(TCPsocket socket, const ClientDataFrame& frame) {
+    bool sent = SDLNet_TCP_Send(socket, frame.data(), (int)frame.size()) == (int)frame.size();
 
-    while (currentScreen == screenProg::GAME) {
-        if (game->messages.size() > 0) {
-            string message = "CLIENT_DATA";
+    uint64_t now = commandClock() / 1000;
+    if (sendStats.sendCalls == 0) {
+        sendStats.firstSendUs = now;
+    }
+    sendStats.lastSendUs = now;
+    sendStats.sendCalls++;
+    telemetry.onSent(frame.size());
+    return sent;
+}
 
-            for (auto m : game->messages) {
-                message += "," + m;
+/**
+ * Sends every queued command to the server as one CLIENT_DATA message, or as few as fit if
+ * there are too many for one frame. Built in a reused buffer, so nothing is allocated.
+ * @param socket the socket to write to.
+ * @return false if a send failed.
+ */
+static bool flushOutbound(TCPsocket socket) {
+    PROFILE_SCOPE("flush");
+    static vector<ClientCommand> commands;
+    static ClientDataFrame frame;
+    if (!takeOutbound(commands)) {
+        return true;
+    }
+    frame.clear();
+    for (const ClientCommand& command : commands) {
+        if (!frame.append(command)) {
+            if (!sendFrame(socket, frame)) {
+                return false;
             }
+            frame.clear();
+            frame.append(command);
+        }
+    }
+    return sendFrame(socket, frame);
+}
 
-            game->messages.clear();
+/**
+ * Sends what the match has queued, called by the reactor thread whenever it wakes. With
+ * --send-batch, the first command is held back that long so any queued after it, such as a second
+ * key pressed in the same frame, go in the same send; the reactor serves its other connections
+ * meanwhile.
+ * @param socket the match's connection.
+ * @param holdUs set to how much longer the batch window has to run, nullptr when closing.
+ * @return false if a send failed.
+ */
+static bool flushConnection(void*, TCPsocket socket, uint64_t* holdUs) {
+    static uint64_t heldSince = 0; //microseconds, when the batch window opened, 0 if none is open
+    if (holdUs != nullptr && options.sendBatchUs > 0 && game->getOutboundDepth() > 0) {
+        uint64_t now = commandClock() / 1000;
+        if (heldSince == 0) {
+            heldSince = now;
+        }
+        if (now - heldSince < (uint64_t)options.sendBatchUs) {
+            *holdUs = options.sendBatchUs - (now - heldSince);
+            return true;
+        }
+    }
+    heldSince = 0;
+    return flushOutbound(socket);
+}
 
-            cout << "Sending_TCP: " << message << endl;
+/**
+ * Sends every queued command over UDP, each on the channel it belongs to.
+ * @param link the link to send on.
+ */
+static void flushOutboundUdp(UdpLink& link) {
+    PROFILE_SCOPE("flush");
+    static vector<ClientCommand> commands;
+    if (!takeOutbound(commands)) {
+        return;
+    }
+    static ClientDataFrame frame;
+    link.sendCommands(commands.data(), commands.size());
 
-            SDLNet_TCP_Send(socket, message.c_str(), message.length());
+    size_t size = 0; //the link splits it by channel, so this is the size before that
+    frame.clear();
+    for (const ClientCommand& command : commands) {
+        if (!frame.append(command)) {
+            size += frame.payload().size();
+            frame.clear();
+            frame.append(command);
         }
+    }
+    size += frame.payload().size();
+    telemetry.onSent(UDP_HEADER_SIZE + size);
+}
 
-        SDL_Delay(1);
+/**
+ * When sending to server over UDP. Also wakes for retransmits and input repeats, so the sleep
+ * is bounded by what the link has pending.
+ * @param link_ptr pointer to the UdpLink.
+ */
+static int on_send_udp(void* link_ptr) {
+    UdpLink* link = (UdpLink*)link_ptr;
+    PROFILE_THREAD("send");
+
+    while (link->isRunning()) {
+        game->waitOutbound((int)link->pumpInterval());
+        flushOutboundUdp(*link);
+        PROFILE_SCOPE("pump");
+        link->pump();
     }
 
     return 0;
 }
 
 /**
- * Send final message to server to indicate closure with User intent.
- * @param socket_ptr pointer to socket.
+ * Asks the reactor to connect to the server, or with --udp only to resolve it, as the UDP session
+ * starts once the address is known and counts as connected once the server answers; loop() shows
+ * progress until then.
  */
-void sendTerminate(void* socket_ptr) {
-    TCPsocket socket = (TCPsocket)socket_ptr;
-
-        if (game->messages.size() > 0) {
-            string message = "CLIENT_DATA";
+static void beginConnect() {
+    if (options.udp) {
+        connection = reactor.resolve(options.host, options.port);
+    }
+    else {
+        connection = reactor.open(options.host, options.port, flushConnection, nullptr);
+    }
+}
 
-            for (auto m : game->messages) {
-                message += "," + m;
-            }
+/**
+ * Starts a new connection's session once the reactor has made it, or over UDP once the server has
+ * first answered: a fresh recording session and
+ * telemetry, and after a drop, the match resumed and the time it took reported.
+ */
+static void onConnected() {
+    uint64_t now = commandClock() / 1000;
+    recorder.markSession();
+    resetTelemetry();
+    if (currentScreen == screenProg::RECONNECTING) {
+        uint64_t took = now - connectStartedAt;
+        reconnectStats.reconnects++;
+        reconnectStats.totalUs += took;
+        reconnectStats.maxUs = took > reconnectStats.maxUs ? took : reconnectStats.maxUs;
+        printf("Reconnected to %s:%u in %.0fms, attempt %d\n", options.host.c_str(), (unsigned)options.port,
+            took / 1000.0, backoff.getAttempt());
+        game->resumeMatch();
+    }
+    else {
+        printf("Connected to %s:%u in %.0fms\n", options.host.c_str(), (unsigned)options.port, (now - connectStartedAt) / 1000.0);
+    }
+    backoff.reset();
+    if (options.binaryWire) {
+        game->send(CommandId::WIRE_BIN);
+    }
+    currentScreen = screenProg::GAME;
+}
 
-            game->messages.clear();
+/**
+ * Handles the match's connection closing without us asking. A drop during a match starts
+ * reconnecting, with a wait from the backoff before each attempt; a failed first connect, or
+ * running out of attempts, shows the error screen.
+ * @param reason why, from the reactor.
+ */
+static void onClosed(string_view reason) {
+    uint64_t now = commandClock() / 1000;
+    connection = 0;
+    connectError = string(reason);
+    if (currentScreen == screenProg::GAME && game->getWinner() == Winner::NONE && options.reconnect.attempts > 0) {
+        reconnectStats.drops++;
+        connectStartedAt = now;
+        retryAt = now + backoff.next() * (uint64_t)1000;
+        currentScreen = screenProg::RECONNECTING;
+    }
+    else if (currentScreen == screenProg::RECONNECTING && !backoff.exhausted()) {
+        retryAt = now + backoff.next() * (uint64_t)1000;
+    }
+    else if (currentScreen == screenProg::RECONNECTING) {
+        reconnectStats.gaveUp++;
+        currentScreen = screenProg::CONN_ERROR;
+        game->setErrorMessage("Could not reconnect: " + connectError);
+    }
+    else if (currentScreen == screenProg::CONNECTING) {
+        printf("Could not connect to %s:%u: %s\n", options.host.c_str(), (unsigned)options.port, connectError.c_str());
+        currentScreen = screenProg::CONN_ERROR;
+        game->setErrorMessage(connectError);
+    }
+    else if (currentScreen == screenProg::GAME) {
+        currentScreen = screenProg::CONN_ERROR;
+        game->setErrorMessage("Connection was terminated.");
+    }
+}
 
-            cout << "Sending_TCP: " << message << endl;
+/**
+ * Counts a UDP session as connected, or reconnected, when the server is first heard from. Until then
+ * the attempt has not succeeded, and silence fails it as a refused TCP connect would.
+ */
+static void udpAnswered() {
+    if (udpSession && (currentScreen == screenProg::CONNECTING || currentScreen == screenProg::RECONNECTING)) {
+        onConnected();
+    }
+}
 
-            SDLNet_TCP_Send(socket, message.c_str(), message.length());
+/**
+ * Handles everything the reactor, or the UDP receive thread, has received for the match since the
+ * last frame, on the main thread, so MyGame and the screen are only changed here. While reconnecting, makes the next
+ * attempt once its wait is over.
+ */
+static void drainNetwork() {
+    PROFILE_SCOPE("network");
+    NetEvent event;
+    if (udpHeard.exchange(false)) {
+        udpAnswered();
+    }
+    while (udpEvents.pop(event)) {
+        udpAnswered(); //the message may be popped before udpHeard was seen
+        dispatch(event.view(), event.wireBytes, event.receivedUs);
+    }
+    while (reactor.next(event)) {
+        if (event.connection != connection) {
+            continue; //a connection we have closed
+        }
+        if (event.type == NetEventType::OPENED) {
+            onConnected();
+        }
+        else if (event.type == NetEventType::RESOLVED) {
+            memcpy(&udpServer, event.payload, sizeof(udpServer));
+            connection = 0; //nothing more follows for a lookup
+            udpReady = true;
+            leaveLoop = true; //run_game() starts the UDP session, which waits for the server to answer
+        }
+        else if (event.type == NetEventType::MESSAGE) {
+            dispatch(event.view(), event.wireBytes, event.receivedUs);
         }
+        else {
+            onClosed(event.view());
+        }
+    }
+    if (currentScreen == screenProg::RECONNECTING && connection == 0 && !udpReady && !udpSession
+        && commandClock() / 1000 >= retryAt) {
+        reconnectStats.attempts++;
+        beginConnect();
+    }
+    if (udpLost.exchange(false) && udpSession) {
+        leaveLoop = true; //run_udp_session() ends, run_game() makes any next attempt
+        onClosed(currentScreen == screenProg::GAME ? "Connection was terminated." : "No reply from the server.");
+    }
+}
 
-        SDL_Delay(1);
+/**
+ * The line shown instead of the match while connecting or reconnecting.
+ * @param line filled with the text.
+ * @param size its size.
+ */
+static void connectStatus(char* line, size_t size) {
+    uint64_t now = commandClock() / 1000;
+    if (currentScreen == screenProg::CONNECTING) {
+        snprintf(line, size, "Connecting to %s:%u... %.1fs", options.host.c_str(), (unsigned)options.port,
+            (now - connectStartedAt) / 1e6);
+    }
+    else if (connection == 0 && retryAt > now) {
+        snprintf(line, size, "Connection lost, retrying %s:%u in %.1fs (attempt %d of %d)", options.host.c_str(),
+            (unsigned)options.port, (retryAt - now) / 1e6, backoff.getAttempt(), backoff.getAttempts());
+    }
+    else {
+        snprintf(line, size, "Connection lost, reconnecting to %s:%u... (attempt %d of %d)", options.host.c_str(),
+            (unsigned)options.port, backoff.getAttempt(), backoff.getAttempts());
+    }
 }
 
 /**
  * Handle the loop of MyGame, including what screen should be displayed.
  * break on screen change.
+ * With --lazy a frame is only drawn when the game has something new to show; otherwise the loop
+ * sleeps until an event arrives, input or a message from the network, or LAZY_IDLE_WAIT passes.
  * @param renderer pointer to the renderer to use.
  */
 void loop(SDL_Renderer* renderer) {
     SDL_Event event;
     screenProg initial = currentScreen;
+    bool drawn = false; //a frame of this screen has been presented
+    leaveLoop = false; //a request left over from a loop() that ended on a screen change
     if (currentScreen == screenProg::CONN_ERROR) {
         game->setErrorScreen();
     }
+    frameClock.reset(); //don't simulate the time spent outside the loop, e.g. connecting
     while (initial == currentScreen) {
-        // input
-        while (SDL_PollEvent(&event)) {
-            if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0) {
-                game->input(event);
+        PROFILE_SCOPE("frame");
+        int steps = frameClock.beginFrame();
 
-                if (event.key.state == SDL_PRESSED) { //only when pressed, not released
-                    switch (event.key.keysym.sym) {
-                    case SDLK_ESCAPE:
-                        currentScreen = screenProg::EXIT;
-                        break;
-                    case SDLK_RETURN:
-                        if (currentScreen == screenProg::MENU) {
-                            currentScreen = screenProg::GAME;
-                            game->setMenu();
-                        }
-                        if (currentScreen == screenProg::CONN_ERROR) {
-                            currentScreen = screenProg::MENU;
-                            game->setMenu();
-                            game->setErrorScreen();
-                            game->resetWin();
-                        }
-                        if (currentScreen == screenProg::GAME_OVER) {
-                            currentScreen = screenProg::MENU;
-                            game->setMenu();
-                            game->resetWin();
+        // input, read as late as possible before the frame is simulated
+        {
+            PROFILE_SCOPE("poll events");
+            while (SDL_PollEvent(&event)) {
+                if ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) && event.key.repeat == 0) {
+                    SDL_Keycode key = event.key.keysym.sym;
+                    bool moves = key == SDLK_w || key == SDLK_s;
+                    if (!moves || currentScreen == screenProg::GAME) { //bat keys outside a match would queue up and go out stale on connecting
+                        game->input(event);
+                    }
+
+                    if (event.key.state == SDL_PRESSED) { //only when pressed, not released
+                        switch (event.key.keysym.sym) {
+                        case SDLK_ESCAPE:
+                            currentScreen = screenProg::EXIT;
+                            break;
+                        case SDLK_RETURN:
+                            if (currentScreen == screenProg::MENU) {
+                                currentScreen = screenProg::CONNECTING;
+                                connectStartedAt = commandClock() / 1000;
+                                game->setMenu();
+                            }
+                            if (currentScreen == screenProg::CONN_ERROR) {
+                                currentScreen = screenProg::MENU;
+                                game->setMenu();
+                                game->setErrorScreen();
+                                game->resetWin();
+                            }
+                            if (currentScreen == screenProg::GAME_OVER) {
+                                currentScreen = screenProg::MENU;
+                                game->setMenu();
+                                game->resetWin();
+                            }
+                            break;
+                        default:
+                            break;
                         }
-                        break;
-                    default:
-                        break;
                     }
                 }
+                if (event.type == SDL_WINDOWEVENT) {
+                    game->markDirty(); //uncovered or resized, the window needs drawing again
+                }
+                if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+                    game->resetScreenCache(); //the cached screen's contents were lost
+                }
+                if (event.type == SDL_QUIT) {
+                    currentScreen = screenProg::EXIT;
+                    break;
+                }
             }
-            if (event.type == SDL_QUIT) {
-                currentScreen = screenProg::EXIT;
-                break;
-            }
+        }
+        drainNetwork();
+        if (connection != 0 && game->getOutboundDepth() > 0) {
+            reactor.wake(); //inputs and replies go out now rather than when the reactor next wakes
         }
         //exit loop immediately if expected screen no longer equals the same as when the loop was started.
         if (currentScreen != initial) {
             break;
         }
-        if (game->getWinCondition() != "0") {
+        if (leaveLoop) {
+            leaveLoop = false;
+            break;
+        }
+        if (game->getWinner() != Winner::NONE) {
             currentScreen = screenProg::GAME_OVER;
         }
+
+        bool connecting = currentScreen == screenProg::CONNECTING || currentScreen == screenProg::RECONNECTING;
+        if (options.lazyRender && drawn && !connecting && !game->needsRedraw(JitterBuffer::nowMicros())) {
+            PROFILE_SCOPE("idle");
+            uint64_t asleep = commandClock();
+            SDL_WaitEventTimeout(nullptr, LAZY_IDLE_WAIT); //leaves the event queued for the next poll
+            lazyStats.idleWaits++;
+            lazyStats.idleUs += (commandClock() - asleep) / 1000;
+            frameClock.reset(); //nothing moved while asleep, so there is nothing to catch up on
+            if (currentScreen == screenProg::GAME) {
+                sampleTelemetry();
+            }
+            Profiler::collect();
+            continue;
+        }
+        drawn = true;
+
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+
+        for (int i = 0; i < steps; i++) {
+            game->update(frameClock.stepSeconds());
+        }
+
+        if (currentScreen == screenProg::CONNECTING || currentScreen == screenProg::RECONNECTING) {
+            char status[128];
+            connectStatus(status, sizeof(status));
+            game->renderStatus(renderer, status);
+        }
+        else {
+            game->render(renderer, frameClock.alpha());
+        }
+
+        {
+            PROFILE_SCOPE("present");
+            SDL_RenderPresent(renderer);
+        }
+        if (firstFrameAt == 0) {
+            firstFrameAt = commandClock() / 1000;
+            printf("First frame presented %.1fms after start\n", (firstFrameAt - startedAt) / 1000.0);
+        }
+
+        {
+            PROFILE_SCOPE("pace");
+            frameClock.endFrame();
+        }
+        game->setFrameStats(frameClock.getStats());
+        if (currentScreen == screenProg::GAME) {
+            sampleTelemetry();
+        }
+        Profiler::collect();
+    }
+}
+
+/**
+ * Plays one connection over the UDP transport. Started by run_game() once the server was resolved,
+ * in CONNECTING or RECONNECTING; the screen goes to GAME when the server first answers, see
+ * udpAnswered(), and the session lasts until it leaves GAME or the server never answers.
+ * @param renderer pointer to the renderer to use.
+ * @param ip the server.
+ */
+static void run_udp_session(SDL_Renderer* renderer, const IPaddress& ip) {
+    UdpLink link;
+
+    if (!link.open(ip)) {
+        currentScreen = screenProg::CONN_ERROR;
+        game->setErrorMessage("Could not open a UDP socket.");
+        return;
+    }
+    udpLost = false;
+    udpHeard = false;
+    udpSession = true;
+
+    link.setRunning(true);
+    SDL_Thread* receiveThread = SDL_CreateThread(on_receive_udp, "ConnectionReceiveThread", (void*)&link);
+    SDL_Thread* sendThread = SDL_CreateThread(on_send_udp, "ConnectionSendThread", (void*)&link);
+
+    screenProg shown;
+    do { //waiting for the server to answer, then the match
+        shown = currentScreen;
+        loop(renderer);
+    } while (currentScreen == screenProg::GAME && shown != screenProg::GAME);
+
+    udpSession = false;
+    link.setRunning(false);
+    game->wakeSender();
+    SDL_WaitThread(sendThread, nullptr);
+    SDL_WaitThread(receiveThread, nullptr);
+    NetEvent unhandled;
+    while (udpEvents.pop(unhandled)) { //the match is over, the next session starts empty
+    }
+
+    // Close connection to the server. CON_CLOSE is sent reliably, so give it a moment to be acknowledged.
+    if (currentScreen == screenProg::EXIT || currentScreen == screenProg::GAME_OVER) {
+        game->send(CommandId::CON_CLOSE);
+        flushOutboundUdp(link);
+        vector<string> ignored;
+        for (int i = 0; i < 20 && link.getStats().unacked > 0; i++) {
+            link.receive(10, ignored);
+            link.pump();
+        }
+    }
+
+    UdpStats stats = link.getStats();
+    printf("UDP: %llu datagrams sent, %llu received, %llu retransmits, %llu stale, %llu skipped, rtt %.1fms\n",
+        (unsigned long long)stats.datagramsSent, (unsigned long long)stats.datagramsReceived,
+        (unsigned long long)stats.retransmits, (unsigned long long)stats.stale,
+        (unsigned long long)stats.skipped, stats.rttMs);
+    if (udpOversized > 0) {
+        printf("UDP: dropped %llu messages too long to hand to the main thread\n", (unsigned long long)udpOversized.load());
+    }
+    link.close();
+}
+
+/**
+ * Applies one record during replay. Messages go through the same dispatch as live ones.
+ * @param record the record read from the recording.
+ */
+static void replayRecord(const ReplayRecord& record) {
+    if (record.type == ReplayType::MESSAGE) {
+        dispatch(record.payload, FRAME_HEADER_SIZE + record.payload.size());
+    }
+    else if (record.type == ReplayType::RESET) {
+        game->resetWin();
+    }
+}
+
+/**
+ * Moves replay to a tick and restores the match as it was just before it.
+ * @param reader the recording.
+ * @param tick the tick to play next.
+ * @return the recording time of the next record, where playback continues.
+ */
+static uint64_t replaySeek(ReplayReader& reader, uint32_t tick) {
+    MatchState state;
+    ReplayRecord record;
+    if (reader.seek(tick, state)) {
+        game->restoreMatch(state);
+        if (!state.positions.empty()) {
+            dispatch(state.positions, FRAME_HEADER_SIZE + state.positions.size());
+        }
+    }
+    return reader.peek(record) ? record.time : reader.getDuration();
+}
+
+/**
+ * Plays a recording through the same MyGame dispatch, update and render as a live match, instead
+ * of connecting. At --replay-speed 0 each frame plays exactly one tick with interpolation off, so
+ * the frames drawn depend only on the recording: the run doubles as a rendering benchmark, and
+ * the digest printed at the end changes only if what is drawn changes.
+ * Space pauses, Left and Right seek, F3, F4 and F5 show the overlays, Escape stops.
+ * @param renderer pointer to the renderer to use.
+ */
+static void run_replay(SDL_Renderer* renderer) {
+    const uint32_t seek_ticks = 300; //about five seconds
+
+    ReplayReader reader;
+    if (!reader.open(options.replayPath)) {
+        return;
+    }
+    printf("Replay: %u ticks, %.1fs, %zu keyframes\n", reader.getTicks(), reader.getDuration() / 1e6, reader.getKeyframes());
+
+    bool instant = options.replaySpeed <= 0;
+    game->setPrediction(false); //no inputs were recorded, so our bat is drawn where the server had it
+    game->setLogging(false);
+    if (instant) {
+        JitterConfig direct;
+        direct.enabled = false;
+        game->setInterpolation(direct);
+    }
+    game->setMenu();
+    currentScreen = screenProg::GAME;
+
+    uint32_t tick = options.replayFrom < reader.getTicks() ? options.replayFrom : reader.getTicks();
+    double playhead = (double)replaySeek(reader, tick); //recording time shown, microseconds
+    bool paused = false;
+    uint64_t frames = 0;
+    uint32_t digest = 2166136261u; //FNV-1a over what each frame shows
+    uint64_t started = commandClock() / 1000;
+    uint64_t lastFrame = started;
+    SDL_Event event;
+    ReplayRecord record;
+    ClientCommand discarded;
+
+    resetTelemetry(); //arrival timing as recorded is replayed, so F4 shows the recording's jitter
+    frameClock.reset();
+    while (currentScreen == screenProg::GAME) {
+        PROFILE_SCOPE("frame");
+        int steps = instant ? 1 : frameClock.beginFrame();
+
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                currentScreen = screenProg::EXIT;
+            }
+            if (event.type != SDL_KEYDOWN || event.key.repeat != 0) {
+                continue;
+            }
+            switch (event.key.keysym.sym) {
+            case SDLK_ESCAPE:
+                currentScreen = screenProg::EXIT;
+                break;
+            case SDLK_SPACE:
+                paused = !paused;
+                break;
+            case SDLK_LEFT:
+                tick = tick > seek_ticks ? tick - seek_ticks : 0;
+                playhead = (double)replaySeek(reader, tick);
+                break;
+            case SDLK_RIGHT:
+                tick += seek_ticks;
+                playhead = (double)replaySeek(reader, tick);
+                break;
+            case SDLK_F3:
+            case SDLK_F4:
+            case SDLK_F5:
+                game->input(event);
+                break;
+            default:
+                break;
+            }
+        }
+
+        uint64_t now = commandClock() / 1000;
+        if (!paused && !instant) {
+            playhead += (now - lastFrame) * (double)options.replaySpeed;
+        }
+        lastFrame = now;
+        if (!reader.peek(record)) {
+            break; //the last tick has been drawn
+        }
+        bool ticked = false;
+        while (!paused && reader.peek(record) && (instant ? !ticked : record.time <= playhead)) {
+            reader.next(record);
+            replayRecord(record);
+            if (record.type == ReplayType::MESSAGE && isTickMessage(record.payload)) {
+                ticked = true;
+                tick = record.tick + 1;
+            }
+        }
+        while (game->nextOutbound(discarded)) {} //ACKs and CONFIRMs have nowhere to go
+
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
+        for (int i = 0; i < steps; i++) {
+            game->update(frameClock.stepSeconds());
+        }
+        game->render(renderer, instant ? 0.0f : frameClock.alpha());
+        {
+            PROFILE_SCOPE("present");
+            SDL_RenderPresent(renderer);
+        }
 
-        game->update();
+        GameView view = game->getView(now);
+        int shown[] = { view.role, (int)view.ballX, (int)view.ballY, (int)view.ownY, view.gameOver ? 1 : 0 };
+        for (int value : shown) {
+            digest = (digest ^ (uint32_t)value) * 16777619u;
+        }
+        frames++;
+        if (!instant) {
+            {
+                PROFILE_SCOPE("pace");
+                frameClock.endFrame();
+            }
+            game->setFrameStats(frameClock.getStats());
+            sampleTelemetry();
+        }
+        Profiler::collect();
+    }
 
-        game->render(renderer);
+    double seconds = (commandClock() / 1000 - started) / 1e6;
+    printf("Replay played to tick %u: %llu frames in %.2fs, %.1f frames/s, digest %08x\n",
+        tick, (unsigned long long)frames, seconds, seconds > 0 ? frames / seconds : 0.0, digest);
+}
 
-        SDL_RenderPresent(renderer);
+/**
+ * Shows every match given with --wall and --watch as tiles in the window until Escape.
+ * @param renderer pointer to the renderer to use.
+ */
+static void run_wall(SDL_Renderer* renderer) {
+    options.wall.binaryWire = options.binaryWire;
+    options.wall.interpolation = options.interpolation;
+    options.wall.textCache = options.textCache;
+    options.wall.assetBundle = options.assetBundle;
 
-        SDL_Delay(17);
+    MatchWall wall;
+    if (wall.start(renderer, options.wall, reactor)) {
+        wall.run(renderer, frameClock);
     }
+    wall.stop();
+    reactor.stop(); //sends each session's CON_CLOSE while the sessions still exist
 }
 
 /**
@@ -196,11 +917,14 @@ void loop(SDL_Renderer* renderer) {
  * indicated that they want to.
  */
 int run_game() {
+    PROFILE_THREAD("main");
+    startedAt = commandClock() / 1000;
+    bool wall = !options.wall.targets.empty();
     SDL_Window* window = SDL_CreateWindow(
         "Multiplayer Pong Client",
         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        800, 600,
-        SDL_WINDOW_SHOWN
+        wall ? 1280 : 800, wall ? 960 : 600,
+        wall ? SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE : SDL_WINDOW_SHOWN
     );
 
     if (nullptr == window) {
@@ -208,7 +932,11 @@ int run_game() {
         return -1;
     }
 
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if (options.pacing.vsync) {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, rendererFlags);
 
     if (nullptr == renderer) {
         std::cout << "Failed to create renderer" << SDL_GetError() << std::endl;
@@ -218,56 +946,300 @@ int run_game() {
         SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
     }
 
-    game->setup(renderer);
+    backoff.configure(options.reconnect);
+    if (!wall) { //the wall's sessions each have their own MyGame
+        game->setServer(options.host, options.port);
+        if (!options.assetBundle.empty()) {
+            game->setAssetBundle(options.assetBundle);
+        }
+        game->setSyncAssets(options.syncAssets);
+        game->setup(renderer);
+        game->setInterpolation(options.interpolation);
+        game->setPrediction(options.prediction);
+        game->setTextCache(options.textCache);
+        if (options.lazyRender) {
+            game->setScreenCache(true);
+            networkEvent = SDL_RegisterEvents(1);
+            if (networkEvent == (Uint32)-1) {
+                networkEvent = 0;
+                printf("SDL_RegisterEvents: %s, lazy rendering polls the network instead\n", SDL_GetError());
+            }
+            reactor.setNotify(networkEvent);
+        }
+    }
+    frameClock.configure(options.pacing);
+
+    if (!options.telemetryPath.empty()) {
+        telemetryExport.open(options.telemetryPath);
+    }
+    if (!options.profileTracePath.empty()) {
+        Profiler::startTrace(options.profileTracePath);
+    }
+    reactor.start();
+    if (wall) {
+        run_wall(renderer);
+        currentScreen = screenProg::EXIT;
+    }
+    else if (!options.replayPath.empty()) {
+        game->waitForAssets(renderer);
+        run_replay(renderer);
+        currentScreen = screenProg::EXIT;
+    }
+    if (!options.recordPath.empty() && currentScreen != screenProg::EXIT) {
+        recorder.open(options.recordPath);
+    }
 
     while (currentScreen != screenProg::EXIT) {
+        screenProg shown = currentScreen;
         loop(renderer);
 
-        if (currentScreen == screenProg::EXIT) {
-            break;
+        if (options.udp && udpReady) {
+            udpReady = false;
+            run_udp_session(renderer, udpServer);
+        }
+        else if (currentScreen == screenProg::CONNECTING && connection == 0) {
+            beginConnect();
         }
 
-        if (currentScreen == screenProg::GAME) {
-            IPaddress ip;
-
-            // Resolve host (ip name + port) into an IPaddress type
-            if (SDLNet_ResolveHost(&ip, IP_NAME, PORT) == -1) {
-                printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
-                exit(3); 
+        // Close connection to the server once the match is left, the reactor sends what is queued first
+        bool inMatch = currentScreen == screenProg::CONNECTING || currentScreen == screenProg::GAME
+            || currentScreen == screenProg::RECONNECTING;
+        if (connection != 0 && !inMatch) {
+            if (shown == screenProg::GAME && (currentScreen == screenProg::EXIT || currentScreen == screenProg::GAME_OVER)) {
+                game->send(CommandId::CON_CLOSE);
             }
+            reactor.close(connection);
+            connection = 0;
+        }
+    }
+    reactor.stop();
+    if (recorder.isOpen()) {
+        printf("Recorded %u ticks to %s\n", recorder.getTicks(), options.recordPath.c_str());
+        recorder.close();
+    }
+    telemetryExport.close();
+    Profiler::stopTrace();
+    if (sendStats.sendCalls > 0) {
+        double seconds = (sendStats.lastSendUs - sendStats.firstSendUs) / 1e6;
+        printf("Send path: %llu sends, %.1f sends/s, %.2f commands per send, key-to-wire mean %.3fms max %.3fms\n",
+            (unsigned long long)sendStats.sendCalls, seconds > 0 ? sendStats.sendCalls / seconds : 0.0,
+            (double)sendStats.commands / sendStats.sendCalls,
+            sendStats.commands > 0 ? sendStats.waitTotalUs / 1000.0 / sendStats.commands : 0.0,
+            sendStats.waitMaxUs / 1000.0);
+    }
+    if (reconnectStats.drops > 0) {
+        printf("Reconnect: %llu drops, %llu reconnected after %llu attempts, %llu gave up, time to reconnect mean %.0fms max %.0fms\n",
+            (unsigned long long)reconnectStats.drops, (unsigned long long)reconnectStats.reconnects,
+            (unsigned long long)reconnectStats.attempts, (unsigned long long)reconnectStats.gaveUp,
+            reconnectStats.reconnects > 0 ? reconnectStats.totalUs / 1000.0 / reconnectStats.reconnects : 0.0,
+            reconnectStats.maxUs / 1000.0);
+    }
+    if (game->getRejectedMessages() > 0) {
+        printf("Ignored %llu unknown or malformed server messages\n", (unsigned long long)game->getRejectedMessages());
+    }
+    FrameStats frames = frameClock.getStats();
+    printf("Frame interval: %llu frames, mean %.3fms, stddev %.3fms, max %.3fms, work mean %.3fms\n",
+        (unsigned long long)frames.frames, frames.mean, frames.stdDev, frames.max, frames.workMean);
+    printf("Frame budget overruns: %llu, dropped simulation steps: %llu\n",
+        (unsigned long long)frames.overruns, (unsigned long long)frames.droppedSteps);
+    if (options.lazyRender && !wall) {
+        uint64_t ranUs = commandClock() / 1000 - startedAt;
+        printf("Lazy render: %llu frames drawn, %llu idle waits, asleep %.1fs (%.0f%% of the run)\n",
+            (unsigned long long)frames.frames, (unsigned long long)lazyStats.idleWaits, lazyStats.idleUs / 1e6,
+            ranUs > 0 ? 100.0 * lazyStats.idleUs / ranUs : 0.0);
+    }
+    if (!wall) {
+        game->printFrameTimes();
+    }
+    delete game;
+    return 0;
+}
 
-            // Open the connection to the server
-            TCPsocket socket = SDLNet_TCP_Open(&ip);
-
-            if (!socket) {
-                printf("SDLNet_TCP_Open: %s\n", SDLNet_GetError());
-                currentScreen = screenProg::CONN_ERROR;
-                if (SDLNet_GetError() != NULL) {
-                    game->setErrorMessage(SDLNet_GetError());
-                }
+/**
+ * Reads command line settings into options.
+ * --binary: ask the server for binary snapshots instead of ASCII GAME_DATA.
+ * --udp: connect over UDP, with snapshots sent unreliably; needs a server that serves it, such as pong_standin --udp.
+ * --interp-delay MS: render a fixed delay behind real time instead of adapting to jitter.
+ * --no-interp: render the newest positions as soon as they arrive.
+ * --no-predict: only move our own bat when the server says it moved.
+ * --no-text-cache: rasterize all text every frame, for comparing render times.
+ * --sim-rate HZ: fixed simulation updates per second.
+ * --fps HZ: frames per second when paced by the timer, 0 for unpaced.
+ * --vsync: pace frames to the display instead of the timer.
+ * --frame-budget MS: frames whose work takes longer are reported as overruns.
+ * --headless N: no window or audio, run N bot sessions against the server instead.
+ * --bot idle|track|random: how headless bots play.
+ * --duration S: stop a headless run after S seconds.
+ * --take-over S: seconds between a spectating bot's TAKE_OVER attempts, 0 never.
+ * --churn N: chance per bot per minute of disconnecting and reconnecting.
+ * --record FILE: record every message received to FILE; headless, only the first session's.
+ * --replay FILE: play FILE back in the window instead of connecting.
+ * --replay-speed X: playback rate, e.g. 4 for four times real time, 0 for one tick per frame as fast as possible.
+ * --replay-from TICK: start playback at TICK.
+ * --telemetry FILE: append network telemetry to FILE every period, as JSON lines if it ends in .json, otherwise CSV.
+ * --telemetry-interval S: seconds per telemetry period, also how often the F4 overlay updates.
+ * --profile-trace FILE: write every profiled scope to FILE as Chrome trace events, for chrome://tracing or Perfetto.
+ * --send-batch US: hold the first queued command this many microseconds so others join its send, 0 sends at once.
+ * --assets FILE: read images, sounds and fonts from FILE, made by pong_pack, instead of ../res.
+ * --sync-assets: load assets before the first frame rather than while the menu renders, for comparing cold start.
+ * --lazy: only draw a frame when something on screen changes and sleep in between, for unattended displays.
+ * --host HOST[:PORT]: the server to connect to, localhost by default.
+ * --port PORT: the server's port, 55555 by default.
+ * --reconnect N: attempts to rejoin the server after the connection drops, 0 to show the error instead.
+ * --wall N: watch N matches on the server at once, tiled in one window; Tab or a click picks the tile keys go to.
+ * --watch HOST[:PORT]: add a match on another server to the wall, may be given many times.
+ */
+void parseOptions(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--binary") {
+            options.binaryWire = true;
+        }
+        else if (arg == "--udp") {
+            options.udp = true;
+        }
+        else if (arg == "--interp-delay" && i + 1 < argc) {
+            options.interpolation.delay = (float)atof(argv[++i]);
+            options.interpolation.adaptive = false;
+        }
+        else if (arg == "--no-interp") {
+            options.interpolation.enabled = false;
+        }
+        else if (arg == "--no-predict") {
+            options.prediction = false;
+        }
+        else if (arg == "--no-text-cache") {
+            options.textCache = false;
+        }
+        else if (arg == "--sim-rate" && i + 1 < argc) {
+            options.pacing.simRate = atoi(argv[++i]);
+        }
+        else if (arg == "--fps" && i + 1 < argc) {
+            options.pacing.targetFps = atoi(argv[++i]);
+        }
+        else if (arg == "--vsync") {
+            options.pacing.vsync = true;
+        }
+        else if (arg == "--frame-budget" && i + 1 < argc) {
+            options.pacing.budgetMs = (float)atof(argv[++i]);
+        }
+        else if (arg == "--headless" && i + 1 < argc) {
+            options.headless = true;
+            options.bots.sessions = atoi(argv[++i]);
+        }
+        else if (arg == "--bot" && i + 1 < argc) {
+            options.bots.bot.kind = parseBotKind(argv[++i]);
+        }
+        else if (arg == "--duration" && i + 1 < argc) {
+            options.bots.duration = (float)atof(argv[++i]);
+        }
+        else if (arg == "--take-over" && i + 1 < argc) {
+            options.bots.bot.takeOverInterval = (float)atof(argv[++i]);
+        }
+        else if (arg == "--churn" && i + 1 < argc) {
+            options.bots.churn = (float)atof(argv[++i]);
+        }
+        else if (arg == "--record" && i + 1 < argc) {
+            options.recordPath = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc) {
+            options.replayPath = argv[++i];
+        }
+        else if (arg == "--replay-speed" && i + 1 < argc) {
+            options.replaySpeed = (float)atof(argv[++i]);
+        }
+        else if (arg == "--replay-from" && i + 1 < argc) {
+            options.replayFrom = (uint32_t)atol(argv[++i]);
+        }
+        else if (arg == "--telemetry" && i + 1 < argc) {
+            options.telemetryPath = argv[++i];
+        }
+        else if (arg == "--telemetry-interval" && i + 1 < argc) {
+            options.telemetryInterval = (float)atof(argv[++i]);
+        }
+        else if (arg == "--profile-trace" && i + 1 < argc) {
+            options.profileTracePath = argv[++i];
+        }
+        else if (arg == "--send-batch" && i + 1 < argc) {
+            options.sendBatchUs = atoi(argv[++i]);
+        }
+        else if (arg == "--assets" && i + 1 < argc) {
+            options.assetBundle = argv[++i];
+        }
+        else if (arg == "--lazy") {
+            options.lazyRender = true;
+        }
+        else if (arg == "--sync-assets") {
+            options.syncAssets = true;
+        }
+        else if (arg == "--host" && i + 1 < argc) {
+            string target = argv[++i];
+            size_t colon = target.rfind(':');
+            options.host = target.substr(0, colon);
+            if (colon != string::npos) {
+                options.port = (Uint16)atoi(target.c_str() + colon + 1);
             }
-            else {
-
-                SDL_CreateThread(on_receive, "ConnectionReceiveThread", (void*)socket);
-                SDL_CreateThread(on_send, "ConnectionSendThread", (void*)socket);
-
-                loop(renderer);
-
-                // Close connection to the server
-                if (currentScreen == screenProg::EXIT || currentScreen == screenProg::GAME_OVER) {
-                    game->send("CON_CLOSE");
-                    sendTerminate(socket);
-
-                    SDLNet_TCP_Close(socket);
-                }
+        }
+        else if (arg == "--port" && i + 1 < argc) {
+            options.port = (Uint16)atoi(argv[++i]);
+        }
+        else if (arg == "--reconnect" && i + 1 < argc) {
+            options.reconnect.attempts = atoi(argv[++i]);
+        }
+        else if (arg == "--wall" && i + 1 < argc) {
+            for (int n = atoi(argv[++i]); n > 0; n--) {
+                options.wall.targets.push_back(WallTarget{ "", 0 }); //the server given by --host, which may come later
+            }
+        }
+        else if (arg == "--watch" && i + 1 < argc) {
+            string target = argv[++i];
+            size_t colon = target.rfind(':');
+            WallTarget watch{ target.substr(0, colon), 0 };
+            if (colon != string::npos) {
+                watch.port = (Uint16)atoi(target.c_str() + colon + 1);
             }
+            options.wall.targets.push_back(watch);
+        }
+        else {
+            cout << "Unknown option: " << arg << endl;
         }
     }
-    delete game;
-    return 0;
+    for (WallTarget& target : options.wall.targets) {
+        target.host = target.host.empty() ? options.host : target.host;
+        target.port = target.port == 0 ? options.port : target.port;
+    }
+}
+
+/**
+ * Runs bot sessions with only SDL_net initialised, for load testing the server.
+ */
+int run_headless() {
+    if (SDL_Init(0) == -1) {
+        printf("SDL_Init: %s\n", SDL_GetError());
+        return 1;
+    }
+    if (SDLNet_Init() == -1) {
+        printf("SDLNet_Init: %s\n", SDLNet_GetError());
+        return 2;
+    }
+
+    options.bots.host = options.host;
+    options.bots.port = options.port;
+    options.bots.binaryWire = options.binaryWire;
+    options.bots.recordPath = options.recordPath;
+    HeadlessClient client;
+    bool ran = client.run(options.bots);
+
+    SDLNet_Quit();
+    SDL_Quit();
+    return ran ? 0 : 3;
 }
 
 int main(int argc, char** argv) {
+    parseOptions(argc, argv);
+    if (options.headless) {
+        return run_headless();
+    }
 
     // Initialize SDL
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) == -1) {
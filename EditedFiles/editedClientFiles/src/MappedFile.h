@@ -0,0 +1,35 @@
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <cstddef>
+#include <string>
+
+//A whole file mapped read-only into memory, so it can be read in place without copying.
+//Uses MapViewOfFile on Windows and mmap elsewhere.
+class MappedFile {
+    private:
+        const char* data = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mapping = nullptr;
+#endif
+
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        ~MappedFile();
+
+        bool open(const std::string& path);
+        void close();
+
+        const char* getData() const {
+            return data;
+        }
+        size_t size() const {
+            return length;
+        }
+};
+
+#endif
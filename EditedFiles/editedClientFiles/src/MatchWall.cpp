@@ -0,0 +1,426 @@
+#include "MatchWall.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "Message.h"
+#include "Profiler.h"
+#include "Snapshot.h"
+
+static const Uint32 CONNECT_SPACING = 20; //ms between the first connects, so the server's accept loop isn't flooded
+static const Uint32 REJOIN_DELAY = 1000; //ms before a session leaving a finished match joins again, plus up to as much again at random
+static const Uint32 GAME_OVER_HOLD = 5000; //ms the game over screen stays up before the session rejoins
+
+MatchWall::~MatchWall() {
+    stop();
+    while (!sessions.empty()) { //the first game owns the assets the others share, so goes last
+        sessions.pop_back();
+    }
+}
+
+/**
+ * Creates a session for every target, sharing the first one's assets. They are connected a few at
+ * a time once run() starts.
+ * @param renderer the renderer every tile is drawn with.
+ * @param settings the matches to show.
+ * @param network the running reactor every session connects through.
+ * @return false if there is nothing to show.
+ */
+bool MatchWall::start(SDL_Renderer* renderer, const WallConfig& settings, NetReactor& network) {
+    config = settings;
+    reactor = &network;
+    if (config.targets.empty()) {
+        return false;
+    }
+    Uint32 now = SDL_GetTicks();
+    for (size_t i = 0; i < config.targets.size(); i++) {
+        sessions.push_back(std::make_unique<Session>());
+        Session& session = *sessions.back();
+        session.target = config.targets[i];
+        session.connectAt = now + (Uint32)i * CONNECT_SPACING;
+        session.backoff = Backoff(random.next());
+        session.game = std::make_unique<MyGame>();
+        MyGame& game = *session.game;
+        game.setLogging(false);
+        game.setAudio(false); //dozens of matches hitting walls at once is only noise
+        if (i == 0) {
+            if (!config.assetBundle.empty()) {
+                game.setAssetBundle(config.assetBundle);
+            }
+        }
+        else {
+            game.shareAssets(*sessions[0]->game);
+        }
+        game.setup(renderer);
+        game.setInterpolation(config.interpolation);
+        game.setTextCache(config.textCache);
+        game.setMenu(); //straight to the match, there is no menu per tile
+        setLink(session, Link::WAITING);
+    }
+    printf("Match wall: %zu sessions\n", sessions.size());
+    return true;
+}
+
+/**
+ * Closes every connection with CON_CLOSE and prints the totals. The reactor sends what each
+ * session has queued before closing it, so it must be stopped before the sessions are destroyed.
+ */
+void MatchWall::stop() {
+    if (reactor == nullptr) {
+        return;
+    }
+    for (std::unique_ptr<Session>& session : sessions) {
+        if (session->connection != 0) {
+            if (session->link == Link::LIVE) {
+                session->game->send(CommandId::CON_CLOSE);
+            }
+            reactor->close(session->connection);
+            session->connection = 0;
+        }
+    }
+    reactor = nullptr;
+    printf("Match wall: %zu sessions, %llu connects, %llu failed, %llu dropped, %llu frames and %.1f KB received\n",
+        sessions.size(), (unsigned long long)connects, (unsigned long long)connectFailures,
+        (unsigned long long)drops, (unsigned long long)framesReceived, bytesReceived / 1024.0);
+}
+
+/**
+ * Asks the reactor for a session's connection; the outcome arrives as an event.
+ * @param session the session.
+ */
+void MatchWall::connect(Session& session) {
+    session.connection = reactor->open(session.target.host, session.target.port, flush, &session);
+    session.gameOverAt = 0;
+    setLink(session, Link::CONNECTING);
+}
+
+/**
+ * Leaves a finished match with CON_CLOSE and schedules rejoining it.
+ * @param session the session.
+ * @param now SDL_GetTicks().
+ */
+void MatchWall::disconnect(Session& session, Uint32 now) {
+    session.game->send(CommandId::CON_CLOSE);
+    reactor->close(session.connection);
+    session.connection = 0;
+    setLink(session, Link::DROPPED);
+    session.connectAt = now + REJOIN_DELAY + random.next() % REJOIN_DELAY;
+}
+
+/**
+ * Handles everything the reactor has received since the last frame, then connects sessions that
+ * are due and rejoins matches a while after they end.
+ * @param now SDL_GetTicks().
+ */
+void MatchWall::drainNetwork(Uint32 now) {
+    PROFILE_SCOPE("wall network");
+    NetEvent event;
+    std::string_view cmd;
+    MessageArgs args;
+    while (reactor->next(event)) {
+        Session* session = find(event.connection);
+        if (session == nullptr) {
+            continue; //closed by us, the rest of its events are stale
+        }
+        switch (event.type) {
+        case NetEventType::OPENED:
+            connects++;
+            session->backoff.reset();
+            session->game->resetWin();
+            if (config.binaryWire) {
+                session->game->send(CommandId::WIRE_BIN);
+            }
+            setLink(*session, Link::LIVE);
+            break;
+        case NetEventType::MESSAGE:
+            framesReceived++;
+            bytesReceived += event.wireBytes;
+            session->game->setArrival(event.receivedUs);
+            if (isBinarySnapshot(event.view())) {
+                session->game->on_snapshot(event.view());
+            }
+            else if (parseMessage(event.view(), cmd, args)) {
+                session->game->on_receive(cmd, args);
+            }
+            session->game->setArrival(0);
+            break;
+        case NetEventType::CLOSED:
+            if (session->link == Link::CONNECTING) {
+                connectFailures++;
+            }
+            else {
+                drops++;
+            }
+            session->connection = 0;
+            setLink(*session, Link::DROPPED);
+            session->connectAt = now + session->backoff.next();
+            break;
+        case NetEventType::RESOLVED: //the wall only opens connections
+            break;
+        }
+    }
+
+    for (std::unique_ptr<Session>& session : sessions) {
+        if (session->connection == 0 && (Sint32)(now - session->connectAt) >= 0) {
+            connect(*session);
+        }
+        else if (session->link != Link::LIVE) {
+            continue;
+        }
+        else if (session->game->getWinner() == Winner::NONE) {
+            session->gameOverAt = 0;
+        }
+        else if (session->gameOverAt == 0) {
+            session->gameOverAt = now | 1; //never 0, which means no winner yet
+        }
+        else if (now - session->gameOverAt >= GAME_OVER_HOLD) {
+            disconnect(*session, now);
+        }
+        if (session->link == Link::LIVE && session->game->getOutboundDepth() > 0) {
+            reactor->wake();
+        }
+    }
+}
+
+/**
+ * Finds the session a connection belongs to.
+ * @return nullptr if no session has it any more.
+ */
+MatchWall::Session* MatchWall::find(uint32_t connection) {
+    for (std::unique_ptr<Session>& session : sessions) {
+        if (session->connection == connection) {
+            return session.get();
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Moves a session to a new link state and sets the status shown while it isn't LIVE.
+ */
+void MatchWall::setLink(Session& session, Link link) {
+    std::string server = session.target.host + ":" + std::to_string(session.target.port);
+    switch (link) {
+    case Link::WAITING:
+    case Link::CONNECTING:
+        session.status = "Connecting to " + server;
+        break;
+    case Link::DROPPED:
+        session.status = (session.game->getWinner() != Winner::NONE ? "Match over, rejoining " : "Reconnecting to ") + server;
+        break;
+    default:
+        break;
+    }
+    session.link = link;
+}
+
+/**
+ * Sends everything a session has queued, inputs from the focused tile and replies such as
+ * CONFIRM, as one CLIENT_DATA message. Runs on the reactor thread.
+ * @param context the Session.
+ * @param socket its connection.
+ * @return false if the send failed.
+ */
+bool MatchWall::flush(void* context, TCPsocket socket, uint64_t*) {
+    static ClientDataFrame frame; //reused by every session, only the reactor thread sends
+    Session& session = *(Session*)context;
+    ClientCommand command;
+    if (!session.game->nextOutbound(command)) {
+        return true;
+    }
+    frame.clear();
+    do {
+        if (!frame.append(command)) {
+            if (SDLNet_TCP_Send(socket, frame.data(), (int)frame.size()) != (int)frame.size()) {
+                return false;
+            }
+            frame.clear();
+            frame.append(command);
+        }
+    } while (session.game->nextOutbound(command));
+    return SDLNet_TCP_Send(socket, frame.data(), (int)frame.size()) == (int)frame.size();
+}
+
+
+/**
+ * One event on the render thread. Escape quits, Tab or a click moves the focus, and other keys go
+ * to the focused match, so its overlays can be shown or its spectator can take over.
+ * @param width output width, for finding the tile clicked.
+ * @param height output height.
+ * @param quit set to true to stop run().
+ */
+void MatchWall::handle(const SDL_Event& event, int width, int height, bool& quit) {
+    if (event.type == SDL_QUIT) {
+        quit = true;
+        return;
+    }
+    if (event.type == SDL_MOUSEBUTTONDOWN) {
+        SDL_Point point{ event.button.x, event.button.y };
+        for (size_t i = 0; i < sessions.size(); i++) {
+            SDL_Rect area = tile(i, sessions.size(), width, height);
+            if (SDL_PointInRect(&point, &area)) {
+                setFocus(i);
+            }
+        }
+        return;
+    }
+    if ((event.type != SDL_KEYDOWN && event.type != SDL_KEYUP) || event.key.repeat != 0) {
+        return;
+    }
+    switch (event.key.keysym.sym) {
+    case SDLK_ESCAPE:
+        quit = quit || event.type == SDL_KEYDOWN;
+        break;
+    case SDLK_TAB:
+        if (event.type == SDL_KEYDOWN) {
+            setFocus((focus + 1) % sessions.size());
+        }
+        break;
+    default: {
+        auto pressed = std::find(held.begin(), held.end(), event.key.keysym.sym);
+        if (event.type == SDL_KEYUP) {
+            if (pressed == held.end()) {
+                break; //pressed before the focus moved, already released on that tile
+            }
+            held.erase(pressed);
+        }
+        else if (pressed == held.end()) {
+            held.push_back(event.key.keysym.sym);
+        }
+        if (sessions[focus]->link == Link::LIVE) {
+            SDL_Event copy = event;
+            sessions[focus]->game->input(copy);
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * Moves keyboard input to another tile, first releasing any key held on the old one so its bat
+ * doesn't keep moving.
+ * @param index the tile to focus.
+ */
+void MatchWall::setFocus(size_t index) {
+    if (index == focus) {
+        return;
+    }
+    for (SDL_Keycode key : held) {
+        if (sessions[focus]->link == Link::LIVE) {
+            SDL_Event release;
+            SDL_zero(release);
+            release.type = SDL_KEYUP;
+            release.key.state = SDL_RELEASED;
+            release.key.keysym.sym = key;
+            sessions[focus]->game->input(release);
+        }
+    }
+    held.clear();
+    focus = index;
+}
+
+/**
+ * Draws every session as a tile until Escape or the window is closed, with the same fixed steps
+ * and pacing as the single match loop.
+ * @param renderer the renderer given to start().
+ * @param clock paces frames and decides how many steps each game is updated by.
+ */
+void MatchWall::run(SDL_Renderer* renderer, FrameClock& clock) {
+    SDL_Event event;
+    bool quit = false;
+    clock.reset();
+    while (!quit) {
+        PROFILE_SCOPE("frame");
+        int steps = clock.beginFrame();
+        int width, height;
+        SDL_GetRendererOutputSize(renderer, &width, &height);
+        {
+            PROFILE_SCOPE("poll events");
+            while (SDL_PollEvent(&event)) {
+                handle(event, width, height, quit);
+            }
+        }
+        drainNetwork(SDL_GetTicks());
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+
+        for (size_t i = 0; i < sessions.size(); i++) {
+            Session& session = *sessions[i];
+            for (int s = 0; s < steps; s++) {
+                session.game->update(clock.stepSeconds());
+            }
+            SDL_Rect area = tile(i, sessions.size(), width, height);
+            beginTile(renderer, area);
+            if (session.link == Link::LIVE) {
+                session.game->render(renderer, clock.alpha());
+            }
+            else {
+                session.game->renderStatus(renderer, session.status);
+            }
+            endTile(renderer);
+            if (i == focus) {
+                SDL_SetRenderDrawColor(renderer, 255, 200, 80, 255);
+            }
+            else {
+                SDL_SetRenderDrawColor(renderer, 60, 60, 60, 255);
+            }
+            SDL_RenderDrawRect(renderer, &area);
+        }
+
+        {
+            PROFILE_SCOPE("present");
+            SDL_RenderPresent(renderer);
+        }
+        {
+            PROFILE_SCOPE("pace");
+            clock.endFrame();
+        }
+        sessions[focus]->game->setFrameStats(clock.getStats());
+        Profiler::collect();
+    }
+}
+
+/**
+ * Where a session's tile goes: a grid as close to square as fits them all, each tile 4:3 and
+ * centred in its cell.
+ * @param index the session.
+ * @param count sessions on the wall.
+ * @param width output width in pixels.
+ * @param height output height in pixels.
+ */
+SDL_Rect MatchWall::tile(size_t index, size_t count, int width, int height) {
+    int columns = (int)std::ceil(std::sqrt((double)count));
+    int rows = (int)((count + columns - 1) / columns);
+    int cellW = width / columns;
+    int cellH = height / rows;
+    float scale = std::fmin((float)cellW / TILE_W, (float)cellH / TILE_H);
+    int w = (int)(TILE_W * scale);
+    int h = (int)(TILE_H * scale);
+    int column = (int)(index % columns);
+    int row = (int)(index / columns);
+    return SDL_Rect{ column * cellW + (cellW - w) / 2, row * cellH + (cellH - h) / 2, w, h };
+}
+
+/**
+ * Points the renderer at one tile, so a MyGame drawing its 800x600 screen fills just that area.
+ * @param renderer the renderer.
+ * @param area the tile, in output pixels.
+ */
+void MatchWall::beginTile(SDL_Renderer* renderer, const SDL_Rect& area) {
+    float scale = (float)area.w / TILE_W;
+    SDL_RenderSetScale(renderer, scale, scale);
+    SDL_Rect viewport{ (int)(area.x / scale), (int)(area.y / scale), TILE_W, TILE_H }; //in scaled units
+    SDL_RenderSetViewport(renderer, &viewport);
+    SDL_Rect clip{ 0, 0, TILE_W, TILE_H }; //so particles and overlays stay inside the tile
+    SDL_RenderSetClipRect(renderer, &clip);
+}
+
+/**
+ * Returns the renderer to the whole output after beginTile().
+ */
+void MatchWall::endTile(SDL_Renderer* renderer) {
+    SDL_RenderSetClipRect(renderer, nullptr);
+    SDL_RenderSetScale(renderer, 1, 1);
+    SDL_RenderSetViewport(renderer, nullptr);
+}
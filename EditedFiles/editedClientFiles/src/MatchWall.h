@@ -0,0 +1,96 @@
+#ifndef __MATCH_WALL_H__
+#define __MATCH_WALL_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_net.h"
+
+#include "Backoff.h"
+#include "ClientCommand.h"
+#include "FastRandom.h"
+#include "FrameClock.h"
+#include "JitterBuffer.h"
+#include "MyGame.h"
+#include "NetReactor.h"
+
+//A server whose match is shown on the wall.
+struct WallTarget {
+    std::string host;
+    Uint16 port = 55555;
+};
+
+//Settings for a wall of matches.
+struct WallConfig {
+    std::vector<WallTarget> targets; //one tile each, the same server may appear more than once
+    bool binaryWire = false; //ask for binary snapshots
+    JitterConfig interpolation;
+    bool textCache = true;
+    std::string assetBundle;
+};
+
+//Watches many matches at once in one window: each target gets its own connection and MyGame, all
+//drawn as tiles on one renderer. Every session's socket is served by the client's NetReactor, so
+//the thread count doesn't grow with the number of matches, and its events are handled here on
+//the render thread, so a session's MyGame is only touched from one thread.
+class MatchWall {
+    public:
+        static const int TILE_W = 800; //MyGame draws in a window of this size, scaled to fit each tile
+        static const int TILE_H = 600;
+
+    private:
+        enum class Link {
+            WAITING, //not connected, connects when connectAt passes
+            CONNECTING, //asked the reactor for a connection
+            LIVE, //connected and playing
+            DROPPED //closed or refused, shown until the next connect
+        };
+
+        struct Session {
+            std::unique_ptr<MyGame> game;
+            WallTarget target;
+            Link link = Link::WAITING;
+            uint32_t connection = 0; //the reactor's id for the connection, 0 if none
+            Uint32 connectAt = 0; //SDL_GetTicks() when the next connect attempt is due
+            Backoff backoff; //waits between attempts while the server can't be reached, never gives up
+            Uint32 gameOverAt = 0; //when a winner was first seen, 0 if none
+            std::string status; //shown instead of the match while not LIVE
+        };
+
+        WallConfig config;
+        NetReactor* reactor = nullptr;
+        std::vector<std::unique_ptr<Session>> sessions;
+        FastRandom random; //rejoin delays, and seeds for each session's backoff
+        size_t focus = 0; //the tile keyboard input goes to
+        std::vector<SDL_Keycode> held; //keys pressed on the focused tile and not yet released
+
+        uint64_t connects = 0;
+        uint64_t connectFailures = 0;
+        uint64_t drops = 0;
+        uint64_t framesReceived = 0;
+        uint64_t bytesReceived = 0;
+
+        void connect(Session& session);
+        void disconnect(Session& session, Uint32 now);
+        void drainNetwork(Uint32 now);
+        Session* find(uint32_t connection);
+        void setLink(Session& session, Link link);
+        void handle(const SDL_Event& event, int width, int height, bool& quit);
+        void setFocus(size_t index);
+        static bool flush(void* context, TCPsocket socket, uint64_t* holdUs);
+
+    public:
+        ~MatchWall();
+
+        bool start(SDL_Renderer* renderer, const WallConfig& settings, NetReactor& network);
+        void run(SDL_Renderer* renderer, FrameClock& clock);
+        void stop();
+
+        static SDL_Rect tile(size_t index, size_t count, int width, int height);
+        static void beginTile(SDL_Renderer* renderer, const SDL_Rect& area);
+        static void endTile(SDL_Renderer* renderer);
+};
+
+#endif
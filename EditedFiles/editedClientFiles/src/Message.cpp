@@ -0,0 +1,61 @@
+#include "Message.h"
+
+#include <charconv>
+
+/**
+ * Splits a message on "," into the command and its arguments. Empty tokens are skipped,
+ * matching the strtok behaviour the server's trailing "," relies on.
+ * @param payload the message, without framing.
+ * @param cmd set to the first token.
+ * @param args filled with the remaining tokens. Extra tokens beyond MAX_MESSAGE_ARGS are dropped.
+ * @return false if the message contained no tokens.
+ */
+bool parseMessage(std::string_view payload, std::string_view& cmd, MessageArgs& args) {
+    args.clear();
+    cmd = std::string_view();
+    bool haveCmd = false;
+
+    size_t start = 0;
+    while (start <= payload.size()) {
+        size_t end = payload.find(',', start);
+        if (end == std::string_view::npos) {
+            end = payload.size();
+        }
+        if (end > start) {
+            std::string_view token = payload.substr(start, end - start);
+            if (!haveCmd) {
+                cmd = token;
+                haveCmd = true;
+            }
+            else {
+                args.push_back(token);
+            }
+        }
+        start = end + 1;
+    }
+    return haveCmd;
+}
+
+/**
+ * Converts a decimal token to an int without allocating. A fractional part is truncated, as the
+ * server formats positions as Java doubles (e.g. "270.0").
+ * @param token the text to convert.
+ * @param value set to the converted value on success.
+ * @return true if the token was a valid number.
+ */
+bool toInt(std::string_view token, int& value) {
+    const char* end = token.data() + token.size();
+    std::from_chars_result result = std::from_chars(token.data(), end, value);
+    if (result.ec != std::errc()) {
+        return false;
+    }
+    if (result.ptr != end && *result.ptr == '.') {
+        for (const char* p = result.ptr + 1; p != end; p++) {
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+        }
+        return true;
+    }
+    return result.ptr == end;
+}
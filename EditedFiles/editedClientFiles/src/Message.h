@@ -0,0 +1,53 @@
+#ifndef __MESSAGE_H__
+#define __MESSAGE_H__
+
+#include <cstddef>
+#include <stdexcept>
+#include <string_view>
+
+const size_t MAX_MESSAGE_ARGS = 16;
+
+//Fixed-capacity list of argument tokens. Tokens are views into the received frame, nothing is copied.
+class MessageArgs {
+    private:
+        std::string_view tokens[MAX_MESSAGE_ARGS];
+        size_t count = 0;
+
+    public:
+        size_t size() const {
+            return count;
+        }
+        bool empty() const {
+            return count == 0;
+        }
+        void clear() {
+            count = 0;
+        }
+        bool push_back(std::string_view token) {
+            if (count == MAX_MESSAGE_ARGS) {
+                return false;
+            }
+            tokens[count++] = token;
+            return true;
+        }
+        std::string_view at(size_t i) const {
+            if (i >= count) {
+                throw std::out_of_range("MessageArgs::at");
+            }
+            return tokens[i];
+        }
+        std::string_view operator[](size_t i) const {
+            return tokens[i];
+        }
+        const std::string_view* begin() const {
+            return tokens;
+        }
+        const std::string_view* end() const {
+            return tokens + count;
+        }
+};
+
+bool parseMessage(std::string_view payload, std::string_view& cmd, MessageArgs& args);
+bool toInt(std::string_view token, int& value);
+
+#endif
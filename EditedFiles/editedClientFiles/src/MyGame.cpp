@@ -1,112 +1,416 @@
 #include "MyGame.h"
 
+#include <cstdio>
+
+#include "CommandTable.h"
+#include "PongRules.h"
+
+/**
+ * Emitter settings for the ball trail, bat hit and wall hit particles.
+ */
+static EmitterConfig trailEmitter() {
+    EmitterConfig config;
+    config.rate = 60;
+    config.life = 0.8f;
+    config.size = 10;
+    config.speed = 120;
+    config.gravity = -75;
+    config.colour = SDL_Color{ 175, 175, 175, 250 };
+    return config;
+}
+
+static EmitterConfig batHitEmitter() {
+    EmitterConfig config;
+    config.life = 0.4f;
+    config.size = 4;
+    config.speed = 240;
+    return config;
+}
+
+static EmitterConfig wallHitEmitter() {
+    EmitterConfig config;
+    config.life = 0.35f;
+    config.size = 3;
+    config.speed = 180;
+    config.colour = SDL_Color{ 255, 200, 80, 255 };
+    return config;
+}
+
+static const double BALL_SPIN = 300; //degrees per second the ball texture rotates
+static const int BAT_HIT_PARTICLES = 24;
+static const int WALL_HIT_PARTICLES = 16;
+static const uint64_t PROFILE_REFRESH = 500000; //microseconds between F5 overlay updates
+static const uint64_t SETTLE_TIME = 1000000; //microseconds the match keeps animating after positions stop arriving, for interpolation and sparks
+static const size_t PROFILE_LINES = 12; //sections listed in the F5 overlay
+static const int LAYER_WORLD = 0; //bats, particles and ball, all from the sprite atlas, in the order queued
+static const int LAYER_TEXT = 1; //over the world
+
 /**
- * Called by Main on_receive, reacts to arguments sent by server.
- * @param cmd String of characters found before first ",".
- * @param args structure of strings found after first string. Split by ",".
+ * @param headless true to run without a window or audio: setup() loads no assets, render() draws
+ *                 nothing and no particle pools are allocated.
  */
-void MyGame::on_receive(std::string cmd, std::vector<std::string>& args) {
-    //Print cmd and subsequent args if not explicitly GAME_DATA
-    if (cmd != "GAME_DATA") {
+MyGame::MyGame(bool headless)
+    : headless(headless),
+      ballTrail(headless ? 0 : 256, trailEmitter(), 0x1234567u),
+      batSparks(headless ? 0 : 1024, batHitEmitter(), 0x89ABCDEu),
+      wallSparks(headless ? 0 : 1024, wallHitEmitter(), 0x2468ACEu) {
+}
+
+//Every ASCII command the server sends. Arguments are counted after empty tokens are dropped.
+static constexpr CommandEntry<MyGame::MessageHandler> MESSAGE_HANDLERS[] = {
+    { "GAME_DATA", 5, 7, false, &MyGame::onGameData },
+    { "BALL_HIT_BAT1", 0, 0, true, &MyGame::onBatHit },
+    { "BALL_HIT_BAT2", 0, 0, true, &MyGame::onBatHit },
+    { "HIT_WALL_UP", 0, 0, true, &MyGame::onWallHit },
+    { "HIT_WALL_DOWN", 0, 0, true, &MyGame::onWallHit },
+    { "HIT_WALL_LEFT", 2, 2, true, &MyGame::onGoal },
+    { "HIT_WALL_RIGHT", 2, 2, true, &MyGame::onGoal },
+    { "ROLE", 1, 1, true, &MyGame::onRole },
+    { "COUNT", 1, 1, true, &MyGame::onCount },
+    { "CONN_CHECK", 0, 0, true, &MyGame::onConnCheck },
+    { "WIRE", 1, 1, true, &MyGame::onWire },
+};
+static constexpr CommandTable messageHandlers(MESSAGE_HANDLERS);
+static_assert(messageHandlers.isPerfect(), "no collision-free seed for MESSAGE_HANDLERS");
+
+/**
+ * Called by Main on_receive, passes a message to its handler in MESSAGE_HANDLERS. Only exact
+ * command names with the expected number of arguments are handled.
+ * @param cmd View of the characters found before first ",".
+ * @param args views of the tokens found after first token. Split by ",".
+ */
+void MyGame::on_receive(std::string_view cmd, const MessageArgs& args) {
+    const CommandEntry<MessageHandler>* entry = messageHandlers.find(cmd);
+    if (entry == nullptr || args.size() < entry->minArgs || args.size() > entry->maxArgs) {
+        rejectedMessages++;
+        if (logMessages) {
+            std::cout << (entry == nullptr ? "Ignored unknown command " : "Ignored malformed ") << cmd
+                << " with " << args.size() << " arguments\n";
+        }
+        return;
+    }
+    if (entry->logged && logMessages) {
         printMessage(cmd, args);
     }
-    //React to args
-    if (cmd.find("GAME_DATA") != std::string::npos) {
-        if (args.size() == 5) {
-            playerOne->setY(stoi(args.at(0)));
-            playerTwo->setY(stoi(args.at(1)));
-            ball.setX(stoi(args.at(2)));
-            ball.setY(stoi(args.at(3)));
-            if (args.at(4) == "1WIN") {
-                std::cout << args.at(4) << std::endl;
-                game_data.playerWin = "1";
-            }
-            else if (args.at(4) == "2WIN") {
-                std::cout << args.at(4) << std::endl;
-                game_data.playerWin = "2";
+    (this->*entry->handler)(args);
+    dirty = true;
+}
 
-            }
+/**
+ * GAME_DATA,p1y,p2y,ballX,ballY,nWIN[,p1Input,p2Input]: positions for the jitter buffer, the
+ * inputs the server has applied for prediction, and the winner once there is one.
+ */
+void MyGame::onGameData(const MessageArgs& args) {
+    int p1y, p2y, bx, by;
+    std::string_view win;
+    if (!decodeArgs(args, p1y, p2y, bx, by, win)) {
+        rejectedMessages++;
+        return;
+    }
+    int16_t fields[SNAPSHOT_POSITIONS];
+    fields[SNAP_P1_Y] = (int16_t)p1y;
+    fields[SNAP_P2_Y] = (int16_t)p2y;
+    fields[SNAP_BALL_X] = (int16_t)bx;
+    fields[SNAP_BALL_Y] = (int16_t)by;
+    jitter.push(fields, arrival());
+    state.setPositions(fields);
+    positionsAt = JitterBuffer::nowMicros();
+
+    int p1Input = 0, p2Input = 0; //servers that predate prediction don't send these
+    if (args.size() == 7) {
+        decodeArg(args[5], p1Input);
+        decodeArg(args[6], p2Input);
+    }
+    reconcilePrediction(p1y, p2y, p1Input, p2Input);
+    if (win == "1WIN" || win == "2WIN") {
+        if (logMessages) {
+            std::cout << win << '\n';
         }
+        state.setWinner(win[0] == '1' ? Winner::ONE : Winner::TWO);
     }
+}
 
-    if (cmd.find("BALL_HIT_BAT") != std::string::npos) {
+/**
+ * BALL_HIT_BAT1 or BALL_HIT_BAT2.
+ */
+void MyGame::onBatHit(const MessageArgs&) {
+    if (batHit != nullptr) {
         Mix_PlayChannel(1, batHit, 0);
     }
+    pendingBatHits++;
+}
 
-    if (cmd.find("HIT_WALL") != std::string::npos) {
+/**
+ * HIT_WALL_UP or HIT_WALL_DOWN.
+ */
+void MyGame::onWallHit(const MessageArgs&) {
+    if (wallHit != nullptr) {
         Mix_PlayChannel(1, wallHit, 0);
-        if (args.size() == 2) {
-            playerOne->setScore(args.at(0).c_str());
-            playerTwo->setScore(args.at(1).c_str());
-        }
     }
+    pendingWallHits++;
+}
 
-    if (cmd.find("ROLE") != std::string::npos) {
-        switch (stoi(args.at(0))) {
-        case 1:
-            thisClient = clientRole::ONE;
-            break;
-        case 2:
-            thisClient = clientRole::TWO;
-            break;
-        case 3:
-            thisClient = clientRole::SPECTATOR;
-            break;
-        default:
-            std::cout << "Error assigning client role." << std::endl;
-            break;
+/**
+ * HIT_WALL_LEFT,score1,score2 or HIT_WALL_RIGHT,score1,score2: a wall hit that scored.
+ */
+void MyGame::onGoal(const MessageArgs& args) {
+    onWallHit(args);
+    int one, two;
+    if (!decodeArgs(args, one, two)) {
+        rejectedMessages++;
+        return;
+    }
+    state.setScore((uint16_t)one, (uint16_t)two);
+}
+
+/**
+ * ROLE,n: 1 and 2 are the players, 3 a spectator.
+ */
+void MyGame::onRole(const MessageArgs& args) {
+    int role = 0;
+    if (!decodeArgs(args, role)) {
+        rejectedMessages++;
+        return;
+    }
+    bool takeOver = takeOverOnSpectate;
+    takeOverOnSpectate = false; //only the first ROLE after rejoining
+    switch (role) {
+    case 1:
+        thisClient = clientRole::ONE;
+        predictor.start();
+        break;
+    case 2:
+        thisClient = clientRole::TWO;
+        predictor.start();
+        break;
+    case 3:
+        thisClient = clientRole::SPECTATOR;
+        predictor.stop();
+        if (takeOver) { //our slot may still be free, as when ENTER is pressed on the menu
+            reply(CommandId::TAKE_OVER);
         }
+        break;
+    default:
+        std::cout << "Error assigning client role." << std::endl;
+        break;
     }
+}
 
-    if (cmd.find("COUNT") != std::string::npos) {
-        game_data.countdown = args.at(0);
+/**
+ * COUNT,n: the countdown before the ball is served.
+ */
+void MyGame::onCount(const MessageArgs& args) {
+    int count;
+    if (!decodeArgs(args, count)) {
+        rejectedMessages++;
+        return;
+    }
+    state.setCountdown((int8_t)count);
+    if (countdownClick != nullptr) {
         Mix_PlayChannel(-1, countdownClick, 0);
     }
+}
+
+/**
+ * CONN_CHECK: the server's active check, answered with CONFIRM.
+ */
+void MyGame::onConnCheck(const MessageArgs&) {
+    if (logMessages) {
+        std::cout << "Sending reply to server Active Check.\n";
+    }
+    reply(CommandId::CONFIRM);
+}
 
-    if (cmd.find("CONN_CHECK") != std::string::npos) {
-        std::cout << "Sending reply to server Active Check." << std::endl;
-        send("CONFIRM");
+/**
+ * WIRE,BIN: the server accepted our request for binary snapshots.
+ */
+void MyGame::onWire(const MessageArgs& args) {
+    if (args[0] == WIRE_ACCEPT && logMessages) {
+        std::cout << "Server will send binary snapshots.\n";
+    }
+}
+
+/**
+ * Called by Main on_receive for binary GAME_DATA. Decodes the positions into the jitter buffer,
+ * and periodically acknowledges so the server can delta encode against what we hold.
+ * @param payload frame payload starting with SNAP_KEY or SNAP_DELTA.
+ */
+void MyGame::on_snapshot(std::string_view payload) {
+    Snapshot snap;
+    if (!snapshotDecoder.decode(payload, snap)) {
+        std::cout << "Discarded snapshot that could not be decoded." << std::endl;
+        return;
+    }
+    jitter.push(snap.fields, arrival());
+    state.setPositions(snap.fields);
+    positionsAt = JitterBuffer::nowMicros();
+    dirty = true;
+    reconcilePrediction(snap.fields[SNAP_P1_Y], snap.fields[SNAP_P2_Y],
+        (uint16_t)snap.fields[SNAP_P1_INPUT], (uint16_t)snap.fields[SNAP_P2_INPUT]);
+    if (snap.win == 1 || snap.win == 2) {
+        state.setWinner((Winner)snap.win);
+    }
+
+    if (snapshotDecoder.shouldAck(snap.seq)) {
+        reply(CommandId::ACK, snap.seq);
     }
 }
 
 /**
  * Print out the command received followed by the arguments.
  * @param cmd the first 'token' received by Client.
- * @param args vector of 'tokens' received by Client, seperated by ",".
+ * @param args 'tokens' received by Client, seperated by ",".
  */
-void MyGame::printMessage(std::string cmd, std::vector<std::string>& args) {
-    std::cout << "Command: " << cmd << std::endl;
-    std::cout << "args: ";
-    for (std::string s : args) {
+void MyGame::printMessage(std::string_view cmd, const MessageArgs& args) {
+    std::cout << "Command: " << cmd << "\nargs: ";
+    for (std::string_view s : args) {
         std::cout << s << ", ";
     }
-    std::cout << std::endl;
+    std::cout << '\n';
 }
 
 /**
- * Pushes a string onto the vector of strings: "messages".
- * @param message data to be sent to server.
+ * Passes our bat's authoritative position to the predictor, if we are a player.
+ * @param p1y top of player one's bat in the snapshot.
+ * @param p2y top of player two's bat in the snapshot.
+ * @param p1Input last input the server applied for player one.
+ * @param p2Input last input the server applied for player two.
  */
-void MyGame::send(std::string message) {
-    messages.push_back(message);
+void MyGame::reconcilePrediction(int p1y, int p2y, int p1Input, int p2Input) {
+    if (thisClient == clientRole::ONE) {
+        predictor.reconcile((float)p1y, (uint16_t)p1Input, arrival());
+    }
+    else if (thisClient == clientRole::TWO) {
+        predictor.reconcile((float)p2y, (uint16_t)p2Input, arrival());
+    }
 }
 
 /**
- * Passes a string to send() dependant on key event.
+ * Formats the scores, countdown and winner line into their buffers, only when the store says one
+ * of them has changed since the last time.
+ * @param match the state render() is drawing this frame.
+ * @param version the store's version, read before match was.
+ */
+void MyGame::formatStateText(const GameState& match, uint32_t version) {
+    if (version == stateTextVersion) {
+        return;
+    }
+    stateTextVersion = version;
+    snprintf(scoreText[0], sizeof(scoreText[0]), "%u", (unsigned)match.score[0]);
+    snprintf(scoreText[1], sizeof(scoreText[1]), "%u", (unsigned)match.score[1]);
+    snprintf(countdownText, sizeof(countdownText), "%d", (int)match.countdown);
+    snprintf(winnerText, sizeof(winnerText), "Player %d was the winner!", (int)match.winner);
+}
+
+/**
+ * Queues a command to be sent. Only called from the render/input thread.
+ * @param id the command to send to server.
+ * @param arg argument sent with commands that take one.
+ */
+void MyGame::send(CommandId id, uint32_t arg) {
+    ClientCommand command{ id, arg, commandClock() };
+    if (!inputQueue.push(command)) {
+        std::cout << "Outbound queue full, dropped " << commandName(id) << std::endl;
+        return;
+    }
+    outboundSignal.notify();
+}
+
+/**
+ * Queues a command in answer to a server message, e.g. CONFIRM. It has its own queue so replies
+ * go out ahead of input.
+ * @param id the command to send to server.
+ * @param arg argument sent with commands that take one.
+ */
+void MyGame::reply(CommandId id, uint32_t arg) {
+    ClientCommand command{ id, arg, commandClock() };
+    if (!replyQueue.push(command)) {
+        std::cout << "Reply queue full, dropped " << commandName(id) << std::endl;
+        return;
+    }
+    outboundSignal.notify();
+}
+
+/**
+ * Takes the next command to send, replies first. Only called from the thread that sends: the
+ * reactor's for TCP, the UDP send thread, or a headless client's.
+ * @param command set to the command taken.
+ * @return false if nothing is waiting.
+ */
+bool MyGame::nextOutbound(ClientCommand& command) {
+    return replyQueue.pop(command) || inputQueue.pop(command);
+}
+
+/**
+ * Blocks the UDP send thread until a command is queued or the timeout passes.
+ * @param timeoutMs longest time to wait.
+ * @return true if woken by a command being queued, or by wakeSender().
+ */
+bool MyGame::waitOutbound(int timeoutMs) {
+    return outboundSignal.wait(timeoutMs);
+}
+
+/**
+ * Wakes the UDP send thread without queueing anything, so it can notice the link has stopped.
+ */
+void MyGame::wakeSender() {
+    outboundSignal.notify();
+}
+
+/**
+ * Sets when the messages about to be handled arrived, so positions are buffered and reconciled
+ * against the time they were read from the socket rather than when the main thread got to them.
+ * @param receivedUs JitterBuffer::nowMicros() at arrival, 0 to use the time they are handled.
+ */
+void MyGame::setArrival(uint64_t receivedUs) {
+    arrivalUs = receivedUs;
+}
+
+/**
+ * Gets when the message being handled arrived, see setArrival().
+ */
+uint64_t MyGame::arrival() const {
+    return arrivalUs != 0 ? arrivalUs : JitterBuffer::nowMicros();
+}
+
+/**
+ * Passes a command to send() dependant on key event.
  * @param event SDL_Event
  */
 void MyGame::input(SDL_Event& event) {
+    bool pressed = event.type == SDL_KEYDOWN;
+    dirty = true;
     switch (event.key.keysym.sym) {
         case SDLK_w:
-            send(event.type == SDL_KEYDOWN ? "W_DOWN" : "W_UP");
+            keysHeld += pressed ? 1 : (keysHeld > 0 ? -1 : 0);
+            startInputTimer(pressed);
+            send(pressed ? CommandId::W_DOWN : CommandId::W_UP, predictor.applyKey(true, pressed, JitterBuffer::nowMicros()));
             break;
         case SDLK_s:
-            send(event.type == SDL_KEYDOWN ? "S_DOWN" : "S_UP");
+            keysHeld += pressed ? 1 : (keysHeld > 0 ? -1 : 0);
+            startInputTimer(pressed);
+            send(pressed ? CommandId::S_DOWN : CommandId::S_UP, predictor.applyKey(false, pressed, JitterBuffer::nowMicros()));
+            break;
+        case SDLK_F3:
+            if (event.type == SDL_KEYDOWN) {
+                showNetStats = !showNetStats;
+            }
+            break;
+        case SDLK_F4:
+            if (event.type == SDL_KEYDOWN) {
+                showTelemetry = !showTelemetry;
+            }
+            break;
+        case SDLK_F5:
+            if (event.type == SDL_KEYDOWN) {
+                showProfile = !showProfile;
+                profileSummaryAt = 0;
+            }
             break;
         case SDLK_RETURN:
             if (event.key.state == SDL_PRESSED) {
                 if (thisClient == clientRole::SPECTATOR) {
-                    send("TAKE_OVER");
+                    send(CommandId::TAKE_OVER);
                 }
             }
             break;
@@ -116,7 +420,7 @@ void MyGame::input(SDL_Event& event) {
 }
 
 /**
- * Run once, loads visual and auditory assets. Initialise Players and set relevant X.
+ * Run once, starts loading visual and auditory assets on the asset worker. Initialise Players and set relevant X.
  * @param renderer pointer to renderer in use.
  */
 void MyGame::setup(SDL_Renderer* renderer) {
@@ -125,76 +429,252 @@ void MyGame::setup(SDL_Renderer* renderer) {
     playerTwo = new Player();
     playerOne->setX(800 / 4);
     playerTwo->setX(3 * 800 / 4 - 20);
-
-    //load visual assets
-    fontTitle = TTF_OpenFont("../res/font/pong.ttf", 64);
-    if (nullptr == fontTitle) {
-        std::cout << TTF_GetError() << std::endl;
+    if (headless || assetSource != &assets) {
+        return;
     }
-    fontInfo = TTF_OpenFont("../res/font/pong.ttf", 18);
-    if (nullptr == fontInfo) {
-        std::cout << TTF_GetError() << std::endl;
-    }
-    fileImgLoad = IMG_Load("../res/img/pBallv2.png");
-    if (fileImgLoad == nullptr) {
-        std::cout << "Error loading PNG Pong Ball: " << IMG_GetError() << std::endl;
+
+    //request assets, decoded on the worker while the menu renders; both bats share one sprite
+    titleFont = assets.font("font/pong.ttf", 64);
+    infoFont = assets.font("font/pong.ttf", 18);
+    ballImage = assets.image("img/pBallv2.png");
+    batImage = assets.image("img/pBat.png");
+    assets.image("img/pBat.png"); //player two, counted so the old per-player texture cost is reported
+    batHitSound = assets.sound("sounds/hit_bat.wav", 20);
+    wallHitSound = assets.sound("sounds/hit_wall.wav", 20);
+    clickSound = assets.sound("sounds/click.wav", 20);
+    assets.start();
+    if (syncAssets) {
+        waitForAssets(renderer);
     }
-    else {
-        ball.setTex(SDL_CreateTextureFromSurface(renderer, fileImgLoad));
-        SDL_FreeSurface(fileImgLoad);
+}
+
+/**
+ * Takes fonts, sounds and sprites from the asset manager once it has finished loading.
+ * @param renderer pointer to the renderer in use, the atlas is uploaded to it.
+ * @return false while assets are still loading.
+ */
+bool MyGame::adoptAssets(SDL_Renderer* renderer) {
+    if (assetsAdopted) {
+        return true;
     }
-    fileImgLoad = IMG_Load("../res/img/pBat.png");
-    if (fileImgLoad == nullptr) {
-        std::cout << "Error loading PNG Pong Bat: " << IMG_GetError() << std::endl;
+    if (!assetSource->poll(renderer)) {
+        return false;
     }
-    else {
-        playerOne->setTex(SDL_CreateTextureFromSurface(renderer, fileImgLoad));
-        playerTwo->setTex(SDL_CreateTextureFromSurface(renderer, fileImgLoad));
-        SDL_FreeSurface(fileImgLoad);
+    fontTitle = assetSource->ttf(titleFont);
+    fontInfo = assetSource->ttf(infoFont);
+    if (audio) {
+        batHit = assetSource->chunk(batHitSound);
+        wallHit = assetSource->chunk(wallHitSound);
+        countdownClick = assetSource->chunk(clickSound);
     }
+    ball.setSprite(assetSource->sprite(ballImage));
+    playerOne->setSprite(assetSource->sprite(batImage));
+    playerTwo->setSprite(assetSource->sprite(batImage));
+    Sprite white = assetSource->whiteSprite();
+    batch.setWhite(white.texture, white.rect);
+    textCache.setBatch(&batch, LAYER_TEXT);
+    assetsAdopted = true;
+    return true;
+}
 
-    //load auditory assets
-    batHit = Mix_LoadWAV("../res/sounds/hit_bat.wav");
-    if (nullptr == batHit) {
-        std::cout << "Bat Hit Sound: " << Mix_GetError() << std::endl;
-    }
-    else {
-        batHit->volume = 20;
-    }
-    wallHit = Mix_LoadWAV("../res/sounds/hit_wall.wav");
-    if (nullptr == wallHit) {
-        std::cout << "Wall Hit Sound: " << Mix_GetError() << std::endl;
+/**
+ * Blocks until every asset is loaded, for when nothing useful can be drawn without them, e.g. replays.
+ * @param renderer pointer to the renderer in use.
+ */
+void MyGame::waitForAssets(SDL_Renderer* renderer) {
+    if (headless) {
+        return;
     }
-    else {
-        wallHit->volume = 20;
+    assetSource->wait(renderer);
+    adoptAssets(renderer);
+}
+
+/**
+ * Drawn by render() instead of any screen until assets are loaded: a bar filling as they decode.
+ * No text, since the fonts are among what is loading.
+ * @param renderer pointer to the renderer in use.
+ */
+void MyGame::drawLoading(SDL_Renderer* renderer) {
+    SDL_Rect outline{ 200, 290, 400, 20 };
+    SDL_Rect fill{ 202, 292, (int)(396 * assetSource->progress()), 16 };
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    SDL_RenderDrawRect(renderer, &outline);
+    SDL_RenderFillRect(renderer, &fill);
+}
+
+/**
+ * Reads assets from a bundle made by pong_pack instead of the res directory. Call before setup().
+ * @param path the bundle.
+ */
+void MyGame::setAssetBundle(const std::string& path) {
+    assets.setBundle(path);
+}
+
+/**
+ * Makes setup() wait for every asset, to compare cold start against loading on the worker.
+ * @param enable true to wait.
+ */
+void MyGame::setSyncAssets(bool enable) {
+    syncAssets = enable;
+}
+
+/**
+ * Uses another game's fonts, sounds and sprite atlas instead of loading a copy, for many games
+ * drawn on one renderer. Call before setup(); owner must be set up first and outlive this game.
+ * @param owner the game that loads the assets.
+ */
+void MyGame::shareAssets(MyGame& owner) {
+    assetSource = owner.assetSource;
+    titleFont = owner.titleFont;
+    infoFont = owner.infoFont;
+    ballImage = owner.ballImage;
+    batImage = owner.batImage;
+    batHitSound = owner.batHitSound;
+    wallHitSound = owner.wallHitSound;
+    clickSound = owner.clickSound;
+}
+
+/**
+ * Turns sound effects on or off. Call before assets are adopted, i.e. before the first render().
+ * @param enable false to never play a sound.
+ */
+void MyGame::setAudio(bool enable) {
+    audio = enable;
+}
+
+/**
+ * Turns caching of the menu, error and game over screens on or off. Each is drawn once into a
+ * render target and copied from it until something on it changes.
+ * @param enable true to cache.
+ */
+void MyGame::setScreenCache(bool enable) {
+    cacheScreens = enable;
+    resetScreenCache();
+}
+
+/**
+ * Forgets the cached text screen, e.g. when the renderer has lost its render targets.
+ */
+void MyGame::resetScreenCache() {
+    if (screenTexture != nullptr) {
+        SDL_DestroyTexture(screenTexture);
+        screenTexture = nullptr;
     }
-    countdownClick = Mix_LoadWAV("../res/sounds/click.wav");
-    if (nullptr == countdownClick) {
-        std::cout << "Countdown Sound: " << Mix_GetError() << std::endl;
+    cachedScreen = ~0u;
+    dirty = true;
+}
+
+/**
+ * Whether the next frame would look different from the last one rendered: something received,
+ * pressed or set since, or the match still moving. Text screens only change when marked dirty;
+ * the match keeps moving while positions arrive, for a while after so interpolation and sparks
+ * settle, while our bat is moving and while an overlay of live counters is shown.
+ * @param now JitterBuffer::nowMicros().
+ */
+bool MyGame::needsRedraw(uint64_t now) {
+    if (dirty || !assetsAdopted) {
+        return true;
     }
-    else {
-        countdownClick->volume = 20;
+    if (menu || currError.errorScreen || state.getWinner() != Winner::NONE) {
+        return false;
     }
+    return showNetStats || showTelemetry || showProfile || keysHeld > 0 || now - positionsAt < SETTLE_TIME;
 }
 
-void MyGame::update() {
+/**
+ * Has the next frame drawn even though nothing shown has changed, e.g. when the window was
+ * uncovered.
+ */
+void MyGame::markDirty() {
+    dirty = true;
+}
+
+/**
+ * Notes that a text screen shows something new, so it is drawn again rather than copied.
+ */
+void MyGame::screenChanged() {
+    screenVersion++;
+    dirty = true;
+}
+
+/**
+ * Advances local simulation by one fixed step.
+ * @param dt length of the step in seconds.
+ */
+void MyGame::update(float dt) {
+    PROFILE_SCOPE("update");
+    predictor.advance(JitterBuffer::nowMicros());
     if (!menu) { //used purely for visual effect, synchronisation between clients not needed
-        ballAngle += 5;
+        previousBallAngle = ballAngle;
+        ballAngle += BALL_SPIN * dt;
         if (ballAngle > 360) {
-            ballAngle = 0;
+            ballAngle -= 360;
+            previousBallAngle -= 360;
+        }
+        if (!headless) {
+            updateParticles(dt);
         }
     }
 }
 
+/**
+ * Emits the trail and any hit bursts reported since the last step, then moves every particle.
+ * Hits arrive as messages are handled, so they are only counted there and emitted here.
+ * @param dt length of the step in seconds.
+ */
+void MyGame::updateParticles(float dt) {
+    PROFILE_SCOPE("particles update");
+    float ballX = ball.getX() + BALL_SIZE / 2;
+    float ballY = ball.getY() + BALL_SIZE / 2;
+    ballTrail.emitOver(ballX, ballY, dt);
+    for (int hits = pendingBatHits.exchange(0); hits > 0; hits--) {
+        batSparks.emit(ballX, ballY, BAT_HIT_PARTICLES);
+    }
+    for (int hits = pendingWallHits.exchange(0); hits > 0; hits--) {
+        wallSparks.emit(ballX, ballY, WALL_HIT_PARTICLES);
+    }
+
+    ballTrail.update(dt);
+    batSparks.update(dt);
+    wallSparks.update(dt);
+}
+
 /**
  * Render relevant information.
  * @param renderer pointer to the renderer in use.
+ * @param alpha how far real time is between the last update and the next, from 0 to 1.
  */
-void MyGame::render(SDL_Renderer* renderer) {
+void MyGame::render(SDL_Renderer* renderer, float alpha) {
+    if (headless) {
+        return;
+    }
+    PROFILE_SCOPE("render");
+    if (!adoptAssets(renderer)) {
+        drawLoading(renderer);
+        return;
+    }
+    uint64_t frameStart = JitterBuffer::nowMicros();
+    uint32_t stateVersion = state.getVersion(); //read first, so a change racing get() is formatted next frame
+    GameState match = state.get();
+    formatStateText(match, stateVersion);
+    bool textScreen = menu || currError.errorScreen || match.winner != Winner::NONE;
+    dirty = false; //cleared before drawing, so a change made meanwhile draws again
+    uint32_t key = screenKey(match);
+    bool caching = false;
+    if (textScreen && cacheScreens) {
+        if (key == cachedScreen && screenTexture != nullptr) {
+            SDL_Rect screen{ 0, 0, 800, 600 };
+            SDL_RenderCopy(renderer, screenTexture, nullptr, &screen);
+            screenCacheHits++;
+            menuFrames.add(JitterBuffer::nowMicros() - frameStart);
+            return;
+        }
+        caching = beginScreenCache(renderer);
+    }
     if (menu) { //menu information
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
         drawText(renderer, 400, 100, "Welcome to Pong", fontTitle);
-        drawText(renderer, 400, 300, "Connect to localhost? ENTER to confirm.", fontInfo);
+        drawText(renderer, 400, 300, serverPrompt, fontInfo);
         drawText(renderer, 400, 525, "Has a Player disconnected? Press ENTER as a Spectator to take over.", fontInfo);
     } 
     else if (currError.errorScreen) { //show error to user
@@ -202,25 +682,45 @@ void MyGame::render(SDL_Renderer* renderer) {
         drawText(renderer, 400, 300, currError.errorMessage, fontInfo);
         drawText(renderer, 400, 525, "Press ENTER to return to the menu.", fontInfo);
     }
-    else if (game_data.playerWin != "0") { //show game over
-        std::string winnerText = "Player ";
-        winnerText.append(game_data.playerWin);
-        winnerText.append(" was the winner!");
+    else if (match.winner != Winner::NONE) { //show game over
         drawText(renderer, 400, 100, "GAME OVER", fontTitle);
         drawText(renderer, 400, 300, winnerText, fontInfo);
         drawText(renderer, 400, 525, "press ENTER to return to the menu.", fontInfo);
     }
     else { //render actual game
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        SDL_RenderCopy(renderer, playerOne->getTex(), 0, &playerOne->getR());
-        SDL_RenderCopy(renderer, playerTwo->getTex(), 0, &playerTwo->getR());
-        ballParticle(renderer);
-        SDL_RenderCopyEx(renderer, ball.getTex(), 0, &ball.getR(), ballAngle, 0, SDL_RendererFlip::SDL_FLIP_NONE);
-        drawText(renderer, 100, 100, playerOne->getScore(), fontTitle);
-        drawText(renderer, 600, 100, playerTwo->getScore(), fontTitle);
-
-        if (game_data.countdown != "0") {
-            drawText(renderer, 400, 400, game_data.countdown, fontTitle);
+        uint64_t now = JitterBuffer::nowMicros();
+        float positions[SNAPSHOT_POSITIONS];
+        if (jitter.sample(now, positions)) {
+            playerOne->setY((int)positions[SNAP_P1_Y]);
+            playerTwo->setY((int)positions[SNAP_P2_Y]);
+            ball.setX((int)positions[SNAP_BALL_X]);
+            ball.setY((int)positions[SNAP_BALL_Y]);
+        }
+        if (predictor.isActive()) { //our own bat is drawn where we predict, not where the server last was
+            Player* own = thisClient == clientRole::ONE ? playerOne : playerTwo;
+            own->setY((int)predictor.displayY(now));
+        }
+        stopInputTimer(now);
+
+        {
+            PROFILE_SCOPE("bats");
+            for (Player* player : { playerOne, playerTwo }) {
+                SDL_Rect r = player->getR();
+                batch.add(LAYER_WORLD, player->getTex(), &player->getClip(), SDL_FRect{ (float)r.x, (float)r.y, (float)r.w, (float)r.h });
+            }
+        }
+        drawParticles();
+        {
+            PROFILE_SCOPE("ball");
+            double angle = previousBallAngle + (ballAngle - previousBallAngle) * alpha;
+            SDL_Rect r = ball.getR();
+            batch.addRotated(LAYER_WORLD, ball.getTex(), &ball.getClip(), SDL_FRect{ (float)r.x, (float)r.y, (float)r.w, (float)r.h }, angle);
+        }
+        drawGlyphText(renderer, 100, 100, scoreText[0], fontTitle);
+        drawGlyphText(renderer, 600, 100, scoreText[1], fontTitle);
+
+        if (match.countdown != 0) {
+            drawGlyphText(renderer, 400, 400, countdownText, fontTitle);
         }
 
         switch (thisClient) {
@@ -236,7 +736,120 @@ void MyGame::render(SDL_Renderer* renderer) {
             default:
                 break;
         }
+
+        if (showNetStats) {
+            JitterStats stats = jitter.getStats();
+            char line[128];
+            snprintf(line, sizeof(line), "buffer %d  late %llu  extrapolated %llums  delay %.0fms  jitter %.1fms",
+                (int)stats.depth, (unsigned long long)stats.latePackets, (unsigned long long)(stats.extrapolatedUs / 1000),
+                stats.delay, stats.jitter);
+            drawGlyphText(renderer, 400, 580, line, fontInfo);
+
+            PredictionStats prediction = predictor.getStats();
+            double inputAvg = inputToPhotonCount > 0 ? inputToPhotonTotalUs / 1000.0 / inputToPhotonCount : 0.0;
+            snprintf(line, sizeof(line), "rtt %.0fms  corrections %llu  input to photon avg %.1fms max %.1fms",
+                prediction.rtt, (unsigned long long)prediction.corrections, inputAvg, inputToPhotonMaxUs / 1000.0);
+            drawGlyphText(renderer, 400, 555, line, fontInfo);
+
+            TextCacheStats text = textCache.getStats();
+            snprintf(line, sizeof(line), "render %.2fms max %.2fms  text hits %llu misses %llu  %uKB  draws %llu quads %llu",
+                gameFrames.averageMs(), gameFrames.maxUs / 1000.0, (unsigned long long)text.hits,
+                (unsigned long long)text.misses, (unsigned)(text.bytes / 1024),
+                (unsigned long long)batchFrame.drawCalls, (unsigned long long)batchFrame.quads);
+            drawGlyphText(renderer, 400, 530, line, fontInfo);
+
+            snprintf(line, sizeof(line), "frame %.2fms  stddev %.2fms  max %.1fms  overruns %llu  dropped steps %llu",
+                frameStats.mean, frameStats.stdDev, frameStats.max, (unsigned long long)frameStats.overruns,
+                (unsigned long long)frameStats.droppedSteps);
+            drawGlyphText(renderer, 400, 505, line, fontInfo);
+        }
+        if (showTelemetry) {
+            drawTelemetry(renderer);
+        }
+        if (showProfile) {
+            drawProfile(renderer);
+        }
     }
+
+    {
+        PROFILE_SCOPE("batch flush");
+        batch.flush(renderer);
+        textCache.endFrame();
+    }
+    if (caching) {
+        endScreenCache(renderer, key);
+    }
+    batchFrame = batch.takeStats();
+    batchTotals.flushes += batchFrame.flushes;
+    batchTotals.drawCalls += batchFrame.drawCalls;
+    batchTotals.quads += batchFrame.quads;
+
+    uint64_t elapsed = JitterBuffer::nowMicros() - frameStart;
+    if (textScreen) {
+        menuFrames.add(elapsed);
+    }
+    else {
+        gameFrames.add(elapsed);
+    }
+}
+
+/**
+ * Identifies what a text screen shows: which screen, and everything drawn on it.
+ */
+uint32_t MyGame::screenKey(const GameState& match) const {
+    uint32_t screen = menu ? 0 : currError.errorScreen ? 1 : 2 + (uint32_t)match.winner;
+    return screenVersion << 3 | screen;
+}
+
+/**
+ * Points the renderer at screenTexture, so a text screen is drawn once and copied after that.
+ * @return false if render targets aren't supported, in which case screens are drawn every time.
+ */
+bool MyGame::beginScreenCache(SDL_Renderer* renderer) {
+    if (screenTexture == nullptr) {
+        screenTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, 800, 600);
+        if (screenTexture != nullptr) {
+            SDL_SetTextureBlendMode(screenTexture, SDL_BLENDMODE_NONE); //opaque, copied over the cleared frame
+        }
+    }
+    if (screenTexture == nullptr || SDL_SetRenderTarget(renderer, screenTexture) != 0) {
+        std::cout << "Text screens not cached: " << SDL_GetError() << std::endl;
+        cacheScreens = false;
+        return false;
+    }
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    return true;
+}
+
+/**
+ * Returns the renderer to the window after beginScreenCache() and shows what was drawn.
+ * @param key screenKey() of the screen drawn.
+ */
+void MyGame::endScreenCache(SDL_Renderer* renderer, uint32_t key) {
+    SDL_SetRenderTarget(renderer, nullptr);
+    cachedScreen = key;
+    SDL_Rect screen{ 0, 0, 800, 600 };
+    SDL_RenderCopy(renderer, screenTexture, nullptr, &screen);
+}
+
+/**
+ * Draws one line of text in the middle of the screen instead of render(), e.g. while connecting.
+ * @param renderer pointer to the renderer in use.
+ * @param text the line to show.
+ */
+void MyGame::renderStatus(SDL_Renderer* renderer, std::string_view text) {
+    if (headless) {
+        return;
+    }
+    if (!adoptAssets(renderer)) {
+        drawLoading(renderer);
+        return;
+    }
+    drawText(renderer, 400, 300, text, fontInfo);
+    batch.flush(renderer);
+    textCache.endFrame();
 }
 
 /**
@@ -244,6 +857,7 @@ void MyGame::render(SDL_Renderer* renderer) {
  */
 void MyGame::setMenu() {
     menu = !menu;
+    screenChanged();
 }
 
 /**
@@ -251,6 +865,7 @@ void MyGame::setMenu() {
  */
 void MyGame::setErrorScreen() {
     currError.errorScreen = !currError.errorScreen;
+    screenChanged();
 }
 
 /**
@@ -259,6 +874,7 @@ void MyGame::setErrorScreen() {
  */
 void MyGame::setErrorMessage(std::string error) {
     currError.errorMessage = error;
+    screenChanged();
 }
 
 /**
@@ -266,80 +882,358 @@ void MyGame::setErrorMessage(std::string error) {
  */
 void MyGame::resetWin() {
     thisClient = clientRole::NONE;
-    game_data.playerWin = "0";
-    playerOne->setScore("0");
-    playerTwo->setScore("0");
+    takeOverOnSpectate = false;
+    keysHeld = 0;
+    positionsAt = 0;
+    screenChanged();
+    state.reset();
     ballTrail.clear();
+    batSparks.clear();
+    wallSparks.clear();
+    pendingBatHits = 0;
+    pendingWallHits = 0;
+    snapshotDecoder.reset();
+    jitter.clear();
+    predictor.stop();
+    inputPendingSince = 0;
 }
 
 /**
- * Rudimentary method to create and render "particles" to trail the ball.
- * @param renderer pointer to the renderer in use.
+ * Clears the match for a connection made again after a drop. A player who comes back as a
+ * spectator asks to take over at once, getting their place back if no one else has.
  */
-void MyGame::ballParticle(SDL_Renderer* renderer) {
-    SDL_Rect * particle = new SDL_Rect{ ball.getX(), ball.getY(), 10, 10 };
-    ballTrail.insert(ballTrail.begin(), particle);
-    if (ballTrail.size() > 50) {
-        ballTrail.erase(ballTrail.end()-1);
-    }
-    int alpha = 255;
-    for (SDL_Rect * r : ballTrail) {
-        alpha -= 5;
-        SDL_SetRenderDrawColor(renderer, 175, 175, 175, alpha);
-        SDL_RenderFillRect(renderer, r);
-        if ((rand() % 2) == 1) {
-            r->x += 2;
-        }
-        else {
-            r->x -= 2;
-        }
-        if ((rand()) % 2 == 1) {
-            r->y -= 2;
+void MyGame::resumeMatch() {
+    bool wasPlayer = thisClient == clientRole::ONE || thisClient == clientRole::TWO;
+    resetWin();
+    takeOverOnSpectate = wasPlayer;
+}
+
+/**
+ * Sets the server named on the menu.
+ * @param host name or address.
+ * @param port the server's port.
+ */
+void MyGame::setServer(const std::string& host, Uint16 port) {
+    serverPrompt = "Connect to " + host + ":" + std::to_string(port) + "? ENTER to confirm.";
+    screenChanged();
+}
+
+/**
+ * Puts the match into a state read from a recording, after a replay seek. Clears it as for a new
+ * connection first; the caller then dispatches state.positions to place the bats and ball.
+ * @param match role, scores, countdown and winner to show.
+ */
+void MyGame::restoreMatch(const MatchState& match) {
+    resetWin();
+    switch (match.role) {
+    case 1:
+        thisClient = clientRole::ONE;
+        predictor.start();
+        break;
+    case 2:
+        thisClient = clientRole::TWO;
+        predictor.start();
+        break;
+    case 3:
+        thisClient = clientRole::SPECTATOR;
+        break;
+    default:
+        break;
+    }
+    int one = 0, two = 0, count = 0, win = 0;
+    toInt(match.score[0], one);
+    toInt(match.score[1], two);
+    toInt(match.countdown, count);
+    toInt(match.win, win);
+    state.setScore((uint16_t)one, (uint16_t)two);
+    state.setCountdown((int8_t)count);
+    if (win == 1 || win == 2) {
+        state.setWinner((Winner)win);
+    }
+}
+
+/**
+ * Turns client-side prediction of our own bat on or off.
+ * @param enable true to predict.
+ */
+void MyGame::setPrediction(bool enable) {
+    predictor.setEnabled(enable);
+}
+
+/**
+ * Starts timing a W/S press until our bat visibly moves, for measuring input-to-photon delay.
+ * @param pressed true for key down, releases are not timed.
+ */
+void MyGame::startInputTimer(bool pressed) {
+    bool player = thisClient == clientRole::ONE || thisClient == clientRole::TWO;
+    if (pressed && player && inputPendingSince == 0) {
+        inputPendingSince = JitterBuffer::nowMicros();
+        inputFromY = thisClient == clientRole::ONE ? playerOne->getY() : playerTwo->getY();
+    }
+}
+
+/**
+ * Called from render() once positions for the frame are set. Records the delay if our bat has
+ * moved since the timed key press.
+ * @param now time the frame is being drawn, in microseconds.
+ */
+void MyGame::stopInputTimer(uint64_t now) {
+    if (inputPendingSince == 0) {
+        return;
+    }
+    int y = thisClient == clientRole::ONE ? playerOne->getY() : playerTwo->getY();
+    uint64_t elapsed = now - inputPendingSince;
+    if (y != inputFromY) {
+        inputToPhotonCount++;
+        inputToPhotonTotalUs += elapsed;
+        if (elapsed > inputToPhotonMaxUs) {
+            inputToPhotonMaxUs = elapsed;
         }
+        inputPendingSince = 0;
     }
+    else if (elapsed > 1000000) { //bat was already against the edge, nothing will move
+        inputPendingSince = 0;
+    }
+}
+
+/**
+ * Sets how received positions are buffered and interpolated before rendering.
+ * @param config the jitter buffer tuning to use.
+ */
+void MyGame::setInterpolation(const JitterConfig& config) {
+    jitter.configure(config);
+}
+
+/**
+ * Gets the jitter buffer counters: depth, late packets, extrapolation time, delay and jitter.
+ */
+JitterStats MyGame::getJitterStats() {
+    return jitter.getStats();
+}
+
+/**
+ * Queues the ball trail and hit bursts into the frame's batch, between the bats and the ball.
+ */
+void MyGame::drawParticles() {
+    PROFILE_SCOPE("particles draw");
+    ballTrail.draw(batch, LAYER_WORLD);
+    batSparks.draw(batch, LAYER_WORLD);
+    wallSparks.draw(batch, LAYER_WORLD);
 }
 
 /**
- * Called from render(), converts a surface and creates subsequent texture from provided text.
+ * Called from render(), draws text centred on x, y. The texture is cached, so text that is
+ * unchanged since an earlier frame is not rasterized or uploaded again.
  * @param renderer pointer to the renderer in use
  * @param x horizontal position to render text
  * @param y vertical position to render text
  * @param text the string to render
  * @param selectedFont the TTF font to use
  */
-void MyGame::drawText(SDL_Renderer* renderer, int x, int y, std::string text, TTF_Font * selectedFont) {
-    SDL_Texture* textText = nullptr;
-    SDL_Surface* textSurf = TTF_RenderText_Blended(selectedFont, text.c_str(), textColour);
-    if (textSurf != nullptr) {
-        textText = SDL_CreateTextureFromSurface(renderer, textSurf);
-        SDL_FreeSurface(textSurf);
+void MyGame::drawText(SDL_Renderer* renderer, int x, int y, std::string_view text, TTF_Font * selectedFont) {
+    PROFILE_SCOPE("text");
+    textCache.draw(renderer, selectedFont, x, y, text, textColour);
+}
+
+/**
+ * Called from render() for text that changes often, such as scores, the countdown and counters.
+ * Composed from the font's cached glyphs so new values never fill the text cache.
+ * @param renderer pointer to the renderer in use
+ * @param x horizontal position to render text
+ * @param y vertical position to render text
+ * @param text the string to render
+ * @param selectedFont the TTF font to use
+ */
+void MyGame::drawGlyphText(SDL_Renderer* renderer, int x, int y, std::string_view text, TTF_Font * selectedFont) {
+    PROFILE_SCOPE("glyph text");
+    textCache.drawGlyphs(renderer, selectedFont, x, y, text, textColour);
+}
+
+/**
+ * Turns the text cache on or off, to compare frame times against rendering text every frame.
+ * @param enable true to cache.
+ */
+void MyGame::setTextCache(bool enable) {
+    textCache.setEnabled(enable);
+}
+
+/**
+ * Turns printing of received messages on or off. Hundreds of bots printing every message would
+ * spend more time on the console than on the network.
+ * @param enable true to print.
+ */
+void MyGame::setLogging(bool enable) {
+    logMessages = enable;
+}
+
+/**
+ * Samples the match for a bot: our role, our bat and the ball, from the same jitter buffer and
+ * predictor the renderer uses.
+ * @param now current time in microseconds.
+ */
+GameView MyGame::getView(uint64_t now) {
+    GameView view;
+    switch (thisClient) {
+        case clientRole::ONE:
+            view.role = 1;
+            break;
+        case clientRole::TWO:
+            view.role = 2;
+            break;
+        case clientRole::SPECTATOR:
+            view.role = 3;
+            break;
+        default:
+            break;
     }
-    else {
-        std::cout << "Failed to create texture from string: " << text << std::endl;
-        std::cout << TTF_GetError() << std::endl;
+    view.gameOver = state.getWinner() != Winner::NONE;
+
+    float positions[SNAPSHOT_POSITIONS];
+    if (!jitter.sample(now, positions)) {
+        return view;
+    }
+    view.valid = true;
+    view.ballX = positions[SNAP_BALL_X];
+    view.ballY = positions[SNAP_BALL_Y];
+    if (view.role == 1 || view.role == 2) {
+        view.ownY = predictor.isActive() ? predictor.displayY(now) : positions[view.role == 1 ? SNAP_P1_Y : SNAP_P2_Y];
+    }
+    return view;
+}
+
+/**
+ * Passes the main loop's frame timing to the F3 overlay.
+ * @param stats counters from the FrameClock.
+ */
+void MyGame::setFrameStats(const FrameStats& stats) {
+    frameStats = stats;
+}
+
+/**
+ * Passes the latest network telemetry period to the F4 overlay.
+ * @param sample the period's measurements.
+ */
+void MyGame::setNetSample(const NetSample& sample) {
+    netSample = sample;
+}
+
+/**
+ * Gets how many commands are waiting to be sent, for telemetry and to wake the reactor.
+ */
+size_t MyGame::getOutboundDepth() const {
+    return inputQueue.size() + replyQueue.size();
+}
+
+/**
+ * Gets how many server messages were ignored for an unknown command or bad arguments.
+ */
+uint64_t MyGame::getRejectedMessages() const {
+    return rejectedMessages.load();
+}
+
+/**
+ * Called from render() when F4 is on, draws the latest telemetry period above the F3 overlay:
+ * round trip, snapshot timing, bandwidth, the send queue and the busiest message kinds.
+ * @param renderer pointer to the renderer in use.
+ */
+void MyGame::drawTelemetry(SDL_Renderer* renderer) {
+    const NetSample& s = netSample;
+    char line[160];
+    snprintf(line, sizeof(line), "ping %.0fms min %.0f max %.0f lost %llu  snapshots %.1f/s every %.1fms jitter %.1fms gap %.0fms",
+        s.rttMs, s.rttMinMs, s.rttMaxMs, (unsigned long long)s.pingsLost, s.snapshotRate,
+        s.snapshotIntervalMs, s.snapshotJitterMs, s.maxGapMs);
+    drawGlyphText(renderer, 400, 480, line, fontInfo);
+
+    snprintf(line, sizeof(line), "in %.1fKB/s %.0f msg/s  out %.1fKB/s %.0f msg/s  send queue max %zu wait %.2fms max %.2fms",
+        s.bytesInPerSec / 1024, s.messagesInPerSec, s.bytesOutPerSec / 1024, s.messagesOutPerSec,
+        s.maxQueueDepth, s.queueWaitMs, s.maxQueueWaitMs);
+    drawGlyphText(renderer, 400, 455, line, fontInfo);
+
+    int written = 0;
+    line[0] = '\0';
+    for (int kind = 0; kind < TELEMETRY_KINDS && written < (int)sizeof(line); kind++) {
+        const KindStats& k = s.kinds[kind];
+        if (k.count > 0) {
+            written += snprintf(line + written, sizeof(line) - written, "%s %llu %.1fus  ",
+                telemetryKindName(kind), (unsigned long long)k.count, k.parseUs + k.handleUs);
+        }
+    }
+    drawGlyphText(renderer, 400, 430, line, fontInfo);
+}
+
+/**
+ * Called from render() when F5 is on, lists the profiled sections below the scores with their
+ * min, mean and p99 time over recent calls. The summary is refreshed twice a second so it can
+ * be read, and so sorting it does not show up in the frames it measures.
+ * @param renderer pointer to the renderer in use.
+ */
+void MyGame::drawProfile(SDL_Renderer* renderer) {
+    uint64_t now = JitterBuffer::nowMicros();
+    if (profileSummaryAt == 0 || now - profileSummaryAt >= PROFILE_REFRESH) {
+        profileSummary = Profiler::summarize();
+        profileSummaryAt = now;
+    }
+    char line[128];
+    int y = 150;
+    if (profileSummary.empty()) {
+        drawGlyphText(renderer, 400, y, PONG_PROFILE ? "no profiled sections yet" : "profiler compiled out", fontInfo);
+        return;
+    }
+    for (size_t i = 0; i < profileSummary.size() && i < PROFILE_LINES; i++, y += 20) {
+        const SectionSummary& s = profileSummary[i];
+        snprintf(line, sizeof(line), "%s/%s  min %.1fus  avg %.1fus  p99 %.1fus  max %.1fus",
+            s.thread.c_str(), s.name, s.minUs, s.avgUs, s.p99Us, s.maxUs);
+        drawGlyphText(renderer, 400, y, line, fontInfo);
+    }
+    if (Profiler::getDropped() > 0) {
+        snprintf(line, sizeof(line), "dropped %llu events", (unsigned long long)Profiler::getDropped());
+        drawGlyphText(renderer, 400, y, line, fontInfo);
+    }
+}
+
+/**
+ * Prints average and worst render() time for the menu and in-game screens.
+ */
+void MyGame::printFrameTimes() {
+    TextCacheStats text = textCache.getStats();
+    printf("Render time, menu screens: %llu frames, avg %.3fms, max %.3fms\n",
+        (unsigned long long)menuFrames.frames, menuFrames.averageMs(), menuFrames.maxUs / 1000.0);
+    printf("Render time, in game: %llu frames, avg %.3fms, max %.3fms\n",
+        (unsigned long long)gameFrames.frames, gameFrames.averageMs(), gameFrames.maxUs / 1000.0);
+    printf("Text cache: %llu hits, %llu misses, %llu evictions, %llu glyph draws\n",
+        (unsigned long long)text.hits, (unsigned long long)text.misses,
+        (unsigned long long)text.evictions, (unsigned long long)text.glyphDraws);
+    printf("Sprite batch: %llu frames, avg %.1f draw calls and %.1f quads per frame\n",
+        (unsigned long long)batchTotals.flushes,
+        batchTotals.flushes > 0 ? (double)batchTotals.drawCalls / batchTotals.flushes : 0.0,
+        batchTotals.flushes > 0 ? (double)batchTotals.quads / batchTotals.flushes : 0.0);
+    if (screenCacheHits > 0) {
+        printf("Screen cache: %llu text screens copied rather than drawn\n", (unsigned long long)screenCacheHits);
     }
-    int w, h;
-    SDL_QueryTexture(textText, 0, 0, &w, &h);
-    SDL_Rect dst{ x - (w/2), y - (h/2), w, h };
-    SDL_RenderCopyEx(renderer, textText, 0, &dst, 0.0, 0, SDL_RendererFlip::SDL_FLIP_NONE);
-    SDL_DestroyTexture(textText);
 }
 
 /**
  * Gets which player has been registered as winning.
- * @return
+ * @return Winner::NONE while the match is still being played.
+ */
+Winner MyGame::getWinner() const {
+    return state.getWinner();
+}
+
+/**
+ * Gets the match state and its recent history, e.g. to ask where the ball was a few ticks ago.
  */
-std::string MyGame::getWinCondition() {
-    return game_data.playerWin;
+const GameStateStore& MyGame::getState() const {
+    return state;
 }
 
 MyGame::~MyGame() {
-    std::cout << "Deleting MyGame instance" << std::endl;
+    if (!headless && logMessages) {
+        std::cout << "Deleting MyGame instance" << std::endl;
+    }
+    textCache.clear();
+    resetScreenCache();
     delete playerOne;
     delete playerTwo;
-    TTF_CloseFont(fontTitle);
-    TTF_CloseFont(fontInfo);
-    Mix_FreeChunk(wallHit);
-    Mix_FreeChunk(batHit);
-    ballTrail.clear();
+    assets.clear();
 }
\ No newline at end of file
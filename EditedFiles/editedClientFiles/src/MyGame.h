@@ -1,46 +1,82 @@
 #ifndef __MY_GAME_H__
 #define __MY_GAME_H__
 
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 
 #include "SDL.h"
 #include "SDL_ttf.h"
 #include "SDL_mixer.h"
 #include "SDL_image.h"
 
-//structure of game data.
-static struct GameData {
-    std::string countdown = "3";
-    std::string playerWin = "0";
-} game_data;
+#include "Assets.h"
+#include "ClientCommand.h"
+#include "FrameClock.h"
+#include "GameState.h"
+#include "JitterBuffer.h"
+#include "NetTelemetry.h"
+#include "PaddlePredictor.h"
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include "Replay.h"
+#include "Message.h"
+#include "Snapshot.h"
+#include "SpriteBatch.h"
+#include "SpscQueue.h"
+#include "TextCache.h"
+#include "WakeSignal.h"
 
 //structure of data relating to errors.
-static struct ErrorData {
+struct ErrorData {
     bool errorScreen = false; //should we render the error screen for connection
     std::string errorMessage; //what is the current error
-} currError;
+};
+
+//What a bot can see of the match, sampled from the same buffers the renderer uses.
+struct GameView {
+    int role = 0; //1 or 2 for players, 3 for spectators, 0 before the server assigns one
+    bool valid = false; //positions have been received
+    float ownY = 0; //top of our bat, as predicted, if we are a player
+    float ballX = 0;
+    float ballY = 0;
+    bool gameOver = false;
+};
+
+//Time spent in render() for one kind of screen.
+struct FrameTimes {
+    uint64_t frames = 0;
+    uint64_t totalUs = 0;
+    uint64_t maxUs = 0;
+
+    void add(uint64_t us) {
+        frames++;
+        totalUs += us;
+        if (us > maxUs) {
+            maxUs = us;
+        }
+    }
+    double averageMs() const {
+        return frames > 0 ? totalUs / 1000.0 / frames : 0.0;
+    }
+};
 
 //Entity Parent class.
 class Entity {
 protected:
     SDL_Rect bounds = { 0, 0, 0, 0 };
-    SDL_Texture* texture;
+    Sprite sprite; //region of the sprite atlas, owned by MyGame's AssetManager
 public:
-    ~Entity() {
-        if (texture != nullptr) {
-            SDL_DestroyTexture(texture);
-        }
-    }
     void setX(int xPos) {
         bounds.x = xPos;
     }
     void setY(int yPos) {
         bounds.y = yPos;
     }
-    void setTex(SDL_Texture* surf) {
-        texture = surf;
+    void setSprite(const Sprite& atlasSprite) {
+        sprite = atlasSprite;
     }
 
     int getX() {
@@ -53,25 +89,20 @@ public:
         return bounds;
     }
     SDL_Texture* getTex() {
-        return texture;
+        return sprite.texture;
+    }
+    const SDL_Rect& getClip() {
+        return sprite.rect;
     }
 };
 
 //Player Child class. Inherits from Entity.
 class Player : public Entity {
-protected:
-    std::string score = "0";
 public:
     Player() {
         bounds.w = 20;
         bounds.h = 60;
     }
-    void setScore(std::string newScore) {
-        score = newScore;
-    }
-    std::string getScore() {
-        return score;
-    }
 };
 
 //Ball Child class. Inherits from Entity.
@@ -85,54 +116,167 @@ public:
 
 class MyGame {
     private:
-        TTF_Font* fontTitle; //font settings for title
-        TTF_Font* fontInfo; //font settings for info text
-        Mix_Chunk* batHit; //sound loaded for ball hit bat
-        Mix_Chunk* wallHit; //sound loaded for ball hit wall
-        Mix_Chunk* countdownClick; //sound loaded for countdown tick
-        SDL_Color textColour{ 255, 255, 255, 255 }; //default colour to be used for text
+        GameStateStore state; //score, countdown, winner and recent positions, as the server sent them
+        uint32_t stateTextVersion = ~0u; //state version the strings below were formatted from
+        char scoreText[2][8] = {};
+        char countdownText[8] = {};
+        char winnerText[32] = {};
+        ErrorData currError;
+        std::string serverPrompt = "Connect to localhost? ENTER to confirm."; //menu line naming the server
+        bool takeOverOnSpectate = false; //rejoining after a drop as a player, so ask for a free slot if made a spectator
+        bool headless = false; //no window, audio or assets, for bots
+        bool logMessages = true; //print received messages to the console
+        std::atomic<uint64_t> rejectedMessages{ 0 }; //unknown commands or the wrong number of arguments
 
-        SDL_Surface* fileImgLoad; //load ball image
-        SDL_Texture* tPongBall; //texture from ball image
-        SDL_Texture* tPongBat; //texture from bat image
+        AssetManager assets; //images, sounds and fonts, loaded on a worker while the menu renders
+        AssetManager* assetSource = &assets; //assets, or another game's given to shareAssets()
+        bool assetsAdopted = false; //the pointers below have been taken from assets
+        bool syncAssets = false; //block in setup() until assets are loaded, the behaviour before the worker
+        bool audio = true; //play sound effects
+        AssetManager::Handle ballImage = -1, batImage = -1; //handles of what setup() requested
+        AssetManager::Handle titleFont = -1, infoFont = -1;
+        AssetManager::Handle batHitSound = -1, wallHitSound = -1, clickSound = -1;
+        TTF_Font* fontTitle = nullptr; //font settings for title
+        TTF_Font* fontInfo = nullptr; //font settings for info text
+        std::atomic<Mix_Chunk*> batHit{ nullptr }; //sound loaded for ball hit bat by the asset worker, played as hits are handled
+        std::atomic<Mix_Chunk*> wallHit{ nullptr }; //sound loaded for ball hit wall
+        std::atomic<Mix_Chunk*> countdownClick{ nullptr }; //sound loaded for countdown tick
+        SDL_Color textColour{ 255, 255, 255, 255 }; //default colour to be used for text
+        TextCache textCache; //rendered strings and glyph atlases, so text is not rasterized every frame
+        SpriteBatch batch; //sprites, particles and text for the frame, drawn together at the end of render()
+        SpriteBatchStats batchFrame; //draw calls and quads of the last frame, shown in the F3 overlay
+        SpriteBatchStats batchTotals;
+        std::atomic<bool> dirty{ true }; //something shown has changed since the last render()
+        std::atomic<uint64_t> positionsAt{ 0 }; //JitterBuffer::nowMicros() when positions last arrived
+        int keysHeld = 0; //W and S held down, our bat is moving
+        bool cacheScreens = false; //draw the menu, error and game over screens once into screenTexture
+        SDL_Texture* screenTexture = nullptr; //the last text screen drawn, copied while unchanged
+        uint32_t screenVersion = 0; //bumped when what a text screen shows changes
+        uint32_t cachedScreen = ~0u; //screenKey() of what screenTexture holds
+        uint64_t screenCacheHits = 0;
+        FrameTimes menuFrames; //render time of the menu, error and game over screens
+        FrameTimes gameFrames; //render time of the in-game screen
 
         double ballAngle = 0.0; //angle to rotate ball texture
+        double previousBallAngle = 0.0; //angle before the last update, for interpolating between updates
         bool menu = true; //should we render the menu
+        bool showNetStats = false; //should we render the jitter buffer counters, toggled with F3
+        bool showTelemetry = false; //should we render the network telemetry, toggled with F4
+        NetSample netSample; //latest telemetry period, shown in the F4 overlay
+        bool showProfile = false; //should we render the profiler summary, toggled with F5
+        std::vector<SectionSummary> profileSummary; //shown in the F5 overlay, refreshed every PROFILE_REFRESH
+        uint64_t profileSummaryAt = 0; //when profileSummary was taken, microseconds
 
-        std::vector<SDL_Rect*> ballTrail; //data structure used to store the particles for trail of ball
+        ParticleSystem ballTrail; //particles left behind the ball
+        ParticleSystem batSparks; //burst when the ball hits a bat
+        ParticleSystem wallSparks; //burst when the ball hits a wall
+        std::atomic<int> pendingBatHits{ 0 }; //hits reported as messages are handled, emitted on the next update
+        std::atomic<int> pendingWallHits{ 0 };
+        FrameStats frameStats; //main loop timing, shown in the F3 overlay
 
         enum class clientRole { //enum class designating client role
             ONE, TWO, SPECTATOR, NONE
         };
-        clientRole thisClient; //current role of client.
+        clientRole thisClient = clientRole::NONE; //current role of client.
 
-        Player* playerOne; //pointer to player 1 of class player
-        Player* playerTwo; //pointer to player 2 of class player
+        Player* playerOne = nullptr; //pointer to player 1 of class player
+        Player* playerTwo = nullptr; //pointer to player 2 of class player
         Ball ball;
 
+        SnapshotDecoder snapshotDecoder; //history of binary snapshots for resolving deltas
+        JitterBuffer jitter; //received positions, rendered a short delay behind real time
+        PaddlePredictor predictor; //our own bat, simulated ahead of the server
+        uint64_t arrivalUs = 0; //when the message being handled was read from the socket, 0 for now
+
+        uint64_t inputPendingSince = 0; //time of a W/S press not yet visible on screen, 0 if none
+        int inputFromY = 0; //where our bat was drawn when that key was pressed
+        uint64_t inputToPhotonCount = 0; //key presses timed until the bat visibly moved
+        uint64_t inputToPhotonTotalUs = 0;
+        uint64_t inputToPhotonMaxUs = 0;
+
+        uint64_t arrival() const;
+        void reconcilePrediction(int p1y, int p2y, int p1Input, int p2Input);
+        void formatStateText(const GameState& match, uint32_t version);
+        bool adoptAssets(SDL_Renderer* renderer);
+        void drawLoading(SDL_Renderer* renderer);
+        void screenChanged();
+        uint32_t screenKey(const GameState& match) const;
+        bool beginScreenCache(SDL_Renderer* renderer);
+        void endScreenCache(SDL_Renderer* renderer, uint32_t key);
+        void startInputTimer(bool pressed);
+        void stopInputTimer(uint64_t now);
+
+        SpscQueue<ClientCommand, 64> inputQueue; //commands from the render/input thread
+        SpscQueue<ClientCommand, 64> replyQueue; //answers to server messages, e.g. CONFIRM
+        WakeSignal outboundSignal; //wakes the UDP send thread when either queue has work; the main loop wakes the reactor
+
     public:
-        ~MyGame();
+        typedef void (MyGame::*MessageHandler)(const MessageArgs& args);
 
-        std::vector<std::string> messages;
+        explicit MyGame(bool headless = false);
+        ~MyGame();
 
         //Functions found in original code
-        void on_receive(std::string message, std::vector<std::string>& args);
-        void send(std::string message);
+        void on_receive(std::string_view cmd, const MessageArgs& args);
+        void send(CommandId id, uint32_t arg = 0);
         void input(SDL_Event& event);
         void setup(SDL_Renderer* renderer);
-        void update();
-        void render(SDL_Renderer* renderer);
+        void update(float dt);
+        void render(SDL_Renderer* renderer, float alpha);
+        void renderStatus(SDL_Renderer* renderer, std::string_view text);
 
         //functions created during project
-        void printMessage(std::string cmd, std::vector<std::string>& args);
+        void on_snapshot(std::string_view payload);
+        void onGameData(const MessageArgs& args);
+        void onBatHit(const MessageArgs& args);
+        void onWallHit(const MessageArgs& args);
+        void onGoal(const MessageArgs& args);
+        void onRole(const MessageArgs& args);
+        void onCount(const MessageArgs& args);
+        void onConnCheck(const MessageArgs& args);
+        void onWire(const MessageArgs& args);
+        void reply(CommandId id, uint32_t arg = 0);
+        bool nextOutbound(ClientCommand& command);
+        bool waitOutbound(int timeoutMs);
+        void wakeSender();
+        void setArrival(uint64_t receivedUs);
+        void setInterpolation(const JitterConfig& config);
+        JitterStats getJitterStats();
+        void setPrediction(bool enable);
+        void setTextCache(bool enable);
+        void setAssetBundle(const std::string& path);
+        void setSyncAssets(bool enable);
+        void shareAssets(MyGame& owner);
+        void setAudio(bool enable);
+        void setScreenCache(bool enable);
+        void resetScreenCache();
+        bool needsRedraw(uint64_t now);
+        void markDirty();
+        void waitForAssets(SDL_Renderer* renderer);
+        void setFrameStats(const FrameStats& stats);
+        void setNetSample(const NetSample& sample);
+        size_t getOutboundDepth() const;
+        uint64_t getRejectedMessages() const;
+        void drawTelemetry(SDL_Renderer* renderer);
+        void drawProfile(SDL_Renderer* renderer);
+        void setLogging(bool enable);
+        GameView getView(uint64_t now);
+        void printMessage(std::string_view cmd, const MessageArgs& args);
         void setMenu();
         void setErrorScreen();
         void setErrorMessage(std::string error);
         void resetWin();
-        void ballParticle(SDL_Renderer* renderer);
-        void drawText(SDL_Renderer* renderer, int x, int y, std::string text, TTF_Font * selectedFont);
+        void resumeMatch();
+        void setServer(const std::string& host, Uint16 port);
+        void restoreMatch(const MatchState& match);
+        void updateParticles(float dt);
+        void drawParticles();
+        void drawText(SDL_Renderer* renderer, int x, int y, std::string_view text, TTF_Font * selectedFont);
+        void drawGlyphText(SDL_Renderer* renderer, int x, int y, std::string_view text, TTF_Font * selectedFont);
+        void printFrameTimes();
 
-        std::string getWinCondition();
+        Winner getWinner() const;
+        const GameStateStore& getState() const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,662 @@
+#include "NetReactor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "JitterBuffer.h"
+#include "Profiler.h"
+
+NetReactor::~NetReactor() {
+    stop();
+}
+
+/**
+ * Opens the wake socket and starts the network thread. SDL_net must be initialised. Without a
+ * wake socket the thread still runs, waking every millisecond instead.
+ * @return false if the thread was already running.
+ */
+bool NetReactor::start() {
+    if (running) {
+        return false;
+    }
+    groupCapacity = GROUP_SIZE;
+    groups.push_back(SDLNet_AllocSocketSet(groupCapacity));
+    groupUsed.push_back(0);
+
+    wakeSocket = SDLNet_UDP_Open(0);
+    wakeSender = SDLNet_UDP_Open(0);
+    IPaddress* bound = wakeSocket != nullptr ? SDLNet_UDP_GetPeerAddress(wakeSocket, -1) : nullptr;
+    if (bound != nullptr && wakeSender != nullptr) {
+        wakePacket = SDLNet_AllocPacket(1);
+        drainPacket = SDLNet_AllocPacket(16);
+        SDLNet_ResolveHost(&wakePacket->address, "127.0.0.1", SDLNet_Read16(&bound->port));
+        wakePacket->data[0] = 0;
+        wakePacket->len = 1;
+        SDLNet_UDP_AddSocket(groups[0], wakeSocket);
+        groupUsed[0]++;
+    }
+    else {
+        std::printf("Network: no loopback wake socket, polling every millisecond instead\n");
+        if (wakeSocket != nullptr) {
+            SDLNet_UDP_Close(wakeSocket);
+            wakeSocket = nullptr;
+        }
+        if (wakeSender != nullptr) {
+            SDLNet_UDP_Close(wakeSender);
+            wakeSender = nullptr;
+        }
+    }
+
+    dialer = std::make_shared<Dialer>();
+    if (wakePacket != nullptr) {
+        dialer->wakeSender = SDLNet_UDP_Open(0);
+        dialer->wakePacket = SDLNet_AllocPacket(1);
+        dialer->wakePacket->address = wakePacket->address;
+        dialer->wakePacket->data[0] = 0;
+        dialer->wakePacket->len = 1;
+    }
+
+    running = true;
+    thread = std::thread([this] { serve(); });
+    dialerThread = std::thread(dial, dialer);
+    return true;
+}
+
+/**
+ * Carries out any open and close requests still queued, closes every connection after sending
+ * what its owner has queued, and joins the thread. No events are delivered after this. A connect
+ * still in progress is not waited for.
+ */
+void NetReactor::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    wake();
+    thread.join();
+
+    bool stuck;
+    {
+        std::lock_guard<std::mutex> lock(dialer->mutex);
+        dialer->running = false;
+        stuck = dialer->busy;
+    }
+    dialer->signal.notify();
+    if (stuck) {
+        dialerThread.detach(); //finishes its connect alone, then closes the socket
+    }
+    else {
+        dialerThread.join();
+    }
+    dialer.reset();
+    dialing.clear();
+    cancelled.clear();
+
+    for (SDLNet_SocketSet group : groups) {
+        SDLNet_FreeSocketSet(group);
+    }
+    groups.clear();
+    groupUsed.clear();
+    if (wakeSocket != nullptr) {
+        SDLNet_UDP_Close(wakeSocket);
+        SDLNet_UDP_Close(wakeSender);
+        SDLNet_FreePacket(wakePacket);
+        SDLNet_FreePacket(drainPacket);
+        wakeSocket = nullptr;
+        wakeSender = nullptr;
+    }
+}
+
+/**
+ * Asks for a connection to a server, made without blocking the network thread. Main thread only,
+ * while running.
+ * @param host name or address, resolved once and remembered.
+ * @param port the server's port.
+ * @param flush called on the network thread to send what the owner has queued.
+ * @param context passed to flush.
+ * @return the connection's id; an OPENED or CLOSED event for it follows.
+ */
+uint32_t NetReactor::open(const std::string& host, Uint16 port, NetFlush flush, void* context) {
+    Control control;
+    control.type = ControlType::OPEN;
+    control.connection = nextId++;
+    control.host = host;
+    control.port = port;
+    control.flush = flush;
+    control.context = context;
+    request(control);
+    return control.connection;
+}
+
+/**
+ * Hands a socket that is already connected to the network thread. Main thread only.
+ * @param socket the connection, owned by the reactor from now on.
+ * @param flush called on the network thread to send what the owner has queued.
+ * @param context passed to flush.
+ * @return the connection's id; an OPENED event for it follows.
+ */
+uint32_t NetReactor::add(TCPsocket socket, NetFlush flush, void* context) {
+    Control control;
+    control.type = ControlType::ADD;
+    control.connection = nextId++;
+    control.socket = socket;
+    control.flush = flush;
+    control.context = context;
+    request(control);
+    return control.connection;
+}
+
+/**
+ * Looks up a server on the dialer thread, for a transport the reactor doesn't serve such as UDP,
+ * so the main thread never waits on DNS. Answers are remembered as for open(). Main thread only,
+ * while running.
+ * @param host name or address.
+ * @param port the server's port.
+ * @return an id, as for a connection; a RESOLVED or CLOSED event for it follows, and close()
+ *         abandons it.
+ */
+uint32_t NetReactor::resolve(const std::string& host, Uint16 port) {
+    Control control;
+    control.type = ControlType::RESOLVE;
+    control.connection = nextId++;
+    control.host = host;
+    control.port = port;
+    request(control);
+    return control.connection;
+}
+
+/**
+ * Closes a connection once what its owner has queued is sent, e.g. a CON_CLOSE, or gives up on one
+ * still connecting. No event follows, and events for it still in the queue should be ignored.
+ * Main thread only.
+ * @param connection the id from open() or add(); 0 and ids already closed are ignored.
+ */
+void NetReactor::close(uint32_t connection) {
+    if (connection == 0) {
+        return;
+    }
+    Control control;
+    control.type = ControlType::CLOSE;
+    control.connection = connection;
+    request(control);
+}
+
+void NetReactor::request(Control& control) {
+    if (!running) {
+        return; //nothing would ever take it
+    }
+    while (!controls.push(control)) {
+        wake();
+        SDL_Delay(1);
+    }
+    wake();
+}
+
+/**
+ * Interrupts the network thread's wait, so commands queued since are sent now rather than when it
+ * next wakes. Cheap to call when a wake is already pending. Main thread only.
+ */
+void NetReactor::wake() {
+    if (wakeSender != nullptr && !wakePending.exchange(true)) {
+        SDLNet_UDP_Send(wakeSender, -1, wakePacket);
+    }
+}
+
+/**
+ * Takes the oldest event. Main thread only, called until it returns false once a frame.
+ * @param event set to the event.
+ * @return false if there are none.
+ */
+bool NetReactor::next(NetEvent& event) {
+    if (events.pop(event)) {
+        return true;
+    }
+    notifyPending = false; //re-armed before looking again, so an event queued meanwhile is either taken or notified
+    return events.pop(event);
+}
+
+/**
+ * Has an SDL event pushed whenever events are queued for a main thread that is empty-handed, so a
+ * main loop sleeping in SDL_WaitEvent wakes for the network as for input. One is pushed until
+ * next() has emptied the queue again.
+ * @param eventType from SDL_RegisterEvents(), 0 to stop.
+ */
+void NetReactor::setNotify(Uint32 eventType) {
+    notifyType = eventType;
+}
+
+void NetReactor::announce() {
+    Uint32 type = notifyType;
+    if (type != 0 && !notifyPending.exchange(true)) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = type;
+        SDL_PushEvent(&event);
+    }
+}
+
+NetReactorStats NetReactor::getStats() const {
+    NetReactorStats stats;
+    stats.opened = opened;
+    stats.failed = failed;
+    stats.resolves = resolves;
+    stats.closedRemotely = closedRemotely;
+    stats.messages = messages;
+    stats.bytesReceived = bytesReceived;
+    stats.wakes = wakes;
+    stats.stalls = stalls;
+    stats.sendStalls = sendStalls;
+    stats.oversized = oversized;
+    return stats;
+}
+
+/**
+ * The network thread: applies requests, waits for any socket to be readable or a wake, reads and
+ * hands complete frames over, then lets every connection's owner send.
+ */
+void NetReactor::serve() {
+    PROFILE_THREAD("network");
+    Control control;
+    while (running) {
+        while (controls.pop(control)) {
+            apply(control);
+        }
+        Dialed result;
+        while (dialer->results.pop(result)) {
+            finish(result);
+        }
+
+        int ready;
+        {
+            PROFILE_SCOPE("net wait");
+            ready = wait(waitTimeout(JitterBuffer::nowMicros()));
+        }
+        if (ready > 0 && wakeSocket != nullptr && SDLNet_SocketReady(wakeSocket)) {
+            wakePending = false; //cleared first, so a wake sent while draining is not lost
+            while (SDLNet_UDP_Recv(wakeSocket, drainPacket) > 0) {
+            }
+            wakes++;
+        }
+
+        PROFILE_SCOPE("net io");
+        bool stalled = false;
+        uint64_t now = JitterBuffer::nowMicros();
+        for (size_t i = connections.size(); i-- > 0;) {
+            Connection& connection = *connections[i];
+            if (ready > 0 && !connection.backlog && SDLNet_SocketReady(connection.socket)) {
+                if (!receive(connection)) {
+                    drop(i, "Connection was terminated.", false);
+                    continue;
+                }
+            }
+            connection.backlog = !deliver(connection);
+            stalled = stalled || connection.backlog;
+            if (connection.flush != nullptr && now >= connection.flushAt) {
+                uint64_t hold = 0;
+                uint64_t sending = JitterBuffer::nowMicros();
+                if (!connection.flush(connection.context, connection.socket, &hold)) {
+                    drop(i, "Could not send to the server.", false);
+                    continue;
+                }
+                if (JitterBuffer::nowMicros() - sending > SEND_STALL) {
+                    sendStalls++;
+                    drop(i, "The server stopped reading.", false);
+                    continue;
+                }
+                connection.flushAt = hold > 0 ? now + hold : 0;
+            }
+        }
+        if (stalled) {
+            stalls++;
+            SDL_Delay(1);
+        }
+    }
+
+    while (controls.pop(control)) {
+        apply(control);
+    }
+    for (size_t i = connections.size(); i-- > 0;) {
+        drop(i, "", true);
+    }
+}
+
+/**
+ * Carries out one request from the main thread.
+ */
+void NetReactor::apply(Control& control) {
+    switch (control.type) {
+    case ControlType::OPEN:
+    case ControlType::RESOLVE:
+        while (!dialer->requests.push(control)) {
+            SDL_Delay(1);
+        }
+        dialer->signal.notify();
+        dialing.push_back(control.connection);
+        break;
+    case ControlType::ADD:
+        adopt(control.connection, control.socket, control.flush, control.context);
+        break;
+    case ControlType::CLOSE:
+        for (size_t i = 0; i < connections.size(); i++) {
+            if (connections[i]->id == control.connection) {
+                drop(i, "", true);
+                return;
+            }
+        }
+        if (std::find(dialing.begin(), dialing.end(), control.connection) != dialing.end()) {
+            cancelled.push_back(control.connection); //closed as soon as the dialer is done with it
+        }
+        break;
+    }
+}
+
+/**
+ * Starts serving a connected socket, in the first socket group with room. On POSIX the one group
+ * is grown instead of adding another.
+ */
+void NetReactor::adopt(uint32_t id, TCPsocket socket, NetFlush flush, void* context) {
+#ifndef _WIN32
+    if (groups.size() == 1 && groupUsed[0] >= groupCapacity) {
+        regroup(groupCapacity * 2);
+    }
+#endif
+    size_t group = 0;
+    while (group < groups.size() && groupUsed[group] >= groupCapacity) {
+        group++;
+    }
+    if (group == groups.size()) {
+        groups.push_back(SDLNet_AllocSocketSet(groupCapacity));
+        groupUsed.push_back(0);
+    }
+    SDLNet_TCP_AddSocket(groups[group], socket);
+    groupUsed[group]++;
+
+    connections.push_back(std::make_unique<Connection>());
+    Connection& connection = *connections.back();
+    connection.id = id;
+    connection.socket = socket;
+    connection.group = group;
+    connection.flush = flush;
+    connection.context = context;
+    opened++;
+    notice(id, NetEventType::OPENED, "");
+}
+
+/**
+ * Moves every socket into one larger set, so the thread can keep waiting in a single select().
+ * Not used on Windows, where a set holds at most 64.
+ * @param capacity sockets the new set holds.
+ */
+void NetReactor::regroup(int capacity) {
+    SDLNet_SocketSet larger = SDLNet_AllocSocketSet(capacity);
+    if (larger == nullptr) {
+        return; //adopt() starts a second group instead
+    }
+    if (wakeSocket != nullptr) {
+        SDLNet_UDP_AddSocket(larger, wakeSocket);
+    }
+    for (const auto& connection : connections) {
+        SDLNet_TCP_AddSocket(larger, connection->socket);
+    }
+    SDLNet_FreeSocketSet(groups[0]);
+    groups[0] = larger;
+    groupCapacity = capacity;
+}
+
+/**
+ * Closes a connection and forgets it.
+ * @param index position in connections, which changes for the last one.
+ * @param reason told to the main thread when it didn't ask for the close.
+ * @param byOwner the main thread asked: what its owner has queued is sent first, and no event follows.
+ */
+void NetReactor::drop(size_t index, std::string_view reason, bool byOwner) {
+    Connection& connection = *connections[index];
+    if (byOwner && connection.flush != nullptr) {
+        connection.flush(connection.context, connection.socket, nullptr);
+    }
+    else if (!byOwner) {
+        closedRemotely++;
+        notice(connection.id, NetEventType::CLOSED, reason);
+    }
+    SDLNet_TCP_DelSocket(groups[connection.group], connection.socket);
+    groupUsed[connection.group]--;
+    SDLNet_TCP_Close(connection.socket);
+    connections[index] = std::move(connections.back());
+    connections.pop_back();
+}
+
+/**
+ * Serves a connect or lookup the dialer has finished: a new connection, a RESOLVED event with the
+ * address, a CLOSED event saying why it failed, or nothing if the main thread closed it meanwhile.
+ */
+void NetReactor::finish(Dialed& result) {
+    dialing.erase(std::find(dialing.begin(), dialing.end(), result.connection));
+    resolves += result.looked ? 1 : 0;
+    auto gone = std::find(cancelled.begin(), cancelled.end(), result.connection);
+    if (gone != cancelled.end()) {
+        cancelled.erase(gone);
+        if (result.socket != nullptr) {
+            SDLNet_TCP_Close(result.socket);
+        }
+        return;
+    }
+    if (result.resolveOnly) {
+        notice(result.connection, NetEventType::RESOLVED,
+            std::string_view((const char*)&result.address, sizeof(result.address)));
+        return;
+    }
+    if (result.socket == nullptr) {
+        failed++;
+        notice(result.connection, NetEventType::CLOSED, result.error);
+        return;
+    }
+    adopt(result.connection, result.socket, result.flush, result.context);
+}
+
+/**
+ * The dialer thread: resolves and connects one request at a time, as both block, and hands the
+ * result to the reactor thread. Holds its own reference to the shared state, as it may outlive
+ * the reactor.
+ */
+void NetReactor::dial(std::shared_ptr<Dialer> dialer) {
+    PROFILE_THREAD("dialer");
+    Control request;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(dialer->mutex);
+            if (!dialer->running) {
+                break;
+            }
+            dialer->busy = dialer->requests.pop(request);
+        }
+        if (!dialer->busy) {
+            dialer->signal.wait(IDLE_WAIT);
+            continue;
+        }
+
+        Dialed result;
+        result.connection = request.connection;
+        result.flush = request.flush;
+        result.context = request.context;
+        IPaddress address;
+        if (!lookup(*dialer, request.host, request.port, address, result.looked)) {
+            result.error = "Could not resolve " + request.host;
+        }
+        else if (request.type == ControlType::RESOLVE) {
+            result.resolveOnly = true;
+            result.address = address;
+        }
+        else {
+            result.socket = SDLNet_TCP_Open(&address); //SDL_net sets TCP_NODELAY, so inputs are not held by Nagle
+            if (result.socket == nullptr) {
+                const char* error = SDLNet_GetError();
+                result.error = error != nullptr && error[0] != 0 ? error : "Could not connect.";
+            }
+        }
+
+        bool abandoned;
+        {
+            std::lock_guard<std::mutex> lock(dialer->mutex);
+            dialer->busy = false;
+            abandoned = !dialer->running;
+        }
+        if (abandoned || !dialer->results.push(result)) {
+            if (result.socket != nullptr) {
+                SDLNet_TCP_Close(result.socket); //the reactor is stopping, or too far behind to want it
+            }
+            continue;
+        }
+        if (dialer->wakeSender != nullptr) {
+            SDLNet_UDP_Send(dialer->wakeSender, -1, dialer->wakePacket);
+        }
+    }
+}
+
+/**
+ * Resolves a host the first time it is asked for, and remembers the answer. Dialer only.
+ * @param looked set to true if it wasn't remembered.
+ * @return false if it could not be resolved.
+ */
+bool NetReactor::lookup(Dialer& dialer, const std::string& host, Uint16 port, IPaddress& address, bool& looked) {
+    for (const Resolved& known : dialer.resolved) {
+        if (known.port == port && known.host == host) {
+            address = known.address;
+            return true;
+        }
+    }
+    looked = true;
+    if (SDLNet_ResolveHost(&address, host.c_str(), port) == -1) {
+        return false;
+    }
+    dialer.resolved.push_back(Resolved{ host, port, address });
+    return true;
+}
+
+/**
+ * Closes the sockets of results never taken, once neither thread holds the dialer.
+ */
+NetReactor::Dialer::~Dialer() {
+    Dialed result;
+    while (results.pop(result)) {
+        if (result.socket != nullptr) {
+            SDLNet_TCP_Close(result.socket);
+        }
+    }
+    if (wakeSender != nullptr) {
+        SDLNet_UDP_Close(wakeSender);
+        SDLNet_FreePacket(wakePacket);
+    }
+}
+
+/**
+ * Reads what is waiting on a readable socket into its frame reader.
+ * @return false if the connection was closed.
+ */
+bool NetReactor::receive(Connection& connection) {
+    const size_t receive_chunk = 1024; //minimum free space offered to each read
+
+    size_t writable;
+    char* buffer = connection.reader.prepareWrite(receive_chunk, writable);
+    int received = SDLNet_TCP_Recv(connection.socket, buffer, (int)writable);
+    if (received <= 0) {
+        return false;
+    }
+    connection.reader.commitWrite(received);
+    connection.readAt = JitterBuffer::nowMicros();
+    bytesReceived += received;
+    return true;
+}
+
+/**
+ * Moves complete frames from a connection's reader to the event queue while it has room.
+ * @return false if frames may be left because the queue filled.
+ */
+bool NetReactor::deliver(Connection& connection) {
+    std::string_view payload;
+    NetEvent event;
+    event.connection = connection.id;
+    event.type = NetEventType::MESSAGE;
+    while (true) {
+        if (events.size() >= EVENT_CAPACITY) {
+            return false;
+        }
+        if (!connection.reader.next(payload)) {
+            return true;
+        }
+        if (payload.size() > NET_EVENT_PAYLOAD) {
+            if (oversized++ == 0) {
+                std::printf("Network: dropped a %zu byte message, longer than any the server sends\n", payload.size());
+            }
+            continue;
+        }
+        std::memcpy(event.payload, payload.data(), payload.size());
+        event.size = (uint16_t)payload.size();
+        event.wireBytes = (uint32_t)(FRAME_HEADER_SIZE + payload.size());
+        event.receivedUs = connection.readAt;
+        events.push(event);
+        messages++;
+        announce();
+    }
+}
+
+/**
+ * Queues an OPENED, CLOSED or RESOLVED event, waiting for room as it must not be lost, unless stopping.
+ * @param text why, for CLOSED, or the address, for RESOLVED; cut to fit.
+ */
+void NetReactor::notice(uint32_t connection, NetEventType type, std::string_view text) {
+    NetEvent event;
+    event.connection = connection;
+    event.type = type;
+    event.size = (uint16_t)std::min(text.size(), NET_EVENT_PAYLOAD);
+    std::memcpy(event.payload, text.data(), event.size);
+    event.receivedUs = JitterBuffer::nowMicros();
+    while (!events.push(event)) {
+        if (!running) {
+            return;
+        }
+        SDL_Delay(1);
+    }
+    announce();
+}
+
+/**
+ * Gets how long the thread may wait for sockets before a connection's held output is due.
+ * @param now JitterBuffer::nowMicros().
+ * @return milliseconds, IDLE_WAIT at most.
+ */
+Uint32 NetReactor::waitTimeout(uint64_t now) const {
+    uint64_t timeout = IDLE_WAIT * 1000ull;
+    for (const auto& connection : connections) {
+        if (connection->flushAt > 0) {
+            uint64_t due = connection->flushAt > now ? connection->flushAt - now : 0;
+            timeout = due < timeout ? due : timeout;
+        }
+    }
+    return (Uint32)((timeout + 999) / 1000); //rounded up, so a hold is never cut short
+}
+
+/**
+ * Waits for a socket to be readable. With more than one group, as on Windows past 64 sockets,
+ * each is only checked, as select() can wait on one set at a time.
+ * @param timeoutMs longest wait.
+ * @return sockets ready, 0 if none.
+ */
+int NetReactor::wait(Uint32 timeoutMs) {
+    if (groups.size() == 1) {
+        int ready = SDLNet_CheckSockets(groups[0], wakeSocket != nullptr ? timeoutMs : 1);
+        if (ready < 0) {
+            SDL_Delay(1);
+        }
+        return ready;
+    }
+    int ready = 0;
+    for (SDLNet_SocketSet group : groups) {
+        int groupReady = SDLNet_CheckSockets(group, 0);
+        ready += groupReady > 0 ? groupReady : 0;
+    }
+    if (ready == 0) {
+        SDL_Delay(1);
+    }
+    return ready;
+}
@@ -0,0 +1,220 @@
+#ifndef __NET_REACTOR_H__
+#define __NET_REACTOR_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "SDL_net.h"
+
+#include "Framing.h"
+#include "SpscQueue.h"
+#include "WakeSignal.h"
+
+const size_t NET_EVENT_PAYLOAD = 104; //longest message handed over whole; server messages are a few dozen bytes
+
+//What happened on a connection, in the order it happened.
+enum class NetEventType : uint8_t {
+    OPENED, //connected, messages follow
+    MESSAGE, //one complete frame from the server
+    CLOSED, //closed by the server, the network or a failed connect; the payload says why
+    RESOLVED //a host asked for with resolve(); the payload holds its IPaddress
+};
+
+//One event handed from the reactor thread to the main thread. Copied whole through the queue, so
+//the payload is held inline rather than pointing into the connection's buffer.
+struct NetEvent {
+    uint32_t connection = 0;
+    NetEventType type = NetEventType::MESSAGE;
+    uint16_t size = 0; //bytes of payload used
+    uint32_t wireBytes = 0; //size on the wire, including framing
+    uint64_t receivedUs = 0; //JitterBuffer::nowMicros() when read from the socket
+    char payload[NET_EVENT_PAYLOAD];
+
+    std::string_view view() const {
+        return std::string_view(payload, size);
+    }
+};
+
+//Sends whatever the connection's owner has queued. Runs on the reactor thread, so it must not
+//sleep: to hold output back, e.g. so more commands join it in one send, it sets holdUs and the
+//reactor calls again once that time has passed, waking for it if need be. SDL_net's sends do
+//block, but only once the kernel's send buffer is full, which with a client's few bytes of input
+//per frame means the peer has stopped reading for minutes; a flush that blocks longer than
+//SEND_STALL closes its connection, so one stuck peer can't keep holding up the rest.
+//@param holdUs set to microseconds to hold what is queued, nullptr when the connection is closing
+//and everything must be sent now.
+//@return false if a send failed, which closes the connection.
+typedef bool (*NetFlush)(void* context, TCPsocket socket, uint64_t* holdUs);
+
+//Counters for the whole run, read from any thread.
+struct NetReactorStats {
+    uint64_t opened = 0;
+    uint64_t failed = 0; //connects that did not succeed
+    uint64_t resolves = 0; //host lookups made, not counting those answered from the cache
+    uint64_t closedRemotely = 0;
+    uint64_t messages = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t wakes = 0; //times the main thread woke the reactor to send
+    uint64_t stalls = 0; //times reading paused because the main thread had not drained events
+    uint64_t sendStalls = 0; //connections closed because a send blocked longer than SEND_STALL
+    uint64_t oversized = 0; //frames too long for a NetEvent, dropped
+};
+
+//The client's one network thread. Every TCP connection, whether the single match or each tile of
+//a wall, is read and written here, multiplexed over SDL_net socket sets (select() underneath,
+//the one readiness API SDL_net offers on every platform), so the number of threads doesn't
+//depend on the number of connections. On POSIX every socket is in one set, grown as connections
+//are added, so the thread blocks in one select() however many there are; Windows limits a set to
+//64 sockets, so there they are split into groups that are each checked in turn. Frames are handed to the main thread as NetEvents through
+//a lock-free queue it drains once a frame, so MyGame is only ever touched from that thread; the
+//main thread asks for connections to be opened and closed through a second queue. Sockets are
+//only read while the event queue has room, so a stalled main thread holds data in the kernel
+//rather than losing it. A loopback UDP socket in the set lets wake() interrupt the wait when
+//there is something to send. SDL_net has no non-blocking connect, so connects are made on a
+//second thread, the dialer, which hands each socket over once connected; a slow or unreachable
+//server never holds up the connections already open. The dialer also looks up hosts for the UDP
+//transport, through the same cache.
+class NetReactor {
+    private:
+        static const int GROUP_SIZE = 64; //sockets per SDLNet_SocketSet, FD_SETSIZE on Windows, the first size elsewhere
+        static const uint64_t SEND_STALL = 500000; //microseconds a flush may block before its peer is taken to be stuck
+        static const Uint32 IDLE_WAIT = 100; //ms the thread sleeps with nothing to do, so pings go out on time
+        static const size_t EVENT_CAPACITY = 1024;
+
+        enum class ControlType : uint8_t { OPEN, ADD, CLOSE, RESOLVE };
+
+        //A request from the main thread.
+        struct Control {
+            ControlType type = ControlType::CLOSE;
+            uint32_t connection = 0;
+            std::string host; //OPEN and RESOLVE
+            Uint16 port = 0;
+            TCPsocket socket = nullptr; //ADD
+            NetFlush flush = nullptr;
+            void* context = nullptr;
+        };
+
+        struct Connection {
+            uint32_t id = 0;
+            TCPsocket socket = nullptr;
+            size_t group = 0;
+            FrameReader reader;
+            NetFlush flush = nullptr;
+            void* context = nullptr;
+            uint64_t readAt = 0; //JitterBuffer::nowMicros() of the last read, stamped on its frames
+            uint64_t flushAt = 0; //JitterBuffer::nowMicros() before which flush isn't called, while the owner holds output
+            bool backlog = false; //complete frames are waiting for room in the event queue
+        };
+
+        //A resolved host, kept so reconnecting never waits on DNS again.
+        struct Resolved {
+            std::string host;
+            Uint16 port;
+            IPaddress address;
+        };
+
+        //A finished connect, from the dialer.
+        struct Dialed {
+            uint32_t connection = 0;
+            TCPsocket socket = nullptr; //nullptr if it failed
+            NetFlush flush = nullptr;
+            void* context = nullptr;
+            std::string error; //why it failed
+            bool looked = false; //the host was looked up rather than found in the cache
+            bool resolveOnly = false; //asked for by resolve(), address is the answer
+            IPaddress address{};
+        };
+
+        //State shared with the dialer thread. Owned jointly, so a dialer stuck in a connect that
+        //the OS takes minutes to give up on can be left to finish after the reactor is gone.
+        struct Dialer {
+            SpscQueue<Control, 128> requests; //reactor thread to dialer
+            SpscQueue<Dialed, 128> results; //dialer to reactor thread
+            WakeSignal signal; //wakes the dialer when a request is queued
+            std::mutex mutex; //guards running and busy together, see stop()
+            bool running = true;
+            bool busy = false; //a request is being carried out
+            std::vector<Resolved> resolved; //dialer only
+            UDPsocket wakeSender = nullptr; //wakes the reactor when a result is queued
+            UDPpacket* wakePacket = nullptr;
+
+            ~Dialer();
+        };
+
+        SpscQueue<NetEvent, EVENT_CAPACITY> events; //reactor thread to main thread
+        SpscQueue<Control, 128> controls; //main thread to reactor thread
+        uint32_t nextId = 1; //main thread only, 0 is never a connection
+
+        std::vector<std::unique_ptr<Connection>> connections; //reactor thread only
+        std::vector<SDLNet_SocketSet> groups;
+        std::vector<int> groupUsed; //sockets in each group
+        int groupCapacity = GROUP_SIZE; //sockets each group can hold
+        std::vector<uint32_t> dialing; //connections the dialer is working on
+        std::vector<uint32_t> cancelled; //of those, ones closed by the main thread meanwhile
+
+        std::shared_ptr<Dialer> dialer;
+        std::thread dialerThread;
+
+        UDPsocket wakeSocket = nullptr; //in groups[0], receives wake()'s datagrams
+        UDPsocket wakeSender = nullptr; //main thread only
+        UDPpacket* wakePacket = nullptr;
+        UDPpacket* drainPacket = nullptr;
+        std::atomic<bool> wakePending{ false };
+        std::atomic<Uint32> notifyType{ 0 }; //SDL event pushed when events are queued, 0 for none
+        std::atomic<bool> notifyPending{ false }; //one was pushed and the queue has not been emptied since
+
+        std::thread thread;
+        std::atomic<bool> running{ false };
+
+        std::atomic<uint64_t> opened{ 0 };
+        std::atomic<uint64_t> failed{ 0 };
+        std::atomic<uint64_t> resolves{ 0 };
+        std::atomic<uint64_t> closedRemotely{ 0 };
+        std::atomic<uint64_t> messages{ 0 };
+        std::atomic<uint64_t> bytesReceived{ 0 };
+        std::atomic<uint64_t> wakes{ 0 };
+        std::atomic<uint64_t> stalls{ 0 };
+        std::atomic<uint64_t> sendStalls{ 0 };
+        std::atomic<uint64_t> oversized{ 0 };
+
+        void serve();
+        void apply(Control& control);
+        void adopt(uint32_t id, TCPsocket socket, NetFlush flush, void* context);
+        void regroup(int capacity);
+        void drop(size_t index, std::string_view reason, bool byOwner);
+        void finish(Dialed& result);
+        bool receive(Connection& connection);
+        bool deliver(Connection& connection);
+        void notice(uint32_t connection, NetEventType type, std::string_view text);
+        int wait(Uint32 timeoutMs);
+        Uint32 waitTimeout(uint64_t now) const;
+        void request(Control& control);
+        void announce();
+        static void dial(std::shared_ptr<Dialer> dialer);
+        static bool lookup(Dialer& dialer, const std::string& host, Uint16 port, IPaddress& address, bool& looked);
+
+    public:
+        ~NetReactor();
+
+        bool start();
+        void stop();
+
+        uint32_t open(const std::string& host, Uint16 port, NetFlush flush, void* context);
+        uint32_t add(TCPsocket socket, NetFlush flush, void* context);
+        uint32_t resolve(const std::string& host, Uint16 port);
+        void close(uint32_t connection);
+        void wake();
+        bool next(NetEvent& event);
+        void setNotify(Uint32 eventType);
+
+        NetReactorStats getStats() const;
+};
+
+#endif
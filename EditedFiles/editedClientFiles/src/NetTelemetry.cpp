@@ -0,0 +1,298 @@
+#include "NetTelemetry.h"
+
+#include <iostream>
+
+#include "Message.h"
+#include "Snapshot.h"
+
+static const char* const KIND_NAMES[TELEMETRY_KINDS] = {
+    "GAME_DATA", "SNAPSHOT", "HIT_WALL", "BALL_HIT_BAT", "ROLE", "COUNT", "CONN_CHECK", "PONG", "OTHER"
+};
+
+const char* telemetryKindName(int kind) {
+    return kind >= 0 && kind < TELEMETRY_KINDS ? KIND_NAMES[kind] : "OTHER";
+}
+
+/**
+ * Sorts a server message into the kind it is counted as. Binary snapshots are SNAPSHOT, the
+ * HIT_WALL_* and BALL_HIT_BAT* variants count together.
+ * @param payload the message as received.
+ */
+TelemetryKind telemetryKind(std::string_view payload) {
+    if (isBinarySnapshot(payload)) {
+        return KIND_SNAPSHOT;
+    }
+    for (int kind = 0; kind < KIND_OTHER; kind++) {
+        std::string_view name = KIND_NAMES[kind];
+        if (kind != KIND_SNAPSHOT && payload.substr(0, name.size()) == name) {
+            return (TelemetryKind)kind;
+        }
+    }
+    return KIND_OTHER;
+}
+
+/**
+ * Starts measuring a new connection, forgetting the last one.
+ * @param nowUs current time in microseconds.
+ */
+void NetTelemetry::reset(uint64_t nowUs) {
+    std::lock_guard<std::mutex> hold(mutex);
+    window = Window();
+    openedAt = nowUs;
+    windowStart = nowUs;
+    lastSnapshot = 0;
+    interval = 0;
+    jitter = 0;
+    nextPingAt = 0;
+    for (int i = 0; i < PING_SLOTS; i++) {
+        pingSentAt[i] = 0;
+    }
+}
+
+/**
+ * Counts one message from the server. Called from the main thread as it handles the message.
+ * @param kind what the message was.
+ * @param wireBytes its size on the wire, including framing.
+ * @param parseNs time spent splitting or decoding it.
+ * @param handleNs time MyGame spent reacting to it.
+ * @param nowUs arrival time in microseconds.
+ */
+void NetTelemetry::onReceived(TelemetryKind kind, size_t wireBytes, uint64_t parseNs, uint64_t handleNs, uint64_t nowUs) {
+    std::lock_guard<std::mutex> hold(mutex);
+    window.bytesIn += wireBytes;
+    window.messagesIn++;
+    window.kindCount[kind]++;
+    window.kindParseNs[kind] += parseNs;
+    window.kindHandleNs[kind] += handleNs;
+    if (parseNs + handleNs > window.kindMaxNs[kind]) {
+        window.kindMaxNs[kind] = parseNs + handleNs;
+    }
+    if (kind != KIND_GAME_DATA && kind != KIND_SNAPSHOT) {
+        return;
+    }
+
+    window.snapshots++;
+    if (lastSnapshot != 0) {
+        uint64_t gap = nowUs - lastSnapshot;
+        if (gap > window.maxGapUs) {
+            window.maxGapUs = gap;
+        }
+        if (interval == 0) {
+            interval = (float)gap;
+        }
+        float deviation = gap > interval ? gap - interval : interval - gap;
+        jitter += (deviation - jitter) / 16;
+        interval += (gap - interval) / 16;
+    }
+    lastSnapshot = nowUs;
+}
+
+/**
+ * Times the PING a PONG answers. Called from the main thread.
+ * @param id the id echoed by the server.
+ * @param nowUs arrival time in microseconds.
+ */
+void NetTelemetry::onPong(std::string_view id, uint64_t nowUs) {
+    int value;
+    if (!toInt(id, value)) {
+        return;
+    }
+    std::lock_guard<std::mutex> hold(mutex);
+    int slot = (uint32_t)value % PING_SLOTS;
+    if (pingSentAt[slot] == 0 || pingIds[slot] != (uint32_t)value) {
+        return; //already counted as lost, or from an earlier connection
+    }
+    uint64_t rtt = nowUs - pingSentAt[slot];
+    pingSentAt[slot] = 0;
+    window.rttTotalUs += (double)rtt;
+    if (window.pingsAnswered == 0 || rtt < window.rttMinUs) {
+        window.rttMinUs = rtt;
+    }
+    if (rtt > window.rttMaxUs) {
+        window.rttMaxUs = rtt;
+    }
+    window.pingsAnswered++;
+}
+
+/**
+ * Whether the sending thread should add a PING to what it sends now.
+ * @param nowUs current time in microseconds.
+ * @param id set to the PING's id if one is due.
+ */
+bool NetTelemetry::pingDue(uint64_t nowUs, uint32_t& id) {
+    std::lock_guard<std::mutex> hold(mutex);
+    if (nowUs < nextPingAt) {
+        return false;
+    }
+    nextPingAt = nowUs + PING_INTERVAL;
+    id = nextPingId++;
+    int slot = id % PING_SLOTS;
+    if (pingSentAt[slot] != 0) {
+        window.pingsLost++;
+    }
+    pingSentAt[slot] = nowUs;
+    pingIds[slot] = id;
+    return true;
+}
+
+/**
+ * Counts the commands the sending thread took from MyGame's queues in one flush.
+ * @param commands how many were taken.
+ * @param queueDepth how many were waiting when the flush began.
+ * @param totalWaitUs time they spent queued, summed.
+ * @param maxWaitUs longest any of them spent queued.
+ */
+void NetTelemetry::onQueued(size_t commands, size_t queueDepth, uint64_t totalWaitUs, uint64_t maxWaitUs) {
+    std::lock_guard<std::mutex> hold(mutex);
+    window.commandsOut += commands;
+    window.queueWaitTotalUs += totalWaitUs;
+    if (queueDepth > window.maxQueueDepth) {
+        window.maxQueueDepth = queueDepth;
+    }
+    if (maxWaitUs > window.queueWaitMaxUs) {
+        window.queueWaitMaxUs = maxWaitUs;
+    }
+}
+
+/**
+ * Counts one message sent to the server. Called from the sending thread, the reactor's for TCP.
+ * @param wireBytes its size on the wire, including framing.
+ */
+void NetTelemetry::onSent(size_t wireBytes) {
+    std::lock_guard<std::mutex> hold(mutex);
+    window.bytesOut += wireBytes;
+    window.messagesOut++;
+}
+
+/**
+ * Ends the current period and summarises it. Called from the main thread.
+ * @param nowUs current time in microseconds.
+ */
+NetSample NetTelemetry::sample(uint64_t nowUs) {
+    std::lock_guard<std::mutex> hold(mutex);
+    for (int i = 0; i < PING_SLOTS; i++) {
+        if (pingSentAt[i] != 0 && nowUs - pingSentAt[i] > PING_TIMEOUT) {
+            pingSentAt[i] = 0;
+            window.pingsLost++;
+        }
+    }
+
+    NetSample out;
+    out.at = (nowUs - openedAt) / 1e6;
+    out.seconds = (nowUs - windowStart) / 1e6;
+    double seconds = out.seconds > 0 ? out.seconds : 1;
+    if (window.pingsAnswered > 0) {
+        out.rttMs = (float)(window.rttTotalUs / window.pingsAnswered / 1000);
+        out.rttMinMs = window.rttMinUs / 1000.0f;
+        out.rttMaxMs = window.rttMaxUs / 1000.0f;
+    }
+    out.pingsAnswered = window.pingsAnswered;
+    out.pingsLost = window.pingsLost;
+    out.snapshotRate = (float)(window.snapshots / seconds);
+    out.snapshotIntervalMs = interval / 1000;
+    out.snapshotJitterMs = jitter / 1000;
+    out.maxGapMs = window.maxGapUs / 1000.0f;
+    out.bytesInPerSec = window.bytesIn / seconds;
+    out.bytesOutPerSec = window.bytesOut / seconds;
+    out.messagesInPerSec = window.messagesIn / seconds;
+    out.messagesOutPerSec = window.messagesOut / seconds;
+    out.commandsOutPerSec = window.commandsOut / seconds;
+    out.maxQueueDepth = window.maxQueueDepth;
+    if (window.commandsOut > 0) {
+        out.queueWaitMs = (float)(window.queueWaitTotalUs / 1000.0 / window.commandsOut);
+    }
+    out.maxQueueWaitMs = window.queueWaitMaxUs / 1000.0f;
+    for (int kind = 0; kind < TELEMETRY_KINDS; kind++) {
+        uint64_t count = window.kindCount[kind];
+        out.kinds[kind].count = count;
+        if (count > 0) {
+            out.kinds[kind].parseUs = window.kindParseNs[kind] / 1000.0 / count;
+            out.kinds[kind].handleUs = window.kindHandleNs[kind] / 1000.0 / count;
+            out.kinds[kind].maxUs = window.kindMaxNs[kind] / 1000.0;
+        }
+    }
+
+    window = Window();
+    windowStart = nowUs;
+    return out;
+}
+
+TelemetryExporter::~TelemetryExporter() {
+    close();
+}
+
+/**
+ * Creates the export file, JSON lines if the name ends in .json or .jsonl, otherwise CSV with a
+ * header row.
+ * @param path the file, replaced if it exists.
+ * @return false if it could not be created.
+ */
+bool TelemetryExporter::open(const std::string& path) {
+    close();
+    file = fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        std::cout << "Could not create telemetry file " << path << std::endl;
+        return false;
+    }
+    size_t dot = path.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    json = extension == ".json" || extension == ".jsonl";
+    if (!json) {
+        fprintf(file, "at,seconds,rtt_ms,rtt_min_ms,rtt_max_ms,pings_answered,pings_lost,"
+            "snapshot_rate,snapshot_interval_ms,snapshot_jitter_ms,max_gap_ms,"
+            "bytes_in_per_s,bytes_out_per_s,messages_in_per_s,messages_out_per_s,commands_out_per_s,"
+            "max_queue_depth,queue_wait_ms,max_queue_wait_ms");
+        for (int kind = 0; kind < TELEMETRY_KINDS; kind++) {
+            const char* name = telemetryKindName(kind);
+            fprintf(file, ",%s_count,%s_parse_us,%s_handle_us,%s_max_us", name, name, name, name);
+        }
+        fprintf(file, "\n");
+    }
+    return true;
+}
+
+/**
+ * Appends one sample and flushes, so the file can be followed while the client runs.
+ */
+void TelemetryExporter::write(const NetSample& s) {
+    if (file == nullptr) {
+        return;
+    }
+    if (json) {
+        fprintf(file, "{\"at\":%.3f,\"seconds\":%.3f,\"rtt_ms\":%.2f,\"rtt_min_ms\":%.2f,\"rtt_max_ms\":%.2f,"
+            "\"pings_answered\":%llu,\"pings_lost\":%llu,\"snapshot_rate\":%.2f,\"snapshot_interval_ms\":%.2f,"
+            "\"snapshot_jitter_ms\":%.2f,\"max_gap_ms\":%.2f,\"bytes_in_per_s\":%.1f,\"bytes_out_per_s\":%.1f,"
+            "\"messages_in_per_s\":%.2f,\"messages_out_per_s\":%.2f,\"commands_out_per_s\":%.2f,"
+            "\"max_queue_depth\":%zu,\"queue_wait_ms\":%.3f,\"max_queue_wait_ms\":%.3f,\"kinds\":{",
+            s.at, s.seconds, s.rttMs, s.rttMinMs, s.rttMaxMs, (unsigned long long)s.pingsAnswered,
+            (unsigned long long)s.pingsLost, s.snapshotRate, s.snapshotIntervalMs, s.snapshotJitterMs, s.maxGapMs,
+            s.bytesInPerSec, s.bytesOutPerSec, s.messagesInPerSec, s.messagesOutPerSec, s.commandsOutPerSec,
+            s.maxQueueDepth, s.queueWaitMs, s.maxQueueWaitMs);
+        for (int kind = 0; kind < TELEMETRY_KINDS; kind++) {
+            const KindStats& k = s.kinds[kind];
+            fprintf(file, "%s\"%s\":{\"count\":%llu,\"parse_us\":%.3f,\"handle_us\":%.3f,\"max_us\":%.3f}",
+                kind == 0 ? "" : ",", telemetryKindName(kind), (unsigned long long)k.count, k.parseUs, k.handleUs, k.maxUs);
+        }
+        fprintf(file, "}}\n");
+    }
+    else {
+        fprintf(file, "%.3f,%.3f,%.2f,%.2f,%.2f,%llu,%llu,%.2f,%.2f,%.2f,%.2f,%.1f,%.1f,%.2f,%.2f,%.2f,%zu,%.3f,%.3f",
+            s.at, s.seconds, s.rttMs, s.rttMinMs, s.rttMaxMs, (unsigned long long)s.pingsAnswered,
+            (unsigned long long)s.pingsLost, s.snapshotRate, s.snapshotIntervalMs, s.snapshotJitterMs, s.maxGapMs,
+            s.bytesInPerSec, s.bytesOutPerSec, s.messagesInPerSec, s.messagesOutPerSec, s.commandsOutPerSec,
+            s.maxQueueDepth, s.queueWaitMs, s.maxQueueWaitMs);
+        for (int kind = 0; kind < TELEMETRY_KINDS; kind++) {
+            const KindStats& k = s.kinds[kind];
+            fprintf(file, ",%llu,%.3f,%.3f,%.3f", (unsigned long long)k.count, k.parseUs, k.handleUs, k.maxUs);
+        }
+        fprintf(file, "\n");
+    }
+    fflush(file);
+}
+
+void TelemetryExporter::close() {
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef __NET_TELEMETRY_H__
+#define __NET_TELEMETRY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+//Kinds of server message counted separately.
+enum TelemetryKind {
+    KIND_GAME_DATA, KIND_SNAPSHOT, KIND_HIT_WALL, KIND_BALL_HIT_BAT, KIND_ROLE, KIND_COUNT,
+    KIND_CONN_CHECK, KIND_PONG, KIND_OTHER, TELEMETRY_KINDS
+};
+
+const char* telemetryKindName(int kind);
+TelemetryKind telemetryKind(std::string_view payload);
+
+//Counts and handling time of one kind of message over a sample period.
+struct KindStats {
+    uint64_t count = 0;
+    double parseUs = 0; //mean time to split or decode the message
+    double handleUs = 0; //mean time MyGame spent reacting to it
+    double maxUs = 0; //longest parse plus handle
+};
+
+//Everything measured over one sample period, by default a second.
+struct NetSample {
+    double at = 0; //seconds since the connection opened
+    double seconds = 0; //length of the period
+
+    float rttMs = 0; //mean of the PINGs answered in the period, 0 if none were
+    float rttMinMs = 0;
+    float rttMaxMs = 0;
+    uint64_t pingsAnswered = 0;
+    uint64_t pingsLost = 0; //unanswered after PING_TIMEOUT
+
+    float snapshotRate = 0; //GAME_DATA or binary snapshots per second
+    float snapshotIntervalMs = 0; //smoothed time between them
+    float snapshotJitterMs = 0; //smoothed deviation from that interval, as in RFC 3550
+    float maxGapMs = 0; //longest time between two in the period
+
+    double bytesInPerSec = 0; //including framing
+    double bytesOutPerSec = 0;
+    double messagesInPerSec = 0;
+    double messagesOutPerSec = 0; //CLIENT_DATA messages, each carrying one or more commands
+    double commandsOutPerSec = 0; //commands taken from MyGame's queues, not counting PINGs
+
+    size_t maxQueueDepth = 0; //most commands waiting to be sent at one flush
+    float queueWaitMs = 0; //mean time from MyGame queueing a command to it being sent
+    float maxQueueWaitMs = 0;
+
+    KindStats kinds[TELEMETRY_KINDS];
+};
+
+//Network measurements for one connection. The main thread reports each message as it handles it
+//and takes a NetSample every period for the overlay and export, while the thread that sends, the
+//reactor's for TCP or the UDP send thread, reports each flush and sends PINGs when due. Updates are a few additions under a mutex held only briefly.
+class NetTelemetry {
+    private:
+        static const uint64_t PING_INTERVAL = 1000000; //microseconds between PINGs
+        static const uint64_t PING_TIMEOUT = 5000000; //a PING unanswered for this long is lost
+        static const int PING_SLOTS = 8; //PINGs outstanding at once, by id % PING_SLOTS
+
+        struct Window {
+            double rttTotalUs = 0;
+            uint64_t rttMinUs = 0;
+            uint64_t rttMaxUs = 0;
+            uint64_t pingsAnswered = 0;
+            uint64_t pingsLost = 0;
+            uint64_t snapshots = 0;
+            uint64_t maxGapUs = 0;
+            uint64_t bytesIn = 0;
+            uint64_t bytesOut = 0;
+            uint64_t messagesIn = 0;
+            uint64_t messagesOut = 0;
+            uint64_t commandsOut = 0;
+            size_t maxQueueDepth = 0;
+            uint64_t queueWaitTotalUs = 0;
+            uint64_t queueWaitMaxUs = 0;
+            uint64_t kindCount[TELEMETRY_KINDS] = {};
+            uint64_t kindParseNs[TELEMETRY_KINDS] = {};
+            uint64_t kindHandleNs[TELEMETRY_KINDS] = {};
+            uint64_t kindMaxNs[TELEMETRY_KINDS] = {};
+        };
+
+        std::mutex mutex;
+        Window window;
+        uint64_t openedAt = 0;
+        uint64_t windowStart = 0;
+        uint64_t lastSnapshot = 0; //arrival of the previous snapshot, 0 before the first
+        float interval = 0; //smoothed snapshot interval, microseconds
+        float jitter = 0; //smoothed deviation from it, microseconds
+        uint32_t nextPingId = 1;
+        uint64_t nextPingAt = 0;
+        uint64_t pingSentAt[PING_SLOTS] = {}; //0 when the slot is free
+        uint32_t pingIds[PING_SLOTS] = {};
+
+    public:
+        void reset(uint64_t nowUs);
+        void onReceived(TelemetryKind kind, size_t wireBytes, uint64_t parseNs, uint64_t handleNs, uint64_t nowUs);
+        void onPong(std::string_view id, uint64_t nowUs);
+        bool pingDue(uint64_t nowUs, uint32_t& id);
+        void onQueued(size_t commands, size_t queueDepth, uint64_t totalWaitUs, uint64_t maxWaitUs);
+        void onSent(size_t wireBytes);
+        NetSample sample(uint64_t nowUs);
+};
+
+//Writes samples to a file, one CSV row or one JSON object per line.
+class TelemetryExporter {
+    private:
+        FILE* file = nullptr;
+        bool json = false;
+
+    public:
+        ~TelemetryExporter();
+
+        bool open(const std::string& path);
+        void write(const NetSample& sample);
+        void close();
+
+        bool isOpen() const {
+            return file != nullptr;
+        }
+};
+
+#endif
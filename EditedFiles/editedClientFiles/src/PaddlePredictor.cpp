@@ -0,0 +1,195 @@
+#include "PaddlePredictor.h"
+
+#include <cmath>
+
+#include "PongRules.h"
+
+const float CORRECTION_TIME = 60; //ms for a correction to blend out to about a third
+const float SNAP_DISTANCE = 100; //errors larger than this are applied at once, e.g. after a reset
+
+PaddlePredictor::PaddlePredictor() {
+    stats.rtt = 100;
+}
+
+/**
+ * Turns prediction on or off. When off the bat is drawn where the server says it is.
+ * @param enable true to predict.
+ */
+void PaddlePredictor::setEnabled(bool enable) {
+    std::lock_guard<std::mutex> lock(mutex);
+    enabled = enable;
+}
+
+/**
+ * Called when we are given a bat to control. Prediction begins with the next snapshot.
+ */
+void PaddlePredictor::start() {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = enabled;
+    haveServerState = false;
+    upHeld = false;
+    downHeld = false;
+    count = 0;
+    correction = 0;
+}
+
+/**
+ * Called when we no longer control a bat.
+ */
+void PaddlePredictor::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    active = false;
+}
+
+bool PaddlePredictor::isActive() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return active && haveServerState;
+}
+
+const PaddlePredictor::Step& PaddlePredictor::at(size_t age) const {
+    return history[(newest + HISTORY - age) % HISTORY];
+}
+
+/**
+ * Moves the predicted bat up to now with the direction currently held and records the step.
+ * @param now time in microseconds.
+ */
+void PaddlePredictor::step(uint64_t now) {
+    int direction = batDirection(upHeld, downHeld);
+    if (count > 0) {
+        const Step& last = at(0);
+        if (now <= last.time) {
+            history[newest].direction = direction;
+            return;
+        }
+        y = moveBat(y, last.direction, (now - last.time) / 1e6f);
+    }
+    newest = (newest + 1) % HISTORY;
+    history[newest] = Step{ now, y, direction };
+    if (count < HISTORY) {
+        count++;
+    }
+}
+
+/**
+ * Applies a W or S key change locally and gives it a sequence number to send with the input.
+ * @param up true for W, false for S.
+ * @param pressed true for key down.
+ * @param now time in microseconds.
+ * @return sequence number to send with the input.
+ */
+uint16_t PaddlePredictor::applyKey(bool up, bool pressed, uint64_t now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint16_t seq = nextSeq++;
+    sent[seq % SENT_INPUTS] = SentInput{ seq, now };
+
+    if (!active || !haveServerState) {
+        (up ? upHeld : downHeld) = pressed;
+        return seq;
+    }
+    step(now); //the old direction applies until this moment
+    (up ? upHeld : downHeld) = pressed;
+    history[newest].direction = batDirection(upHeld, downHeld);
+    return seq;
+}
+
+/**
+ * Advances the prediction, called once per frame.
+ * @param now time in microseconds.
+ */
+void PaddlePredictor::advance(uint64_t now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (active && haveServerState) {
+        step(now);
+    }
+}
+
+/**
+ * Corrects the prediction with an authoritative snapshot. The snapshot shows the server's state
+ * after it applied the acknowledged input and before the next one we sent, about one round trip
+ * ago in our timeline. We rewind to that moment, kept between the two inputs' send times so a
+ * late or early snapshot can't put the bat on the wrong side of an input, put the bat where the
+ * server says, and replay only the steps after it.
+ * @param serverY top of our bat in the snapshot.
+ * @param ack sequence number of the last input the server applied.
+ * @param now arrival time in microseconds.
+ */
+void PaddlePredictor::reconcile(float serverY, uint16_t ack, uint64_t now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!active) {
+        return;
+    }
+
+    uint16_t ahead = (uint16_t)(ack - lastAck);
+    if (ahead > 0 && ahead < 0x8000) {
+        const SentInput& input = sent[ack % SENT_INPUTS];
+        if (input.seq == ack && input.time > 0 && now > input.time) {
+            stats.rtt += ((now - input.time) / 1000.0f - stats.rtt) / 8;
+        }
+        lastAck = ack;
+    }
+
+    if (!haveServerState) {
+        y = serverY;
+        haveServerState = true;
+        count = 0;
+        step(now);
+        return;
+    }
+
+    step(now);
+    uint64_t rttUs = (uint64_t)(stats.rtt * 1000);
+    uint64_t rewindTo = now > rttUs ? now - rttUs : 0;
+    const SentInput& acked = sent[lastAck % SENT_INPUTS];
+    if (lastAck != 0 && acked.seq == lastAck && acked.time > rewindTo) {
+        rewindTo = acked.time; //the server has applied it, so the snapshot is no older
+    }
+    uint16_t following = (uint16_t)(lastAck + 1);
+    const SentInput& unacked = sent[following % SENT_INPUTS];
+    if (unacked.seq == following && unacked.time > 0 && unacked.time < rewindTo) {
+        rewindTo = unacked.time; //not applied yet, so the snapshot is no newer
+    }
+
+    size_t age = 0;
+    while (age + 1 < count && at(age).time > rewindTo) {
+        age++;
+    }
+
+    float replayed = serverY;
+    uint64_t time = rewindTo > at(age).time ? rewindTo : at(age).time;
+    int direction = at(age).direction;
+    while (age > 0) {
+        age--;
+        Step& s = history[(newest + HISTORY - age) % HISTORY];
+        replayed = moveBat(replayed, direction, (s.time - time) / 1e6f);
+        s.y = replayed;
+        time = s.time;
+        direction = s.direction;
+    }
+
+    float error = y - replayed;
+    y = replayed;
+    if (std::fabs(error) > 0.5f) {
+        stats.corrections++;
+        stats.lastError = error;
+    }
+    correction = std::fabs(correction + error) > SNAP_DISTANCE ? 0 : correction + error;
+}
+
+/**
+ * Gets where to draw our bat, blending out recent corrections.
+ * @param now time in microseconds.
+ */
+float PaddlePredictor::displayY(uint64_t now) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (lastDisplay != 0 && now > lastDisplay) {
+        correction *= std::exp(-(float)(now - lastDisplay) / 1000.0f / CORRECTION_TIME);
+    }
+    lastDisplay = now;
+    return y + correction;
+}
+
+PredictionStats PaddlePredictor::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,69 @@
+#ifndef __PADDLE_PREDICTOR_H__
+#define __PADDLE_PREDICTOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+//Counters for tuning prediction.
+struct PredictionStats {
+    float rtt = 0; //smoothed round trip from sending an input to a snapshot acknowledging it, ms
+    uint64_t corrections = 0; //snapshots that moved the predicted bat by more than half a pixel
+    float lastError = 0; //pixels the last correction moved the bat
+};
+
+//Simulates the local player's bat as soon as keys are pressed, using the server's movement rules,
+//then reconciles with authoritative snapshots by rewinding to the state the snapshot describes
+//and replaying the inputs the server had not applied yet. Any error is blended out over a few frames.
+//Called from the thread that handles input and server messages.
+class PaddlePredictor {
+    private:
+        static const size_t HISTORY = 256; //steps kept for replay, about 4 seconds at 60 FPS
+        static const size_t SENT_INPUTS = 64; //inputs remembered for measuring round trip time
+
+        struct Step {
+            uint64_t time; //microseconds
+            float y; //predicted top of the bat at time
+            int direction; //direction held from time until the next step
+        };
+
+        struct SentInput {
+            uint16_t seq;
+            uint64_t time;
+        };
+
+        std::mutex mutex;
+        Step history[HISTORY];
+        size_t count = 0;
+        size_t newest = 0;
+        SentInput sent[SENT_INPUTS] = {};
+        bool enabled = true;
+        bool active = false; //we control a bat
+        bool haveServerState = false;
+        bool upHeld = false;
+        bool downHeld = false;
+        float y = 0;
+        float correction = 0; //offset still to blend out, added to y when displayed
+        uint64_t lastDisplay = 0;
+        uint16_t nextSeq = 1;
+        uint16_t lastAck = 0;
+        PredictionStats stats;
+
+        void step(uint64_t now);
+        const Step& at(size_t age) const; //0 is the newest
+
+    public:
+        PaddlePredictor();
+
+        void setEnabled(bool enable);
+        void start();
+        void stop();
+        bool isActive();
+        uint16_t applyKey(bool up, bool pressed, uint64_t now);
+        void advance(uint64_t now);
+        void reconcile(float serverY, uint16_t ack, uint64_t now);
+        float displayY(uint64_t now);
+        PredictionStats getStats();
+};
+
+#endif
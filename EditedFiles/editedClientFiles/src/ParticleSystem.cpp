@@ -0,0 +1,152 @@
+#include "ParticleSystem.h"
+
+#include "SpriteBatch.h"
+
+/**
+ * Allocates the pool and the index buffer for drawing it. Nothing is allocated afterwards.
+ * @param capacity most particles alive at once.
+ * @param config how particles are spawned and move.
+ * @param seed starting state of this system's random numbers.
+ */
+ParticleSystem::ParticleSystem(size_t capacity, const EmitterConfig& config, uint32_t seed)
+    : config(config), capacity(capacity), random(seed),
+      x(capacity), y(capacity), vx(capacity), vy(capacity), age(capacity),
+      vertices(capacity * 4), indices(capacity * 6) {
+    for (size_t i = 0; i < capacity; i++) {
+        int corner = (int)(i * 4);
+        int* quad = &indices[i * 6];
+        quad[0] = corner;
+        quad[1] = corner + 1;
+        quad[2] = corner + 2;
+        quad[3] = corner + 2;
+        quad[4] = corner + 1;
+        quad[5] = corner + 3;
+    }
+}
+
+/**
+ * Spawns particles at a point. When the pool is full the oldest particles are replaced.
+ * @param atX horizontal position to spawn at.
+ * @param atY vertical position to spawn at.
+ * @param particles how many to spawn.
+ */
+void ParticleSystem::emit(float atX, float atY, size_t particles) {
+    for (size_t n = 0; n < particles && capacity > 0; n++) {
+        size_t i;
+        if (count < capacity) {
+            i = head + count;
+            if (i >= capacity) {
+                i -= capacity;
+            }
+            count++;
+        }
+        else {
+            i = head;
+            head = head + 1 == capacity ? 0 : head + 1;
+        }
+        x[i] = atX;
+        y[i] = atY;
+        vx[i] = config.speed * random.signedUnit();
+        vy[i] = config.speed * random.signedUnit();
+        age[i] = 0;
+    }
+}
+
+/**
+ * Spawns particles at the configured rate for a period of time, carrying any fraction over to
+ * the next call so the rate holds at any frame rate.
+ * @param atX horizontal position to spawn at.
+ * @param atY vertical position to spawn at.
+ * @param dt seconds of emission.
+ */
+void ParticleSystem::emitOver(float atX, float atY, float dt) {
+    carry += config.rate * dt;
+    size_t whole = (size_t)carry;
+    carry -= (float)whole;
+    emit(atX, atY, whole);
+}
+
+/**
+ * Moves and ages every live particle, then drops the ones that have expired. All particles share
+ * one lifetime, so expired particles are always at the oldest end of the ring.
+ * @param dt seconds since the last update.
+ */
+void ParticleSystem::update(float dt) {
+    float rise = config.gravity * dt;
+    //live particles are at most two contiguous runs of the arrays
+    size_t firstEnd = head + count < capacity ? head + count : capacity;
+    size_t runs[2][2] = { { head, firstEnd }, { 0, count - (firstEnd - head) } };
+    for (auto& run : runs) {
+        for (size_t i = run[0]; i < run[1]; i++) {
+            vy[i] += rise;
+            x[i] += vx[i] * dt;
+            y[i] += vy[i] * dt;
+            age[i] += dt;
+        }
+    }
+
+    while (count > 0 && age[head] >= config.life) {
+        head = head + 1 == capacity ? 0 : head + 1;
+        count--;
+    }
+}
+
+/**
+ * Writes a quad for each live particle into the vertex buffer, faded by age.
+ * @return number of vertices written.
+ */
+size_t ParticleSystem::buildVertices() {
+    float half = config.size / 2;
+    float fade = (float)config.colour.a / config.life;
+    SDL_Vertex* out = vertices.data();
+    size_t firstEnd = head + count < capacity ? head + count : capacity;
+    size_t runs[2][2] = { { head, firstEnd }, { 0, count - (firstEnd - head) } };
+    for (auto& run : runs) {
+        for (size_t i = run[0]; i < run[1]; i++) {
+            SDL_Color colour = config.colour;
+            float alpha = (float)config.colour.a - age[i] * fade;
+            colour.a = alpha > 0 ? (Uint8)alpha : 0;
+            float left = x[i] - half, right = x[i] + half;
+            float top = y[i] - half, bottom = y[i] + half;
+            out[0] = SDL_Vertex{ { left, top }, colour, { 0, 0 } };
+            out[1] = SDL_Vertex{ { right, top }, colour, { 0, 0 } };
+            out[2] = SDL_Vertex{ { left, bottom }, colour, { 0, 0 } };
+            out[3] = SDL_Vertex{ { right, bottom }, colour, { 0, 0 } };
+            out += 4;
+        }
+    }
+    return count * 4;
+}
+
+/**
+ * Draws every live particle with a single geometry call.
+ * @param renderer pointer to the renderer in use.
+ */
+void ParticleSystem::draw(SDL_Renderer* renderer) {
+    size_t vertexCount = buildVertices();
+    if (vertexCount == 0) {
+        return;
+    }
+    SDL_RenderGeometry(renderer, nullptr, vertices.data(), (int)vertexCount, indices.data(), (int)(count * 6));
+}
+
+/**
+ * Queues every live particle as a coloured quad, drawn when the batch is flushed.
+ * @param batch the frame's sprite batch.
+ * @param layer the batch layer to draw on.
+ */
+void ParticleSystem::draw(SpriteBatch& batch, int layer) {
+    if (buildVertices() == 0) {
+        return;
+    }
+    batch.addColouredQuads(layer, vertices.data(), count);
+}
+
+/**
+ * Removes every particle, keeping the pool.
+ */
+void ParticleSystem::clear() {
+    head = 0;
+    count = 0;
+    carry = 0;
+}
@@ -0,0 +1,63 @@
+#ifndef __PARTICLE_SYSTEM_H__
+#define __PARTICLE_SYSTEM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SDL.h"
+
+#include "FastRandom.h"
+
+class SpriteBatch;
+
+//How one emitter's particles are spawned and move. Distances are pixels, times are seconds.
+struct EmitterConfig {
+    float rate = 0; //particles per second while emitting continuously, 0 for bursts only
+    float life = 1; //every particle lives this long, so the oldest always expires first
+    float size = 4; //side of each square particle
+    float speed = 0; //largest initial speed on each axis, direction is random
+    float gravity = 0; //added to vertical velocity per second, negative rises
+    SDL_Color colour{ 255, 255, 255, 255 }; //alpha fades to 0 over the particle's life
+};
+
+//Fixed-capacity pool of particles from one emitter, stored as a ring of parallel arrays so updates
+//stream through memory. Nothing is allocated after construction: when the pool is full the oldest
+//particle is replaced. Drawn as one SDL_RenderGeometry call, or queued into a SpriteBatch to share
+//a call with other quads.
+class ParticleSystem {
+    private:
+        EmitterConfig config;
+        size_t capacity;
+        size_t head = 0; //index of the oldest live particle
+        size_t count = 0;
+        float carry = 0; //fraction of a particle owed by continuous emission
+        FastRandom random;
+
+        std::vector<float> x, y, vx, vy, age;
+        std::vector<SDL_Vertex> vertices; //4 per particle, rebuilt each draw
+        std::vector<int> indices; //2 triangles per particle, built once
+
+    public:
+        ParticleSystem(size_t capacity, const EmitterConfig& config, uint32_t seed = 1);
+
+        void emit(float atX, float atY, size_t particles);
+        void emitOver(float atX, float atY, float dt);
+        void update(float dt);
+        size_t buildVertices();
+        void draw(SDL_Renderer* renderer);
+        void draw(SpriteBatch& batch, int layer);
+        void clear();
+
+        size_t size() const {
+            return count;
+        }
+        size_t getCapacity() const {
+            return capacity;
+        }
+        const SDL_Vertex* getVertices() const { //as of the last buildVertices()
+            return vertices.data();
+        }
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __PONG_RULES_H__
+#define __PONG_RULES_H__
+
+//Match rules mirrored from the Java server (PongApp, BatComponent and BallComponent).
+const float APP_WIDTH = 800;
+const float APP_HEIGHT = 600;
+const float BAT_WIDTH = 20;
+const float BAT_HEIGHT = 60;
+const float BALL_SIZE = 15;
+const float BAT_X[2] = { APP_WIDTH / 4, 3 * APP_WIDTH / 4 - BAT_WIDTH };
+const float BAT_SPEED = 420; //pixels per second
+const float BALL_SPEED = 5 * 60; //pixels per second on each axis
+const int WIN_SCORE = 10;
+
+/**
+ * Which way a bat moves for the keys held. The server runs the "down" action after "up" each
+ * frame, so holding both moves down.
+ * @return -1 up, 1 down, 0 stopped.
+ */
+inline int batDirection(bool upHeld, bool downHeld) {
+    return downHeld ? 1 : (upHeld ? -1 : 0);
+}
+
+/**
+ * Moves a bat the way BatComponent does, stopping at the edges of the screen.
+ * @param y current top of the bat.
+ * @param direction value from batDirection().
+ * @param dt seconds to move for.
+ * @return new top of the bat.
+ */
+inline float moveBat(float y, int direction, float dt) {
+    y += direction * BAT_SPEED * dt;
+    if (y < 0) {
+        return 0;
+    }
+    if (y > APP_HEIGHT - BAT_HEIGHT) {
+        return APP_HEIGHT - BAT_HEIGHT;
+    }
+    return y;
+}
+
+#endif
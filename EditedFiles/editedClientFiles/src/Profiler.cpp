@@ -0,0 +1,290 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#include "SpscQueue.h"
+
+namespace {
+
+const size_t THREAD_EVENTS = 4096; //scopes a thread can record between two collects
+
+//Events recorded by one thread. The thread is the only producer and collect() the only consumer.
+struct ThreadBuffer {
+    SpscQueue<ProfileEvent, THREAD_EVENTS> events;
+    std::atomic<uint64_t> dropped{ 0 }; //events lost because the queue was full
+    std::atomic<bool> retired{ false }; //the owning thread has exited
+    int tid = 0; //id in the trace, kept when the buffer is reused
+    std::string name; //guarded by registryMutex
+};
+
+//Releases the calling thread's buffer for reuse once it has been drained.
+struct BufferOwner {
+    ThreadBuffer* buffer = nullptr;
+
+    ~BufferOwner() {
+        if (buffer != nullptr) {
+            buffer->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+//Rolling durations of one section on one thread. Main thread only.
+struct Section {
+    const char* name;
+    int tid;
+    uint64_t calls = 0;
+    float samples[Profiler::SUMMARY_SAMPLES]; //microseconds, oldest overwritten first
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+thread_local BufferOwner owner;
+
+std::vector<Section> sections;
+uint64_t droppedTotal = 0;
+
+FILE* traceFile = nullptr;
+uint64_t traceStart = 0;
+bool traceFirst = true;
+std::vector<std::string> tracedNames; //thread name last written for each tid
+
+/**
+ * Returns the calling thread's buffer, registering one on first use. A buffer left by a thread
+ * that has exited is reused once everything it recorded has been collected.
+ */
+ThreadBuffer* threadBuffer() {
+    if (owner.buffer != nullptr) {
+        return owner.buffer;
+    }
+    std::lock_guard<std::mutex> hold(registryMutex);
+    for (auto& buffer : buffers) {
+        if (buffer->retired.load(std::memory_order_acquire) && buffer->events.size() == 0) {
+            buffer->retired.store(false, std::memory_order_relaxed);
+            buffer->name.clear();
+            owner.buffer = buffer.get();
+            return owner.buffer;
+        }
+    }
+    buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffers.back()->tid = (int)buffers.size();
+    owner.buffer = buffers.back().get();
+    return owner.buffer;
+}
+
+/**
+ * Writes one JSON string, escaping the characters JSON requires.
+ */
+void writeJsonString(FILE* file, const char* text) {
+    fputc('"', file);
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        }
+        else if ((unsigned char)*c < 0x20) {
+            fprintf(file, "\\u%04x", (unsigned char)*c);
+        }
+        else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+void beginTraceEvent() {
+    fputs(traceFirst ? "\n" : ",\n", traceFile);
+    traceFirst = false;
+}
+
+/**
+ * Writes thread_name metadata the first time a tid is seen in the trace, and again if the buffer
+ * has passed to a differently named thread.
+ */
+void traceThreadName(int tid, const std::string& name) {
+    if ((int)tracedNames.size() <= tid) {
+        tracedNames.resize(tid + 1);
+    }
+    if (name.empty() || tracedNames[tid] == name) {
+        return;
+    }
+    tracedNames[tid] = name;
+    beginTraceEvent();
+    fprintf(traceFile, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", tid);
+    writeJsonString(traceFile, name.c_str());
+    fputs("}}", traceFile);
+}
+
+void traceEvent(int tid, const ProfileEvent& event) {
+    if (event.start < traceStart) {
+        return; //recorded before the trace started
+    }
+    beginTraceEvent();
+    fputs("{\"name\":", traceFile);
+    writeJsonString(traceFile, event.name);
+    fprintf(traceFile, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+        tid, (event.start - traceStart) / 1000.0, (event.end - event.start) / 1000.0);
+}
+
+Section& section(const char* name, int tid) {
+    for (Section& s : sections) {
+        if (s.tid == tid && (s.name == name || strcmp(s.name, name) == 0)) {
+            return s;
+        }
+    }
+    Section added;
+    added.name = name;
+    added.tid = tid;
+    sections.push_back(added);
+    return sections.back();
+}
+
+}
+
+/**
+ * Names the calling thread in the trace and summary.
+ * @param name e.g. "main", "send" or "receive".
+ */
+void Profiler::nameThread(const char* name) {
+    ThreadBuffer* buffer = threadBuffer();
+    std::lock_guard<std::mutex> hold(registryMutex);
+    buffer->name = name;
+}
+
+/**
+ * Records one finished scope on the calling thread. Lock-free after the thread's first call; if
+ * the thread has recorded THREAD_EVENTS scopes since the last collect the event is dropped.
+ * @param name section name, a string literal.
+ * @param start profileClock() at the start of the scope.
+ * @param end profileClock() at its end.
+ */
+void Profiler::record(const char* name, uint64_t start, uint64_t end) {
+    ThreadBuffer* buffer = threadBuffer();
+    if (!buffer->events.push(ProfileEvent{ name, start, end })) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Drains every thread's events into the summary and the trace. Called once a frame from the main
+ * thread, and only from there.
+ */
+void Profiler::collect() {
+    struct Drain {
+        ThreadBuffer* buffer;
+        std::string name;
+    };
+    std::vector<Drain> drains;
+    {
+        std::lock_guard<std::mutex> hold(registryMutex);
+        for (auto& buffer : buffers) {
+            drains.push_back(Drain{ buffer.get(), buffer->name });
+        }
+    }
+
+    ProfileEvent event;
+    for (Drain& drain : drains) {
+        ThreadBuffer* buffer = drain.buffer;
+        droppedTotal += buffer->dropped.exchange(0, std::memory_order_relaxed);
+        bool named = false;
+        while (buffer->events.pop(event)) {
+            if (traceFile != nullptr) {
+                if (!named) {
+                    traceThreadName(buffer->tid, drain.name);
+                    named = true;
+                }
+                traceEvent(buffer->tid, event);
+            }
+            Section& s = section(event.name, buffer->tid);
+            s.samples[s.calls % SUMMARY_SAMPLES] = (event.end - event.start) / 1000.0f;
+            s.calls++;
+        }
+    }
+}
+
+/**
+ * Starts writing a Chrome trace event file, viewable in chrome://tracing or Perfetto. Scopes
+ * are written as they are collected, so the file grows until stopTrace().
+ * @param path file to create.
+ * @return false if it could not be created.
+ */
+bool Profiler::startTrace(const std::string& path) {
+    stopTrace();
+    traceFile = fopen(path.c_str(), "w");
+    if (traceFile == nullptr) {
+        std::cout << "Could not create trace file " << path << std::endl;
+        return false;
+    }
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", traceFile);
+    traceStart = profileClock();
+    traceFirst = true;
+    tracedNames.clear();
+    return true;
+}
+
+/**
+ * Collects what is left and closes the trace file, if one is open.
+ */
+void Profiler::stopTrace() {
+    if (traceFile == nullptr) {
+        return;
+    }
+    collect();
+    fputs("\n]}\n", traceFile);
+    fclose(traceFile);
+    traceFile = nullptr;
+}
+
+/**
+ * Computes min, mean, p99 and max of each section's recent calls, ordered by thread then by
+ * first appearance. Main thread only.
+ */
+std::vector<SectionSummary> Profiler::summarize() {
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> hold(registryMutex);
+        for (auto& buffer : buffers) {
+            names.push_back(buffer->name);
+        }
+    }
+
+    std::vector<SectionSummary> summaries;
+    std::vector<float> durations;
+    for (const Section& s : sections) {
+        size_t count = (size_t)std::min<uint64_t>(s.calls, (uint64_t)SUMMARY_SAMPLES);
+        if (count == 0) {
+            continue;
+        }
+        durations.assign(s.samples, s.samples + count);
+        std::sort(durations.begin(), durations.end());
+        double total = 0;
+        for (float d : durations) {
+            total += d;
+        }
+        SectionSummary summary;
+        summary.name = s.name;
+        summary.thread = s.tid - 1 < (int)names.size() ? names[s.tid - 1] : "";
+        summary.calls = s.calls;
+        summary.minUs = durations.front();
+        summary.avgUs = total / count;
+        summary.p99Us = durations[std::min(count - 1, (size_t)(count * 0.99))];
+        summary.maxUs = durations.back();
+        summaries.push_back(summary);
+    }
+    std::stable_sort(summaries.begin(), summaries.end(), [](const SectionSummary& a, const SectionSummary& b) {
+        return a.thread < b.thread;
+    });
+    return summaries;
+}
+
+/**
+ * Returns how many events have been dropped because a thread filled its buffer between collects.
+ */
+uint64_t Profiler::getDropped() {
+    return droppedTotal;
+}
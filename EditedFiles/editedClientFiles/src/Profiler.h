@@ -0,0 +1,81 @@
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Build with PONG_PROFILE=0 to compile every PROFILE_SCOPE and PROFILE_THREAD out.
+#ifndef PONG_PROFILE
+#define PONG_PROFILE 1
+#endif
+
+//One timed scope, in profileClock() nanoseconds.
+struct ProfileEvent {
+    const char* name = nullptr; //a string literal, never copied
+    uint64_t start = 0;
+    uint64_t end = 0;
+};
+
+//Rolling statistics of one section over its last SUMMARY_SAMPLES calls.
+struct SectionSummary {
+    const char* name = nullptr;
+    std::string thread;
+    uint64_t calls = 0; //since the profiler started
+    double minUs = 0;
+    double avgUs = 0;
+    double p99Us = 0;
+    double maxUs = 0;
+};
+
+inline uint64_t profileClock() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Scoped-timer profiler. Each thread records finished scopes into its own lock-free queue, so
+//timing a section costs two clock reads and a push. The main loop calls collect() once a frame
+//to drain every thread's queue into the rolling per-section summary, and into a Chrome trace
+//event file (chrome://tracing, Perfetto) when one is being written.
+class Profiler {
+    public:
+        static const size_t SUMMARY_SAMPLES = 240; //calls per section the summary covers
+
+        static void nameThread(const char* name);
+        static void record(const char* name, uint64_t start, uint64_t end);
+        static void collect();
+        static bool startTrace(const std::string& path);
+        static void stopTrace();
+        static std::vector<SectionSummary> summarize();
+        static uint64_t getDropped();
+};
+
+//Times from construction to the end of the enclosing scope.
+class ProfileScope {
+    private:
+        const char* name;
+        uint64_t start;
+
+    public:
+        explicit ProfileScope(const char* name) : name(name), start(profileClock()) {}
+        ~ProfileScope() {
+            Profiler::record(name, start, profileClock());
+        }
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+
+#if PONG_PROFILE
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler::nameThread(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,443 @@
+#include "Replay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "ClientCommand.h"
+#include "Message.h"
+
+static const char REPLAY_MAGIC[] = "PONGREPL";
+static const char INDEX_MAGIC[] = "PIDX";
+static const char TRAILER_MAGIC[] = "PEND";
+static const size_t INDEX_HEADER = 4 + 4 + 4 + 8;
+static const size_t INDEX_ENTRY = 4 + 8 + 8;
+static const size_t TRAILER_SIZE = 8 + 4;
+
+static void putU16(char* out, uint16_t value) {
+    out[0] = (char)(value >> 8);
+    out[1] = (char)(value & 0xFF);
+}
+
+static void putU32(char* out, uint32_t value) {
+    putU16(out, (uint16_t)(value >> 16));
+    putU16(out + 2, (uint16_t)value);
+}
+
+static void putU64(char* out, uint64_t value) {
+    putU32(out, (uint32_t)(value >> 32));
+    putU32(out + 4, (uint32_t)value);
+}
+
+static uint16_t getU16(const char* in) {
+    return (uint16_t)(((uint8_t)in[0] << 8) | (uint8_t)in[1]);
+}
+
+static uint32_t getU32(const char* in) {
+    return ((uint32_t)getU16(in) << 16) | getU16(in + 2);
+}
+
+static uint64_t getU64(const char* in) {
+    return ((uint64_t)getU32(in) << 32) | getU32(in + 4);
+}
+
+bool isTickMessage(std::string_view payload) {
+    return isBinarySnapshot(payload) || payload.substr(0, 9) == "GAME_DATA";
+}
+
+/**
+ * Updates the state from one message, following the same messages MyGame::on_receive reacts to.
+ * @param payload a message as recorded, binary snapshots must be key snapshots.
+ */
+void MatchTracker::apply(std::string_view payload) {
+    if (isBinarySnapshot(payload)) {
+        Snapshot snap;
+        if (decoder.decode(payload, snap)) {
+            state.positions.assign(payload);
+            if (snap.win == 1 || snap.win == 2) {
+                state.win = std::to_string(snap.win);
+            }
+        }
+        return;
+    }
+    std::string_view cmd;
+    MessageArgs args;
+    if (!parseMessage(payload, cmd, args)) {
+        return;
+    }
+    if (cmd == "GAME_DATA") {
+        state.positions.assign(payload);
+        if (args.size() >= 5 && (args[4] == "1WIN" || args[4] == "2WIN")) {
+            state.win = std::string(args[4].substr(0, 1));
+        }
+    }
+    else if ((cmd == "HIT_WALL_LEFT" || cmd == "HIT_WALL_RIGHT") && args.size() == 2) {
+        state.score[0] = std::string(args[0]);
+        state.score[1] = std::string(args[1]);
+    }
+    else if (cmd == "ROLE" && !args.empty()) {
+        toInt(args[0], state.role);
+    }
+    else if (cmd == "COUNT" && !args.empty()) {
+        state.countdown = std::string(args[0]);
+    }
+}
+
+/**
+ * Forgets the match, as MyGame::resetWin does for a new connection.
+ */
+void MatchTracker::reset() {
+    state = MatchState();
+    decoder.reset();
+}
+
+static void appendShort(std::string& out, std::string_view text) {
+    size_t length = text.size() < 255 ? text.size() : 255;
+    out.push_back((char)length);
+    out.append(text.data(), length);
+}
+
+static bool readShort(std::string_view& in, std::string& out) {
+    if (in.empty() || in.size() < 1 + (size_t)(uint8_t)in[0]) {
+        return false;
+    }
+    size_t length = (uint8_t)in[0];
+    out.assign(in.substr(1, length));
+    in.remove_prefix(1 + length);
+    return true;
+}
+
+/**
+ * Writes a keyframe payload: [tick u32][role u8] then scores, countdown and win as
+ * [length u8][text], then the positions message filling the rest.
+ * @param tick the tick the keyframe comes before.
+ * @param state the match state at that point.
+ * @param out replaced with the payload.
+ */
+void encodeKeyframe(uint32_t tick, const MatchState& state, std::string& out) {
+    char head[5];
+    putU32(head, tick);
+    head[4] = (char)state.role;
+    out.assign(head, sizeof(head));
+    appendShort(out, state.score[0]);
+    appendShort(out, state.score[1]);
+    appendShort(out, state.countdown);
+    appendShort(out, state.win);
+    out.append(state.positions);
+}
+
+/**
+ * Reads a keyframe payload written by encodeKeyframe.
+ * @return false if it is malformed.
+ */
+bool decodeKeyframe(std::string_view payload, uint32_t& tick, MatchState& state) {
+    if (payload.size() < 5) {
+        return false;
+    }
+    tick = getU32(payload.data());
+    state.role = (uint8_t)payload[4];
+    payload.remove_prefix(5);
+    if (!readShort(payload, state.score[0]) || !readShort(payload, state.score[1])
+        || !readShort(payload, state.countdown) || !readShort(payload, state.win)) {
+        return false;
+    }
+    state.positions.assign(payload);
+    return true;
+}
+
+ReplayWriter::~ReplayWriter() {
+    close();
+}
+
+/**
+ * Creates the recording, replacing any file at path, and writes its header.
+ * @param path file to record to.
+ * @param interval ticks between keyframes.
+ * @return false if the file could not be created.
+ */
+bool ReplayWriter::open(const std::string& path, uint16_t interval) {
+    close();
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        std::cout << "Could not create recording " << path << std::endl;
+        return false;
+    }
+    setvbuf(file, nullptr, _IOFBF, 1 << 16); //the main thread should only rarely reach the disk
+    keyframeInterval = interval > 0 ? interval : 1;
+    char header[REPLAY_HEADER_SIZE] = {};
+    memcpy(header, REPLAY_MAGIC, 8);
+    putU16(header + 8, REPLAY_VERSION);
+    putU16(header + 10, keyframeInterval);
+    fwrite(header, 1, sizeof(header), file);
+    offset = sizeof(header);
+    startUs = commandClock() / 1000;
+    lastUs = 0;
+    tick = 0;
+    index.clear();
+    tracker.reset();
+    decoder.reset();
+    sessionPending = false;
+    return true;
+}
+
+void ReplayWriter::writeRecord(ReplayType type, uint64_t time, std::string_view payload) {
+    char header[REPLAY_RECORD_HEADER];
+    header[0] = (char)type;
+    putU16(header + 1, (uint16_t)payload.size());
+    putU64(header + 3, time);
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(payload.data(), 1, payload.size(), file);
+    offset += sizeof(header) + payload.size();
+}
+
+/**
+ * Appends a received message, and a keyframe first if this message starts a new interval.
+ * @param payload the message as dispatched to MyGame.
+ */
+void ReplayWriter::record(std::string_view payload) {
+    if (file == nullptr) {
+        return;
+    }
+    uint64_t time = commandClock() / 1000 - startUs;
+    lastUs = time;
+    if (sessionPending.exchange(false)) {
+        writeRecord(ReplayType::RESET, time, std::string_view());
+        tracker.reset();
+        decoder.reset();
+    }
+
+    char key[MAX_SNAPSHOT_SIZE];
+    if (payload.size() > 0 && payload[0] == SNAP_DELTA) {
+        Snapshot snap;
+        if (!decoder.decode(payload, snap)) {
+            return; //MyGame discards it too
+        }
+        payload = std::string_view(key, encodeKeySnapshot(snap, key, sizeof(key)));
+    }
+    else if (isBinarySnapshot(payload)) {
+        Snapshot snap;
+        decoder.decode(payload, snap); //keeps the base for later deltas
+    }
+
+    if (payload.size() > 0xFFFF) {
+        return;
+    }
+    if (isTickMessage(payload)) {
+        if (tick % keyframeInterval == 0) {
+            index.push_back(IndexEntry{ tick, time, offset });
+            encodeKeyframe(tick, tracker.getState(), keyframe);
+            writeRecord(ReplayType::KEYFRAME, time, keyframe);
+        }
+        tick++;
+    }
+    writeRecord(ReplayType::MESSAGE, time, payload);
+    tracker.apply(payload);
+}
+
+/**
+ * Notes that a new connection has started. The next record is preceded by a reset, so playback
+ * clears the game as the client did.
+ */
+void ReplayWriter::markSession() {
+    sessionPending = true;
+}
+
+/**
+ * Writes the keyframe index and trailer and closes the file.
+ */
+void ReplayWriter::close() {
+    if (file == nullptr) {
+        return;
+    }
+    uint64_t indexOffset = offset;
+    char head[INDEX_HEADER];
+    memcpy(head, INDEX_MAGIC, 4);
+    putU32(head + 4, (uint32_t)index.size());
+    putU32(head + 8, tick);
+    putU64(head + 12, lastUs);
+    fwrite(head, 1, sizeof(head), file);
+    for (const IndexEntry& entry : index) {
+        char out[INDEX_ENTRY];
+        putU32(out, entry.tick);
+        putU64(out + 4, entry.time);
+        putU64(out + 12, entry.offset);
+        fwrite(out, 1, sizeof(out), file);
+    }
+    char trailer[TRAILER_SIZE];
+    putU64(trailer, indexOffset);
+    memcpy(trailer + 8, TRAILER_MAGIC, 4);
+    fwrite(trailer, 1, sizeof(trailer), file);
+    fclose(file);
+    file = nullptr;
+}
+
+/**
+ * Maps a recording and loads its index, rebuilding it if the recording was cut short.
+ * @param path the recording.
+ * @return false if it cannot be read or is not a recording.
+ */
+bool ReplayReader::open(const std::string& path) {
+    index.clear();
+    ticks = 0;
+    duration = 0;
+    if (!mapped.open(path)) {
+        return false;
+    }
+    const char* data = mapped.getData();
+    if (mapped.size() < REPLAY_HEADER_SIZE || memcmp(data, REPLAY_MAGIC, 8) != 0) {
+        std::cout << path << " is not a recording." << std::endl;
+        return false;
+    }
+    if (getU16(data + 8) != REPLAY_VERSION) {
+        std::cout << path << " is recording version " << getU16(data + 8) << ", expected " << REPLAY_VERSION << std::endl;
+        return false;
+    }
+    if (!loadIndex()) {
+        scanIndex();
+    }
+    cursor = REPLAY_HEADER_SIZE;
+    nextTick = 0;
+    return true;
+}
+
+/**
+ * Reads the index written when recording stopped.
+ * @return false if there is no valid trailer.
+ */
+bool ReplayReader::loadIndex() {
+    const char* data = mapped.getData();
+    size_t size = mapped.size();
+    if (size < REPLAY_HEADER_SIZE + INDEX_HEADER + TRAILER_SIZE || memcmp(data + size - 4, TRAILER_MAGIC, 4) != 0) {
+        return false;
+    }
+    uint64_t at = getU64(data + size - TRAILER_SIZE);
+    if (at < REPLAY_HEADER_SIZE || at + INDEX_HEADER > size - TRAILER_SIZE || memcmp(data + at, INDEX_MAGIC, 4) != 0) {
+        return false;
+    }
+    uint32_t count = getU32(data + at + 4);
+    if (at + INDEX_HEADER + (uint64_t)count * INDEX_ENTRY != size - TRAILER_SIZE) {
+        return false;
+    }
+    recordsEnd = (size_t)at;
+    ticks = getU32(data + at + 8);
+    duration = getU64(data + at + 12);
+    const char* entry = data + at + INDEX_HEADER;
+    index.reserve(count);
+    for (uint32_t i = 0; i < count; i++, entry += INDEX_ENTRY) {
+        index.push_back(IndexEntry{ getU32(entry), getU64(entry + 4), getU64(entry + 12) });
+    }
+    return true;
+}
+
+/**
+ * Builds the index by reading every record, for a recording that has no trailer.
+ */
+void ReplayReader::scanIndex() {
+    recordsEnd = mapped.size();
+    size_t at = REPLAY_HEADER_SIZE;
+    size_t after;
+    ReplayRecord record;
+    while (readAt(at, record, after)) {
+        if (record.type == ReplayType::KEYFRAME) {
+            index.push_back(IndexEntry{ getU32(record.payload.data()), record.time, at });
+        }
+        else if (record.type == ReplayType::MESSAGE && isTickMessage(record.payload)) {
+            ticks++;
+        }
+        duration = record.time;
+        at = after;
+    }
+    recordsEnd = at; //drops a record only partly written
+}
+
+/**
+ * Reads the record at an offset, without the tick, which depends on what came before.
+ * @param after set to the offset of the following record.
+ * @return false at the end of the records or if the record is cut short.
+ */
+bool ReplayReader::readAt(size_t at, ReplayRecord& record, size_t& after) const {
+    if (at + REPLAY_RECORD_HEADER > recordsEnd) {
+        return false;
+    }
+    const char* data = mapped.getData() + at;
+    size_t length = getU16(data + 1);
+    if (at + REPLAY_RECORD_HEADER + length > recordsEnd) {
+        return false;
+    }
+    record.type = (ReplayType)data[0];
+    record.time = getU64(data + 3);
+    record.payload = std::string_view(data + REPLAY_RECORD_HEADER, length);
+    if (record.type == ReplayType::KEYFRAME && length < 4) {
+        return false;
+    }
+    after = at + REPLAY_RECORD_HEADER + length;
+    return true;
+}
+
+/**
+ * Gets the next record without moving past it.
+ * @return false at the end of the recording.
+ */
+bool ReplayReader::peek(ReplayRecord& record) const {
+    size_t after;
+    if (!readAt(cursor, record, after)) {
+        return false;
+    }
+    record.tick = nextTick;
+    return true;
+}
+
+/**
+ * Gets the next record and moves past it.
+ * @return false at the end of the recording.
+ */
+bool ReplayReader::next(ReplayRecord& record) {
+    size_t after;
+    if (!readAt(cursor, record, after)) {
+        return false;
+    }
+    record.tick = nextTick;
+    if (record.type == ReplayType::MESSAGE && isTickMessage(record.payload)) {
+        nextTick++;
+    }
+    cursor = after;
+    return true;
+}
+
+/**
+ * Moves playback so the next tick message is the given tick: finds the last keyframe at or before
+ * it with a binary search of the index, then reads forward at most one keyframe interval,
+ * following the match state without dispatching anything.
+ * @param tick the tick to play next, clamped to the recording.
+ * @param state set to the match state before that tick, for MyGame to restore.
+ * @return false if the recording has no keyframes.
+ */
+bool ReplayReader::seek(uint32_t tick, MatchState& state) {
+    auto after = std::upper_bound(index.begin(), index.end(), tick,
+        [](uint32_t value, const IndexEntry& entry) { return value < entry.tick; });
+    if (after == index.begin()) {
+        return false;
+    }
+    const IndexEntry& keyframe = *(after - 1);
+    ReplayRecord record;
+    size_t afterKeyframe;
+    uint32_t keyTick;
+    MatchTracker tracker;
+    if (!readAt((size_t)keyframe.offset, record, afterKeyframe) || !decodeKeyframe(record.payload, keyTick, state)) {
+        return false;
+    }
+    tracker.setState(state);
+    cursor = afterKeyframe;
+    nextTick = keyTick;
+    while (peek(record) && !(record.type == ReplayType::MESSAGE && isTickMessage(record.payload) && record.tick >= tick)) {
+        next(record);
+        if (record.type == ReplayType::RESET) {
+            tracker.reset();
+        }
+        else if (record.type == ReplayType::MESSAGE) {
+            tracker.apply(record.payload);
+        }
+    }
+    state = tracker.getState();
+    return true;
+}
@@ -0,0 +1,155 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Snapshot.h"
+
+//A recording is an append-only log of everything the server sent, read back in place from a
+//memory mapping. Integers are big-endian like the wire.
+//  header:  "PONGREPL" [version u16][keyframe interval u16][reserved u32]
+//  records: [type u8][payload length u16][receive time u64, microseconds from the start][payload]
+//  index:   "PIDX" [entries u32][ticks u32][duration u64] then [tick u32][time u64][offset u64] per keyframe
+//  trailer: [index offset u64] "PEND"
+//The index and trailer are written when recording stops. A recording cut short, e.g. by a crash,
+//has neither and is indexed by scanning its records instead.
+const size_t REPLAY_HEADER_SIZE = 16;
+const size_t REPLAY_RECORD_HEADER = 11;
+const uint16_t REPLAY_VERSION = 1;
+const uint16_t REPLAY_KEYFRAME_INTERVAL = 120; //ticks between keyframes, a seek replays at most this many
+
+enum class ReplayType : uint8_t {
+    MESSAGE = 1, //a message as received; binary deltas are stored as key snapshots so any tick can be decoded alone
+    KEYFRAME = 2, //the match state before the tick it names, see MatchState
+    RESET = 3 //a new connection started, the game was reset
+};
+
+//What a client knows of a match apart from the positions in snapshots, enough to resume playback
+//from any tick. positions is the newest GAME_DATA or key snapshot, empty before the first.
+struct MatchState {
+    int role = 0; //1 or 2 for players, 3 for spectators, 0 before the server assigns one
+    std::string score[2] = { "0", "0" };
+    std::string countdown = "3";
+    std::string win = "0";
+    std::string positions;
+};
+
+//Follows the match state through the messages the server sends, the way MyGame does.
+class MatchTracker {
+    private:
+        MatchState state;
+        SnapshotDecoder decoder; //only for key snapshots, so no history is needed
+
+    public:
+        void apply(std::string_view payload);
+        void reset();
+
+        const MatchState& getState() const {
+            return state;
+        }
+        void setState(const MatchState& restored) {
+            state = restored;
+        }
+};
+
+//Whether a message carries positions, i.e. is one server tick.
+bool isTickMessage(std::string_view payload);
+
+//Records received messages to a file. Called from the thread that receives them; only
+//markSession may be called from another.
+class ReplayWriter {
+    private:
+        struct IndexEntry {
+            uint32_t tick;
+            uint64_t time;
+            uint64_t offset;
+        };
+
+        FILE* file = nullptr;
+        uint64_t offset = 0; //bytes written so far
+        uint64_t startUs = 0;
+        uint64_t lastUs = 0;
+        uint32_t tick = 0; //tick messages recorded so far
+        uint16_t keyframeInterval = REPLAY_KEYFRAME_INTERVAL;
+        MatchTracker tracker;
+        SnapshotDecoder decoder; //resolves deltas before they are stored as key snapshots
+        std::vector<IndexEntry> index;
+        std::atomic<bool> sessionPending{ false };
+        std::string keyframe; //reused for encoding keyframes
+
+        void writeRecord(ReplayType type, uint64_t time, std::string_view payload);
+
+    public:
+        ~ReplayWriter();
+
+        bool open(const std::string& path, uint16_t interval = REPLAY_KEYFRAME_INTERVAL);
+        void record(std::string_view payload);
+        void markSession();
+        void close();
+
+        bool isOpen() const {
+            return file != nullptr;
+        }
+        uint32_t getTicks() const {
+            return tick;
+        }
+};
+
+//One record read back from a recording. payload points into the mapped file.
+struct ReplayRecord {
+    ReplayType type = ReplayType::MESSAGE;
+    uint64_t time = 0; //microseconds from the start of the recording
+    uint32_t tick = 0; //for tick messages their own tick, otherwise the next tick to come
+    std::string_view payload;
+};
+
+//Plays a recording back from a memory mapping. Records are read in place, and seek() finds the
+//nearest keyframe with a binary search of the index.
+class ReplayReader {
+    private:
+        struct IndexEntry {
+            uint32_t tick;
+            uint64_t time;
+            uint64_t offset;
+        };
+
+        MappedFile mapped;
+        size_t recordsEnd = 0; //offset of the index, or the end of the last whole record
+        std::vector<IndexEntry> index; //by tick
+        uint32_t ticks = 0;
+        uint64_t duration = 0;
+        size_t cursor = 0; //offset of the next record
+        uint32_t nextTick = 0;
+
+        bool readAt(size_t at, ReplayRecord& record, size_t& after) const;
+        bool loadIndex();
+        void scanIndex();
+
+    public:
+        bool open(const std::string& path);
+        bool next(ReplayRecord& record);
+        bool peek(ReplayRecord& record) const;
+        bool seek(uint32_t tick, MatchState& state);
+
+        uint32_t getTicks() const {
+            return ticks;
+        }
+        uint64_t getDuration() const {
+            return duration;
+        }
+        size_t getKeyframes() const {
+            return index.size();
+        }
+};
+
+void encodeKeyframe(uint32_t tick, const MatchState& state, std::string& out);
+bool decodeKeyframe(std::string_view payload, uint32_t& tick, MatchState& state);
+
+#endif
@@ -0,0 +1,150 @@
+#include "Snapshot.h"
+
+static void putU16(char* out, uint16_t value) {
+    out[0] = (char)(value >> 8);
+    out[1] = (char)(value & 0xFF);
+}
+
+static uint16_t getU16(const char* in) {
+    return (uint16_t)(((uint8_t)in[0] << 8) | (uint8_t)in[1]);
+}
+
+/**
+ * Writes a snapshot that does not depend on any earlier one.
+ * @param snap the snapshot to encode.
+ * @param out destination buffer, MAX_SNAPSHOT_SIZE is always enough.
+ * @param outSize size of the destination buffer.
+ * @return number of bytes written, or 0 if the buffer was too small.
+ */
+size_t encodeKeySnapshot(const Snapshot& snap, char* out, size_t outSize) {
+    size_t length = 3 + SNAPSHOT_FIELDS * 2 + 1;
+    if (outSize < length) {
+        return 0;
+    }
+    out[0] = SNAP_KEY;
+    putU16(out + 1, snap.seq);
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        putU16(out + 3 + i * 2, (uint16_t)snap.fields[i]);
+    }
+    out[length - 1] = (char)snap.win;
+    return length;
+}
+
+/**
+ * Writes a snapshot as the difference from a base the client has acknowledged. Each field is
+ * described by two bits of the mask: 0 unchanged, 1 a signed byte difference, 2 a full value.
+ * @param snap the snapshot to encode.
+ * @param base the acknowledged snapshot to encode against, at most SNAPSHOT_HISTORY - 1 ticks
+ *        older, the furthest back a SnapshotDecoder remembers.
+ * @param out destination buffer, MAX_SNAPSHOT_SIZE is always enough.
+ * @param outSize size of the destination buffer.
+ * @return number of bytes written, or 0 if the buffer was too small or base was too old.
+ */
+size_t encodeDeltaSnapshot(const Snapshot& snap, const Snapshot& base, char* out, size_t outSize) {
+    uint16_t distance = (uint16_t)(snap.seq - base.seq);
+    if (distance == 0 || distance >= SNAPSHOT_HISTORY || outSize < MAX_SNAPSHOT_SIZE) {
+        return 0;
+    }
+    out[0] = SNAP_DELTA;
+    putU16(out + 1, snap.seq);
+    out[3] = (char)distance;
+    out[4] = (char)snap.win;
+
+    uint16_t mask = 0;
+    size_t length = 7;
+    for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+        int diff = snap.fields[i] - base.fields[i];
+        if (diff == 0) {
+            continue;
+        }
+        if (diff >= -128 && diff <= 127) {
+            mask |= 1 << (i * 2);
+            out[length++] = (char)(int8_t)diff;
+        }
+        else {
+            mask |= 2 << (i * 2);
+            putU16(out + length, (uint16_t)snap.fields[i]);
+            length += 2;
+        }
+    }
+    putU16(out + 5, mask);
+    return length;
+}
+
+/**
+ * Decodes a binary snapshot, resolving deltas against the remembered history.
+ * @param payload the frame payload, starting with SNAP_KEY or SNAP_DELTA.
+ * @param out set to the decoded snapshot.
+ * @return false if the payload was malformed or referred to an unknown base.
+ */
+bool SnapshotDecoder::decode(std::string_view payload, Snapshot& out) {
+    const char* p = payload.data();
+    size_t size = payload.size();
+
+    if (size >= 3 + SNAPSHOT_FIELDS * 2 + 1 && p[0] == SNAP_KEY) {
+        out.seq = getU16(p + 1);
+        for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+            out.fields[i] = (int16_t)getU16(p + 3 + i * 2);
+        }
+        out.win = (uint8_t)p[3 + SNAPSHOT_FIELDS * 2];
+    }
+    else if (size >= 7 && p[0] == SNAP_DELTA) {
+        uint16_t seq = getU16(p + 1);
+        uint16_t baseSeq = (uint16_t)(seq - (uint8_t)p[3]);
+        const Snapshot& base = history[baseSeq % SNAPSHOT_HISTORY];
+        if (!valid[baseSeq % SNAPSHOT_HISTORY] || base.seq != baseSeq) {
+            return false;
+        }
+        uint16_t mask = getU16(p + 5);
+        size_t offset = 7;
+        Snapshot result = base;
+        for (int i = 0; i < SNAPSHOT_FIELDS; i++) {
+            int kind = (mask >> (i * 2)) & 3;
+            if (kind == 1 && offset < size) {
+                result.fields[i] = (int16_t)(base.fields[i] + (int8_t)p[offset]);
+                offset += 1;
+            }
+            else if (kind == 2 && offset + 1 < size) {
+                result.fields[i] = (int16_t)getU16(p + offset);
+                offset += 2;
+            }
+            else if (kind != 0) {
+                return false;
+            }
+        }
+        result.seq = seq;
+        result.win = (uint8_t)p[4];
+        out = result;
+    }
+    else {
+        return false;
+    }
+
+    history[out.seq % SNAPSHOT_HISTORY] = out;
+    valid[out.seq % SNAPSHOT_HISTORY] = true;
+    return true;
+}
+
+/**
+ * Decides whether a decoded snapshot should be acknowledged, so the server has a recent base
+ * without the client replying to every tick.
+ * @param seq the sequence number just decoded.
+ */
+bool SnapshotDecoder::shouldAck(uint16_t seq) {
+    if (acked && (uint16_t)(seq - lastAcked) < SNAPSHOT_ACK_INTERVAL) {
+        return false;
+    }
+    lastAcked = seq;
+    acked = true;
+    return true;
+}
+
+/**
+ * Forgets all history, used when a new connection is made.
+ */
+void SnapshotDecoder::reset() {
+    for (uint16_t i = 0; i < SNAPSHOT_HISTORY; i++) {
+        valid[i] = false;
+    }
+    acked = false;
+}
@@ -0,0 +1,55 @@
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+//Values carried by every snapshot, in wire order. Positions come first, then the sequence number
+//of the last input the server applied for each player, used for client-side prediction.
+enum SnapshotField {
+    SNAP_P1_Y, SNAP_P2_Y, SNAP_BALL_X, SNAP_BALL_Y, SNAPSHOT_POSITIONS,
+    SNAP_P1_INPUT = SNAPSHOT_POSITIONS, SNAP_P2_INPUT, SNAPSHOT_FIELDS
+};
+
+//One server tick of GAME_DATA in binary form.
+struct Snapshot {
+    uint16_t seq = 0; //server tick number, wraps
+    int16_t fields[SNAPSHOT_FIELDS] = {}; //indexed by SnapshotField
+    uint8_t win = 0; //0 no winner yet, otherwise the winning player
+};
+
+//Binary frames start with a byte that can never begin an ASCII command.
+const char SNAP_KEY = 0x01; //[0x01][seq u16][fields i16...][win u8]
+const char SNAP_DELTA = 0x02; //[0x02][seq u16][seq - base u8][win u8][mask u16][values...]
+
+const uint16_t SNAPSHOT_HISTORY = 64; //snapshots a delta may refer back to
+const uint16_t SNAPSHOT_ACK_INTERVAL = 4; //client acks every this many snapshots
+const size_t MAX_SNAPSHOT_SIZE = 6 + SNAPSHOT_FIELDS * 2 + 2;
+
+//Text sent by the client to ask for binary snapshots, and the server's acceptance.
+const char* const WIRE_REQUEST = "WIRE_BIN";
+const char* const WIRE_ACCEPT = "BIN";
+
+inline bool isBinarySnapshot(std::string_view payload) {
+    return !payload.empty() && (payload[0] == SNAP_KEY || payload[0] == SNAP_DELTA);
+}
+
+size_t encodeKeySnapshot(const Snapshot& snap, char* out, size_t outSize);
+size_t encodeDeltaSnapshot(const Snapshot& snap, const Snapshot& base, char* out, size_t outSize);
+
+//Keeps recently decoded snapshots so deltas can be applied to whichever base the server chose.
+class SnapshotDecoder {
+    private:
+        Snapshot history[SNAPSHOT_HISTORY]; //indexed by seq % SNAPSHOT_HISTORY
+        bool valid[SNAPSHOT_HISTORY] = {};
+        uint16_t lastAcked = 0; //last seq reported back to the server
+        bool acked = false;
+
+    public:
+        bool decode(std::string_view payload, Snapshot& out);
+        bool shouldAck(uint16_t seq);
+        void reset();
+};
+
+#endif
@@ -0,0 +1,227 @@
+#include "SpriteBatch.h"
+
+#include <algorithm>
+#include <cmath>
+
+static const int LAYER_SHIFT = 48;
+static const int TEXTURE_SHIFT = 16;
+
+/**
+ * Sets the atlas block used for coloured quads, so they share the atlas's draw calls.
+ * @param texture the atlas, e.g. AssetManager::whiteSprite().texture. nullptr to draw coloured
+ *                quads untextured instead.
+ * @param rect a solid white region of it.
+ */
+void SpriteBatch::setWhite(SDL_Texture* texture, const SDL_Rect& rect) {
+    whiteTexture = texture;
+    whiteU = 0;
+    whiteV = 0;
+    if (texture != nullptr) {
+        float invW, invH;
+        textureScale(texture, invW, invH);
+        whiteU = (rect.x + rect.w * 0.5f) * invW;
+        whiteV = (rect.y + rect.h * 0.5f) * invH;
+    }
+}
+
+/**
+ * Orders quads by layer, then texture, then blend mode. Textures are numbered in the order they
+ * are first seen this frame, so the order is stable from frame to frame.
+ */
+uint64_t SpriteBatch::makeKey(int layer, SDL_Texture* texture, SDL_BlendMode blend) {
+    size_t textureIndex = 0;
+    while (textureIndex < textures.size() && textures[textureIndex] != texture) {
+        textureIndex++;
+    }
+    if (textureIndex == textures.size()) {
+        textures.push_back(texture);
+    }
+    uint64_t clampedLayer = (uint64_t)std::min(std::max(layer, 0), 0xFFFF);
+    return (clampedLayer << LAYER_SHIFT) | ((uint64_t)textureIndex << TEXTURE_SHIFT) | ((uint64_t)blend & 0xFFFF);
+}
+
+/**
+ * Starts a quad and returns its 4 vertices to fill in.
+ */
+SDL_Vertex* SpriteBatch::push(int layer, SDL_Texture* texture, SDL_BlendMode blend) {
+    uint64_t key = makeKey(layer, texture, blend);
+    if (!quads.empty() && key < quads.back().key) {
+        inOrder = false;
+    }
+    quads.push_back(Quad{ key, (uint32_t)quads.size(), (uint32_t)vertices.size() });
+    vertices.resize(vertices.size() + 4);
+    return &vertices[vertices.size() - 4];
+}
+
+void SpriteBatch::textureScale(SDL_Texture* texture, float& invW, float& invH) {
+    if (texture != lastTexture) {
+        int w = 1, h = 1;
+        SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+        lastTexture = texture;
+        lastInvW = 1.0f / (w > 0 ? w : 1);
+        lastInvH = 1.0f / (h > 0 ? h : 1);
+    }
+    invW = lastInvW;
+    invH = lastInvH;
+}
+
+/**
+ * Queues a textured quad, the batched SDL_RenderCopy.
+ * @param layer quads on higher layers are drawn over lower ones.
+ * @param texture the texture to draw from.
+ * @param src region of the texture, nullptr for all of it.
+ * @param dst where to draw it.
+ * @param colour multiplied with the texture, as colour and alpha mod would be.
+ * @param blend how the quad is blended onto the frame.
+ */
+void SpriteBatch::add(int layer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, SDL_Color colour, SDL_BlendMode blend) {
+    addRotated(layer, texture, src, dst, 0, colour, blend);
+}
+
+/**
+ * Queues a textured quad rotated about its centre, the batched SDL_RenderCopyEx.
+ * @param degrees clockwise rotation.
+ */
+void SpriteBatch::addRotated(int layer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, double degrees, SDL_Color colour, SDL_BlendMode blend) {
+    if (texture == nullptr) {
+        return;
+    }
+    float invW, invH;
+    textureScale(texture, invW, invH);
+    float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+    if (src != nullptr) {
+        u0 = src->x * invW;
+        v0 = src->y * invH;
+        u1 = (src->x + src->w) * invW;
+        v1 = (src->y + src->h) * invH;
+    }
+
+    float halfW = dst.w / 2, halfH = dst.h / 2;
+    float cx = dst.x + halfW, cy = dst.y + halfH;
+    float cosA = 1, sinA = 0;
+    if (degrees != 0) {
+        double radians = degrees * 3.14159265358979323846 / 180.0;
+        cosA = (float)std::cos(radians);
+        sinA = (float)std::sin(radians);
+    }
+    const float corners[4][2] = { { -halfW, -halfH }, { halfW, -halfH }, { -halfW, halfH }, { halfW, halfH } };
+    const float uvs[4][2] = { { u0, v0 }, { u1, v0 }, { u0, v1 }, { u1, v1 } };
+
+    SDL_Vertex* out = push(layer, texture, blend);
+    for (int i = 0; i < 4; i++) {
+        float dx = corners[i][0], dy = corners[i][1];
+        out[i] = SDL_Vertex{ { cx + dx * cosA - dy * sinA, cy + dx * sinA + dy * cosA }, colour, { uvs[i][0], uvs[i][1] } };
+    }
+}
+
+/**
+ * Queues a solid rectangle, the batched SDL_SetRenderDrawColor and SDL_RenderFillRect.
+ */
+void SpriteBatch::addFill(int layer, const SDL_FRect& dst, SDL_Color colour, SDL_BlendMode blend) {
+    SDL_Vertex* out = push(layer, whiteTexture, blend);
+    SDL_FPoint uv{ whiteU, whiteV };
+    out[0] = SDL_Vertex{ { dst.x, dst.y }, colour, uv };
+    out[1] = SDL_Vertex{ { dst.x + dst.w, dst.y }, colour, uv };
+    out[2] = SDL_Vertex{ { dst.x, dst.y + dst.h }, colour, uv };
+    out[3] = SDL_Vertex{ { dst.x + dst.w, dst.y + dst.h }, colour, uv };
+}
+
+/**
+ * Queues coloured quads that are already laid out as vertices, e.g. a particle system's.
+ * @param corners 4 vertices per quad: top left, top right, bottom left, bottom right. Texture
+ *                coordinates are ignored.
+ * @param count number of quads.
+ */
+void SpriteBatch::addColouredQuads(int layer, const SDL_Vertex* corners, size_t count, SDL_BlendMode blend) {
+    SDL_FPoint uv{ whiteU, whiteV };
+    for (size_t q = 0; q < count; q++) {
+        SDL_Vertex* out = push(layer, whiteTexture, blend);
+        for (int i = 0; i < 4; i++) {
+            out[i] = corners[q * 4 + i];
+            out[i].tex_coord = uv;
+        }
+    }
+}
+
+/**
+ * Draws every queued quad, one SDL_RenderGeometry call per run of quads with the same layer,
+ * texture and blend mode, then empties the batch.
+ * @param renderer pointer to the renderer in use.
+ */
+void SpriteBatch::flush(SDL_Renderer* renderer) {
+    stats.flushes++;
+    if (quads.empty()) {
+        return;
+    }
+    const SDL_Vertex* drawn = vertices.data();
+    if (!inOrder) {
+        std::sort(quads.begin(), quads.end(), [](const Quad& a, const Quad& b) {
+            return a.key != b.key ? a.key < b.key : a.sequence < b.sequence;
+        });
+        sorted.resize(vertices.size());
+        for (size_t q = 0; q < quads.size(); q++) {
+            std::copy_n(&vertices[quads[q].firstVertex], 4, &sorted[q * 4]);
+        }
+        drawn = sorted.data();
+    }
+    if (indices.size() < quads.size() * 6) {
+        size_t built = indices.size() / 6;
+        indices.resize(quads.size() * 6);
+        for (size_t q = built; q < quads.size(); q++) {
+            int corner = (int)(q * 4);
+            int* quad = &indices[q * 6];
+            quad[0] = corner;
+            quad[1] = corner + 1;
+            quad[2] = corner + 2;
+            quad[3] = corner + 2;
+            quad[4] = corner + 1;
+            quad[5] = corner + 3;
+        }
+    }
+
+    SDL_BlendMode drawBlend;
+    SDL_GetRenderDrawBlendMode(renderer, &drawBlend);
+    size_t start = 0;
+    while (start < quads.size()) {
+        uint64_t key = quads[start].key;
+        size_t end = start + 1;
+        while (end < quads.size() && quads[end].key == key) {
+            end++;
+        }
+        SDL_Texture* texture = textures[(key >> TEXTURE_SHIFT) & 0xFFFFFFFFu];
+        SDL_BlendMode blend = (SDL_BlendMode)(key & 0xFFFF);
+        if (texture != nullptr) {
+            SDL_SetTextureBlendMode(texture, blend);
+        }
+        else {
+            SDL_SetRenderDrawBlendMode(renderer, blend);
+        }
+        int count = (int)(end - start);
+        SDL_RenderGeometry(renderer, texture, drawn + start * 4, count * 4, indices.data(), count * 6);
+        stats.drawCalls++;
+        start = end;
+    }
+    SDL_SetRenderDrawBlendMode(renderer, drawBlend);
+    stats.quads += quads.size();
+    clear();
+}
+
+/**
+ * Drops every queued quad without drawing it.
+ */
+void SpriteBatch::clear() {
+    quads.clear();
+    vertices.clear();
+    textures.clear();
+    inOrder = true;
+    lastTexture = nullptr; //textures retired this frame may be destroyed and their address reused
+}
+
+/**
+ * Gets the counters since they were last taken, and resets them.
+ */
+SpriteBatchStats SpriteBatch::takeStats() {
+    SpriteBatchStats taken = stats;
+    stats = SpriteBatchStats();
+    return taken;
+}
@@ -0,0 +1,64 @@
+#ifndef __SPRITE_BATCH_H__
+#define __SPRITE_BATCH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SDL.h"
+
+//Draw calls and quads submitted by a SpriteBatch, since it was made or the counters last taken.
+struct SpriteBatchStats {
+    uint64_t flushes = 0;
+    uint64_t drawCalls = 0; //SDL_RenderGeometry calls
+    uint64_t quads = 0;
+};
+
+//Collects textured, rotated and coloured quads for a frame and draws them with as few
+//SDL_RenderGeometry calls as possible. Quads are grouped by layer first, so a higher layer is
+//always drawn over a lower one, then by texture and blend mode within a layer; one call draws
+//each run of quads sharing all three. Coloured quads use a white block in the sprite atlas when
+//one is set, so they join the same runs as the sprites. Only used from the render thread.
+class SpriteBatch {
+    private:
+        struct Quad {
+            uint64_t key; //layer, texture order and blend mode, compared when sorting
+            uint32_t sequence; //submission order, kept within equal keys
+            uint32_t firstVertex;
+        };
+
+        std::vector<SDL_Vertex> vertices; //4 per quad in submission order: TL, TR, BL, BR
+        std::vector<Quad> quads;
+        std::vector<SDL_Texture*> textures; //textures seen this frame, a quad's key holds its index
+        std::vector<SDL_Vertex> sorted; //vertices reordered by key for drawing
+        bool inOrder = true; //every quad so far was queued in key order, so no sort is needed
+        std::vector<int> indices; //2 triangles per quad, relative to the first vertex of a run
+        SDL_Texture* whiteTexture = nullptr; //atlas holding a white block for coloured quads, if any
+        float whiteU = 0, whiteV = 0; //its centre in texture coordinates
+
+        SDL_Texture* lastTexture = nullptr; //size of the most recently used texture, to skip queries
+        float lastInvW = 1, lastInvH = 1;
+        SpriteBatchStats stats;
+
+        uint64_t makeKey(int layer, SDL_Texture* texture, SDL_BlendMode blend);
+        SDL_Vertex* push(int layer, SDL_Texture* texture, SDL_BlendMode blend);
+        void textureScale(SDL_Texture* texture, float& invW, float& invH);
+
+    public:
+        void setWhite(SDL_Texture* texture, const SDL_Rect& rect);
+        void add(int layer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst,
+            SDL_Color colour = SDL_Color{ 255, 255, 255, 255 }, SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+        void addRotated(int layer, SDL_Texture* texture, const SDL_Rect* src, const SDL_FRect& dst, double degrees,
+            SDL_Color colour = SDL_Color{ 255, 255, 255, 255 }, SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+        void addFill(int layer, const SDL_FRect& dst, SDL_Color colour, SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+        void addColouredQuads(int layer, const SDL_Vertex* corners, size_t count, SDL_BlendMode blend = SDL_BLENDMODE_BLEND);
+        void flush(SDL_Renderer* renderer);
+        void clear();
+
+        size_t pending() const {
+            return quads.size();
+        }
+        SpriteBatchStats takeStats();
+};
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef __SPSC_QUEUE_H__
+#define __SPSC_QUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+
+//Bounded lock-free queue for exactly one producer thread and one consumer thread.
+//Slots are preallocated, so push and pop never allocate.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    private:
+        T slots[Capacity];
+        alignas(64) std::atomic<size_t> head{ 0 }; //next slot to pop, written by the consumer
+        alignas(64) std::atomic<size_t> tail{ 0 }; //next slot to push, written by the producer
+
+    public:
+        /**
+         * Adds an item. Producer thread only.
+         * @return false if the queue was full and the item was not added.
+         */
+        bool push(const T& item) {
+            size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == Capacity) {
+                return false;
+            }
+            slots[t & (Capacity - 1)] = item;
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * Removes the oldest item. Consumer thread only.
+         * @return false if the queue was empty.
+         */
+        bool pop(T& item) {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire)) {
+                return false;
+            }
+            item = slots[h & (Capacity - 1)];
+            head.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        //Approximate when called while the other thread is active.
+        size_t size() const {
+            return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+        }
+};
+
+#endif
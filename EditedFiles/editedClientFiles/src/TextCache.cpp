@@ -0,0 +1,315 @@
+#include "TextCache.h"
+
+#include <cstring>
+#include <iostream>
+
+#include "SpriteBatch.h"
+
+TextCache::~TextCache() {
+    clear();
+}
+
+/**
+ * Sets the most texture memory cached strings may hold before the least recently used are freed.
+ * Glyph atlases are not counted, there is one small atlas per font.
+ * @param bytes the budget, estimated at 4 bytes per pixel.
+ */
+void TextCache::setBudget(size_t bytes) {
+    budget = bytes;
+    evict();
+}
+
+/**
+ * Turns caching on or off. When off, every draw rasterizes and uploads the text again, as
+ * drawText originally did, so frame times can be compared.
+ * @param enable true to cache.
+ */
+void TextCache::setEnabled(bool enable) {
+    enabled = enable;
+    if (!enabled) {
+        clear();
+    }
+}
+
+/**
+ * Queues text into a sprite batch instead of drawing it, so it shares draw calls with other text
+ * from the same texture. The batch must be flushed before endFrame() is called.
+ * @param spriteBatch the batch, or nullptr to draw immediately again.
+ * @param layer the batch layer to draw text on.
+ */
+void TextCache::setBatch(SpriteBatch* spriteBatch, int layer) {
+    batch = spriteBatch;
+    batchLayer = layer;
+}
+
+/**
+ * Destroys textures freed since the last call. Call once the frame's batch has been flushed.
+ */
+void TextCache::endFrame() {
+    for (SDL_Texture* texture : retired) {
+        SDL_DestroyTexture(texture);
+    }
+    retired.clear();
+}
+
+/**
+ * Draws part of a texture tinted by colour, or queues it into the batch if one is set.
+ */
+void TextCache::copy(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect& dst, SDL_Color colour) {
+    if (batch != nullptr) {
+        batch->add(batchLayer, texture, src, SDL_FRect{ (float)dst.x, (float)dst.y, (float)dst.w, (float)dst.h }, colour);
+        return;
+    }
+    SDL_SetTextureColorMod(texture, colour.r, colour.g, colour.b);
+    SDL_SetTextureAlphaMod(texture, colour.a);
+    SDL_RenderCopy(renderer, texture, src, &dst);
+}
+
+/**
+ * Frees a texture, or if the batch may still draw it, keeps it until endFrame().
+ */
+void TextCache::retire(SDL_Texture* texture) {
+    if (batch != nullptr) {
+        retired.push_back(texture);
+    }
+    else {
+        SDL_DestroyTexture(texture);
+    }
+}
+
+/**
+ * Fills keyScratch with the lookup key for a string: font pointer, colour, then the text.
+ */
+void TextCache::buildKey(TTF_Font* font, SDL_Color colour, std::string_view text) {
+    keyScratch.clear();
+    keyScratch.append((const char*)&font, sizeof(font));
+    keyScratch.append((const char*)&colour, sizeof(colour));
+    keyScratch.append(text.data(), text.size());
+}
+
+/**
+ * Draws text centred on x, y, uploading it only if it is not already cached.
+ * @param renderer pointer to the renderer in use.
+ * @param font the TTF font to use.
+ * @param x horizontal centre of the text.
+ * @param y vertical centre of the text.
+ * @param text the string to render.
+ * @param colour colour of the text.
+ * @return false if the text could not be rendered.
+ */
+bool TextCache::draw(SDL_Renderer* renderer, TTF_Font* font, int x, int y, std::string_view text, SDL_Color colour) {
+    if (!enabled) {
+        return drawUncached(renderer, font, x, y, text, colour);
+    }
+
+    buildKey(font, colour, text);
+    auto found = lookup.find(keyScratch);
+    if (found != lookup.end()) {
+        stats.hits++;
+        entries.splice(entries.begin(), entries, found->second);
+    }
+    else {
+        stats.misses++;
+        std::string terminated(text); //SDL_ttf needs a null terminated string
+        SDL_Surface* surface = TTF_RenderText_Blended(font, terminated.c_str(), colour);
+        if (surface == nullptr) {
+            std::cout << "Failed to create texture from string: " << terminated << std::endl;
+            std::cout << TTF_GetError() << std::endl;
+            return false;
+        }
+        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+        int w = surface->w;
+        int h = surface->h;
+        SDL_FreeSurface(surface);
+        if (texture == nullptr) {
+            return false;
+        }
+
+        entries.push_front(Entry{ keyScratch, texture, w, h });
+        lookup.emplace(entries.front().key, entries.begin());
+        stats.bytes += (size_t)w * h * 4;
+        evict();
+    }
+
+    const Entry& entry = entries.front();
+    SDL_Rect dst{ x - (entry.w / 2), y - (entry.h / 2), entry.w, entry.h };
+    copy(renderer, entry.texture, nullptr, dst, SDL_Color{ 255, 255, 255, 255 }); //colour is already in the texture
+    return true;
+}
+
+/**
+ * Draws text centred on x, y from quads in the font's glyph atlas. Nothing is rasterized after
+ * the atlas is built, so this suits text that changes most frames. Kerning is not applied.
+ * Falls back to draw() for characters outside printable ASCII.
+ * @param renderer pointer to the renderer in use.
+ * @param font the TTF font to use.
+ * @param x horizontal centre of the text.
+ * @param y vertical centre of the text.
+ * @param text the string to render.
+ * @param colour colour of the text.
+ * @return false if the text could not be rendered.
+ */
+bool TextCache::drawGlyphs(SDL_Renderer* renderer, TTF_Font* font, int x, int y, std::string_view text, SDL_Color colour) {
+    if (!enabled) {
+        return drawUncached(renderer, font, x, y, text, colour);
+    }
+    GlyphAtlas* atlas = atlasFor(renderer, font);
+    if (atlas == nullptr) {
+        return draw(renderer, font, x, y, text, colour);
+    }
+
+    int width = 0;
+    for (char c : text) {
+        if (c < FIRST_GLYPH || c > LAST_GLYPH) {
+            return draw(renderer, font, x, y, text, colour);
+        }
+        width += atlas->advance[c - FIRST_GLYPH];
+    }
+
+    stats.glyphDraws++;
+    int pen = x - (width / 2);
+    int top = y - (atlas->height / 2);
+    for (char c : text) {
+        int index = c - FIRST_GLYPH;
+        const SDL_Rect& cell = atlas->cells[index];
+        if (cell.w > 0) {
+            SDL_Rect dst{ pen, top, cell.w, cell.h };
+            copy(renderer, atlas->texture, &cell, dst, colour);
+        }
+        pen += atlas->advance[index];
+    }
+    return true;
+}
+
+/**
+ * Gets the glyph atlas for a font, rasterizing printable ASCII into one texture the first time.
+ * Glyphs are rendered white and tinted with the texture colour mod, or vertex colour, when drawn.
+ * @return nullptr if the atlas could not be built.
+ */
+TextCache::GlyphAtlas* TextCache::atlasFor(SDL_Renderer* renderer, TTF_Font* font) {
+    auto found = atlases.find(font);
+    if (found != atlases.end()) {
+        return found->second.texture != nullptr ? &found->second : nullptr;
+    }
+    GlyphAtlas& atlas = atlases[font]; //a failed build is remembered so it is not retried every frame
+
+    const SDL_Color white{ 255, 255, 255, 255 };
+    SDL_Surface* glyphs[GLYPH_COUNT] = {};
+    int penX = 0, penY = 0, rowHeight = 0;
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        char text[2] = { (char)(FIRST_GLYPH + i), '\0' };
+        int minX, maxX, minY, maxY, advance;
+        if (TTF_GlyphMetrics(font, (Uint16)text[0], &minX, &maxX, &minY, &maxY, &advance) == 0) {
+            atlas.advance[i] = advance;
+        }
+        glyphs[i] = TTF_RenderText_Blended(font, text, white);
+        if (glyphs[i] == nullptr) {
+            continue; //e.g. space on some SDL_ttf versions, only the advance is needed
+        }
+        if (penX + glyphs[i]->w > ATLAS_WIDTH) {
+            penX = 0;
+            penY += rowHeight;
+            rowHeight = 0;
+        }
+        atlas.cells[i] = SDL_Rect{ penX, penY, glyphs[i]->w, glyphs[i]->h };
+        penX += glyphs[i]->w;
+        if (glyphs[i]->h > rowHeight) {
+            rowHeight = glyphs[i]->h;
+        }
+        if (glyphs[i]->h > atlas.height) {
+            atlas.height = glyphs[i]->h;
+        }
+    }
+
+    SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, penY + rowHeight, 32, SDL_PIXELFORMAT_RGBA32);
+    if (sheet != nullptr) {
+        for (int i = 0; i < GLYPH_COUNT; i++) {
+            if (glyphs[i] != nullptr) {
+                SDL_SetSurfaceBlendMode(glyphs[i], SDL_BLENDMODE_NONE); //copy alpha rather than blend onto the empty sheet
+                SDL_BlitSurface(glyphs[i], nullptr, sheet, &atlas.cells[i]);
+            }
+        }
+        atlas.texture = SDL_CreateTextureFromSurface(renderer, sheet);
+        if (atlas.texture != nullptr) {
+            SDL_SetTextureBlendMode(atlas.texture, SDL_BLENDMODE_BLEND);
+        }
+        SDL_FreeSurface(sheet);
+    }
+    for (SDL_Surface* glyph : glyphs) {
+        if (glyph != nullptr) {
+            SDL_FreeSurface(glyph);
+        }
+    }
+
+    if (atlas.texture == nullptr) {
+        std::cout << "Failed to build glyph atlas: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    return &atlas;
+}
+
+/**
+ * Rasterizes, uploads, draws and frees text in one go, the behaviour before caching.
+ */
+bool TextCache::drawUncached(SDL_Renderer* renderer, TTF_Font* font, int x, int y, std::string_view text, SDL_Color colour) {
+    std::string terminated(text);
+    SDL_Surface* surface = TTF_RenderText_Blended(font, terminated.c_str(), colour);
+    if (surface == nullptr) {
+        std::cout << "Failed to create texture from string: " << terminated << std::endl;
+        std::cout << TTF_GetError() << std::endl;
+        return false;
+    }
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_Rect dst{ x - (surface->w / 2), y - (surface->h / 2), surface->w, surface->h };
+    SDL_FreeSurface(surface);
+    if (texture != nullptr) {
+        copy(renderer, texture, nullptr, dst, SDL_Color{ 255, 255, 255, 255 });
+        retire(texture);
+    }
+    stats.misses++;
+    return true;
+}
+
+/**
+ * Frees least recently used strings until the cache is within budget. The newest entry is
+ * always kept, so a single string larger than the budget can still be drawn.
+ */
+void TextCache::evict() {
+    while (stats.bytes > budget && entries.size() > 1) {
+        Entry& oldest = entries.back();
+        stats.bytes -= (size_t)oldest.w * oldest.h * 4;
+        stats.evictions++;
+        lookup.erase(oldest.key);
+        retire(oldest.texture);
+        entries.pop_back();
+    }
+}
+
+/**
+ * Frees every cached texture and glyph atlas. Must be called before the renderer is destroyed,
+ * and not between queueing text into a batch and flushing it.
+ */
+void TextCache::clear() {
+    endFrame();
+    lookup.clear();
+    for (Entry& entry : entries) {
+        SDL_DestroyTexture(entry.texture);
+    }
+    entries.clear();
+    for (auto& atlas : atlases) {
+        if (atlas.second.texture != nullptr) {
+            SDL_DestroyTexture(atlas.second.texture);
+        }
+    }
+    atlases.clear();
+    stats.bytes = 0;
+}
+
+/**
+ * Gets the hit, miss and eviction counters and current memory use.
+ */
+TextCacheStats TextCache::getStats() const {
+    TextCacheStats current = stats;
+    current.entries = entries.size();
+    return current;
+}
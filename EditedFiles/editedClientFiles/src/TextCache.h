@@ -0,0 +1,85 @@
+#ifndef __TEXT_CACHE_H__
+#define __TEXT_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "SDL.h"
+#include "SDL_ttf.h"
+
+class SpriteBatch;
+
+//Counters for tuning the cache budget.
+struct TextCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0; //strings rasterized and uploaded
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0; //estimated texture memory held by cached strings
+    uint64_t glyphDraws = 0; //strings composed from the glyph atlas
+};
+
+//Textures for rendered strings, keyed by font, colour and text, so unchanged text is rasterized
+//and uploaded once rather than every frame. Least recently used strings are evicted once the
+//memory budget is exceeded. Text that changes often (scores, countdown, counters) can instead
+//be composed from a per-font atlas of ASCII glyphs, which never needs rasterizing again.
+//With a SpriteBatch set, text is queued into it rather than drawn, and textures freed during the
+//frame are kept until endFrame() so quads already queued stay valid. Only used from the render thread.
+class TextCache {
+    private:
+        static const int ATLAS_WIDTH = 512;
+        static const char FIRST_GLYPH = ' ';
+        static const char LAST_GLYPH = '~';
+        static const int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+
+        struct Entry {
+            std::string key;
+            SDL_Texture* texture;
+            int w, h;
+        };
+
+        struct GlyphAtlas {
+            SDL_Texture* texture = nullptr;
+            SDL_Rect cells[GLYPH_COUNT] = {}; //w of 0 if the glyph could not be rendered
+            int advance[GLYPH_COUNT] = {};
+            int height = 0;
+        };
+
+        std::list<Entry> entries; //most recently used first
+        std::unordered_map<std::string_view, std::list<Entry>::iterator> lookup; //views into Entry::key
+        std::unordered_map<TTF_Font*, GlyphAtlas> atlases;
+        std::string keyScratch; //reused so a hit does not allocate
+        size_t budget = 4 * 1024 * 1024;
+        bool enabled = true;
+        TextCacheStats stats;
+        SpriteBatch* batch = nullptr; //queue text here instead of drawing it, if set
+        int batchLayer = 0;
+        std::vector<SDL_Texture*> retired; //freed this frame, destroyed by endFrame() once the batch is drawn
+
+        void copy(SDL_Renderer* renderer, SDL_Texture* texture, const SDL_Rect* src, const SDL_Rect& dst, SDL_Color colour);
+        void retire(SDL_Texture* texture);
+
+        void buildKey(TTF_Font* font, SDL_Color colour, std::string_view text);
+        void evict();
+        GlyphAtlas* atlasFor(SDL_Renderer* renderer, TTF_Font* font);
+        bool drawUncached(SDL_Renderer* renderer, TTF_Font* font, int x, int y, std::string_view text, SDL_Color colour);
+
+    public:
+        ~TextCache();
+
+        void setBudget(size_t bytes);
+        void setEnabled(bool enable);
+        void setBatch(SpriteBatch* spriteBatch, int layer);
+        void endFrame();
+        bool draw(SDL_Renderer* renderer, TTF_Font* font, int x, int y, std::string_view text, SDL_Color colour);
+        bool drawGlyphs(SDL_Renderer* renderer, TTF_Font* font, int x, int y, std::string_view text, SDL_Color colour);
+        void clear();
+        TextCacheStats getStats() const;
+};
+
+#endif
@@ -0,0 +1,237 @@
+#include "UdpLink.h"
+
+#include <cstring>
+#include <iostream>
+
+/**
+ * Microseconds for the session's retransmission timers.
+ */
+static uint64_t nowMicros() {
+    return commandClock() / 1000;
+}
+
+UdpLink::~UdpLink() {
+    close();
+}
+
+/**
+ * Opens a UDP socket on any free port and greets the server with an empty reliable CLIENT_DATA,
+ * which is how the server learns of a new client. SDLNet_Init must already have been called.
+ * @param address the server.
+ * @return false if the socket could not be opened.
+ */
+bool UdpLink::open(const IPaddress& address) {
+    server = address;
+    socket = SDLNet_UDP_Open(0);
+    if (socket == nullptr) {
+        std::cout << "SDLNet_UDP_Open: " << SDLNet_GetError() << std::endl;
+        return false;
+    }
+    sendPacket = SDLNet_AllocPacket((int)MAX_DATAGRAM);
+    receivePacket = SDLNet_AllocPacket((int)MAX_DATAGRAM);
+    socketSet = SDLNet_AllocSocketSet(1);
+    lock = SDL_CreateMutex();
+    if (sendPacket == nullptr || receivePacket == nullptr || socketSet == nullptr || lock == nullptr) {
+        close();
+        return false;
+    }
+    SDLNet_UDP_AddSocket(socketSet, socket);
+    lastReceived = SDL_GetTicks();
+
+    SDL_LockMutex(lock);
+    session.queueReliable("CLIENT_DATA");
+    pumpLocked();
+    SDL_UnlockMutex(lock);
+    return true;
+}
+
+/**
+ * Frees the socket. Both threads using the link must have finished.
+ */
+void UdpLink::close() {
+    if (socketSet != nullptr) {
+        SDLNet_FreeSocketSet(socketSet);
+        socketSet = nullptr;
+    }
+    if (socket != nullptr) {
+        SDLNet_UDP_Close(socket);
+        socket = nullptr;
+    }
+    SDLNet_FreePacket(sendPacket);
+    SDLNet_FreePacket(receivePacket);
+    sendPacket = nullptr;
+    receivePacket = nullptr;
+    if (lock != nullptr) {
+        SDL_DestroyMutex(lock);
+        lock = nullptr;
+    }
+}
+
+/**
+ * Sends one datagram to the server. Called with the lock held.
+ */
+void UdpLink::transmit(const char* data, size_t length) {
+    memcpy(sendPacket->data, data, length);
+    sendPacket->len = (int)length;
+    sendPacket->address = server;
+    SDLNet_UDP_Send(socket, -1, sendPacket);
+}
+
+/**
+ * Sends commands on the channel each belongs to. Called with the commands MyGame queued.
+ * Both payloads are built locally and the key state only changed under the lock, since the
+ * receive thread may be repeating the input state meanwhile.
+ * @param commands the commands, in the order they were queued.
+ * @param count how many there are.
+ */
+void UdpLink::sendCommands(const ClientCommand* commands, size_t count) {
+    std::string reliable = "CLIENT_DATA";
+    std::string unreliable = "CLIENT_DATA";
+    int up = -1, down = -1; //the last state of each key in these commands, -1 if not pressed or released
+    uint32_t seq = 0;
+    for (size_t i = 0; i < count; i++) {
+        const ClientCommand& command = commands[i];
+        switch (command.id) {
+        case CommandId::W_DOWN:
+        case CommandId::W_UP:
+            up = command.id == CommandId::W_DOWN;
+            seq = command.arg;
+            break;
+        case CommandId::S_DOWN:
+        case CommandId::S_UP:
+            down = command.id == CommandId::S_DOWN;
+            seq = command.arg;
+            break;
+        case CommandId::ACK:
+        case CommandId::PING:
+            appendCommand(unreliable, command);
+            break;
+        default:
+            appendCommand(reliable, command);
+            break;
+        }
+    }
+
+    SDL_LockMutex(lock);
+    Uint32 now = SDL_GetTicks();
+    if (reliable.size() > strlen("CLIENT_DATA")) {
+        session.queueReliable(reliable);
+    }
+    if (up >= 0 || down >= 0) {
+        upHeld = up >= 0 ? up == 1 : upHeld;
+        downHeld = down >= 0 ? down == 1 : downHeld;
+        inputSeq = seq;
+        inputRepeats = INPUT_REPEATS + 1;
+        sendInputState(now, unreliable); //carries any ACK or PING with it
+    }
+    else if (unreliable.size() > strlen("CLIENT_DATA")) {
+        char datagram[MAX_DATAGRAM];
+        size_t length = session.packUnreliable(unreliable, datagram, sizeof(datagram));
+        if (length > 0) {
+            transmit(datagram, length);
+        }
+    }
+    pumpLocked();
+    SDL_UnlockMutex(lock);
+}
+
+/**
+ * Sends the held state of both keys with the newest input sequence number, after whatever is
+ * already in payload. Called with the lock held.
+ * @param payload a CLIENT_DATA message, appended to.
+ */
+void UdpLink::sendInputState(Uint32 now, std::string& payload) {
+    appendCommand(payload, ClientCommand{ upHeld ? CommandId::W_DOWN : CommandId::W_UP, inputSeq });
+    appendCommand(payload, ClientCommand{ downHeld ? CommandId::S_DOWN : CommandId::S_UP, inputSeq });
+    char datagram[MAX_DATAGRAM];
+    size_t length = session.packUnreliable(payload, datagram, sizeof(datagram));
+    if (length > 0) {
+        transmit(datagram, length);
+    }
+    inputRepeats--;
+    nextRepeat = now + INPUT_REPEAT_MS;
+}
+
+/**
+ * Sends reliable messages that are new or due for retransmission, any owed acknowledgement,
+ * and repeats of the latest input state. Called with the lock held.
+ */
+void UdpLink::pumpLocked() {
+    char datagram[MAX_DATAGRAM];
+    size_t length;
+    while ((length = session.nextOutgoing(nowMicros(), datagram, sizeof(datagram))) > 0) {
+        transmit(datagram, length);
+    }
+    Uint32 now = SDL_GetTicks();
+    if (inputRepeats > 0 && now >= nextRepeat) {
+        std::string repeat = "CLIENT_DATA";
+        sendInputState(now, repeat);
+    }
+}
+
+/**
+ * Sends anything due by now. Call at least every pumpInterval() ms.
+ */
+void UdpLink::pump() {
+    SDL_LockMutex(lock);
+    pumpLocked();
+    SDL_UnlockMutex(lock);
+}
+
+/**
+ * Gets how long the sender may sleep before pump() has work, so retransmits are not late.
+ * @return milliseconds, at least 1.
+ */
+Uint32 UdpLink::pumpInterval() {
+    SDL_LockMutex(lock);
+    uint64_t wait = session.nextTimeout(nowMicros()) / 1000;
+    if (inputRepeats > 0 && wait > INPUT_REPEAT_MS) {
+        wait = INPUT_REPEAT_MS;
+    }
+    SDL_UnlockMutex(lock);
+    return wait < 1 ? 1 : (wait > 100 ? 100 : (Uint32)wait);
+}
+
+/**
+ * Waits for datagrams from the server and collects the messages they release.
+ * @param timeoutMs longest time to wait for the first datagram.
+ * @param delivered messages to dispatch, in order, are appended here.
+ * @return number of datagrams read, or -1 if the socket failed or the session gave up.
+ */
+int UdpLink::receive(Uint32 timeoutMs, std::vector<std::string>& delivered) {
+    if (SDLNet_CheckSockets(socketSet, timeoutMs) <= 0) {
+        return session.hasFailed() ? -1 : 0;
+    }
+    int datagrams = 0;
+    SDL_LockMutex(lock);
+    int status;
+    while ((status = SDLNet_UDP_Recv(socket, receivePacket)) > 0) {
+        if (receivePacket->address.host != server.host || receivePacket->address.port != server.port) {
+            continue;
+        }
+        session.receive((const char*)receivePacket->data, (size_t)receivePacket->len, nowMicros(), delivered);
+        datagrams++;
+    }
+    if (datagrams > 0) {
+        lastReceived = SDL_GetTicks();
+        pumpLocked(); //acknowledge promptly rather than waiting for the send thread
+    }
+    bool failed = status < 0 || session.hasFailed();
+    SDL_UnlockMutex(lock);
+    return failed ? -1 : datagrams;
+}
+
+/**
+ * Whether nothing has been heard from the server for a while. The server sends CONN_CHECK
+ * every few seconds, so long silence means it has gone.
+ */
+bool UdpLink::isSilent(Uint32 limitMs) const {
+    return SDL_GetTicks() - lastReceived > limitMs;
+}
+
+UdpStats UdpLink::getStats() {
+    SDL_LockMutex(lock);
+    UdpStats stats = session.getStats();
+    SDL_UnlockMutex(lock);
+    return stats;
+}
@@ -0,0 +1,71 @@
+#ifndef __UDP_LINK_H__
+#define __UDP_LINK_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SDL_net.h"
+
+#include "ClientCommand.h"
+#include "UdpSession.h"
+
+//Client end of the UDP transport, used instead of the TCPsocket when --udp is given. Commands
+//are split across the session's channels: TAKE_OVER, CONFIRM, CON_CLOSE and WIRE_BIN are
+//reliable, while ACK, PING and the paddle keys are unreliable. Key presses are sent as the held
+//state of both keys, repeated for a few ticks, so a lost or stale datagram is corrected by the
+//next one instead of leaving a key stuck. Safe to use from one receive and one send thread.
+class UdpLink {
+    private:
+        static const int INPUT_REPEATS = 3; //extra sends of each input state, a tick apart
+        static const Uint32 INPUT_REPEAT_MS = 16;
+
+        UDPsocket socket = nullptr;
+        IPaddress server;
+        UDPpacket* sendPacket = nullptr;
+        UDPpacket* receivePacket = nullptr;
+        SDLNet_SocketSet socketSet = nullptr;
+        SDL_mutex* lock = nullptr; //guards session, sendPacket and the input state below
+        UdpSession session;
+        std::atomic<Uint32> lastReceived{ 0 };
+        std::atomic<bool> running{ false }; //the threads using the link keep going while set
+
+        bool upHeld = false;
+        bool downHeld = false;
+        uint32_t inputSeq = 0;
+        int inputRepeats = 0; //sends of the current input state still to do
+        Uint32 nextRepeat = 0;
+
+        void transmit(const char* data, size_t length);
+        void sendInputState(Uint32 now, std::string& payload);
+        void pumpLocked();
+
+    public:
+        ~UdpLink();
+
+        bool open(const IPaddress& address);
+        void close();
+        void sendCommands(const ClientCommand* commands, size_t count);
+        void pump();
+        int receive(Uint32 timeoutMs, std::vector<std::string>& delivered);
+        Uint32 pumpInterval();
+        bool isSilent(Uint32 limitMs) const;
+        UdpStats getStats();
+
+        UDPsocket getSocket() const {
+            return socket;
+        }
+
+        //Tells the threads using the link to start or stop.
+        void setRunning(bool run) {
+            running = run;
+        }
+
+        bool isRunning() const {
+            return running;
+        }
+};
+
+#endif
@@ -0,0 +1,232 @@
+#include "UdpSession.h"
+
+#include <cstring>
+
+static void putU16(char* out, uint16_t value) {
+    out[0] = (char)(value >> 8);
+    out[1] = (char)(value & 0xFF);
+}
+
+static uint16_t getU16(const char* in) {
+    return (uint16_t)(((uint8_t)in[0] << 8) | (uint8_t)in[1]);
+}
+
+/**
+ * Whether sequence number a was sent after b, allowing for wrap around.
+ */
+static bool seqAfter(uint16_t a, uint16_t b) {
+    return (int16_t)(a - b) > 0;
+}
+
+/**
+ * Writes the channel, sequence number and current acknowledgement of the peer's reliable messages.
+ */
+size_t UdpSession::writeHeader(char* out, UdpChannel channel, uint16_t seq) {
+    uint32_t bits = 0;
+    for (uint16_t i = 0; i < RECEIVE_WINDOW; i++) {
+        if (isHeld[(uint16_t)(expected + 1 + i) % RECEIVE_WINDOW]) {
+            bits |= 1u << i;
+        }
+    }
+    out[0] = (char)channel;
+    putU16(out + 1, seq);
+    putU16(out + 3, expected);
+    putU16(out + 5, (uint16_t)(bits >> 16));
+    putU16(out + 7, (uint16_t)bits);
+    ackDue = false;
+    stats.datagramsSent++;
+    return UDP_HEADER_SIZE;
+}
+
+/**
+ * Builds a datagram for a message that is sent once, such as a snapshot or input state.
+ * @param message the payload, at most MAX_UDP_MESSAGE bytes.
+ * @param out destination buffer, MAX_DATAGRAM is always enough.
+ * @param outSize size of the destination buffer.
+ * @return the datagram length, or 0 if it does not fit.
+ */
+size_t UdpSession::packUnreliable(std::string_view message, char* out, size_t outSize) {
+    if (message.size() > MAX_UDP_MESSAGE || outSize < UDP_HEADER_SIZE + message.size()) {
+        return 0;
+    }
+    size_t length = writeHeader(out, UdpChannel::UNRELIABLE, nextUnreliable++);
+    memcpy(out + length, message.data(), message.size());
+    return length + message.size();
+}
+
+/**
+ * Queues a message for reliable, ordered delivery. It is sent by the next nextOutgoing call.
+ * @param message the payload, at most MAX_UDP_MESSAGE bytes.
+ * @return false if the message is too long, or so many are unacknowledged that the peer is
+ * considered gone; the session has then failed.
+ */
+bool UdpSession::queueReliable(std::string_view message) {
+    if (message.size() > MAX_UDP_MESSAGE || unacked.size() >= SEND_WINDOW) {
+        failed = true;
+        return false;
+    }
+    unacked.push_back(Pending{ nextReliable++, std::string(message) });
+    return true;
+}
+
+/**
+ * Gets the next datagram that should be sent now: a new or timed out reliable message, or a
+ * bare acknowledgement if one is owed and nothing else carried it. Call until it returns 0.
+ * @param now current time in microseconds.
+ * @param out destination buffer, MAX_DATAGRAM is always enough.
+ * @param outSize size of the destination buffer.
+ * @return the datagram length, or 0 if nothing is due.
+ */
+size_t UdpSession::nextOutgoing(uint64_t now, char* out, size_t outSize) {
+    for (Pending& p : unacked) {
+        int backoff = p.sends < 5 ? p.sends - 1 : 4;
+        bool due = p.sends == 0 || now - p.sentAt >= (rto << backoff);
+        if (!due) {
+            continue;
+        }
+        if (outSize < UDP_HEADER_SIZE + p.message.size()) {
+            return 0;
+        }
+        if (p.sends >= MAX_SENDS) {
+            failed = true;
+            return 0;
+        }
+        if (p.sends > 0) {
+            stats.retransmits++;
+        }
+        p.sends++;
+        p.sentAt = now;
+        size_t length = writeHeader(out, UdpChannel::RELIABLE, p.seq);
+        memcpy(out + length, p.message.data(), p.message.size());
+        return length + p.message.size();
+    }
+    if (ackDue && outSize >= UDP_HEADER_SIZE) {
+        return writeHeader(out, UdpChannel::ACK, 0);
+    }
+    return 0;
+}
+
+/**
+ * Drops acknowledged messages and updates the round trip estimate from those sent only once.
+ */
+void UdpSession::applyAck(uint16_t ack, uint32_t bits, uint64_t now) {
+    for (auto p = unacked.begin(); p != unacked.end();) {
+        uint16_t beyond = (uint16_t)(p->seq - ack - 1);
+        bool acked = seqAfter(ack, p->seq) || (beyond < 32 && (bits & (1u << beyond)) != 0);
+        if (!acked || p->sends == 0) {
+            ++p;
+            continue;
+        }
+        if (p->sends == 1) { //retransmitted messages are ambiguous, as in Karn's algorithm
+            float sample = (float)(now - p->sentAt);
+            if (srtt == 0) {
+                srtt = sample;
+                rttVar = sample / 2;
+            }
+            else {
+                float error = sample > srtt ? sample - srtt : srtt - sample;
+                rttVar += (error - rttVar) / 4;
+                srtt += (sample - srtt) / 8;
+            }
+            uint64_t timeout = (uint64_t)(srtt + 4 * rttVar);
+            rto = timeout < 20000 ? 20000 : (timeout > 1000000 ? 1000000 : timeout);
+        }
+        p = unacked.erase(p);
+    }
+}
+
+/**
+ * Consumes one received datagram.
+ * @param data the datagram.
+ * @param length its length.
+ * @param now current time in microseconds.
+ * @param delivered messages now ready to dispatch, in order, are appended here.
+ * @return false if the datagram was malformed.
+ */
+bool UdpSession::receive(const char* data, size_t length, uint64_t now, std::vector<std::string>& delivered) {
+    if (length < UDP_HEADER_SIZE || (uint8_t)data[0] > (uint8_t)UdpChannel::ACK) {
+        return false;
+    }
+    stats.datagramsReceived++;
+    UdpChannel channel = (UdpChannel)data[0];
+    uint16_t seq = getU16(data + 1);
+    uint32_t bits = ((uint32_t)getU16(data + 5) << 16) | getU16(data + 7);
+    applyAck(getU16(data + 3), bits, now);
+    std::string_view message(data + UDP_HEADER_SIZE, length - UDP_HEADER_SIZE);
+
+    if (channel == UdpChannel::UNRELIABLE) {
+        if (haveUnreliable && !seqAfter(seq, lastUnreliable)) {
+            stats.stale++;
+            return true;
+        }
+        if (haveUnreliable) {
+            stats.skipped += (uint16_t)(seq - lastUnreliable - 1);
+        }
+        haveUnreliable = true;
+        lastUnreliable = seq;
+        delivered.emplace_back(message);
+    }
+    else if (channel == UdpChannel::RELIABLE) {
+        ackDue = true;
+        uint16_t ahead = (uint16_t)(seq - expected);
+        if (seqAfter(expected, seq) || (ahead > 0 && ahead <= RECEIVE_WINDOW && isHeld[seq % RECEIVE_WINDOW])) {
+            stats.duplicates++;
+        }
+        else if (ahead == 0) {
+            delivered.emplace_back(message);
+            expected++;
+            while (isHeld[expected % RECEIVE_WINDOW]) {
+                uint16_t slot = expected % RECEIVE_WINDOW;
+                delivered.push_back(std::move(held[slot]));
+                isHeld[slot] = false;
+                expected++;
+            }
+        }
+        else if (ahead <= RECEIVE_WINDOW) {
+            held[seq % RECEIVE_WINDOW].assign(message);
+            isHeld[seq % RECEIVE_WINDOW] = true;
+        }
+        //further ahead than the window: dropped, the sender retransmits it later
+    }
+    return true;
+}
+
+/**
+ * Gets how long the owner may wait before nextOutgoing has something to send.
+ * @param now current time in microseconds.
+ * @return microseconds, 0 if something is due now, UINT64_MAX if nothing is pending.
+ */
+uint64_t UdpSession::nextTimeout(uint64_t now) const {
+    if (ackDue) {
+        return 0;
+    }
+    uint64_t soonest = UINT64_MAX;
+    for (const Pending& p : unacked) {
+        if (p.sends == 0) {
+            return 0;
+        }
+        int backoff = p.sends < 5 ? p.sends - 1 : 4;
+        uint64_t due = p.sentAt + (rto << backoff);
+        uint64_t wait = due > now ? due - now : 0;
+        if (wait < soonest) {
+            soonest = wait;
+        }
+    }
+    return soonest;
+}
+
+/**
+ * Whether a datagram is the first reliable message of a session, which is the only kind that
+ * should make a server create a client. Anything else from an unknown address is a leftover,
+ * such as a retransmitted CON_CLOSE from a client already removed.
+ */
+bool UdpSession::opensSession(const char* data, size_t length) {
+    return length >= UDP_HEADER_SIZE && (UdpChannel)data[0] == UdpChannel::RELIABLE && getU16(data + 1) == 0;
+}
+
+UdpStats UdpSession::getStats() const {
+    UdpStats current = stats;
+    current.rttMs = srtt / 1000;
+    current.unacked = unacked.size();
+    return current;
+}
@@ -0,0 +1,89 @@
+#ifndef __UDP_SESSION_H__
+#define __UDP_SESSION_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//Every datagram is [channel u8][seq u16][ack u16][ack bits u32][one message], big-endian like
+//frames. ack is the next reliable seq the sender expects, bit i of ack bits says ack + 1 + i
+//also arrived, so every datagram acknowledges the other side's reliable messages.
+const size_t UDP_HEADER_SIZE = 9;
+const size_t MAX_DATAGRAM = 1200; //stays under typical path MTUs
+const size_t MAX_UDP_MESSAGE = MAX_DATAGRAM - UDP_HEADER_SIZE;
+
+enum class UdpChannel : uint8_t {
+    UNRELIABLE = 0, //sequenced: anything older than the newest already received is dropped
+    RELIABLE = 1, //acknowledged, retransmitted and delivered in order
+    ACK = 2 //no message, only the acknowledgement fields
+};
+
+//Counters for one side of a session.
+struct UdpStats {
+    uint64_t datagramsSent = 0;
+    uint64_t datagramsReceived = 0;
+    uint64_t retransmits = 0;
+    uint64_t stale = 0; //unreliable messages dropped for arriving after a newer one
+    uint64_t skipped = 0; //unreliable sequence numbers never seen, lost or still in flight
+    uint64_t duplicates = 0; //reliable messages received again
+    float rttMs = 0; //smoothed round trip of reliable messages
+    size_t unacked = 0; //reliable messages waiting for acknowledgement
+};
+
+//Reliability over datagrams for one peer, independent of any socket: pack* and nextOutgoing
+//produce datagrams to send, receive consumes datagrams and hands back messages to dispatch.
+//Reliable messages are retransmitted with backoff until acknowledged; unreliable ones are
+//sent once and dropped by the receiver if a newer one has already arrived, so a lost snapshot
+//never holds up the next. Not thread safe.
+class UdpSession {
+    private:
+        static const uint16_t RECEIVE_WINDOW = 32; //out of order reliable messages held, one per ack bit
+        static const size_t SEND_WINDOW = 256; //reliable messages in flight before the session fails
+        static const int MAX_SENDS = 20; //transmissions of one message before the session fails
+
+        struct Pending {
+            uint16_t seq;
+            std::string message;
+            uint64_t sentAt = 0; //0 until first sent
+            int sends = 0;
+        };
+
+        uint16_t nextUnreliable = 0;
+        uint16_t nextReliable = 0;
+        std::deque<Pending> unacked; //oldest first
+
+        bool haveUnreliable = false;
+        uint16_t lastUnreliable = 0; //newest unreliable seq received
+        uint16_t expected = 0; //next reliable seq to deliver
+        std::string held[RECEIVE_WINDOW]; //reliable messages after expected, by seq % window
+        bool isHeld[RECEIVE_WINDOW] = {};
+        bool ackDue = false;
+
+        uint64_t rto = 200000; //retransmission timeout, microseconds
+        float srtt = 0; //smoothed round trip, microseconds, 0 until measured
+        float rttVar = 0;
+        bool failed = false;
+        UdpStats stats;
+
+        size_t writeHeader(char* out, UdpChannel channel, uint16_t seq);
+        void applyAck(uint16_t ack, uint32_t bits, uint64_t now);
+
+    public:
+        size_t packUnreliable(std::string_view message, char* out, size_t outSize);
+        bool queueReliable(std::string_view message);
+        size_t nextOutgoing(uint64_t now, char* out, size_t outSize);
+        bool receive(const char* data, size_t length, uint64_t now, std::vector<std::string>& delivered);
+        uint64_t nextTimeout(uint64_t now) const;
+
+        static bool opensSession(const char* data, size_t length);
+
+        bool hasFailed() const {
+            return failed;
+        }
+        UdpStats getStats() const;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __WAKE_SIGNAL_H__
+#define __WAKE_SIGNAL_H__
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+//Lets a thread sleep until another thread says there is work, instead of polling.
+class WakeSignal {
+    private:
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool pending = false; //notify() was called since the last wait returned
+
+    public:
+        void notify() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending = true;
+            }
+            cond.notify_one();
+        }
+
+        /**
+         * Blocks until notify() is called or the timeout passes.
+         * @param timeoutMs longest time to wait.
+         * @return true if woken by notify().
+         */
+        bool wait(int timeoutMs) {
+            std::unique_lock<std::mutex> lock(mutex);
+            bool woken = cond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return pending; });
+            pending = false;
+            return woken;
+        }
+};
+
+#endif
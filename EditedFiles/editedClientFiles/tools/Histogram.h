@@ -0,0 +1,88 @@
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Log-linear histogram of microsecond values: each power of two is split into 128 equal buckets,
+//so percentiles are accurate to under 1% across any range in about 60 KB.
+class Histogram {
+    private:
+        static const int SUB_BITS = 7;
+        static const int SUB_BUCKETS = 1 << SUB_BITS;
+
+        std::vector<uint64_t> buckets;
+        uint64_t total = 0;
+        uint64_t sum = 0;
+        uint64_t largest = 0;
+
+        static size_t indexOf(uint64_t value) {
+            if (value < SUB_BUCKETS) {
+                return (size_t)value;
+            }
+            int power = 63;
+            while ((value >> power) == 0) {
+                power--;
+            }
+            uint64_t sub = (value >> (power - SUB_BITS)) & (SUB_BUCKETS - 1);
+            return (size_t)(power - SUB_BITS + 1) * SUB_BUCKETS + (size_t)sub;
+        }
+        //Middle of the range of values a bucket holds.
+        static double midpoint(size_t index) {
+            if (index < SUB_BUCKETS) {
+                return (double)index;
+            }
+            int shift = (int)(index / SUB_BUCKETS) - 1;
+            uint64_t sub = index % SUB_BUCKETS;
+            return (double)((SUB_BUCKETS + sub) << shift) + ((1ull << shift) - 1) / 2.0;
+        }
+
+    public:
+        Histogram() : buckets((64 - SUB_BITS + 1) * SUB_BUCKETS, 0) {}
+
+        void add(uint64_t us) {
+            buckets[indexOf(us)]++;
+            total++;
+            sum += us;
+            if (us > largest) {
+                largest = us;
+            }
+        }
+        void merge(const Histogram& other) {
+            for (size_t i = 0; i < buckets.size(); i++) {
+                buckets[i] += other.buckets[i];
+            }
+            total += other.total;
+            sum += other.sum;
+            if (other.largest > largest) {
+                largest = other.largest;
+            }
+        }
+        //Value below which the given fraction of samples fall, in milliseconds.
+        double percentileMs(double fraction) const {
+            if (total == 0) {
+                return 0;
+            }
+            uint64_t rank = (uint64_t)(fraction * (total - 1));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < buckets.size(); i++) {
+                seen += buckets[i];
+                if (seen > rank) {
+                    return midpoint(i) / 1000.0;
+                }
+            }
+            return largest / 1000.0;
+        }
+        uint64_t count() const {
+            return total;
+        }
+        double meanMs() const {
+            return total > 0 ? (double)sum / total / 1000.0 : 0;
+        }
+        double maxMs() const {
+            return largest / 1000.0;
+        }
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include "LinkSimulator.h"
+
+LinkSimulator::LinkSimulator(const LinkConfig& config, bool stream, uint32_t seed)
+    : config(config), stream(stream), random(seed) {
+}
+
+/**
+ * Sends bytes into the simulated link.
+ * @param bytes a frame in stream mode, a datagram in datagram mode.
+ * @param now current time, milliseconds.
+ */
+void LinkSimulator::push(std::string_view bytes, uint64_t now) {
+    uint64_t due = now + config.latency;
+    if (config.jitter > 0) {
+        due += (uint64_t)(random.unit() * config.jitter);
+    }
+    bool dropped = config.loss > 0 && random.unit() * 100 < config.loss;
+
+    if (!stream) {
+        if (dropped) {
+            lost++;
+            return;
+        }
+        //datagrams are independent, so keep the queue sorted by due time and let jitter reorder them
+        auto at = held.end();
+        while (at != held.begin() && (at - 1)->due > due) {
+            --at;
+        }
+        held.insert(at, Held{ due, std::string(bytes) });
+        return;
+    }
+
+    if (dropped) {
+        lost++;
+        due += config.tcpRto;
+    }
+    if (due < lastDue) {
+        due = lastDue; //nothing overtakes a segment still waiting to be retransmitted
+    }
+    lastDue = due;
+    held.push_back(Held{ due, std::string(bytes) });
+}
+
+/**
+ * Takes the next bytes whose time has come.
+ * @param now current time, milliseconds.
+ * @param out the bytes, if any.
+ * @return false if nothing is due yet.
+ */
+bool LinkSimulator::pop(uint64_t now, std::string& out) {
+    if (held.empty() || held.front().due > now) {
+        return false;
+    }
+    out = std::move(held.front().bytes);
+    held.pop_front();
+    return true;
+}
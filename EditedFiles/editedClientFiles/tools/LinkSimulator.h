@@ -0,0 +1,51 @@
+#ifndef __LINK_SIMULATOR_H__
+#define __LINK_SIMULATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include "FastRandom.h"
+
+//Network conditions to simulate in one direction. Times are milliseconds.
+struct LinkConfig {
+    int latency = 0; //added to every packet
+    int jitter = 0; //further random delay of up to this much
+    float loss = 0; //percentage of packets lost
+    int tcpRto = 200; //delay before a lost TCP segment is retransmitted, Linux's minimum RTO
+};
+
+//Holds back packets to imitate a slower, lossy link. In datagram mode lost packets vanish and
+//jitter may reorder the rest, as UDP would. In stream mode nothing is lost: a lost segment is
+//delivered after tcpRto instead, and everything behind it waits, which is TCP's head-of-line
+//blocking. Fast retransmit, which can recover sooner when more segments follow, is not modelled.
+class LinkSimulator {
+    private:
+        struct Held {
+            uint64_t due;
+            std::string bytes;
+        };
+
+        LinkConfig config;
+        bool stream = true;
+        FastRandom random;
+        std::deque<Held> held; //stream mode: in order, dues never decrease
+        uint64_t lastDue = 0;
+        uint64_t lost = 0;
+
+    public:
+        LinkSimulator(const LinkConfig& config, bool stream, uint32_t seed);
+
+        bool isActive() const {
+            return config.latency > 0 || config.jitter > 0 || config.loss > 0;
+        }
+        void push(std::string_view bytes, uint64_t now);
+        bool pop(uint64_t now, std::string& out);
+        uint64_t getLost() const {
+            return lost;
+        }
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "LoadGenerator.h"
+#include "StandInServer.h"
+
+/**
+ * Runs a stand-in server on its own thread, for measuring without a separate process.
+ */
+static int runStandIn(void* server) {
+    ((StandInServer*)server)->run();
+    return 0;
+}
+
+static void printPercentiles(const char* name, const Histogram& h) {
+    if (h.count() == 0) {
+        printf("%-22s no samples\n", name);
+        return;
+    }
+    printf("%-22s p50 %7.2f  p90 %7.2f  p99 %7.2f  p99.9 %7.2f  max %7.2f ms  (%llu samples)\n", name,
+        h.percentileMs(0.5), h.percentileMs(0.9), h.percentileMs(0.99), h.percentileMs(0.999), h.maxMs(),
+        (unsigned long long)h.count());
+}
+
+static void printReport(const LoadReport& r, const LoadConfig& config) {
+    double perClient = r.connected > 0 && r.seconds > 0 ? r.snapshots / r.seconds / r.connected : 0;
+    printf("\n%d clients: %d connected, %d failed to connect, %d closed by the server, measured %.1f s\n",
+        r.clients, r.connected, r.connectFailures, r.closedEarly, r.seconds);
+    printf("snapshots per client   mean %.2f/s  worst %.2f/s  expected %d/s  delivered %.1f%%\n",
+        perClient, r.minClientRate, config.tickRate, r.deliveryRatio(config.tickRate) * 100);
+    printPercentiles("snapshot interval", r.interArrival);
+    printf("bandwidth              in %.1f KB/s (%.2f KB/s per client), out %.1f KB/s\n",
+        r.bytesReceived / r.seconds / 1024, r.bytesReceived / r.seconds / 1024 / (r.connected > 0 ? r.connected : 1),
+        r.bytesSent / r.seconds / 1024);
+    printPercentiles("connect", r.connectTime);
+    printPercentiles("connect to ROLE", r.roleTime);
+    printPercentiles("PING to PONG", r.pingRtt);
+    printPercentiles("snapshot delay", r.snapshotDelay);
+}
+
+/**
+ * Whether a run served every client at close to the tick rate.
+ * @param limitMs the largest acceptable p99 snapshot interval.
+ */
+static bool healthy(const LoadReport& r, const LoadConfig& config, double limitMs) {
+    return r.connectFailures == 0 && r.closedEarly == 0
+        && r.deliveryRatio(config.tickRate) >= 0.95
+        && r.interArrival.count() > 0 && r.interArrival.percentileMs(0.99) <= limitMs;
+}
+
+/**
+ * Opens many concurrent connections to a Pong server and reports how well it serves them.
+ * --host NAME, --port N, --clients N, --duration S, --connect-rate N, --tick-rate N,
+ * --input-rate N, --ping-interval S, --binary
+ * --udp uses the UDP transport instead of TCP; the server must serve it, as the stand-in can.
+ * --standin runs the C++ stand-in server in this process, with --autoplay, --latency MS,
+ *   --jitter MS, --loss P, --tcp-rto MS and --check-interval MS passed to it; CONN_CHECK round
+ *   trips are then reported too. With --binary, how late each snapshot arrived is reported, so
+ *   e.g. "--loss 2 --latency 30" can be run with and without --udp to compare tail latency.
+ * --sweep doubles the client count from --clients until delivery drops below 95% or the p99
+ *   snapshot interval passes twice the tick period, up to --max-clients.
+ * SDL_net waits on sockets with select(), which handles about 1000 sockets per process on most
+ * platforms, so runs past a few hundred clients should use a separate pong_standin or server.
+ */
+int main(int argc, char** argv) {
+    LoadConfig config;
+    StandInConfig standInConfig;
+    bool standIn = false;
+    bool sweep = false;
+    int maxClients = 4096;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--host" && hasValue) {
+            config.host = argv[++i];
+        }
+        else if (arg == "--port" && hasValue) {
+            config.port = (Uint16)std::stoi(argv[++i]);
+        }
+        else if (arg == "--clients" && hasValue) {
+            config.clients = std::stoi(argv[++i]);
+        }
+        else if (arg == "--duration" && hasValue) {
+            config.duration = std::stof(argv[++i]);
+        }
+        else if (arg == "--connect-rate" && hasValue) {
+            config.connectRate = std::stoi(argv[++i]);
+        }
+        else if (arg == "--tick-rate" && hasValue) {
+            config.tickRate = std::stoi(argv[++i]);
+        }
+        else if (arg == "--input-rate" && hasValue) {
+            config.inputRate = std::stof(argv[++i]);
+        }
+        else if (arg == "--ping-interval" && hasValue) {
+            config.pingInterval = std::stof(argv[++i]);
+        }
+        else if (arg == "--binary") {
+            config.binaryWire = true;
+        }
+        else if (arg == "--standin") {
+            standIn = true;
+        }
+        else if (arg == "--autoplay") {
+            standInConfig.autoplay = true;
+        }
+        else if (arg == "--latency" && hasValue) {
+            standInConfig.link.latency = std::stoi(argv[++i]);
+        }
+        else if (arg == "--jitter" && hasValue) {
+            standInConfig.link.jitter = std::stoi(argv[++i]);
+        }
+        else if (arg == "--loss" && hasValue) {
+            standInConfig.link.loss = std::stof(argv[++i]);
+        }
+        else if (arg == "--tcp-rto" && hasValue) {
+            standInConfig.link.tcpRto = std::stoi(argv[++i]);
+        }
+        else if (arg == "--udp") {
+            config.udp = true;
+            standInConfig.udp = true;
+        }
+        else if (arg == "--check-interval" && hasValue) {
+            standInConfig.checkInterval = (Uint32)std::stoi(argv[++i]);
+        }
+        else if (arg == "--sweep") {
+            sweep = true;
+        }
+        else if (arg == "--max-clients" && hasValue) {
+            maxClients = std::stoi(argv[++i]);
+        }
+        else {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (config.clients < 1) {
+        config.clients = 1;
+    }
+
+    if (SDL_Init(0) == -1) {
+        std::cout << "SDL_Init: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    if (SDLNet_Init() == -1) {
+        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
+        return 2;
+    }
+
+    if (standIn && (sweep ? maxClients : config.clients) > 480) {
+        std::cout << "Warning: with --standin both ends of every connection share this process's select() limit" << std::endl;
+    }
+
+    standInConfig.port = config.port;
+    standInConfig.tickRate = config.tickRate;
+    standInConfig.maxClients = sweep ? maxClients : config.clients;
+    double limitMs = 2000.0 / config.tickRate;
+    int served = 0;
+    LoadGenerator generator;
+
+    while (true) {
+        //a fresh stand-in per run, so CONN_CHECK timings and the match belong to that run
+        std::unique_ptr<StandInServer> server;
+        SDL_Thread* serverThread = nullptr;
+        if (standIn) {
+            server.reset(new StandInServer());
+            if (!server->start(standInConfig)) {
+                return 3;
+            }
+            serverThread = SDL_CreateThread(runStandIn, "StandIn", server.get());
+        }
+
+        printf("Running %d clients against %s:%d for %.0f s...\n", config.clients, config.host.c_str(), config.port, config.duration);
+        LoadReport report = generator.run(config);
+        printReport(report, config);
+
+        if (server) {
+            server->stop();
+            SDL_WaitThread(serverThread, nullptr);
+            printPercentiles("CONN_CHECK to CONFIRM", server->getCheckRtt());
+        }
+
+        if (!sweep) {
+            break;
+        }
+        if (!healthy(report, config, limitMs)) {
+            printf("\nDegraded at %d clients\n", config.clients);
+            break;
+        }
+        served = config.clients;
+        if (config.clients * 2 > maxClients) {
+            printf("\nReached --max-clients\n");
+            break;
+        }
+        config.clients *= 2;
+    }
+    if (sweep) {
+        printf("Most concurrent clients served at %d/s: %d\n", config.tickRate, served);
+    }
+
+    SDLNet_Quit();
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,477 @@
+#include "LoadGenerator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "ClientCommand.h"
+#include "FastRandom.h"
+#include "Framing.h"
+#include "Message.h"
+#include "Snapshot.h"
+#include "UdpLink.h"
+
+/**
+ * Monotonic microseconds, shared by every worker so their timestamps compare.
+ */
+static uint64_t nowUs() {
+    return commandClock() / 1000;
+}
+
+static const Uint32 UDP_SILENCE_MS = 15000; //three missed CONN_CHECKs
+
+//One load connection and what has been measured on it.
+struct LoadConnection {
+    TCPsocket socket = nullptr;
+    std::unique_ptr<UdpLink> udp; //instead of socket with --udp
+    FrameReader reader;
+    SnapshotDecoder decoder;
+    bool connected = false;
+    uint64_t openAt = 0; //when this connection is due to be opened
+    uint64_t connectStart = 0;
+    bool gotRole = false;
+    uint64_t lastSnapshot = 0;
+    uint64_t measuredSnapshots = 0;
+    uint32_t inputSeq = 0;
+    int heldKey = 0; //0 none, 1 W, 2 S
+    uint64_t nextInput = 0;
+    uint32_t pingId = 0;
+    uint64_t pingSentAt = 0; //0 when no PING is outstanding
+    uint64_t nextPing = 0;
+    bool haveSeq = false;
+    uint16_t lastSeq = 0;
+    uint32_t tick = 0; //binary snapshot seq, unwrapped
+    std::vector<std::pair<uint32_t, uint64_t>> arrivals; //tick and arrival time of each measured binary snapshot
+
+    bool isOpen() const {
+        return socket != nullptr || udp != nullptr;
+    }
+};
+
+/**
+ * Finds the arrival in [begin, end) that was least delayed, assuming ticks are period apart.
+ */
+static size_t earliestArrival(const std::vector<std::pair<uint32_t, uint64_t>>& arrivals, size_t begin, size_t end, double period) {
+    size_t best = begin;
+    for (size_t i = begin; i < end; i++) {
+        if (arrivals[i].second - arrivals[i].first * period < arrivals[best].second - arrivals[best].first * period) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Adds how late each binary snapshot on a connection arrived, relative to its tick. The tick
+ * period is the slope between the least delayed arrivals of each half of the run, so stalls
+ * do not skew it, and the least delayed arrival counts as on time, so neither clock offset nor
+ * the server's exact tick rate matter.
+ */
+static void addSnapshotDelays(const LoadConnection& c, Histogram& delays) {
+    const auto& arrivals = c.arrivals;
+    if (arrivals.size() < 4 || arrivals.back().first == arrivals.front().first) {
+        return;
+    }
+    double period = (double)(arrivals.back().second - arrivals.front().second) / (arrivals.back().first - arrivals.front().first);
+    size_t half = arrivals.size() / 2;
+    size_t first = earliestArrival(arrivals, 0, half, period);
+    size_t second = earliestArrival(arrivals, half, arrivals.size(), period);
+    if (arrivals[second].first != arrivals[first].first) {
+        period = (double)(arrivals[second].second - arrivals[first].second) / (arrivals[second].first - arrivals[first].first);
+    }
+    size_t best = earliestArrival(arrivals, 0, arrivals.size(), period);
+    double onTime = arrivals[best].second - arrivals[best].first * period;
+    for (const auto& arrival : arrivals) {
+        delays.add((uint64_t)(arrival.second - arrival.first * period - onTime));
+    }
+}
+
+struct LoadGenerator::Worker {
+    const LoadConfig* config = nullptr;
+    IPaddress address;
+    std::vector<LoadConnection> connections;
+    SDLNet_SocketSet socketSet = nullptr;
+    FastRandom random;
+    std::atomic<bool>* stop = nullptr;
+    std::atomic<int>* settled = nullptr; //connections that have connected or failed, over all workers
+    std::atomic<uint64_t>* measureStart = nullptr; //0 until every client has connected
+    LoadReport report;
+    std::string message; //reused for building CLIENT_DATA
+    std::vector<std::string> delivered; //messages released by a UDP link
+
+    bool measuring(uint64_t at) const {
+        uint64_t start = measureStart->load();
+        return start != 0 && at >= start;
+    }
+
+    void open(LoadConnection& c);
+    void close(LoadConnection& c, bool early);
+    void receive(LoadConnection& c);
+    void handle(LoadConnection& c, std::string_view payload, uint64_t at);
+    void send(LoadConnection& c, const ClientCommand* commands, size_t count, uint64_t at);
+    void sendInput(LoadConnection& c, uint64_t at);
+};
+
+/**
+ * Opens a connection, timing how long SDLNet_TCP_Open takes.
+ */
+void LoadGenerator::Worker::open(LoadConnection& c) {
+    c.connectStart = nowUs();
+    if (config->udp) {
+        c.udp.reset(new UdpLink());
+        if (!c.udp->open(address)) {
+            c.udp.reset();
+        }
+    }
+    else {
+        c.socket = SDLNet_TCP_Open(&address);
+    }
+    uint64_t connected = nowUs();
+    (*settled)++;
+    if (!c.isOpen()) {
+        report.connectFailures++;
+        return;
+    }
+    c.connected = true;
+    report.connected++;
+    report.connectTime.add(connected - c.connectStart);
+    if (c.udp) {
+        SDLNet_UDP_AddSocket(socketSet, c.udp->getSocket());
+    }
+    else {
+        SDLNet_TCP_AddSocket(socketSet, c.socket);
+    }
+
+    float inputGap = config->inputRate > 0 ? 1000000.0f / config->inputRate : 0;
+    c.nextInput = inputGap > 0 ? connected + (uint64_t)(inputGap * random.unit()) : UINT64_MAX;
+    c.nextPing = config->pingInterval > 0 ? connected + (uint64_t)(config->pingInterval * 1000000 * random.unit()) : UINT64_MAX;
+    if (config->binaryWire) {
+        ClientCommand wire{ CommandId::WIRE_BIN, 0, 0 };
+        send(c, &wire, 1, connected);
+    }
+}
+
+/**
+ * Closes a connection, telling the server with CON_CLOSE if we are the ones leaving.
+ * @param early true if the server closed it before the run ended.
+ */
+void LoadGenerator::Worker::close(LoadConnection& c, bool early) {
+    if (!c.isOpen()) {
+        return;
+    }
+    if (early) {
+        report.closedEarly++;
+    }
+    else {
+        ClientCommand leave{ CommandId::CON_CLOSE, 0, 0 };
+        send(c, &leave, 1, nowUs());
+    }
+    if (c.udp) {
+        SDLNet_UDP_DelSocket(socketSet, c.udp->getSocket());
+        c.udp.reset();
+    }
+    if (c.socket != nullptr) {
+        SDLNet_TCP_DelSocket(socketSet, c.socket);
+        SDLNet_TCP_Close(c.socket);
+        c.socket = nullptr;
+    }
+}
+
+void LoadGenerator::Worker::receive(LoadConnection& c) {
+    if (c.udp) {
+        delivered.clear();
+        int datagrams = c.udp->receive(0, delivered);
+        uint64_t at = nowUs();
+        if (datagrams < 0) {
+            close(c, true);
+            return;
+        }
+        for (const std::string& payload : delivered) {
+            if (measuring(at)) {
+                report.bytesReceived += UDP_HEADER_SIZE + payload.size();
+            }
+            handle(c, payload, at);
+            if (!c.isOpen()) {
+                return;
+            }
+        }
+        return;
+    }
+
+    size_t writable;
+    char* buffer = c.reader.prepareWrite(4096, writable);
+    int received = SDLNet_TCP_Recv(c.socket, buffer, (int)writable);
+    uint64_t at = nowUs();
+    if (received <= 0) {
+        close(c, true);
+        return;
+    }
+    c.reader.commitWrite(received);
+    if (measuring(at)) {
+        report.bytesReceived += received;
+    }
+
+    std::string_view payload;
+    while (c.isOpen() && c.reader.next(payload)) {
+        handle(c, payload, at);
+    }
+}
+
+/**
+ * Reacts to one message: timestamps snapshots, answers CONN_CHECK and acknowledges binary
+ * snapshots as the client does, and times ROLE and PONG.
+ * @param at when the data was read, microseconds.
+ */
+void LoadGenerator::Worker::handle(LoadConnection& c, std::string_view payload, uint64_t at) {
+    std::string_view cmd;
+    MessageArgs args;
+    bool snapshot = false;
+
+    if (isBinarySnapshot(payload)) {
+        Snapshot snap;
+        if (c.decoder.decode(payload, snap)) {
+            snapshot = true;
+            c.tick = c.haveSeq ? c.tick + (uint16_t)(snap.seq - c.lastSeq) : 0;
+            c.haveSeq = true;
+            c.lastSeq = snap.seq;
+            if (measuring(at)) {
+                c.arrivals.emplace_back(c.tick, at);
+            }
+            if (c.decoder.shouldAck(snap.seq)) {
+                ClientCommand ack{ CommandId::ACK, snap.seq, 0 };
+                send(c, &ack, 1, at);
+            }
+        }
+    }
+    else if (!parseMessage(payload, cmd, args)) {
+        return;
+    }
+    else if (cmd == "GAME_DATA") {
+        snapshot = true;
+    }
+    else if (cmd == "ROLE") {
+        if (!c.gotRole) {
+            c.gotRole = true;
+            report.roleTime.add(at - c.connectStart);
+        }
+    }
+    else if (cmd == "CONN_CHECK") {
+        ClientCommand confirm{ CommandId::CONFIRM, 0, 0 };
+        send(c, &confirm, 1, at);
+    }
+    else if (cmd == "PONG") {
+        int id;
+        if (c.pingSentAt != 0 && !args.empty() && toInt(args[0], id) && (uint32_t)id == c.pingId) {
+            report.pingRtt.add(at - c.pingSentAt);
+            c.pingSentAt = 0;
+        }
+    }
+
+    if (snapshot && measuring(at)) {
+        if (measuring(c.lastSnapshot)) {
+            report.interArrival.add(at - c.lastSnapshot);
+        }
+        c.measuredSnapshots++;
+        report.snapshots++;
+    }
+    if (snapshot) {
+        c.lastSnapshot = at;
+    }
+}
+
+/**
+ * Sends commands as one CLIENT_DATA message.
+ */
+void LoadGenerator::Worker::send(LoadConnection& c, const ClientCommand* commands, size_t count, uint64_t at) {
+    message = "CLIENT_DATA";
+    for (size_t i = 0; i < count; i++) {
+        appendCommand(message, commands[i]);
+    }
+    if (c.udp) {
+        c.udp->sendCommands(commands, count);
+        if (measuring(at)) {
+            report.bytesSent += UDP_HEADER_SIZE + message.size();
+        }
+        return;
+    }
+    char frame[FRAME_HEADER_SIZE + 256];
+    size_t length = encodeFrame(frame, sizeof(frame), message);
+    if (length == 0) {
+        return;
+    }
+    if (SDLNet_TCP_Send(c.socket, frame, (int)length) < (int)length) {
+        close(c, true);
+        return;
+    }
+    if (measuring(at)) {
+        report.bytesSent += length;
+    }
+}
+
+/**
+ * Presses or releases W or S, the way a player does, with the next input sequence number.
+ */
+void LoadGenerator::Worker::sendInput(LoadConnection& c, uint64_t at) {
+    ClientCommand key{ CommandId::W_UP, ++c.inputSeq, 0 };
+    if (c.heldKey == 0) {
+        c.heldKey = (random.next() & 1) ? 1 : 2;
+        key.id = c.heldKey == 1 ? CommandId::W_DOWN : CommandId::S_DOWN;
+    }
+    else {
+        key.id = c.heldKey == 1 ? CommandId::W_UP : CommandId::S_UP;
+        c.heldKey = 0;
+    }
+    float gap = 1000000.0f / config->inputRate;
+    c.nextInput = at + (uint64_t)(gap * (0.5f + random.unit()));
+    send(c, &key, 1, at);
+}
+
+/**
+ * Thread body for one worker: opens its connections on schedule, then serves them until stopped.
+ */
+int LoadGenerator::runWorker(void* data) {
+    Worker& w = *(Worker*)data;
+    size_t open = 0;
+
+    while (!w.stop->load()) {
+        uint64_t now = nowUs();
+        while (open < w.connections.size() && w.connections[open].openAt <= now) {
+            w.open(w.connections[open++]);
+        }
+
+        bool anyOpen = false;
+        for (LoadConnection& c : w.connections) {
+            anyOpen = anyOpen || c.isOpen();
+        }
+        if (!anyOpen) {
+            SDL_Delay(1);
+            continue;
+        }
+
+        if (SDLNet_CheckSockets(w.socketSet, 1) > 0) {
+            for (LoadConnection& c : w.connections) {
+                if ((c.socket != nullptr && SDLNet_SocketReady(c.socket)) || (c.udp && SDLNet_SocketReady(c.udp->getSocket()))) {
+                    w.receive(c);
+                }
+            }
+        }
+
+        now = nowUs();
+        for (LoadConnection& c : w.connections) {
+            if (!c.isOpen()) {
+                continue;
+            }
+            if (c.udp) {
+                c.udp->pump(); //retransmits and input repeats
+                if (c.udp->isSilent(UDP_SILENCE_MS)) {
+                    w.close(c, true);
+                    continue;
+                }
+            }
+            if (now >= c.nextInput) {
+                w.sendInput(c, now);
+            }
+            if (c.isOpen() && now >= c.nextPing && c.pingSentAt == 0) {
+                ClientCommand ping{ CommandId::PING, ++c.pingId, 0 };
+                c.pingSentAt = now;
+                c.nextPing = now + (uint64_t)(w.config->pingInterval * 1000000);
+                w.send(c, &ping, 1, now);
+            }
+        }
+    }
+
+    for (LoadConnection& c : w.connections) {
+        w.close(c, false);
+    }
+    return 0;
+}
+
+/**
+ * Connects every client, measures for the configured duration once all are connected, then
+ * disconnects them. SDL_net must be initialised.
+ * @param config the run to perform.
+ * @return the merged measurements; connected is 0 if the host could not be resolved.
+ */
+LoadReport LoadGenerator::run(const LoadConfig& config) {
+    LoadReport total;
+    total.clients = config.clients;
+    IPaddress address;
+    if (SDLNet_ResolveHost(&address, config.host.c_str(), config.port) == -1) {
+        printf("SDLNet_ResolveHost: %s\n", SDLNet_GetError());
+        return total;
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> settled(0);
+    std::atomic<uint64_t> measureStart(0);
+    int connectRate = config.connectRate > 0 ? config.connectRate : 1;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    uint64_t start = nowUs();
+    for (int first = 0; first < config.clients; first += GROUP_SIZE) {
+        std::unique_ptr<Worker> w(new Worker());
+        w->config = &config;
+        w->address = address;
+        w->stop = &stop;
+        w->settled = &settled;
+        w->measureStart = &measureStart;
+        w->random = FastRandom(0x9E3779B9u * (uint32_t)(first + 1));
+        int count = std::min((int)GROUP_SIZE, config.clients - first);
+        w->connections.resize(count);
+        for (int i = 0; i < count; i++) {
+            w->connections[i].openAt = start + (uint64_t)(first + i) * 1000000 / connectRate;
+        }
+        w->socketSet = SDLNet_AllocSocketSet(count);
+        workers.push_back(std::move(w));
+    }
+
+    std::vector<SDL_Thread*> threads;
+    for (auto& w : workers) {
+        threads.push_back(SDL_CreateThread(runWorker, "LoadWorker", w.get()));
+    }
+
+    //measure only once everyone is connected, so the numbers describe a steady match
+    uint64_t connectDeadline = start + (uint64_t)config.clients * 1000000 / connectRate + 10000000;
+    while (settled.load() < config.clients && nowUs() < connectDeadline) {
+        SDL_Delay(10);
+    }
+    uint64_t measured = nowUs();
+    measureStart = measured;
+    SDL_Delay((Uint32)(config.duration * 1000));
+    total.seconds = (nowUs() - measured) / 1000000.0;
+    stop = true;
+    for (SDL_Thread* thread : threads) {
+        SDL_WaitThread(thread, nullptr);
+    }
+
+    total.minClientRate = -1;
+    for (auto& w : workers) {
+        const LoadReport& r = w->report;
+        total.connected += r.connected;
+        total.connectFailures += r.connectFailures;
+        total.closedEarly += r.closedEarly;
+        total.snapshots += r.snapshots;
+        total.bytesReceived += r.bytesReceived;
+        total.bytesSent += r.bytesSent;
+        total.interArrival.merge(r.interArrival);
+        total.connectTime.merge(r.connectTime);
+        total.roleTime.merge(r.roleTime);
+        total.pingRtt.merge(r.pingRtt);
+        for (const LoadConnection& c : w->connections) {
+            if (!c.connected) {
+                continue;
+            }
+            addSnapshotDelays(c, total.snapshotDelay);
+            double rate = total.seconds > 0 ? c.measuredSnapshots / total.seconds : 0;
+            if (total.minClientRate < 0 || rate < total.minClientRate) {
+                total.minClientRate = rate;
+            }
+        }
+        SDLNet_FreeSocketSet(w->socketSet);
+    }
+    if (total.minClientRate < 0) {
+        total.minClientRate = 0;
+    }
+    return total;
+}
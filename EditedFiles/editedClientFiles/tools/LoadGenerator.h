@@ -0,0 +1,66 @@
+#ifndef __LOAD_GENERATOR_H__
+#define __LOAD_GENERATOR_H__
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "SDL_net.h"
+
+#include "Histogram.h"
+
+//Settings for one load run.
+struct LoadConfig {
+    std::string host = "localhost";
+    Uint16 port = 55555;
+    int clients = 100; //concurrent connections
+    float duration = 20; //seconds measured after the last client has connected
+    int connectRate = 200; //most new connections opened per second
+    int tickRate = 60; //snapshots per second the server is expected to send
+    float inputRate = 4; //key presses and releases each client sends per second, with sequence numbers
+    float pingInterval = 1; //seconds between PINGs on each connection, 0 for none
+    bool binaryWire = false; //ask for binary snapshots, acknowledging them as the client does
+    bool udp = false; //connect with the UDP transport instead of TCP
+};
+
+//Results of one load run, summed over all connections.
+struct LoadReport {
+    int clients = 0;
+    int connected = 0;
+    int connectFailures = 0;
+    int closedEarly = 0; //connections the server closed during the run
+    double seconds = 0; //length of the measured period
+    uint64_t snapshots = 0; //GAME_DATA or binary snapshots received in the measured period
+    uint64_t bytesReceived = 0;
+    uint64_t bytesSent = 0;
+    double minClientRate = 0; //snapshots per second of the worst served connection
+    Histogram interArrival; //time between consecutive snapshots on a connection
+    Histogram connectTime; //SDLNet_TCP_Open returning
+    Histogram roleTime; //connect started to ROLE received
+    Histogram pingRtt; //PING sent to PONG received
+    Histogram snapshotDelay; //binary snapshots only: arrival after the earliest any arrived relative to its tick
+
+    //Snapshots received as a fraction of those the tick rate promised.
+    double deliveryRatio(int tickRate) const {
+        double expected = seconds * tickRate * connected;
+        return expected > 0 ? snapshots / expected : 0;
+    }
+};
+
+//Opens many concurrent connections to a Pong server with the client's own framing, parsing and
+//snapshot decoding, sends CLIENT_DATA input streams and PINGs, and timestamps every snapshot.
+//Connections are split into groups of up to 64, each served by its own thread blocking on an
+//SDLNet_SocketSet, so arrival times are taken as soon as the data is readable.
+class LoadGenerator {
+    private:
+        static const int GROUP_SIZE = 64;
+
+        struct Worker;
+
+        static int runWorker(void* worker);
+
+    public:
+        LoadReport run(const LoadConfig& config);
+};
+
+#endif
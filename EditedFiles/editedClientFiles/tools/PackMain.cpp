@@ -0,0 +1,43 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "AssetBundle.h"
+
+/**
+ * Packs the client's assets into one bundle for --assets.
+ * pong_pack OUT [--root DIR] [NAME...]: names are relative to DIR, ../res/ by default, and
+ * default to every asset MyGame::setup requests.
+ */
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: pong_pack OUT [--root DIR] [NAME...]" << std::endl;
+        return 1;
+    }
+    std::string out = argv[1];
+    std::string root = "../res/";
+    std::vector<std::string> names;
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--root" && i + 1 < argc) {
+            root = argv[++i];
+            if (!root.empty() && root.back() != '/' && root.back() != '\\') {
+                root += '/';
+            }
+        }
+        else {
+            names.push_back(arg);
+        }
+    }
+    if (names.empty()) {
+        names = { "font/pong.ttf", "img/pBallv2.png", "img/pBat.png",
+            "sounds/hit_bat.wav", "sounds/hit_wall.wav", "sounds/click.wav" };
+    }
+
+    if (!writeAssetBundle(out, root, names)) {
+        return 2;
+    }
+    std::cout << "Packed " << names.size() << " files from " << root << " into " << out << std::endl;
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "PosixSocket.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * Opens a non-blocking listening socket on every interface.
+ * @param port the port to listen on.
+ * @param backlog most connections waiting to be accepted.
+ * @return the descriptor, or -1.
+ */
+int listenTcp(uint16_t port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        perror("socket");
+        return -1;
+    }
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&address, sizeof(address)) == -1 || listen(fd, backlog) == -1 || !setNonBlocking(fd)) {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Starts a non-blocking connect with TCP_NODELAY set, as SDLNet_TCP_Open does.
+ * @param host name or address to resolve.
+ * @param port the port to connect to.
+ * @param inProgress set true if the connect completes later; wait for writability, then check connectError().
+ * @return the descriptor, or -1.
+ */
+int connectTcp(const std::string& host, uint16_t port, bool& inProgress) {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0 || found == nullptr) {
+        fprintf(stderr, "Could not resolve %s\n", host.c_str());
+        return -1;
+    }
+
+    int fd = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+    if (fd == -1 || !setNonBlocking(fd)) {
+        perror("socket");
+        freeaddrinfo(found);
+        if (fd != -1) {
+            close(fd);
+        }
+        return -1;
+    }
+    setNoDelay(fd);
+    int result = connect(fd, found->ai_addr, found->ai_addrlen);
+    freeaddrinfo(found);
+    inProgress = result == -1 && errno == EINPROGRESS;
+    if (result == -1 && !inProgress) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Gets the result of a non-blocking connect once the socket is writable.
+ * @return 0 if connected, otherwise the errno value.
+ */
+int connectError(int fd) {
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == -1) {
+        return errno;
+    }
+    return error;
+}
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags != -1 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+void setNoDelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/**
+ * Shrinks or grows the kernel receive buffer, e.g. to make a subscriber fall behind quickly.
+ */
+void setReceiveBuffer(int fd, int bytes) {
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+}
+
+/**
+ * Raises the open file limit to the hard limit, since every connection is a descriptor.
+ * @return the limit now in force.
+ */
+long raiseFileLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        return -1;
+    }
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    getrlimit(RLIMIT_NOFILE, &limit);
+    return (long)limit.rlim_cur;
+}
+
+void closeSocket(int fd) {
+    if (fd != -1) {
+        close(fd);
+    }
+}
@@ -0,0 +1,19 @@
+#ifndef __POSIX_SOCKET_H__
+#define __POSIX_SOCKET_H__
+
+#include <cstdint>
+#include <string>
+
+//Thin helpers over BSD sockets for the Linux-only tools, which need non-blocking descriptors
+//for epoll rather than SDL_net's blocking sockets. Descriptors are -1 on failure.
+
+int listenTcp(uint16_t port, int backlog);
+int connectTcp(const std::string& host, uint16_t port, bool& inProgress);
+int connectError(int fd);
+bool setNonBlocking(int fd);
+void setNoDelay(int fd);
+void setReceiveBuffer(int fd, int bytes);
+long raiseFileLimit();
+void closeSocket(int fd);
+
+#endif
@@ -0,0 +1,214 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Framing.h"
+#include "PosixSocket.h"
+#include "SpectatorRelay.h"
+
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<bool> finished(false);
+static std::atomic<uint64_t> drained(0); //bytes read by the fast subscribers
+
+/**
+ * Plays the Pong server: accepts the relay and sends it GAME_DATA at the tick rate, plus a
+ * COUNT every second, so the relay sees the same traffic a spectator would.
+ */
+static void runUpstream(int listener, int tickRate) {
+    int fd = -1;
+    while (fd == -1 && !finished) {
+        pollfd waiting{ listener, POLLIN, 0 };
+        poll(&waiting, 1, 100);
+        fd = accept(listener, nullptr, nullptr);
+    }
+    if (fd == -1) {
+        return;
+    }
+    setNoDelay(fd);
+
+    char frame[FRAME_HEADER_SIZE + 128];
+    char payload[128];
+    char discard[1024];
+    auto period = std::chrono::nanoseconds(1000000000 / tickRate);
+    auto next = Clock::now();
+    for (uint32_t tick = 0; !finished; tick++) {
+        int length = snprintf(payload, sizeof(payload), "GAME_DATA,%d,%d,%d,%d,0WIN,%u,%u",
+            300 + (int)(tick % 200), 300 - (int)(tick % 200), 100 + (int)(tick % 600), 100 + (int)(tick % 400), tick, tick);
+        size_t size = encodeFrame(frame, sizeof(frame), std::string_view(payload, length));
+        send(fd, frame, size, MSG_NOSIGNAL);
+        if (tick % tickRate == 0) {
+            size = encodeFrame(frame, sizeof(frame), "COUNT,3");
+            send(fd, frame, size, MSG_NOSIGNAL);
+        }
+        while (recv(fd, discard, sizeof(discard), MSG_DONTWAIT) > 0) {} //CONFIRMs from the relay
+
+        next += period;
+        std::this_thread::sleep_until(next);
+    }
+    close(fd);
+}
+
+/**
+ * Reads and discards everything the fast subscribers receive, as real spectators would.
+ */
+static void runDrain(int epollFd) {
+    epoll_event events[256];
+    static char buffer[65536];
+    while (!finished) {
+        int count = epoll_wait(epollFd, events, 256, 100);
+        for (int i = 0; i < count; i++) {
+            ssize_t received;
+            while ((received = recv(events[i].data.fd, buffer, sizeof(buffer), 0)) > 0) {
+                drained += (uint64_t)received;
+            }
+        }
+    }
+}
+
+/**
+ * Opens spectator connections to the relay.
+ * @param epollFd drain set to add them to, or -1 for subscribers that never read.
+ */
+static bool addSubscribers(std::vector<int>& sockets, int count, uint16_t port, int epollFd) {
+    for (int i = 0; i < count; i++) {
+        bool inProgress;
+        int fd = connectTcp("127.0.0.1", port, inProgress);
+        if (fd == -1) {
+            perror("connect");
+            return false;
+        }
+        if (epollFd == -1) {
+            setReceiveBuffer(fd, 4096);
+        }
+        else {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+        }
+        sockets.push_back(fd);
+    }
+    return true;
+}
+
+/**
+ * Measures relay CPU against subscriber count on loopback. The benchmark plays the server and
+ * every spectator in one process; only the relay thread's CPU time is reported, but all threads
+ * share the machine, so use a host with spare cores for numbers near production.
+ * --subscribers a,b,c counts to step through, --tick-rate N, --seconds S measured per step,
+ * --slow N extra subscribers that never read, to exercise drop-to-latest, --queue N.
+ */
+int main(int argc, char** argv) {
+    std::vector<int> steps = { 100, 500, 1000, 2000, 4000, 8000 };
+    int tickRate = 60;
+    double seconds = 3;
+    int slow = 0;
+    RelayConfig config;
+    config.upstreamHost = "127.0.0.1";
+    config.upstreamPort = 56100;
+    config.port = 56101;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--subscribers" && hasValue) {
+            steps.clear();
+            std::string list = argv[++i];
+            for (size_t start = 0; start < list.size();) {
+                size_t comma = list.find(',', start);
+                steps.push_back(std::stoi(list.substr(start, comma - start)));
+                start = comma == std::string::npos ? list.size() : comma + 1;
+            }
+        }
+        else if (arg == "--tick-rate" && hasValue) {
+            tickRate = std::stoi(argv[++i]);
+        }
+        else if (arg == "--seconds" && hasValue) {
+            seconds = std::stod(argv[++i]);
+        }
+        else if (arg == "--slow" && hasValue) {
+            slow = std::stoi(argv[++i]);
+        }
+        else if (arg == "--queue" && hasValue) {
+            config.queueLimit = (size_t)std::stoi(argv[++i]);
+        }
+        else {
+            printf("Unknown option: %s\n", arg.c_str());
+            return 1;
+        }
+    }
+
+    long fileLimit = raiseFileLimit();
+    int upstreamListener = listenTcp(config.upstreamPort, 4);
+    SpectatorRelay relay;
+    if (upstreamListener == -1 || !relay.start(config)) {
+        return 3;
+    }
+    std::thread upstream(runUpstream, upstreamListener, tickRate);
+    std::thread relayThread([&relay] { relay.run(); });
+    int drainFd = epoll_create1(0);
+    std::thread drain(runDrain, drainFd);
+
+    std::vector<int> sockets;
+    if (!addSubscribers(sockets, slow, config.port, -1)) {
+        return 4;
+    }
+
+    printf("Relay fan-out at %d Hz, %d slow subscribers, queue %zu, open file limit %ld\n", tickRate, slow, config.queueLimit, fileLimit);
+    printf("%11s %10s %13s %9s %9s %12s %13s %10s %9s %10s\n", "subscribers", "frames/s", "deliveries/s",
+        "MB/s out", "relay CPU", "us/frame", "ns/delivery", "writev/s", "dropped", "MB/s read");
+
+    for (int target : steps) {
+        int fast = (int)sockets.size() - slow;
+        if ((long)(target + slow) * 2 + 16 > fileLimit) {
+            printf("%11d skipped, needs more than the open file limit\n", target);
+            continue;
+        }
+        if (target > fast && !addSubscribers(sockets, target - fast, config.port, drainFd)) {
+            break;
+        }
+        auto deadline = Clock::now() + std::chrono::seconds(10);
+        while ((int)relay.getStats().subscribers < target + slow && Clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(500)); //let the greeting burst settle
+
+        RelayStats before = relay.getStats();
+        uint64_t drainedBefore = drained.load();
+        auto start = Clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        RelayStats after = relay.getStats();
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+        double frames = (double)(after.framesIn - before.framesIn);
+        double deliveries = (double)(after.deliveries - before.deliveries);
+        double cpu = (double)(after.cpuNanos - before.cpuNanos);
+        printf("%11llu %10.1f %13.0f %9.2f %8.1f%% %12.1f %13.1f %10.0f %9llu %10.2f\n",
+            (unsigned long long)after.subscribers, frames / elapsed, deliveries / elapsed,
+            (after.bytesOut - before.bytesOut) / elapsed / 1e6, cpu / elapsed / 1e7,
+            frames > 0 ? cpu / frames / 1000 : 0, deliveries > 0 ? cpu / deliveries : 0,
+            (after.writeCalls - before.writeCalls) / elapsed, (unsigned long long)(after.dropped - before.dropped),
+            (drained.load() - drainedBefore) / elapsed / 1e6);
+    }
+
+    finished = true;
+    relay.stop();
+    relayThread.join();
+    upstream.join();
+    drain.join();
+    for (int fd : sockets) {
+        close(fd);
+    }
+    close(drainFd);
+    close(upstreamListener);
+    return 0;
+}
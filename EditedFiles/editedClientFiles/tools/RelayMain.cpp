@@ -0,0 +1,76 @@
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "PosixSocket.h"
+#include "SpectatorRelay.h"
+
+static SpectatorRelay relay;
+
+static void onSignal(int) {
+    relay.stop();
+}
+
+/**
+ * Runs the spectator relay until interrupted, printing its counters every few seconds.
+ * --port N where spectators connect, --upstream-host NAME, --upstream-port N for the server,
+ * --queue N frames per subscriber before snapshots are dropped, --stats S between reports.
+ */
+int main(int argc, char** argv) {
+    RelayConfig config;
+    int statsInterval = 5;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue) {
+            config.port = (uint16_t)std::stoi(argv[++i]);
+        }
+        else if (arg == "--upstream-host" && hasValue) {
+            config.upstreamHost = argv[++i];
+        }
+        else if (arg == "--upstream-port" && hasValue) {
+            config.upstreamPort = (uint16_t)std::stoi(argv[++i]);
+        }
+        else if (arg == "--queue" && hasValue) {
+            config.queueLimit = (size_t)std::stoi(argv[++i]);
+        }
+        else if (arg == "--stats" && hasValue) {
+            statsInterval = std::stoi(argv[++i]);
+        }
+        else {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Open file limit " << raiseFileLimit() << std::endl;
+    if (!relay.start(config)) {
+        return 3;
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::cout << "Relaying " << config.upstreamHost << ":" << config.upstreamPort << " to spectators on port " << config.port << std::endl;
+
+    std::thread reporter([statsInterval] {
+        RelayStats last = relay.getStats();
+        while (true) {
+            std::this_thread::sleep_for(std::chrono::seconds(statsInterval));
+            RelayStats now = relay.getStats();
+            double seconds = statsInterval;
+            printf("%llu subscribers, %.1f frames/s in, %.0f deliveries/s, %.1f KB/s out, %llu dropped, CPU %.1f%%\n",
+                (unsigned long long)now.subscribers, (now.framesIn - last.framesIn) / seconds,
+                (now.deliveries - last.deliveries) / seconds, (now.bytesOut - last.bytesOut) / seconds / 1024,
+                (unsigned long long)(now.dropped - last.dropped), (now.cpuNanos - last.cpuNanos) / seconds / 1e7);
+            fflush(stdout);
+            last = now;
+        }
+    });
+    reporter.detach();
+
+    relay.run();
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include "SpectatorRelay.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "Message.h"
+#include "PosixSocket.h"
+
+static const int MAX_EVENTS = 256;
+static const int MAX_IOVECS = 64;
+
+static uint64_t nowMs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t threadCpuNanos() {
+    timespec t;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+SpectatorRelay::SpectatorRelay() : running(false) {
+    for (auto& value : published) {
+        value = 0;
+    }
+    roleFrame = makeFrame("ROLE,3", false);
+}
+
+SpectatorRelay::~SpectatorRelay() {
+    for (auto& s : subscribers) {
+        closeSocket(s->fd);
+    }
+    closeSocket(upstream.fd);
+    closeSocket(listener);
+    closeSocket(epollFd);
+}
+
+/**
+ * Frames a payload once so it can be queued to any number of subscribers.
+ */
+std::shared_ptr<const RelayFrame> SpectatorRelay::makeFrame(std::string_view payload, bool snapshot) {
+    auto frame = std::make_shared<RelayFrame>();
+    frame->bytes.resize(FRAME_HEADER_SIZE + payload.size());
+    encodeFrame(&frame->bytes[0], frame->bytes.size(), payload);
+    frame->snapshot = snapshot;
+    return frame;
+}
+
+/**
+ * Opens the spectator port and starts connecting to the server.
+ * @param settings ports, server address and queue limit to use.
+ * @return false if the port could not be opened.
+ */
+bool SpectatorRelay::start(const RelayConfig& settings) {
+    config = settings;
+    if (config.queueLimit < 1) {
+        config.queueLimit = 1;
+    }
+    epollFd = epoll_create1(0);
+    listener = listenTcp(config.port, 1024);
+    if (epollFd == -1 || listener == -1) {
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = this;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listener, &event);
+    connectUpstream(nowMs());
+    return true;
+}
+
+/**
+ * Serves the server connection and every subscriber until stop() is called.
+ */
+void SpectatorRelay::run() {
+    running = true;
+    epoll_event events[MAX_EVENTS];
+
+    while (running) {
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, 100); //wake regularly to notice stop() and retry the server
+        uint64_t now = nowMs();
+
+        for (int i = 0; i < count; i++) {
+            void* owner = events[i].data.ptr;
+            uint32_t flags = events[i].events;
+            if (owner == this) {
+                accept();
+            }
+            else if (owner == &upstream) {
+                if (upstream.connecting) {
+                    finishConnect();
+                }
+                else if (flags & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    readUpstream(now);
+                }
+            }
+            else {
+                Subscriber& s = *(Subscriber*)owner;
+                if (s.closed) {
+                    continue;
+                }
+                if (flags & (EPOLLERR | EPOLLHUP)) {
+                    close(s);
+                    continue;
+                }
+                if (flags & EPOLLIN) {
+                    readSubscriber(s);
+                }
+                if ((flags & EPOLLOUT) && !s.closed) {
+                    flush(s);
+                }
+            }
+        }
+
+        if (upstream.fd == -1 && now >= upstream.retryAt) {
+            connectUpstream(now);
+        }
+        removeClosed();
+        publish();
+    }
+}
+
+void SpectatorRelay::stop() {
+    running = false;
+}
+
+/**
+ * Starts a non-blocking connect to the server. Failures are retried after reconnectDelay.
+ */
+void SpectatorRelay::connectUpstream(uint64_t now) {
+    upstream.fd = connectTcp(config.upstreamHost, config.upstreamPort, upstream.connecting);
+    if (upstream.fd == -1) {
+        upstream.retryAt = now + config.reconnectDelay;
+        return;
+    }
+    upstream.reader = FrameReader();
+    epoll_event event{};
+    event.events = upstream.connecting ? EPOLLOUT : EPOLLIN;
+    event.data.ptr = &upstream;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, upstream.fd, &event);
+}
+
+void SpectatorRelay::finishConnect() {
+    int error = connectError(upstream.fd);
+    if (error != 0) {
+        fprintf(stderr, "Could not reach %s:%d: %s\n", config.upstreamHost.c_str(), config.upstreamPort, strerror(error));
+        dropUpstream(nowMs());
+        return;
+    }
+    upstream.connecting = false;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = &upstream;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, upstream.fd, &event);
+    printf("Connected to %s:%d\n", config.upstreamHost.c_str(), config.upstreamPort);
+}
+
+/**
+ * Closes the server connection and schedules a reconnect. Subscribers stay connected and
+ * simply receive nothing until the server is back.
+ */
+void SpectatorRelay::dropUpstream(uint64_t now) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, upstream.fd, nullptr);
+    closeSocket(upstream.fd);
+    upstream.fd = -1;
+    upstream.connecting = false;
+    upstream.retryAt = now + config.reconnectDelay;
+}
+
+/**
+ * Reads everything the server has sent, then fans the frames out. Reading first means a
+ * subscriber gets a whole burst in one writev rather than one write per frame.
+ */
+void SpectatorRelay::readUpstream(uint64_t now) {
+    batch.clear();
+    while (true) {
+        size_t writable;
+        char* buffer = upstream.reader.prepareWrite(16384, writable);
+        ssize_t received = recv(upstream.fd, buffer, writable, 0);
+        if (received > 0) {
+            upstream.reader.commitWrite((size_t)received);
+            stats.bytesIn += (uint64_t)received;
+            if ((size_t)received < writable) {
+                break;
+            }
+            continue;
+        }
+        if (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        if (received == -1 && errno == EINTR) {
+            continue;
+        }
+        printf("Lost the server connection\n");
+        dropUpstream(now);
+        break;
+    }
+
+    std::string_view payload, cmd;
+    MessageArgs args;
+    while (upstream.fd != -1 && upstream.reader.next(payload)) {
+        stats.framesIn++;
+        if (!parseMessage(payload, cmd, args)) {
+            continue;
+        }
+        if (cmd == "CONN_CHECK") {
+            sendUpstream("CLIENT_DATA,CONFIRM");
+        }
+        else if (cmd == "ROLE" || cmd == "WIRE" || cmd == "PONG") {
+            continue; //meant for the relay itself, subscribers get their own ROLE,3
+        }
+        else {
+            bool snapshot = cmd == "GAME_DATA";
+            batch.push_back(makeFrame(payload, snapshot));
+            if (snapshot) {
+                latestSnapshot = batch.back();
+            }
+        }
+    }
+
+    if (batch.empty()) {
+        return;
+    }
+    for (auto& s : subscribers) {
+        if (s->closed) {
+            continue;
+        }
+        for (auto& frame : batch) {
+            enqueue(*s, frame);
+        }
+        if (!s->writeArmed) { //otherwise EPOLLOUT will flush it
+            flush(*s);
+        }
+    }
+    batch.clear();
+}
+
+/**
+ * Sends a short reply to the server. Replies are tiny, so a full send buffer is treated as a
+ * lost connection rather than queued.
+ */
+void SpectatorRelay::sendUpstream(std::string_view payload) {
+    char frame[FRAME_HEADER_SIZE + 64];
+    size_t length = encodeFrame(frame, sizeof(frame), payload);
+    if (length > 0 && send(upstream.fd, frame, length, MSG_NOSIGNAL) != (ssize_t)length) {
+        dropUpstream(nowMs());
+    }
+}
+
+/**
+ * Accepts every waiting spectator, greeting each with ROLE,3 and the latest snapshot.
+ */
+void SpectatorRelay::accept() {
+    while (true) {
+        int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd == -1) {
+            if (errno == EMFILE || errno == ENFILE) {
+                perror("accept");
+            }
+            return;
+        }
+        setNoDelay(fd);
+
+        std::unique_ptr<Subscriber> s(new Subscriber());
+        s->fd = fd;
+        s->index = subscribers.size();
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.ptr = s.get();
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+
+        enqueue(*s, roleFrame);
+        if (latestSnapshot) {
+            enqueue(*s, latestSnapshot);
+        }
+        subscribers.push_back(std::move(s));
+        flush(*subscribers.back());
+    }
+}
+
+/**
+ * Reads what a subscriber sent. Only CON_CLOSE and PING mean anything to the relay; input and
+ * TAKE_OVER are not forwarded, since the relay joined as a spectator.
+ */
+void SpectatorRelay::readSubscriber(Subscriber& s) {
+    size_t writable;
+    char* buffer = s.reader.prepareWrite(1024, writable);
+    ssize_t received = recv(s.fd, buffer, writable, 0);
+    if (received == 0 || (received == -1 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        close(s);
+        return;
+    }
+    if (received < 0) {
+        return;
+    }
+    s.reader.commitWrite((size_t)received);
+
+    std::string_view payload, cmd;
+    MessageArgs args;
+    while (s.reader.next(payload)) {
+        if (!parseMessage(payload, cmd, args) || cmd != "CLIENT_DATA") {
+            continue;
+        }
+        for (size_t i = 0; i < args.size(); i++) {
+            if (args[i] == "CON_CLOSE") {
+                close(s);
+                return;
+            }
+            if (args[i] == "PING" && i + 1 < args.size()) {
+                message = "PONG,";
+                message += args[++i];
+                enqueue(s, makeFrame(message, false));
+            }
+        }
+    }
+    if (!s.queue.empty() && !s.writeArmed) {
+        flush(s);
+    }
+}
+
+/**
+ * Queues a frame for a subscriber. When the queue is full, snapshots it has not started
+ * receiving are dropped first, since the newest snapshot replaces them; if it is still full,
+ * the oldest unstarted frames go. A partly written frame is never dropped, it would corrupt the
+ * stream.
+ */
+void SpectatorRelay::enqueue(Subscriber& s, const std::shared_ptr<const RelayFrame>& frame) {
+    if (s.queue.size() >= config.queueLimit) {
+        auto unstarted = s.queue.begin() + (s.sentOffset > 0 ? 1 : 0);
+        if (frame->snapshot) {
+            auto kept = std::remove_if(unstarted, s.queue.end(),
+                [](const std::shared_ptr<const RelayFrame>& queued) { return queued->snapshot; });
+            stats.dropped += (uint64_t)(s.queue.end() - kept);
+            s.queue.erase(kept, s.queue.end());
+        }
+        while (s.queue.size() >= config.queueLimit) {
+            unstarted = s.queue.begin() + (s.sentOffset > 0 ? 1 : 0);
+            if (unstarted == s.queue.end()) {
+                break;
+            }
+            s.queue.erase(unstarted);
+            stats.dropped++;
+        }
+    }
+    s.queue.push_back(frame);
+    stats.deliveries++;
+}
+
+/**
+ * Writes as much of a subscriber's queue as the socket takes, in one writev. Whatever is left
+ * waits for EPOLLOUT.
+ */
+void SpectatorRelay::flush(Subscriber& s) {
+    while (!s.queue.empty()) {
+        iovec parts[MAX_IOVECS];
+        int count = 0;
+        for (auto& frame : s.queue) {
+            if (count == MAX_IOVECS) {
+                break;
+            }
+            size_t skip = count == 0 ? s.sentOffset : 0;
+            parts[count].iov_base = (void*)(frame->bytes.data() + skip);
+            parts[count].iov_len = frame->bytes.size() - skip;
+            count++;
+        }
+
+        ssize_t written = writev(s.fd, parts, count);
+        stats.writeCalls++;
+        if (written == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno != EINTR) {
+                close(s);
+                return;
+            }
+            continue;
+        }
+        stats.bytesOut += (uint64_t)written;
+
+        size_t remaining = (size_t)written;
+        while (remaining > 0) {
+            size_t left = s.queue.front()->bytes.size() - s.sentOffset;
+            if (remaining < left) {
+                s.sentOffset += remaining;
+                break;
+            }
+            remaining -= left;
+            s.queue.pop_front();
+            s.sentOffset = 0;
+        }
+        if (s.sentOffset > 0) {
+            break; //the socket buffer is full
+        }
+    }
+
+    bool wantWrite = !s.queue.empty();
+    if (wantWrite != s.writeArmed) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | (wantWrite ? (uint32_t)EPOLLOUT : 0u);
+        event.data.ptr = &s;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, s.fd, &event);
+        s.writeArmed = wantWrite;
+    }
+}
+
+/**
+ * Marks a subscriber for removal once the current events have been handled, since pointers to
+ * it may still be waiting in the event list.
+ */
+void SpectatorRelay::close(Subscriber& s) {
+    if (s.closed) {
+        return;
+    }
+    s.closed = true;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, s.fd, nullptr);
+    closeSocket(s.fd);
+    s.fd = -1;
+    closing.push_back(&s);
+}
+
+/**
+ * Removes closed subscribers by swapping the last one into their place.
+ */
+void SpectatorRelay::removeClosed() {
+    for (Subscriber* s : closing) {
+        size_t index = s->index;
+        if (index != subscribers.size() - 1) {
+            std::swap(subscribers[index], subscribers.back());
+            subscribers[index]->index = index;
+        }
+        subscribers.pop_back();
+    }
+    closing.clear();
+}
+
+/**
+ * Copies the counters where other threads can read them.
+ */
+void SpectatorRelay::publish() {
+    stats.subscribers = subscribers.size();
+    stats.cpuNanos = threadCpuNanos();
+    const uint64_t values[8] = { stats.subscribers, stats.framesIn, stats.bytesIn, stats.deliveries,
+        stats.bytesOut, stats.writeCalls, stats.dropped, stats.cpuNanos };
+    for (int i = 0; i < 8; i++) {
+        published[i].store(values[i], std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Gets the counters as of the relay thread's last loop. Safe from any thread.
+ */
+RelayStats SpectatorRelay::getStats() const {
+    RelayStats current;
+    current.subscribers = published[0].load(std::memory_order_relaxed);
+    current.framesIn = published[1].load(std::memory_order_relaxed);
+    current.bytesIn = published[2].load(std::memory_order_relaxed);
+    current.deliveries = published[3].load(std::memory_order_relaxed);
+    current.bytesOut = published[4].load(std::memory_order_relaxed);
+    current.writeCalls = published[5].load(std::memory_order_relaxed);
+    current.dropped = published[6].load(std::memory_order_relaxed);
+    current.cpuNanos = published[7].load(std::memory_order_relaxed);
+    return current;
+}
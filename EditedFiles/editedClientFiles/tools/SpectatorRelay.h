@@ -0,0 +1,108 @@
+#ifndef __SPECTATOR_RELAY_H__
+#define __SPECTATOR_RELAY_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Framing.h"
+
+//Settings for the relay.
+struct RelayConfig {
+    std::string upstreamHost = "localhost";
+    uint16_t upstreamPort = 55555;
+    uint16_t port = 55556; //where spectators connect
+    size_t queueLimit = 8; //frames a subscriber may have waiting before older snapshots are dropped
+    int reconnectDelay = 1000; //ms between attempts to reach the server
+};
+
+//Counters since start(), published by the relay thread every loop so other threads can read them.
+struct RelayStats {
+    uint64_t subscribers = 0;
+    uint64_t framesIn = 0; //frames received from the server
+    uint64_t bytesIn = 0;
+    uint64_t deliveries = 0; //frames queued to subscribers, one per subscriber per frame
+    uint64_t bytesOut = 0;
+    uint64_t writeCalls = 0;
+    uint64_t dropped = 0; //frames discarded for slow subscribers
+    uint64_t cpuNanos = 0; //CPU time used by the relay thread
+};
+
+//One message from the server, framed once and shared by every subscriber queue that holds it.
+struct RelayFrame {
+    std::string bytes; //length header and payload, exactly as sent
+    bool snapshot = false; //GAME_DATA, superseded by any newer one
+};
+
+//Fans one spectator connection to the Pong server out to many spectator clients. The relay joins
+//the server like any client, is given ROLE,3, and forwards each GAME_DATA, COUNT and other game
+//message to every subscriber, writing the same encoded buffer to each. It answers CONN_CHECK
+//upstream and PING downstream itself. Subscribers that read too slowly keep a bounded queue:
+//once full, queued snapshots they have not started receiving are replaced by the newest one.
+//Single threaded on epoll with non-blocking sockets; Linux only.
+class SpectatorRelay {
+    private:
+        struct Subscriber {
+            int fd = -1;
+            size_t index = 0; //position in subscribers
+            FrameReader reader;
+            std::deque<std::shared_ptr<const RelayFrame>> queue;
+            size_t sentOffset = 0; //bytes of queue.front() already written
+            bool writeArmed = false; //waiting for EPOLLOUT
+            bool closed = false;
+        };
+
+        struct Upstream {
+            int fd = -1;
+            bool connecting = false;
+            FrameReader reader;
+            uint64_t retryAt = 0; //ms, when to try connecting again
+        };
+
+        RelayConfig config;
+        int epollFd = -1;
+        int listener = -1;
+        Upstream upstream;
+        std::vector<std::unique_ptr<Subscriber>> subscribers;
+        std::vector<Subscriber*> closing;
+
+        std::shared_ptr<const RelayFrame> roleFrame; //ROLE,3, sent to each new subscriber
+        std::shared_ptr<const RelayFrame> latestSnapshot; //so new subscribers see the match at once
+        std::vector<std::shared_ptr<const RelayFrame>> batch; //frames read from upstream this wakeup
+        std::string message; //reused for replies
+
+        RelayStats stats;
+        std::atomic<bool> running;
+        std::atomic<uint64_t> published[8];
+
+        void connectUpstream(uint64_t now);
+        void finishConnect();
+        void dropUpstream(uint64_t now);
+        void readUpstream(uint64_t now);
+        void sendUpstream(std::string_view payload);
+        void accept();
+        void readSubscriber(Subscriber& s);
+        void enqueue(Subscriber& s, const std::shared_ptr<const RelayFrame>& frame);
+        void flush(Subscriber& s);
+        void close(Subscriber& s);
+        void removeClosed();
+        void publish();
+
+        static std::shared_ptr<const RelayFrame> makeFrame(std::string_view payload, bool snapshot);
+
+    public:
+        SpectatorRelay();
+        ~SpectatorRelay();
+
+        bool start(const RelayConfig& settings);
+        void run();
+        void stop();
+        RelayStats getStats() const;
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <string>
+
+#include "StandInServer.h"
+
+/**
+ * Runs the stand-in server until killed.
+ * --port N, --tick-rate N, --max-clients N, --autoplay
+ * --latency MS adds MS in each direction, e.g. to compare the client with and without --no-predict.
+ * --jitter MS adds up to MS more at random, --loss P loses P% of packets in each direction.
+ * --tcp-rto MS is how late a lost TCP segment, and everything behind it, arrives (default 200).
+ * --udp also serves the UDP transport on the same port.
+ * --check-interval MS sets the time between CONN_CHECKs.
+ */
+int main(int argc, char** argv) {
+    StandInConfig config;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--port" && hasValue) {
+            config.port = (Uint16)std::stoi(argv[++i]);
+        }
+        else if (arg == "--tick-rate" && hasValue) {
+            config.tickRate = std::stoi(argv[++i]);
+        }
+        else if (arg == "--max-clients" && hasValue) {
+            config.maxClients = std::stoi(argv[++i]);
+        }
+        else if (arg == "--latency" && hasValue) {
+            config.link.latency = std::stoi(argv[++i]);
+        }
+        else if (arg == "--jitter" && hasValue) {
+            config.link.jitter = std::stoi(argv[++i]);
+        }
+        else if (arg == "--loss" && hasValue) {
+            config.link.loss = std::stof(argv[++i]);
+        }
+        else if (arg == "--tcp-rto" && hasValue) {
+            config.link.tcpRto = std::stoi(argv[++i]);
+        }
+        else if (arg == "--udp") {
+            config.udp = true;
+        }
+        else if (arg == "--check-interval" && hasValue) {
+            config.checkInterval = (Uint32)std::stoi(argv[++i]);
+        }
+        else if (arg == "--autoplay") {
+            config.autoplay = true;
+        }
+        else {
+            std::cout << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (SDL_Init(0) == -1) {
+        std::cout << "SDL_Init: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    if (SDLNet_Init() == -1) {
+        std::cout << "SDLNet_Init: " << SDLNet_GetError() << std::endl;
+        return 2;
+    }
+
+    StandInServer server;
+    if (!server.start(config)) {
+        return 3;
+    }
+    std::cout << "Stand-in server listening on port " << config.port << std::endl;
+    server.run();
+
+    SDLNet_Quit();
+    SDL_Quit();
+    return 0;
+}
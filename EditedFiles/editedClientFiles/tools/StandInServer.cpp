@@ -0,0 +1,628 @@
+#include "StandInServer.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "ClientCommand.h"
+#include "PongRules.h"
+
+/**
+ * Microseconds for the UDP sessions' retransmission timers.
+ */
+static uint64_t nowMicros() {
+    return commandClock() / 1000;
+}
+
+/**
+ * Key for finding a UDP client by the address its datagrams come from.
+ */
+static uint64_t addressKey(const IPaddress& address) {
+    return ((uint64_t)address.host << 16) | address.port;
+}
+
+StandInServer::StandInServer() : running(false), bytesSent(0) {
+    resetMatch();
+}
+
+StandInServer::~StandInServer() {
+    for (auto& c : clients) {
+        if (c->socket != nullptr) {
+            SDLNet_TCP_Close(c->socket);
+        }
+    }
+    if (listener != nullptr) {
+        SDLNet_TCP_Close(listener);
+    }
+    if (udpSocket != nullptr) {
+        SDLNet_UDP_Close(udpSocket);
+    }
+    SDLNet_FreePacket(packet);
+    if (socketSet != nullptr) {
+        SDLNet_FreeSocketSet(socketSet);
+    }
+}
+
+/**
+ * Opens the listening socket. SDLNet_Init must already have been called.
+ * @param settings port, tick rate and behaviour to use.
+ * @return false if the port could not be opened.
+ */
+bool StandInServer::start(const StandInConfig& settings) {
+    config = settings;
+
+    IPaddress ip;
+    if (SDLNet_ResolveHost(&ip, nullptr, config.port) == -1) {
+        std::cout << "SDLNet_ResolveHost: " << SDLNet_GetError() << std::endl;
+        return false;
+    }
+    listener = SDLNet_TCP_Open(&ip);
+    if (!listener) {
+        std::cout << "SDLNet_TCP_Open: " << SDLNet_GetError() << std::endl;
+        return false;
+    }
+    socketSet = SDLNet_AllocSocketSet(config.maxClients + 2);
+    SDLNet_TCP_AddSocket(socketSet, listener);
+    if (config.udp) {
+        udpSocket = SDLNet_UDP_Open(config.port);
+        packet = SDLNet_AllocPacket((int)MAX_DATAGRAM);
+        if (!udpSocket || !packet) {
+            std::cout << "SDLNet_UDP_Open: " << SDLNet_GetError() << std::endl;
+            return false;
+        }
+        SDLNet_UDP_AddSocket(socketSet, udpSocket);
+    }
+    nextCheck = SDL_GetTicks() + config.checkInterval;
+    return true;
+}
+
+/**
+ * Serves clients until stop() is called, waiting on the sockets between ticks.
+ */
+void StandInServer::run() {
+    running = true;
+    const Uint32 tickMs = 1000 / config.tickRate;
+    Uint32 last = SDL_GetTicks();
+    Uint32 nextTick = last + tickMs;
+
+    while (running) {
+        Uint32 now = SDL_GetTicks();
+        Uint32 wait = nextTick > now ? nextTick - now : 0;
+        bool simulated = config.link.latency > 0 || config.link.jitter > 0 || config.link.loss > 0;
+        if (simulated && wait > 1) { //wake often enough to release delayed frames on time
+            wait = 1;
+        }
+        if (!udpClients.empty() && wait > 5) { //and to retransmit reliable UDP messages
+            wait = 5;
+        }
+
+        if (SDLNet_CheckSockets(socketSet, wait) > 0) {
+            if (SDLNet_SocketReady(listener)) {
+                accept();
+            }
+            if (udpSocket != nullptr && SDLNet_SocketReady(udpSocket)) {
+                receiveDatagrams();
+            }
+            for (auto& c : clients) {
+                if (!c->closed && !c->udp && SDLNet_SocketReady(c->socket)) {
+                    receive(*c);
+                }
+            }
+        }
+
+        now = SDL_GetTicks();
+        flushDelayed(now);
+        if (now >= nextTick) {
+            tick((now - last) / 1000.0f);
+            last = now;
+            nextTick += tickMs;
+            if (nextTick <= now) { //fell behind, don't try to catch up with a burst of ticks
+                nextTick = now + tickMs;
+            }
+        }
+        removeClosed();
+    }
+}
+
+/**
+ * Makes run() return after its current iteration. Safe to call from another thread.
+ */
+void StandInServer::stop() {
+    running = false;
+}
+
+void StandInServer::accept() {
+    TCPsocket socket = SDLNet_TCP_Accept(listener);
+    if (!socket) {
+        return;
+    }
+    if ((int)clients.size() >= config.maxClients) {
+        SDLNet_TCP_Close(socket);
+        return;
+    }
+    std::unique_ptr<Client> client(new Client(config.link, false, nextSeed++));
+    client->socket = socket;
+    SDLNet_TCP_AddSocket(socketSet, socket);
+    assignRole(*client, false);
+    clients.push_back(std::move(client));
+}
+
+/**
+ * Gives a client a free player slot, or makes it a spectator, and tells it which.
+ * @param client the client to assign.
+ * @param takeOver true if a spectator asked to take over, in which case nothing changes unless a slot is free.
+ */
+void StandInServer::assignRole(Client& client, bool takeOver) {
+    for (int i = 0; i < 2; i++) {
+        if (players[i] == nullptr) {
+            players[i] = &client;
+            client.role = i + 1;
+            sendTo(client, i == 0 ? "ROLE,1" : "ROLE,2");
+            return;
+        }
+    }
+    if (!takeOver) {
+        client.role = 3;
+        sendTo(client, "ROLE,3");
+    }
+}
+
+void StandInServer::receive(Client& client) {
+    size_t writable;
+    char* buffer = client.reader.prepareWrite(1024, writable);
+    int received = SDLNet_TCP_Recv(client.socket, buffer, (int)writable);
+    if (received <= 0) {
+        client.closed = true;
+        return;
+    }
+    client.reader.commitWrite(received);
+
+    std::string_view payload;
+    while (client.reader.next(payload)) {
+        if (client.inbound.isActive()) {
+            client.inbound.push(payload, SDL_GetTicks());
+        }
+        else {
+            handleMessage(client, payload);
+        }
+    }
+}
+
+/**
+ * Reads every waiting datagram. The first datagram from an address is a new client, which is
+ * given a role just as an accepted TCP connection is.
+ */
+void StandInServer::receiveDatagrams() {
+    while (SDLNet_UDP_Recv(udpSocket, packet) > 0) {
+        uint64_t key = addressKey(packet->address);
+        auto found = udpClients.find(key);
+        Client* client;
+        if (found != udpClients.end()) {
+            client = found->second;
+        }
+        else {
+            if ((int)clients.size() >= config.maxClients || !UdpSession::opensSession((const char*)packet->data, (size_t)packet->len)) {
+                continue;
+            }
+            std::unique_ptr<Client> created(new Client(config.link, true, nextSeed++));
+            created->address = packet->address;
+            client = created.get();
+            udpClients[key] = client;
+            clients.push_back(std::move(created));
+            assignRole(*client, false);
+        }
+        if (client->closed) {
+            continue;
+        }
+
+        std::string_view datagram((const char*)packet->data, (size_t)packet->len);
+        if (client->inbound.isActive()) {
+            client->inbound.push(datagram, SDL_GetTicks());
+        }
+        else {
+            handleDatagram(*client, datagram);
+        }
+    }
+}
+
+/**
+ * Passes a datagram through the client's session and handles the messages it releases.
+ */
+void StandInServer::handleDatagram(Client& client, std::string_view datagram) {
+    delivered.clear();
+    client.session.receive(datagram.data(), datagram.size(), nowMicros(), delivered);
+    for (const std::string& message : delivered) {
+        if (client.closed) {
+            break;
+        }
+        handleMessage(client, message);
+    }
+    pumpSession(client); //acknowledge now rather than on the next reply
+}
+
+void StandInServer::handleMessage(Client& client, std::string_view payload) {
+    std::string_view cmd;
+    MessageArgs tokens;
+    if (parseMessage(payload, cmd, tokens) && cmd == "CLIENT_DATA") {
+        for (size_t i = 0; i < tokens.size(); i++) {
+            handleToken(client, tokens, i);
+        }
+    }
+}
+
+/**
+ * Handles received messages and writes frames whose simulated latency has passed.
+ * @param now current SDL_GetTicks().
+ */
+void StandInServer::flushDelayed(Uint32 now) {
+    std::string bytes;
+    for (auto& c : clients) {
+        while (!c->closed && c->inbound.pop(now, bytes)) {
+            if (c->udp) {
+                handleDatagram(*c, bytes);
+            }
+            else {
+                handleMessage(*c, bytes);
+            }
+        }
+        while (!c->closed && c->outbound.pop(now, bytes)) {
+            write(*c, bytes.data(), bytes.size());
+        }
+        if (c->udp && !c->closed) {
+            pumpSession(*c);
+        }
+    }
+}
+
+/**
+ * Sends a UDP client's new and timed out reliable messages and any owed acknowledgement.
+ * A session that has given up is closed, as a TCP client would be when its socket fails.
+ */
+void StandInServer::pumpSession(Client& client) {
+    char datagram[MAX_DATAGRAM];
+    size_t length;
+    while ((length = client.session.nextOutgoing(nowMicros(), datagram, sizeof(datagram))) > 0) {
+        transmit(client, datagram, length);
+    }
+    if (client.session.hasFailed()) {
+        client.closed = true;
+    }
+}
+
+/**
+ * Reacts to one token of a CLIENT_DATA message, the same way PongApp.onReceive does.
+ * @param client the client that sent it.
+ * @param tokens every token of the message.
+ * @param i index of the token to handle, advanced past any argument it consumes.
+ */
+void StandInServer::handleToken(Client& client, const MessageArgs& tokens, size_t& i) {
+    std::string_view token = tokens[i];
+    bool player = client.role == 1 || client.role == 2;
+
+    //key tokens are followed by their input sequence number
+    bool key = token == "W_DOWN" || token == "W_UP" || token == "S_DOWN" || token == "S_UP";
+    int seq;
+    if (key && i + 1 < tokens.size() && toInt(tokens[i + 1], seq)) {
+        i++;
+        if (player) {
+            client.inputSeq = (uint16_t)seq;
+        }
+    }
+
+    if (token == "W_DOWN" && player) {
+        client.upHeld = true;
+    }
+    else if (token == "W_UP" && player) {
+        client.upHeld = false;
+    }
+    else if (token == "S_DOWN" && player) {
+        client.downHeld = true;
+    }
+    else if (token == "S_UP" && player) {
+        client.downHeld = false;
+    }
+    else if (token == "CON_CLOSE") {
+        client.closed = true;
+    }
+    else if (token == "TAKE_OVER" && !player) {
+        assignRole(client, true);
+    }
+    else if (token == "CONFIRM") {
+        client.confirmed = true;
+        if (client.checkSentAt != 0) {
+            uint64_t elapsed = SDL_GetPerformanceCounter() - client.checkSentAt;
+            checkRtt.add(elapsed * 1000000 / SDL_GetPerformanceFrequency());
+            client.checkSentAt = 0;
+        }
+    }
+    else if (token == "PING" && i + 1 < tokens.size()) {
+        std::string reply = "PONG,";
+        reply.append(tokens[++i]);
+        sendTo(client, reply);
+    }
+    else if (token == WIRE_REQUEST) {
+        client.binary = true;
+        sendTo(client, std::string("WIRE,") + WIRE_ACCEPT);
+    }
+    else if (token == "ACK" && i + 1 < tokens.size()) {
+        int ack;
+        if (toInt(tokens[++i], ack)) {
+            client.ackSeq = (uint16_t)ack;
+            client.acked = true;
+        }
+    }
+}
+
+/**
+ * One server update: active check, countdown, movement and the GAME_DATA broadcast.
+ * @param dt seconds since the last tick.
+ */
+void StandInServer::tick(float dt) {
+    Uint32 now = SDL_GetTicks();
+
+    if (now >= nextCheck) {
+        for (auto& c : clients) {
+            if (!c->confirmed) {
+                std::cout << "No reply from connection. Terminating." << std::endl;
+                c->closed = true;
+                continue;
+            }
+            c->confirmed = false;
+            c->checkSentAt = SDL_GetPerformanceCounter();
+            sendTo(*c, "CONN_CHECK");
+        }
+        nextCheck = now + config.checkInterval;
+    }
+
+    bool matchReady = (players[0] != nullptr && players[1] != nullptr) || (config.autoplay && !clients.empty());
+    if (!matchReady) {
+        ballMoving = false;
+        countdown = -1;
+    }
+    else if (!ballMoving && countdown < 0) {
+        countdown = 3;
+        countdownAt = now;
+    }
+
+    if (countdown >= 0 && now >= countdownAt) {
+        broadcast("COUNT," + std::to_string(countdown));
+        if (countdown == 0) {
+            ballMoving = true;
+        }
+        countdown--;
+        countdownAt += 1000;
+    }
+
+    simulate(dt);
+    broadcastSnapshot();
+
+    if (score[0] >= WIN_SCORE || score[1] >= WIN_SCORE) {
+        resetMatch();
+    }
+}
+
+void StandInServer::simulate(float dt) {
+    for (int i = 0; i < 2; i++) {
+        int dir = 0;
+        if (players[i] != nullptr) {
+            dir = batDirection(players[i]->upHeld, players[i]->downHeld);
+        }
+        else if (config.autoplay) {
+            float target = ballY + BALL_SIZE / 2 - BAT_HEIGHT / 2;
+            dir = target > batY[i] + 4 ? 1 : (target < batY[i] - 4 ? -1 : 0);
+        }
+        batY[i] = moveBat(batY[i], dir, dt);
+    }
+
+    if (!ballMoving) {
+        return;
+    }
+    ballX += ballVX * dt;
+    ballY += ballVY * dt;
+
+    if (ballY < 0) {
+        ballY = 0;
+        ballVY = -ballVY;
+        broadcast("HIT_WALL_UP");
+    }
+    else if (ballY > APP_HEIGHT - BALL_SIZE) {
+        ballY = APP_HEIGHT - BALL_SIZE;
+        ballVY = -ballVY;
+        broadcast("HIT_WALL_DOWN");
+    }
+
+    if (ballX < 0) {
+        ballX = 0;
+        ballVX = -ballVX;
+        score[1]++;
+        broadcast("HIT_WALL_LEFT," + std::to_string(score[0]) + "," + std::to_string(score[1]));
+    }
+    else if (ballX > APP_WIDTH - BALL_SIZE) {
+        ballX = APP_WIDTH - BALL_SIZE;
+        ballVX = -ballVX;
+        score[0]++;
+        broadcast("HIT_WALL_RIGHT," + std::to_string(score[0]) + "," + std::to_string(score[1]));
+    }
+
+    for (int i = 0; i < 2; i++) {
+        bool movingTowards = (i == 0) ? ballVX < 0 : ballVX > 0;
+        bool overlaps = ballX < BAT_X[i] + BAT_WIDTH && ballX + BALL_SIZE > BAT_X[i]
+            && ballY < batY[i] + BAT_HEIGHT && ballY + BALL_SIZE > batY[i];
+        if (movingTowards && overlaps) {
+            ballVX = -ballVX;
+            broadcast(i == 0 ? "BALL_HIT_BAT1" : "BALL_HIT_BAT2");
+        }
+    }
+}
+
+/**
+ * Appends a position the way Java's Double.toString does for the values seen here ("270.0").
+ * @param out the message being built.
+ * @param value the position to append.
+ */
+static void appendJavaDouble(std::string& out, float value) {
+    char text[32];
+    std::to_chars_result result = std::to_chars(text, text + sizeof(text), (double)value);
+    std::string_view written(text, result.ptr - text);
+    out.append(written);
+    if (written.find('.') == std::string_view::npos) {
+        out.append(".0");
+    }
+}
+
+/**
+ * Sends this tick's positions to every client, as ASCII GAME_DATA or as a binary snapshot
+ * delta encoded against the last one that client acknowledged.
+ */
+void StandInServer::broadcastSnapshot() {
+    Snapshot snap;
+    snap.seq = seq++;
+    snap.fields[SNAP_P1_Y] = (int16_t)batY[0];
+    snap.fields[SNAP_P2_Y] = (int16_t)batY[1];
+    snap.fields[SNAP_BALL_X] = (int16_t)ballX;
+    snap.fields[SNAP_BALL_Y] = (int16_t)ballY;
+    snap.fields[SNAP_P1_INPUT] = players[0] != nullptr ? (int16_t)players[0]->inputSeq : 0;
+    snap.fields[SNAP_P2_INPUT] = players[1] != nullptr ? (int16_t)players[1]->inputSeq : 0;
+    snap.win = score[0] >= WIN_SCORE ? 1 : (score[1] >= WIN_SCORE ? 2 : 0);
+    history[snap.seq % SNAPSHOT_HISTORY] = snap;
+
+    std::string ascii = "GAME_DATA,";
+    appendJavaDouble(ascii, batY[0]);
+    ascii += ",";
+    appendJavaDouble(ascii, batY[1]);
+    ascii += ",";
+    appendJavaDouble(ascii, ballX);
+    ascii += ",";
+    appendJavaDouble(ascii, ballY);
+    ascii += "," + std::to_string(snap.win) + "WIN,";
+    ascii += std::to_string((uint16_t)snap.fields[SNAP_P1_INPUT]) + "," + std::to_string((uint16_t)snap.fields[SNAP_P2_INPUT]);
+
+    char binary[MAX_SNAPSHOT_SIZE];
+    size_t keyLength = encodeKeySnapshot(snap, binary, sizeof(binary));
+    std::string key(binary, keyLength);
+
+    for (auto& c : clients) {
+        if (c->closed) {
+            continue;
+        }
+        if (!c->binary) {
+            sendTo(*c, ascii);
+            continue;
+        }
+        const Snapshot& base = history[c->ackSeq % SNAPSHOT_HISTORY];
+        size_t length = 0;
+        if (c->acked && (uint16_t)(snap.seq - c->ackSeq) < SNAPSHOT_HISTORY && base.seq == c->ackSeq) {
+            length = encodeDeltaSnapshot(snap, base, binary, sizeof(binary));
+        }
+        if (length > 0) {
+            sendTo(*c, std::string_view(binary, length));
+        }
+        else {
+            sendTo(*c, key);
+        }
+    }
+}
+
+void StandInServer::resetMatch() {
+    score[0] = 0;
+    score[1] = 0;
+    batY[0] = APP_HEIGHT / 2 - BAT_HEIGHT / 2;
+    batY[1] = APP_HEIGHT / 2 - BAT_HEIGHT / 2;
+    ballX = APP_WIDTH / 2 - 5;
+    ballY = APP_HEIGHT / 2 - 5;
+    ballVX = (std::rand() % 2) ? BALL_SPEED : -BALL_SPEED;
+    ballVY = (std::rand() % 2) ? BALL_SPEED : -BALL_SPEED;
+    ballMoving = false;
+    countdown = -1;
+}
+
+/**
+ * Sends one message. Over UDP, snapshots go on the unreliable channel, where a lost one is
+ * simply replaced by the next, and everything else on the reliable channel.
+ */
+void StandInServer::sendTo(Client& client, std::string_view payload) {
+    if (client.udp) {
+        if (isBinarySnapshot(payload) || payload.substr(0, 9) == "GAME_DATA") {
+            char datagram[MAX_DATAGRAM];
+            size_t length = client.session.packUnreliable(payload, datagram, sizeof(datagram));
+            if (length > 0) {
+                transmit(client, datagram, length);
+            }
+        }
+        else if (client.session.queueReliable(payload)) {
+            pumpSession(client);
+        }
+        else {
+            client.closed = true;
+        }
+        return;
+    }
+
+    char frame[FRAME_HEADER_SIZE + 512];
+    size_t length = encodeFrame(frame, sizeof(frame), payload);
+    if (length > 0) {
+        transmit(client, frame, length);
+    }
+}
+
+/**
+ * Sends a frame or datagram through the simulated link, if there is one.
+ */
+void StandInServer::transmit(Client& client, const char* bytes, size_t length) {
+    if (client.outbound.isActive()) {
+        client.outbound.push(std::string_view(bytes, length), SDL_GetTicks());
+        return;
+    }
+    write(client, bytes, length);
+}
+
+void StandInServer::write(Client& client, const char* bytes, size_t length) {
+    if (client.udp) {
+        memcpy(packet->data, bytes, length);
+        packet->len = (int)length;
+        packet->address = client.address;
+        SDLNet_UDP_Send(udpSocket, -1, packet);
+    }
+    else if (SDLNet_TCP_Send(client.socket, bytes, (int)length) < (int)length) {
+        client.closed = true;
+        return;
+    }
+    bytesSent += length;
+}
+
+void StandInServer::broadcast(std::string_view payload) {
+    for (auto& c : clients) {
+        if (!c->closed) {
+            sendTo(*c, payload);
+        }
+    }
+}
+
+/**
+ * Drops clients that closed or failed, freeing their player slot and pausing the match as PongApp does.
+ */
+void StandInServer::removeClosed() {
+    for (size_t i = 0; i < clients.size();) {
+        Client* c = clients[i].get();
+        if (!c->closed) {
+            i++;
+            continue;
+        }
+        for (int p = 0; p < 2; p++) {
+            if (players[p] == c) {
+                players[p] = nullptr;
+                ballMoving = false;
+                countdown = -1;
+            }
+        }
+        if (c->udp) {
+            udpClients.erase(addressKey(c->address));
+        }
+        else {
+            SDLNet_TCP_DelSocket(socketSet, c->socket);
+            SDLNet_TCP_Close(c->socket);
+        }
+        clients.erase(clients.begin() + i);
+    }
+}
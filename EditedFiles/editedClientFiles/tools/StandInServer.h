@@ -0,0 +1,121 @@
+#ifndef __STAND_IN_SERVER_H__
+#define __STAND_IN_SERVER_H__
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "SDL_net.h"
+
+#include "Framing.h"
+#include "Histogram.h"
+#include "LinkSimulator.h"
+#include "Message.h"
+#include "Snapshot.h"
+#include "UdpSession.h"
+
+//Settings for the stand-in server.
+struct StandInConfig {
+    Uint16 port = 55555;
+    int tickRate = 60; //GAME_DATA messages per second
+    int maxClients = 1024;
+    bool autoplay = false; //bats follow the ball when no player controls them, so spectators see a live match
+    bool udp = false; //also accept clients over UDP on the same port
+    LinkConfig link; //latency, jitter and loss simulated in each direction, e.g. to test prediction or compare transports
+    Uint32 checkInterval = 5000; //ms between CONN_CHECKs, as in PongApp.activeCheck
+};
+
+//Offline C++ stand-in for the Java Pong server. Speaks the same protocol on loopback, including
+//the optional binary snapshot mode, so the client can be tested and measured without the JVM.
+//Optionally also serves the UDP transport, which the Java server does not have.
+class StandInServer {
+    private:
+        struct Client {
+            TCPsocket socket = nullptr; //null for UDP clients
+            bool udp = false;
+            IPaddress address; //UDP clients only
+            UdpSession session; //UDP clients only
+            FrameReader reader;
+            LinkSimulator outbound; //frames or datagrams waiting for their simulated arrival at the client
+            LinkSimulator inbound; //frames or datagrams waiting for their simulated arrival here
+            int role = 3; //1 or 2 for players, 3 for spectators
+            bool binary = false; //client asked for binary snapshots
+            bool acked = false; //client has acknowledged at least one snapshot
+            uint16_t ackSeq = 0; //last snapshot acknowledged
+            bool upHeld = false;
+            bool downHeld = false;
+            uint16_t inputSeq = 0; //last input applied, echoed in GAME_DATA for prediction
+            bool confirmed = true; //replied to the last CONN_CHECK
+            uint64_t checkSentAt = 0; //performance counter when the last CONN_CHECK was sent
+            bool closed = false;
+
+            Client(const LinkConfig& link, bool udp, uint32_t seed)
+                : udp(udp), outbound(link, !udp, seed), inbound(link, !udp, seed ^ 0x5bd1e995u) {}
+        };
+
+        StandInConfig config;
+        TCPsocket listener = nullptr;
+        UDPsocket udpSocket = nullptr;
+        UDPpacket* packet = nullptr; //reused for every datagram sent and received
+        SDLNet_SocketSet socketSet = nullptr;
+        std::vector<std::unique_ptr<Client>> clients;
+        std::unordered_map<uint64_t, Client*> udpClients; //by address
+        uint32_t nextSeed = 1;
+        std::vector<std::string> delivered; //messages released by a UDP session
+        Client* players[2] = { nullptr, nullptr };
+
+        float batY[2];
+        float ballX, ballY, ballVX, ballVY;
+        int score[2] = { 0, 0 };
+        bool ballMoving = false;
+        int countdown = -1; //next COUNT value to send, -1 when not counting down
+        Uint32 countdownAt = 0; //time the next COUNT is due
+
+        Snapshot history[SNAPSHOT_HISTORY]; //snapshots sent, for delta encoding
+        uint16_t seq = 0;
+        Uint32 nextCheck = 0;
+
+        std::atomic<bool> running;
+        std::atomic<uint64_t> bytesSent;
+        Histogram checkRtt; //CONN_CHECK to CONFIRM, including any simulated latency
+
+        void accept();
+        void receive(Client& client);
+        void receiveDatagrams();
+        void handleDatagram(Client& client, std::string_view datagram);
+        void handleMessage(Client& client, std::string_view payload);
+        void handleToken(Client& client, const MessageArgs& tokens, size_t& i);
+        void flushDelayed(Uint32 now);
+        void pumpSession(Client& client);
+        void transmit(Client& client, const char* bytes, size_t length);
+        void write(Client& client, const char* bytes, size_t length);
+        void tick(float dt);
+        void simulate(float dt);
+        void broadcastSnapshot();
+        void resetMatch();
+        void assignRole(Client& client, bool takeOver);
+        void sendTo(Client& client, std::string_view payload);
+        void broadcast(std::string_view payload);
+        void removeClosed();
+
+    public:
+        StandInServer();
+        ~StandInServer();
+
+        bool start(const StandInConfig& settings);
+        void run();
+        void stop();
+
+        uint64_t getBytesSent() const {
+            return bytesSent.load();
+        }
+        //Only safe once run() has returned.
+        const Histogram& getCheckRtt() const {
+            return checkRtt;
+        }
+};
+
+#endif
@@ -44,6 +44,7 @@ import javafx.scene.paint.Color;
 import javafx.util.Duration;
 
 import java.io.*;
+import java.nio.charset.StandardCharsets;
 
 import java.util.*;
 import java.util.concurrent.ArrayBlockingQueue;
@@ -79,6 +80,7 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
 
     private Server<String> server;
     private Connection player1Conn, player2Conn; //Connections that have been assigned player1 or player2
+    private int player1Input = 0, player2Input = 0; //Sequence number of the last input applied for each player
     private ArrayList<Connection> activeConnList = new ArrayList<>(); //The connections that are still active
     private BlockingQueue<Connection> confirmed = new ArrayBlockingQueue<>(25); //The connections that have confirmed they are still active
 
@@ -289,7 +291,8 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
     /**
      * Game Logic update loop.
      * Changes made: Remove any terminated connections from the 'active' array. Append relevant win
-     * message to information sent to Client. Initiate counter if not already & ball velocity 0 and
+     * message to information sent to Client, followed by the last input applied for each player so
+     * Clients can reconcile their predicted bat. Initiate counter if not already & ball velocity 0 and
      * both players present. Pause game if both players are not present and reset game if win met.
      * @param tpf
      */
@@ -307,6 +310,7 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
             } else {
                 message += ",0WIN,";
             }
+            message += player1Input + "," + player2Input;
 
             sendToActive(message); //replaces server.broadcast(message);
 
@@ -413,19 +417,50 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
      * Handle messages sent by Client.
      * Changes made: Check connection control and mock key presses accordingly. Terminate connection if
      * informed that it is exiting. Reconfigure connection-entity association for control take over.
-     * Inform timeoutCheck that connection is confirmed via the confirmed BlockingQueue.
+     * Inform timeoutCheck that connection is confirmed via the confirmed BlockingQueue. Every token of
+     * the message is handled, and a number following a key token is recorded as that player's input
+     * sequence number. PING is answered with PONG and the same number, for measuring round trip time.
      * @param connection The connection that has sent the message.
      * @param message The message that has been sent.
      */
     @Override
     public void onReceive(Connection<String> connection, String message) {
-        KeyCode key;
         var tokens = message.split(","); //separation of message
 
-        key = KeyCode.valueOf(tokens[1].substring(0, 1));
+        for (int i = 1; i < tokens.length; i++) {
+            String token = tokens[i];
+            int seq = -1;
+
+            if (i + 1 < tokens.length && tokens[i + 1].matches("\\d+")) {
+                seq = Integer.parseInt(tokens[++i]);
+            }
+
+            handleToken(connection, token, seq);
+        }
+    }
+
+    /**
+     * Handle a single token of a message sent by Client.
+     * @param connection The connection that has sent the message.
+     * @param token The token to handle.
+     * @param seq The number that followed the token, or -1 if there was none.
+     */
+    private void handleToken(Connection<String> connection, String token, int seq) {
+        KeyCode key;
+        boolean keyToken = token.endsWith("_DOWN") || token.endsWith("_UP");
+
+        if (token.equals("PING")) {
+            connection.send("PONG," + seq);
+            return;
+        }
+
+        key = KeyCode.valueOf(token.substring(0, 1));
 
         if (connection.getConnectionNum() == player1Conn.getConnectionNum()) {
             //we don't want to switch the keys to mock on server in this situation
+            if (seq >= 0 && keyToken) {
+                player1Input = seq;
+            }
         } else if (connection.getConnectionNum() == player2Conn.getConnectionNum()) {
             if (key == KeyCode.W) {
                 key = KeyCode.I;
@@ -433,17 +468,20 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
             if (key == KeyCode.S) {
                 key = KeyCode.K;
             }
+            if (seq >= 0 && keyToken) {
+                player2Input = seq;
+            }
         } else {
             key = KeyCode.Q; //arbitrary key so spectators can't control a player
         }
 
-        if (tokens[1].endsWith("_DOWN")) {
+        if (token.endsWith("_DOWN")) {
             getInput().mockKeyPress(key);
-        } else if (tokens[1].endsWith("_UP")) {
+        } else if (token.endsWith("_UP")) {
             getInput().mockKeyRelease(key);
         }
 
-        if (tokens[1].equals("CON_CLOSE")) {
+        if (token.equals("CON_CLOSE")) {
             System.out.println("Terminating:");
             connection.terminate();
             if (connection == player1Conn) {
@@ -454,7 +492,7 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
             }
         }
 
-        if (tokens[1].equals("TAKE_OVER")) {
+        if (token.equals("TAKE_OVER")) {
             if (!player1Conn.isConnected()) {
                 player1Conn = connection;
                 connection.send("ROLE,1");
@@ -464,7 +502,7 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
             }
         }
 
-        if (tokens[1].equals("CONFIRM")) {
+        if (token.equals("CONFIRM")) {
             try {
                 confirmed.put(connection);
             } catch (InterruptedException e) {
@@ -489,51 +527,61 @@ public class PongApp extends GameApplication implements MessageHandler<String> {
 
     /**
      * Handles outgoing messages.
-     * Changes made: N/A
+     * Changes made: Each message is written as a 2 byte big-endian length followed by its bytes, so the
+     * Client can find message boundaries no matter how TCP splits or merges the stream.
      */
     static class MessageWriterS implements TCPMessageWriter<String> {
 
-        private OutputStream os;
-        private PrintWriter out;
+        // Longest payload the 2 byte length can describe, the same limit as the Client's MAX_FRAME_PAYLOAD
+        static final int MAX_PAYLOAD = 0xFFFF;
+
+        private DataOutputStream out;
 
         MessageWriterS(OutputStream os) {
-            this.os = os;
-            out = new PrintWriter(os, true);
+            out = new DataOutputStream(new BufferedOutputStream(os));
         }
 
         @Override
-        public void write(String s) throws Exception {
-            out.print(s.toCharArray());
+        public synchronized void write(String s) throws Exception {
+            byte[] payload = s.getBytes(StandardCharsets.US_ASCII);
+            if (payload.length > MAX_PAYLOAD) {
+                // writeShort would wrap the length and the Client would lose track of every message after it
+                throw new IllegalArgumentException("Message of " + payload.length + " bytes is longer than a frame can hold");
+            }
+            out.writeShort(payload.length);
+            out.write(payload);
             out.flush();
         }
     }
 
     /**
      * Handles incoming messages.
-     * Changes made: N/A
+     * Changes made: Reads length-prefixed messages in the same format as MessageWriterS, rather than
+     * treating each read of the stream as one message.
      */
     static class MessageReaderS implements TCPMessageReader<String> {
 
         private BlockingQueue<String> messages = new ArrayBlockingQueue<>(50);
 
-        private InputStreamReader in;
+        private DataInputStream in;
 
         MessageReaderS(InputStream is) {
-            in =  new InputStreamReader(is);
+            in = new DataInputStream(new BufferedInputStream(is));
             var t = new Thread(() -> {
                 try {
+                    while (true) {
+                        int len = in.readUnsignedShort();
+                        byte[] buf = new byte[len];
+                        in.readFully(buf);
 
-                    char[] buf = new char[36];
-
-                    int len;
-
-                    while ((len = in.read(buf)) > 0) {
-                        var message = new String(Arrays.copyOf(buf, len));
+                        var message = new String(buf, StandardCharsets.US_ASCII);
 
                         System.out.println("Recv message: " + message);
 
                         messages.put(message);
                     }
+                } catch (EOFException e) {
+                    //connection closed
                 } catch (Exception e) {
                     e.printStackTrace();
                 }